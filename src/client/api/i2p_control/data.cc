@@ -416,6 +416,12 @@ const std::string I2PControlDataTraits::MethodRouterInfo::GetTrait(
         return "i2p.router.net.tunnels.inbound.list";
       case TunnelsOutList:
         return "i2p.router.net.tunnels.outbound.list";
+      case DHKeysPoolEmpty:
+        return "i2p.router.net.dhkeys.poolempty";
+      case TunnelsDropped:
+        return "i2p.router.net.tunnels.queue.dropped";
+      case NetDbDropped:
+        return "i2p.router.netdb.queue.dropped";
       case Unknown:
         return "";
     }
@@ -485,6 +491,15 @@ std::uint8_t I2PControlDataTraits::MethodRouterInfo::GetTrait(
   else if (value == GetTrait(TunnelsOutList))
     return TunnelsOutList;
 
+  else if (value == GetTrait(DHKeysPoolEmpty))
+    return DHKeysPoolEmpty;
+
+  else if (value == GetTrait(TunnelsDropped))
+    return TunnelsDropped;
+
+  else if (value == GetTrait(NetDbDropped))
+    return NetDbDropped;
+
   return Unknown;
 }
 
@@ -527,6 +542,9 @@ void I2PControlDataTraits::MethodRouterInfo::ParseResponse(const ptree& tree)
           case KnownPeers:
           case Floodfills:
           case LeaseSets:
+          case DHKeysPoolEmpty:
+          case TunnelsDropped:
+          case NetDbDropped:
             Set(option, pair.second.get_value<std::size_t>());
             break;
 
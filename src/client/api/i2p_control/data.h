@@ -238,6 +238,9 @@ struct I2PControlDataTraits
       TunnelsCreationSuccessRate,
       TunnelsInList,
       TunnelsOutList,
+      DHKeysPoolEmpty,
+      TunnelsDropped,
+      NetDbDropped,
       Unknown,
     };
     Method Which() const
@@ -318,6 +318,22 @@ void I2PControlSession::HandleRouterInfo(
             HandleTunnelsOutList(response);
             break;
 
+          case RouterInfo::DHKeysPoolEmpty:
+            response->SetParam(
+                pair.first,
+                static_cast<std::size_t>(
+                    core::transports.GetNumDHKeysPairsEmpty()));
+            break;
+
+          case RouterInfo::TunnelsDropped:
+            response->SetParam(
+                pair.first, core::tunnels.GetNumDroppedMsgs());
+            break;
+
+          case RouterInfo::NetDbDropped:
+            response->SetParam(pair.first, core::netdb.GetNumDroppedMsgs());
+            break;
+
           case RouterInfo::BWIn15S:
           case RouterInfo::BWOut15S:
           case RouterInfo::FastPeers:
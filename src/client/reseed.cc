@@ -96,12 +96,20 @@ bool Reseed::Start() {
     LOG(error) << "Reseed: SU3 implementation failed";
     return false;
   }
-  // Insert extracted RI's into NetDb
-  for (auto const& router : su3.m_RouterInfos)
-    if (!xi2p::core::netdb.AddRouterInfo(
-          router.second.data(),
-          router.second.size()))
+  // Insert extracted RI's into NetDb, verified as one batch
+  std::vector<xi2p::core::NetDb::RouterInfoBuffer> routers;
+  for (auto const& router : su3.m_RouterInfos) {
+    xi2p::core::IdentityEx identity;
+    if (!identity.FromBuffer(router.second.data(), router.second.size())) {
+      LOG(error) << "Reseed: unable to add router info";
       return false;
+    }
+    routers.emplace_back(identity.GetIdentHash(), router.second);
+  }
+  if (!xi2p::core::netdb.AddRouterInfos(routers)) {
+    LOG(error) << "Reseed: no valid RouterInfo found";
+    return false;
+  }
   LOG(info) << "Reseed: implementation successful";
   return true;
 }
@@ -58,6 +58,14 @@ bool HasAESNI();
 /// @return True we are using AES-NI, false if not
 bool UsingAESNI();
 
+/// @brief Checks for VAES (AES-NI on 256-bit AVX registers) support
+/// @return True if supported along with AVX2 and enabled by the OS
+bool HasVAES();
+
+/// @brief Returns result of VAES check, only set when using AES-NI
+/// @note Used for runtime selection of the multi-block kernels
+bool UsingVAES();
+
 struct CipherBlock {
   std::uint8_t buf[16];
   void operator^=(const CipherBlock& other) {  // XOR
@@ -144,6 +152,11 @@ class ECBEncryption {
       const CipherBlock* in,
       CipherBlock* out);
 
+  void Encrypt(
+      int num_blocks,
+      const CipherBlock* in,
+      CipherBlock* out);
+
  private:
   class ECBEncryptionImpl;
   std::unique_ptr<ECBEncryptionImpl> m_ECBEncryptionPimpl;
@@ -164,6 +177,11 @@ class ECBDecryption {
       const CipherBlock* in,
       CipherBlock* out);
 
+  void Decrypt(
+      int num_blocks,
+      const CipherBlock* in,
+      CipherBlock* out);
+
  private:
   class ECBDecryptionImpl;
   std::unique_ptr<ECBDecryptionImpl> m_ECBDecryptionPimpl;
@@ -33,13 +33,46 @@
 #ifndef SRC_CORE_CRYPTO_ELGAMAL_H_
 #define SRC_CORE_CRYPTO_ELGAMAL_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 
 namespace xi2p {
 namespace core {
 
+/// @class ElGamalEphemeralSupplier
+/// @brief Precomputes ephemeral ElGamal keys (k, g^k) on a background thread
+/// @details Encryption takes a fresh ephemeral key for every message and
+///   only computes y^k itself. When the supplier isn't running or has run
+///   dry, g^k is computed inline from the fixed-base table instead.
+class ElGamalEphemeralSupplier {
+ public:
+  /// @brief Default number of ephemeral keys kept ready
+  static const std::size_t DefaultSize = 64;
+
+  ElGamalEphemeralSupplier();
+  ~ElGamalEphemeralSupplier();
+
+  /// @param size Number of ephemeral keys kept ready
+  void Start(
+      std::size_t size = DefaultSize);
+
+  void Stop();
+
+  /// @return Number of ephemeral keys ready
+  std::size_t GetNumReady() const;
+
+ private:
+  friend class ElGamalEncryption;
+  class ElGamalEphemeralSupplierImpl;
+  std::unique_ptr<ElGamalEphemeralSupplierImpl> m_ElGamalEphemeralSupplierPimpl;
+};
+
+/// @brief Supplier which all ElGamalEncryption instances take ephemeral keys from
+ElGamalEphemeralSupplier& GetElGamalEphemeralSupplier();
+
 /// @class ElGamalEncryption
+/// @note A fresh ephemeral key is used for every Encrypt call
 class ElGamalEncryption {
  public:
   ElGamalEncryption(
@@ -47,9 +47,13 @@ namespace core {
 /// @brief Used for runtime AES-NI
 static bool g_HasAESNI(false);
 
+/// @brief Used for runtime VAES
+static bool g_HasVAES(false);
+
 /// @note Initialize once to avoid repeated tests for AES-NI
 void SetupAESNI() {
   g_HasAESNI = HasAESNI();
+  g_HasVAES = g_HasAESNI && HasVAES();
 }
 
 /// @note Used for runtime AES-NI
@@ -57,6 +61,11 @@ bool UsingAESNI() {
   return g_HasAESNI;
 }
 
+/// @note Used for runtime VAES
+bool UsingVAES() {
+  return g_HasVAES;
+}
+
 /// TODO(unassigned): if we switch libraries, we should move AES-NI elsewhere.
 /// TODO(unassigned): ARM support? MSVC x86-64 support?
 bool HasAESNI() {
@@ -78,6 +87,39 @@ bool HasAESNI() {
   return false;
 }
 
+bool HasVAES() {
+// Without WITH_VAES, the assembler could not build the VAES kernels
+#if (defined(__x86_64__) || defined(_M_X64)) && defined(WITH_VAES)
+  unsigned int eax, ebx, ecx, edx;
+  LOG(debug) << "Crypto: checking for VAES...";
+  // AVX must be enabled by the OS (OSXSAVE, XCR0 SSE and AVX state)
+  __asm__ __volatile__(
+      "cpuid"
+      : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+      : "a"(1), "c"(0));
+  const unsigned int osxsave_avx = (1 << 27) | (1 << 28);
+  if ((ecx & osxsave_avx) != osxsave_avx)
+    return false;
+  __asm__ __volatile__(
+      "xgetbv"
+      : "=a"(eax), "=d"(edx)
+      : "c"(0));
+  if ((eax & 0x06) != 0x06)
+    return false;
+  // EBX bit 5 for AVX2, ECX bit 9 for VAES
+  __asm__ __volatile__(
+      "cpuid"
+      : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+      : "a"(7), "c"(0));
+  if ((ebx & (1 << 5)) && (ecx & (1 << 9))) {
+    LOG(debug) << "Crypto: VAES is available!";
+    return true;
+  }
+#endif
+  LOG(debug) << "Crypto: VAES is not available";
+  return false;
+}
+
 /// @class ECBCryptoAESNI
 /// @brief AES-NI base class for ECB
 class ECBCryptoAESNI {
@@ -129,6 +171,275 @@ class ECBCryptoAESNI {
   AESAlignedBuffer<AESSize::ExpandedKey> m_KeySchedule;
 };
 
+#if defined(__x86_64__) || defined(_M_X64)  // TODO(unassigned): hack until we implement ARM AES-NI
+/**
+ *
+ * Multi-block kernels
+ *
+ * ECB and CBC decryption have no dependency between blocks: eight blocks
+ * go through the rounds together, the remaining ones one at a time.
+ * in and out may be the same buffer.
+ *
+ */
+
+static void EncryptECBx8(
+    const std::uint8_t* sched,
+    int num_blocks,
+    const CipherBlock* in,
+    CipherBlock* out) {
+  __asm__ __volatile__(
+      "cmp $8, %[num] \n"
+      "jb 2f \n"
+      "1: \n"
+      LoadBlocks8(in)
+      EncryptAES256x8(sched)
+      StoreBlocks8(out)
+      "add $128, %[in] \n"
+      "add $128, %[out] \n"
+      "sub $8, %[num] \n"
+      "cmp $8, %[num] \n"
+      "jae 1b \n"
+      "2: \n"
+      "test %[num], %[num] \n"
+      "jz 4f \n"
+      "3: \n"
+      "movups (%[in]), %%xmm0 \n"
+      EncryptAES256(sched)
+      "movups %%xmm0, (%[out]) \n"
+      "add $16, %[in] \n"
+      "add $16, %[out] \n"
+      "dec %[num] \n"
+      "jnz 3b \n"
+      "4: \n"
+      : [in]"+r"(in), [out]"+r"(out), [num]"+r"(num_blocks)
+      : [sched]"r"(sched)
+      : "%xmm0", "%xmm8", "%xmm9", "%xmm10", "%xmm11",
+        "%xmm12", "%xmm13", "%xmm14", "%xmm15", "cc", "memory");
+}
+
+#ifdef WITH_VAES
+static void EncryptECBVAESx8(
+    const std::uint8_t* sched,
+    int num_blocks,
+    const CipherBlock* in,
+    CipherBlock* out) {
+  __asm__ __volatile__(
+      "cmp $8, %[num] \n"
+      "jb 2f \n"
+      "1: \n"
+      VLoadBlocks8(in)
+      VEncryptAES256x8(sched)
+      VStoreBlocks8(out)
+      "add $128, %[in] \n"
+      "add $128, %[out] \n"
+      "sub $8, %[num] \n"
+      "cmp $8, %[num] \n"
+      "jae 1b \n"
+      "2: \n"
+      "vzeroupper \n"
+      "test %[num], %[num] \n"
+      "jz 4f \n"
+      "3: \n"
+      "movups (%[in]), %%xmm0 \n"
+      EncryptAES256(sched)
+      "movups %%xmm0, (%[out]) \n"
+      "add $16, %[in] \n"
+      "add $16, %[out] \n"
+      "dec %[num] \n"
+      "jnz 3b \n"
+      "4: \n"
+      : [in]"+r"(in), [out]"+r"(out), [num]"+r"(num_blocks)
+      : [sched]"r"(sched)
+      : "%xmm0", "%xmm8", "%xmm9", "%xmm10", "%xmm11", "cc", "memory");
+}
+#endif
+
+static void DecryptECBx8(
+    const std::uint8_t* sched,
+    int num_blocks,
+    const CipherBlock* in,
+    CipherBlock* out) {
+  __asm__ __volatile__(
+      "cmp $8, %[num] \n"
+      "jb 2f \n"
+      "1: \n"
+      LoadBlocks8(in)
+      DecryptAES256x8(sched)
+      StoreBlocks8(out)
+      "add $128, %[in] \n"
+      "add $128, %[out] \n"
+      "sub $8, %[num] \n"
+      "cmp $8, %[num] \n"
+      "jae 1b \n"
+      "2: \n"
+      "test %[num], %[num] \n"
+      "jz 4f \n"
+      "3: \n"
+      "movups (%[in]), %%xmm0 \n"
+      DecryptAES256(sched)
+      "movups %%xmm0, (%[out]) \n"
+      "add $16, %[in] \n"
+      "add $16, %[out] \n"
+      "dec %[num] \n"
+      "jnz 3b \n"
+      "4: \n"
+      : [in]"+r"(in), [out]"+r"(out), [num]"+r"(num_blocks)
+      : [sched]"r"(sched)
+      : "%xmm0", "%xmm8", "%xmm9", "%xmm10", "%xmm11",
+        "%xmm12", "%xmm13", "%xmm14", "%xmm15", "cc", "memory");
+}
+
+#ifdef WITH_VAES
+static void DecryptECBVAESx8(
+    const std::uint8_t* sched,
+    int num_blocks,
+    const CipherBlock* in,
+    CipherBlock* out) {
+  __asm__ __volatile__(
+      "cmp $8, %[num] \n"
+      "jb 2f \n"
+      "1: \n"
+      VLoadBlocks8(in)
+      VDecryptAES256x8(sched)
+      VStoreBlocks8(out)
+      "add $128, %[in] \n"
+      "add $128, %[out] \n"
+      "sub $8, %[num] \n"
+      "cmp $8, %[num] \n"
+      "jae 1b \n"
+      "2: \n"
+      "vzeroupper \n"
+      "test %[num], %[num] \n"
+      "jz 4f \n"
+      "3: \n"
+      "movups (%[in]), %%xmm0 \n"
+      DecryptAES256(sched)
+      "movups %%xmm0, (%[out]) \n"
+      "add $16, %[in] \n"
+      "add $16, %[out] \n"
+      "dec %[num] \n"
+      "jnz 3b \n"
+      "4: \n"
+      : [in]"+r"(in), [out]"+r"(out), [num]"+r"(num_blocks)
+      : [sched]"r"(sched)
+      : "%xmm0", "%xmm8", "%xmm9", "%xmm10", "%xmm11", "cc", "memory");
+}
+#endif
+
+// XORs decrypted block in reg with the ciphertext preceding it. Blocks are
+// finished from last to first so that an in-place store never overwrites
+// a ciphertext which is still needed.
+#define CBCFinishBlock(reg, offset) \
+  "movups "#offset"-16(%[in]), %%xmm0 \n" \
+  "pxor %%xmm0, %%"#reg" \n" \
+  "movups %%"#reg", "#offset"(%[out]) \n"
+
+static void DecryptCBCx8(
+    const std::uint8_t* sched,
+    CipherBlock* iv,
+    int num_blocks,
+    const CipherBlock* in,
+    CipherBlock* out) {
+  __asm__ __volatile__(
+      "movups (%[iv]), %%xmm1 \n"
+      "cmp $8, %[num] \n"
+      "jb 2f \n"
+      "1: \n"
+      LoadBlocks8(in)
+      "movaps %%xmm15, %%xmm2 \n"  // next IV
+      DecryptAES256x8(sched)
+      CBCFinishBlock(xmm15, 112)
+      CBCFinishBlock(xmm14, 96)
+      CBCFinishBlock(xmm13, 80)
+      CBCFinishBlock(xmm12, 64)
+      CBCFinishBlock(xmm11, 48)
+      CBCFinishBlock(xmm10, 32)
+      CBCFinishBlock(xmm9, 16)
+      "pxor %%xmm1, %%xmm8 \n"
+      "movups %%xmm8, (%[out]) \n"
+      "movaps %%xmm2, %%xmm1 \n"
+      "add $128, %[in] \n"
+      "add $128, %[out] \n"
+      "sub $8, %[num] \n"
+      "cmp $8, %[num] \n"
+      "jae 1b \n"
+      "2: \n"
+      "test %[num], %[num] \n"
+      "jz 4f \n"
+      "3: \n"
+      "movups (%[in]), %%xmm0 \n"
+      "movaps %%xmm0, %%xmm2 \n"
+      DecryptAES256(sched)
+      "pxor %%xmm1, %%xmm0 \n"
+      "movups %%xmm0, (%[out]) \n"
+      "movaps %%xmm2, %%xmm1 \n"
+      "add $16, %[in] \n"
+      "add $16, %[out] \n"
+      "dec %[num] \n"
+      "jnz 3b \n"
+      "4: \n"
+      "movups %%xmm1, (%[iv]) \n"
+      : [in]"+r"(in), [out]"+r"(out), [num]"+r"(num_blocks)
+      : [sched]"r"(sched), [iv]"r"(iv)
+      : "%xmm0", "%xmm1", "%xmm2", "%xmm8", "%xmm9", "%xmm10", "%xmm11",
+        "%xmm12", "%xmm13", "%xmm14", "%xmm15", "cc", "memory");
+}
+
+#ifdef WITH_VAES
+static void DecryptCBCVAESx8(
+    const std::uint8_t* sched,
+    CipherBlock* iv,
+    int num_blocks,
+    const CipherBlock* in,
+    CipherBlock* out) {
+  __asm__ __volatile__(
+      "movups (%[iv]), %%xmm1 \n"
+      "cmp $8, %[num] \n"
+      "jb 2f \n"
+      "1: \n"
+      VLoadBlocks8(in)
+      // preceding ciphertexts, loaded before anything is stored
+      "vinserti128 $1, (%[in]), %%ymm1, %%ymm12 \n"
+      "vmovdqu 16(%[in]), %%ymm13 \n"
+      "vmovdqu 48(%[in]), %%ymm14 \n"
+      "vmovdqu 80(%[in]), %%ymm15 \n"
+      "vextracti128 $1, %%ymm11, %%xmm1 \n"  // next IV
+      VDecryptAES256x8(sched)
+      "vpxor %%ymm12, %%ymm8, %%ymm8 \n"
+      "vpxor %%ymm13, %%ymm9, %%ymm9 \n"
+      "vpxor %%ymm14, %%ymm10, %%ymm10 \n"
+      "vpxor %%ymm15, %%ymm11, %%ymm11 \n"
+      VStoreBlocks8(out)
+      "add $128, %[in] \n"
+      "add $128, %[out] \n"
+      "sub $8, %[num] \n"
+      "cmp $8, %[num] \n"
+      "jae 1b \n"
+      "2: \n"
+      "vzeroupper \n"
+      "test %[num], %[num] \n"
+      "jz 4f \n"
+      "3: \n"
+      "movups (%[in]), %%xmm0 \n"
+      "movaps %%xmm0, %%xmm2 \n"
+      DecryptAES256(sched)
+      "pxor %%xmm1, %%xmm0 \n"
+      "movups %%xmm0, (%[out]) \n"
+      "movaps %%xmm2, %%xmm1 \n"
+      "add $16, %[in] \n"
+      "add $16, %[out] \n"
+      "dec %[num] \n"
+      "jnz 3b \n"
+      "4: \n"
+      "movups %%xmm1, (%[iv]) \n"
+      : [in]"+r"(in), [out]"+r"(out), [num]"+r"(num_blocks)
+      : [sched]"r"(sched), [iv]"r"(iv)
+      : "%xmm0", "%xmm1", "%xmm2", "%xmm8", "%xmm9", "%xmm10", "%xmm11",
+        "%xmm12", "%xmm13", "%xmm14", "%xmm15", "cc", "memory");
+}
+#endif
+#endif
+
 /**
  *
  * ECB Encryption
@@ -175,6 +486,24 @@ class ECBEncryption::ECBEncryptionImpl : public ECBCryptoAESNI {
     }
   }
 
+  void Encrypt(
+      int num_blocks,
+      const CipherBlock* in,
+      CipherBlock* out) {
+    if (UsingAESNI()) {
+#if defined(__x86_64__) || defined(_M_X64)  // TODO(unassigned): hack until we implement ARM AES-NI
+#ifdef WITH_VAES
+      if (UsingVAES())
+        EncryptECBVAESx8(GetKeySchedule(), num_blocks, in, out);
+      else
+#endif
+        EncryptECBx8(GetKeySchedule(), num_blocks, in, out);
+#endif
+    } else {
+      m_Encryption.ProcessData(out->buf, in->buf, num_blocks * 16);
+    }
+  }
+
  private:
   CryptoPP::ECB_Mode<CryptoPP::AES>::Encryption m_Encryption;
 };
@@ -200,6 +529,13 @@ void ECBEncryption::Encrypt(
   m_ECBEncryptionPimpl->Encrypt(in, out);
 }
 
+void ECBEncryption::Encrypt(
+    int num_blocks,
+    const CipherBlock* in,
+    CipherBlock* out) {
+  m_ECBEncryptionPimpl->Encrypt(num_blocks, in, out);
+}
+
 /**
  *
  * ECB Decryption
@@ -264,6 +600,24 @@ class ECBDecryption::ECBDecryptionImpl : public ECBCryptoAESNI {
     }
   }
 
+  void Decrypt(
+      int num_blocks,
+      const CipherBlock* in,
+      CipherBlock* out) {
+    if (UsingAESNI()) {
+#if defined(__x86_64__) || defined(_M_X64)  // TODO(unassigned): hack until we implement ARM AES-NI
+#ifdef WITH_VAES
+      if (UsingVAES())
+        DecryptECBVAESx8(GetKeySchedule(), num_blocks, in, out);
+      else
+#endif
+        DecryptECBx8(GetKeySchedule(), num_blocks, in, out);
+#endif
+    } else {
+      m_Decryption.ProcessData(out->buf, in->buf, num_blocks * 16);
+    }
+  }
+
  private:
   CryptoPP::ECB_Mode<CryptoPP::AES>::Decryption m_Decryption;
 };
@@ -289,6 +643,13 @@ void ECBDecryption::Decrypt(
   m_ECBDecryptionPimpl->Decrypt(in, out);
 }
 
+void ECBDecryption::Decrypt(
+    int num_blocks,
+    const CipherBlock* in,
+    CipherBlock* out) {
+  m_ECBDecryptionPimpl->Decrypt(num_blocks, in, out);
+}
+
 /**
  *
  * CBC Encryption
@@ -479,24 +840,14 @@ class CBCDecryption::CBCDecryptionImpl {
       CipherBlock* out) {
     if (UsingAESNI()) {
 #if defined(__x86_64__) || defined(_M_X64)  // TODO(unassigned): hack until we implement ARM AES-NI
-      __asm__(
-        "movups (%[iv]), %%xmm1 \n"
-        "1: \n"
-        "movups (%[in]), %%xmm0 \n"
-        "movaps %%xmm0, %%xmm2 \n"
-        DecryptAES256(sched)
-        "pxor %%xmm1, %%xmm0 \n"
-        "movups %%xmm0, (%[out]) \n"
-        "movaps %%xmm2, %%xmm1 \n"
-        "add $16, %[in] \n"
-        "add $16, %[out] \n"
-        "dec %[num] \n"
-        "jnz 1b \n"
-        "movups %%xmm1, (%[iv]) \n"
-        :
-        : [iv]"r"(&m_IV), [sched]"r"(m_ECBDecryption.GetKeySchedule ()),
-          [in]"r"(in), [out]"r"(out), [num]"r"(num_blocks)
-        : "%xmm0", "%xmm1", "%xmm2", "cc", "memory");
+#ifdef WITH_VAES
+      if (UsingVAES())
+        DecryptCBCVAESx8(
+            m_ECBDecryption.GetKeySchedule(), &m_IV, num_blocks, in, out);
+      else
+#endif
+        DecryptCBCx8(
+            m_ECBDecryption.GetKeySchedule(), &m_IV, num_blocks, in, out);
 #endif
     } else {
       for (int i = 0; i < num_blocks; i++) {
@@ -90,6 +90,167 @@
   "aesdec 16(%["#sched"]), %%xmm0 \n" \
   "aesdeclast (%["#sched"]), %%xmm0 \n"
 
+// Multi-block kernels: eight independent blocks are kept in flight so that
+// the aesenc/aesdec latency is hidden. AES-NI uses xmm8-xmm15, VAES uses
+// ymm8-ymm11 with two blocks each. The round key is loaded into xmm0/ymm0.
+
+#define AES256Round8(sched, offset, op) \
+  "movaps "#offset"(%["#sched"]), %%xmm0 \n" \
+  #op" %%xmm0, %%xmm8 \n" \
+  #op" %%xmm0, %%xmm9 \n" \
+  #op" %%xmm0, %%xmm10 \n" \
+  #op" %%xmm0, %%xmm11 \n" \
+  #op" %%xmm0, %%xmm12 \n" \
+  #op" %%xmm0, %%xmm13 \n" \
+  #op" %%xmm0, %%xmm14 \n" \
+  #op" %%xmm0, %%xmm15 \n"
+
+#define EncryptAES256x8(sched) \
+  AES256Round8(sched, 0, pxor) \
+  AES256Round8(sched, 16, aesenc) \
+  AES256Round8(sched, 32, aesenc) \
+  AES256Round8(sched, 48, aesenc) \
+  AES256Round8(sched, 64, aesenc) \
+  AES256Round8(sched, 80, aesenc) \
+  AES256Round8(sched, 96, aesenc) \
+  AES256Round8(sched, 112, aesenc) \
+  AES256Round8(sched, 128, aesenc) \
+  AES256Round8(sched, 144, aesenc) \
+  AES256Round8(sched, 160, aesenc) \
+  AES256Round8(sched, 176, aesenc) \
+  AES256Round8(sched, 192, aesenc) \
+  AES256Round8(sched, 208, aesenc) \
+  AES256Round8(sched, 224, aesenclast)
+
+#define DecryptAES256x8(sched) \
+  AES256Round8(sched, 224, pxor) \
+  AES256Round8(sched, 208, aesdec) \
+  AES256Round8(sched, 192, aesdec) \
+  AES256Round8(sched, 176, aesdec) \
+  AES256Round8(sched, 160, aesdec) \
+  AES256Round8(sched, 144, aesdec) \
+  AES256Round8(sched, 128, aesdec) \
+  AES256Round8(sched, 112, aesdec) \
+  AES256Round8(sched, 96, aesdec) \
+  AES256Round8(sched, 80, aesdec) \
+  AES256Round8(sched, 64, aesdec) \
+  AES256Round8(sched, 48, aesdec) \
+  AES256Round8(sched, 32, aesdec) \
+  AES256Round8(sched, 16, aesdec) \
+  AES256Round8(sched, 0, aesdeclast)
+
+#define LoadBlocks8(in) \
+  "movups (%["#in"]), %%xmm8 \n" \
+  "movups 16(%["#in"]), %%xmm9 \n" \
+  "movups 32(%["#in"]), %%xmm10 \n" \
+  "movups 48(%["#in"]), %%xmm11 \n" \
+  "movups 64(%["#in"]), %%xmm12 \n" \
+  "movups 80(%["#in"]), %%xmm13 \n" \
+  "movups 96(%["#in"]), %%xmm14 \n" \
+  "movups 112(%["#in"]), %%xmm15 \n"
+
+#define StoreBlocks8(out) \
+  "movups %%xmm8, (%["#out"]) \n" \
+  "movups %%xmm9, 16(%["#out"]) \n" \
+  "movups %%xmm10, 32(%["#out"]) \n" \
+  "movups %%xmm11, 48(%["#out"]) \n" \
+  "movups %%xmm12, 64(%["#out"]) \n" \
+  "movups %%xmm13, 80(%["#out"]) \n" \
+  "movups %%xmm14, 96(%["#out"]) \n" \
+  "movups %%xmm15, 112(%["#out"]) \n"
+
+#define VAES256Round8(sched, offset, op) \
+  "vbroadcasti128 "#offset"(%["#sched"]), %%ymm0 \n" \
+  #op" %%ymm0, %%ymm8, %%ymm8 \n" \
+  #op" %%ymm0, %%ymm9, %%ymm9 \n" \
+  #op" %%ymm0, %%ymm10, %%ymm10 \n" \
+  #op" %%ymm0, %%ymm11, %%ymm11 \n"
+
+#define VEncryptAES256x8(sched) \
+  VAES256Round8(sched, 0, vpxor) \
+  VAES256Round8(sched, 16, vaesenc) \
+  VAES256Round8(sched, 32, vaesenc) \
+  VAES256Round8(sched, 48, vaesenc) \
+  VAES256Round8(sched, 64, vaesenc) \
+  VAES256Round8(sched, 80, vaesenc) \
+  VAES256Round8(sched, 96, vaesenc) \
+  VAES256Round8(sched, 112, vaesenc) \
+  VAES256Round8(sched, 128, vaesenc) \
+  VAES256Round8(sched, 144, vaesenc) \
+  VAES256Round8(sched, 160, vaesenc) \
+  VAES256Round8(sched, 176, vaesenc) \
+  VAES256Round8(sched, 192, vaesenc) \
+  VAES256Round8(sched, 208, vaesenc) \
+  VAES256Round8(sched, 224, vaesenclast)
+
+#define VDecryptAES256x8(sched) \
+  VAES256Round8(sched, 224, vpxor) \
+  VAES256Round8(sched, 208, vaesdec) \
+  VAES256Round8(sched, 192, vaesdec) \
+  VAES256Round8(sched, 176, vaesdec) \
+  VAES256Round8(sched, 160, vaesdec) \
+  VAES256Round8(sched, 144, vaesdec) \
+  VAES256Round8(sched, 128, vaesdec) \
+  VAES256Round8(sched, 112, vaesdec) \
+  VAES256Round8(sched, 96, vaesdec) \
+  VAES256Round8(sched, 80, vaesdec) \
+  VAES256Round8(sched, 64, vaesdec) \
+  VAES256Round8(sched, 48, vaesdec) \
+  VAES256Round8(sched, 32, vaesdec) \
+  VAES256Round8(sched, 16, vaesdec) \
+  VAES256Round8(sched, 0, vaesdeclast)
+
+#define VLoadBlocks8(in) \
+  "vmovdqu (%["#in"]), %%ymm8 \n" \
+  "vmovdqu 32(%["#in"]), %%ymm9 \n" \
+  "vmovdqu 64(%["#in"]), %%ymm10 \n" \
+  "vmovdqu 96(%["#in"]), %%ymm11 \n"
+
+#define VStoreBlocks8(out) \
+  "vmovdqu %%ymm8, (%["#out"]) \n" \
+  "vmovdqu %%ymm9, 32(%["#out"]) \n" \
+  "vmovdqu %%ymm10, 64(%["#out"]) \n" \
+  "vmovdqu %%ymm11, 96(%["#out"]) \n"
+
+// Lane kernels: eight messages, each with its own key, advance one block per
+// step in xmm8-xmm15. Round keys of the lanes are interleaved, 128 bytes per
+// round, and lane pointers are offset by %[off].
+
+#define AES256LaneRound8(ks, round, op) \
+  #op" "#round"*128(%["#ks"]), %%xmm8 \n" \
+  #op" "#round"*128+16(%["#ks"]), %%xmm9 \n" \
+  #op" "#round"*128+32(%["#ks"]), %%xmm10 \n" \
+  #op" "#round"*128+48(%["#ks"]), %%xmm11 \n" \
+  #op" "#round"*128+64(%["#ks"]), %%xmm12 \n" \
+  #op" "#round"*128+80(%["#ks"]), %%xmm13 \n" \
+  #op" "#round"*128+96(%["#ks"]), %%xmm14 \n" \
+  #op" "#round"*128+112(%["#ks"]), %%xmm15 \n"
+
+#define EncryptAES256Lanes8(ks) \
+  AES256LaneRound8(ks, 0, pxor) \
+  AES256LaneRound8(ks, 1, aesenc) \
+  AES256LaneRound8(ks, 2, aesenc) \
+  AES256LaneRound8(ks, 3, aesenc) \
+  AES256LaneRound8(ks, 4, aesenc) \
+  AES256LaneRound8(ks, 5, aesenc) \
+  AES256LaneRound8(ks, 6, aesenc) \
+  AES256LaneRound8(ks, 7, aesenc) \
+  AES256LaneRound8(ks, 8, aesenc) \
+  AES256LaneRound8(ks, 9, aesenc) \
+  AES256LaneRound8(ks, 10, aesenc) \
+  AES256LaneRound8(ks, 11, aesenc) \
+  AES256LaneRound8(ks, 12, aesenc) \
+  AES256LaneRound8(ks, 13, aesenc) \
+  AES256LaneRound8(ks, 14, aesenclast)
+
+#define LoadLane(ptrs, lane, reg) \
+  "mov "#lane"*8(%["#ptrs"]), %%rax \n" \
+  "movups (%%rax,%[off]), %%xmm"#reg" \n"
+
+#define StoreLane(ptrs, lane, reg) \
+  "mov "#lane"*8(%["#ptrs"]), %%rax \n" \
+  "movups %%xmm"#reg", (%%rax,%[off]) \n"
+
 #define CallAESIMC(offset) \
   "movaps "#offset"(%[shed]), %%xmm0 \n"  \
   "aesimc %%xmm0, %%xmm0 \n" \
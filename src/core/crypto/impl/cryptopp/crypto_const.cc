@@ -32,6 +32,9 @@
 
 #include "crypto_const.h"
 
+#include <cryptopp/eprecomp.h>
+#include <cryptopp/modexppc.h>
+
 #include <inttypes.h>
 
 namespace xi2p {
@@ -94,5 +97,28 @@ const CryptoConstants& GetCryptoConstants() {
   return cryptoConstants;
 }
 
+namespace {
+/// @brief Exponent bits covered by the fixed-base table
+const unsigned int ElGamalBaseExponentBits = 2048;
+/// @brief Number of precomputed powers of g, 256 bytes each
+const unsigned int ElGamalBaseStorage = 64;
+}  // namespace
+
+CryptoPP::Integer ElGamalExponentiateBase(
+    const CryptoPP::Integer& e) {
+  // Montgomery arithmetic keeps a workspace, so each thread has its own
+  // group while the table itself is shared read-only
+  thread_local CryptoPP::ModExpPrecomputation group(elgp);
+  static const CryptoPP::DL_FixedBasePrecomputationImpl<CryptoPP::Integer>
+    base = [] {
+      CryptoPP::ModExpPrecomputation group(elgp);
+      CryptoPP::DL_FixedBasePrecomputationImpl<CryptoPP::Integer> base;
+      base.SetBase(group, elgg);
+      base.Precompute(group, ElGamalBaseExponentBits, ElGamalBaseStorage);
+      return base;
+    }();
+  return base.Exponentiate(group, e);
+}
+
 }  // namespace core
 }  // namespace xi2p
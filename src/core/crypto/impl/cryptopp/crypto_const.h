@@ -51,6 +51,14 @@ struct CryptoConstants {
 
 const CryptoConstants& GetCryptoConstants();
 
+/// @brief g^e mod p for the ElGamal/Diffie-Hellman generator
+/// @details Uses a table of precomputed powers of g, built on first use,
+///   so that only a fraction of the squarings of a plain exponentiation remain
+/// @param e Exponent, at most 2048 bits
+/// @note Thread-safe
+CryptoPP::Integer ElGamalExponentiateBase(
+    const CryptoPP::Integer& e);
+
 // ElGamal/Diffie-Hellman
 #define elgp GetCryptoConstants().elgp
 #define elgg GetCryptoConstants().elgg
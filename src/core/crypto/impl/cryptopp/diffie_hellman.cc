@@ -54,7 +54,13 @@ class DiffieHellman::DiffieHellmanImpl {
   void GenerateKeyPair(
       std::uint8_t* private_key,
       std::uint8_t* public_key) {
-    m_DH.GenerateKeyPair(m_PRNG, private_key, public_key);
+    // As CryptoPP::DH would, but g^x comes from the fixed-base table
+    CryptoPP::Integer x(
+        m_PRNG,
+        CryptoPP::Integer::One(),
+        m_DH.GetGroupParameters().GetMaxExponent());
+    x.Encode(private_key, m_DH.PrivateKeyLength());
+    ElGamalExponentiateBase(x).Encode(public_key, m_DH.PublicKeyLength());
   }
 
   /// @brief Agreed value from your private key and other party's public key
@@ -33,10 +33,14 @@
 #include "core/crypto/elgamal.h"
 
 #include <cryptopp/integer.h>
-#include <cryptopp/osrng.h>
 #include <cryptopp/sha.h>
 
 #include <array>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
 
 #include "crypto_const.h"
 
@@ -48,25 +52,150 @@
 namespace xi2p {
 namespace core {
 
+namespace {
+/// @brief Ephemeral key k and a = g^k
+struct ElGamalEphemeral {
+  CryptoPP::Integer k, a;
+};
+}  // namespace
+
+/// @class ElGamalEphemeralSupplierImpl
+/// @brief Keeps a queue of ephemeral keys topped up, like DHKeysPairSupplier
+class ElGamalEphemeralSupplier::ElGamalEphemeralSupplierImpl {
+ public:
+  ElGamalEphemeralSupplierImpl()
+      : m_Size(0),
+        m_IsRunning(false) {}
+
+  ~ElGamalEphemeralSupplierImpl() {
+    Stop();
+  }
+
+  void Start(
+      std::size_t size) {
+    if (m_Thread)
+      return;
+    m_Size = size;
+    m_IsRunning = true;
+    m_Thread =
+      std::make_unique<std::thread>(
+          std::bind(
+              &ElGamalEphemeralSupplierImpl::Run,
+              this));
+  }
+
+  void Stop() {
+    {
+      std::unique_lock<std::mutex> l(m_QueueMutex);
+      m_IsRunning = false;
+    }
+    m_Acquired.notify_one();
+    if (m_Thread) {
+      m_Thread->join();
+      m_Thread.reset(nullptr);
+    }
+  }
+
+  std::size_t GetNumReady() const {
+    std::unique_lock<std::mutex> l(m_QueueMutex);
+    return m_Queue.size();
+  }
+
+  /// @return Precomputed ephemeral key, or one computed inline if none is ready
+  ElGamalEphemeral Acquire() {
+    {
+      std::unique_lock<std::mutex> l(m_QueueMutex);
+      if (!m_Queue.empty()) {
+        ElGamalEphemeral ephemeral = std::move(m_Queue.front());
+        m_Queue.pop();
+        m_Acquired.notify_one();
+        return ephemeral;
+      }
+    }
+    return Create();
+  }
+
+ private:
+  static ElGamalEphemeral Create() {
+    ElGamalEphemeral ephemeral;
+    // k in [1, p - 1] from the per-thread generator, rejection is as rare
+    // as p is close to 2^2048
+    std::array<std::uint8_t, 256> bytes;
+    do {
+      RandBytes(bytes.data(), bytes.size());
+      ephemeral.k.Decode(bytes.data(), bytes.size());
+    } while (ephemeral.k.IsZero() || ephemeral.k >= elgp);
+    bytes.fill(0);
+    ephemeral.a = ElGamalExponentiateBase(ephemeral.k);
+    return ephemeral;
+  }
+
+  void Run() {
+    try {
+      std::unique_lock<std::mutex> l(m_QueueMutex);
+      while (m_IsRunning) {
+        if (m_Queue.size() < m_Size) {
+          l.unlock();
+          ElGamalEphemeral ephemeral = Create();
+          l.lock();
+          m_Queue.push(std::move(ephemeral));
+        } else {
+          m_Acquired.wait(l);  // wait for an ephemeral key to be acquired
+        }
+      }
+    } catch (const std::exception& ex) {
+      // encryption falls back to computing ephemeral keys inline
+      LOG(error) << "ElGamalEphemeralSupplier: " << __func__ << " exception: " << ex.what();
+    }
+  }
+
+ private:
+  std::size_t m_Size;
+  bool m_IsRunning;
+  std::queue<ElGamalEphemeral> m_Queue;
+  mutable std::mutex m_QueueMutex;
+  std::condition_variable m_Acquired;
+  std::unique_ptr<std::thread> m_Thread;
+};
+
+ElGamalEphemeralSupplier::ElGamalEphemeralSupplier()
+    : m_ElGamalEphemeralSupplierPimpl(
+          std::make_unique<ElGamalEphemeralSupplierImpl>()) {}
+
+ElGamalEphemeralSupplier::~ElGamalEphemeralSupplier() {}
+
+void ElGamalEphemeralSupplier::Start(
+    std::size_t size) {
+  m_ElGamalEphemeralSupplierPimpl->Start(size);
+}
+
+void ElGamalEphemeralSupplier::Stop() {
+  m_ElGamalEphemeralSupplierPimpl->Stop();
+}
+
+std::size_t ElGamalEphemeralSupplier::GetNumReady() const {
+  return m_ElGamalEphemeralSupplierPimpl->GetNumReady();
+}
+
+ElGamalEphemeralSupplier& GetElGamalEphemeralSupplier() {
+  static ElGamalEphemeralSupplier supplier;
+  return supplier;
+}
+
 /// @class ElGamalEncryptionImpl
 /// @brief ElGamal encryption
 class ElGamalEncryption::ElGamalEncryptionImpl {
  public:
   ElGamalEncryptionImpl(
-      const std::uint8_t* key) {
-    CryptoPP::AutoSeededRandomPool prng;
-    CryptoPP::Integer
-      y(key, 256),
-      k(prng, CryptoPP::Integer::One(), elgp - 1);
-    a = a_exp_b_mod_c(elgg, k, elgp);
-    b1 = a_exp_b_mod_c(y, k, elgp);
-  }
+      const std::uint8_t* key)
+      : y(key, 256) {}
 
   void Encrypt(
       const std::uint8_t* data,
       std::size_t len,
       std::uint8_t* encrypted,
-      bool zeroPadding) const {
+      bool zeroPadding,
+      const ElGamalEphemeral& ephemeral) const {
     if (len > 222) {
       // Bad size, will overflow
       throw std::logic_error(
@@ -84,25 +213,26 @@ class ElGamalEncryption::ElGamalEncryptionImpl {
         memory.data() + 1,
         memory.data() + 33,
         222);
+    // g^k is precomputed, only y^k depends on the recipient
     CryptoPP::Integer b(
         a_times_b_mod_c(
-            b1,
+            a_exp_b_mod_c(y, ephemeral.k, elgp),
             CryptoPP::Integer(memory.data(), 255),
             elgp));
     // Copy a and b
     if (zeroPadding) {
       encrypted[0] = 0;
-      a.Encode(encrypted + 1, 256);
+      ephemeral.a.Encode(encrypted + 1, 256);
       encrypted[257] = 0;
       b.Encode(encrypted + 258, 256);
     } else {
-      a.Encode(encrypted, 256);
+      ephemeral.a.Encode(encrypted, 256);
       b.Encode(encrypted + 256, 256);
     }
   }
 
  private:
-  CryptoPP::Integer a, b1;
+  CryptoPP::Integer y;
 };
 
 ElGamalEncryption::ElGamalEncryption(
@@ -117,7 +247,12 @@ void ElGamalEncryption::Encrypt(
     std::size_t len,
     std::uint8_t* encrypted,
     bool zeroPadding) const {
-  m_ElGamalEncryptionPimpl->Encrypt(data, len, encrypted, zeroPadding);
+  m_ElGamalEncryptionPimpl->Encrypt(
+      data,
+      len,
+      encrypted,
+      zeroPadding,
+      GetElGamalEphemeralSupplier().m_ElGamalEphemeralSupplierPimpl->Acquire());
 }
 
 // ElGamal decryption
@@ -156,10 +291,8 @@ void GenerateElGamalKeyPair(
     std::uint8_t* pub) {
 #if defined(__x86_64__) || defined(__i386__) || defined(_MSC_VER)
   RandBytes(priv, 256);
-  a_exp_b_mod_c(
-      elgg,
-      CryptoPP::Integer(priv, 256),
-      elgp).Encode(pub, 256);
+  ElGamalExponentiateBase(
+      CryptoPP::Integer(priv, 256)).Encode(pub, 256);
 #else
     DiffieHellman().GenerateKeyPair(priv, pub);
 #endif
@@ -30,23 +30,147 @@
 
 #include "core/crypto/rand.h"
 
+#include <cryptopp/aes.h>
+#include <cryptopp/modes.h>
 #include <cryptopp/osrng.h>
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
 namespace xi2p {
 namespace core {
 
+namespace {
+
+/// @brief Incremented in the child of each fork, so that threads of the
+///   child reseed rather than repeat the output of the parent
+std::atomic<std::uint32_t> g_ForkGeneration{0};
+
+/// @class DRBG
+/// @brief Per-thread AES-256-CTR generator, seeded by the OS
+/// @details Keystream is generated a buffer at a time and handed out from
+///   the buffer, so that most requests are a copy. After each refill the
+///   generator is rekeyed from its own keystream (fast key erasure), and
+///   bytes are wiped once handed out, so that a later compromise of the
+///   state does not reveal earlier output. The key is reseeded from the OS
+///   periodically and after a fork.
+class DRBG {
+ public:
+  enum Size : std::size_t {
+    Key = 32,
+    IV = 16,
+    Buffer = 4096,
+    /// @brief Bytes generated between reseeds from the OS
+    ReseedInterval = 1 << 20,
+  };
+
+  DRBG() : m_Available(0), m_Generated(0), m_ForkGeneration(0) {
+#ifndef _WIN32
+    static std::once_flag once;
+    std::call_once(once, [] {
+      pthread_atfork(nullptr, nullptr, [] {
+        g_ForkGeneration.fetch_add(1, std::memory_order_relaxed);
+      });
+    });
+#endif
+    Reseed();
+  }
+
+  ~DRBG() {
+    std::memset(m_Buffer.data(), 0, m_Buffer.size());
+  }
+
+  void Generate(
+      std::uint8_t* data,
+      std::size_t length) {
+    if (m_Generated >= Size::ReseedInterval
+        || m_ForkGeneration
+            != g_ForkGeneration.load(std::memory_order_relaxed))
+      Reseed();
+    m_Generated += length;
+    while (length) {
+      if (!m_Available)
+        Refill();
+      std::size_t const size = std::min(length, m_Available);
+      // Handed out from the end, so that the rest stays contiguous
+      std::uint8_t* bytes =
+          m_Buffer.data() + Size::Key + Size::IV + m_Available - size;
+      std::memcpy(data, bytes, size);
+      std::memset(bytes, 0, size);
+      m_Available -= size;
+      data += size;
+      length -= size;
+    }
+  }
+
+ private:
+  void Refill() {
+    std::memset(m_Buffer.data(), 0, m_Buffer.size());
+    m_Cipher.ProcessData(m_Buffer.data(), m_Buffer.data(), m_Buffer.size());
+    // The first bytes become the next key and are never handed out
+    m_Cipher.SetKeyWithIV(m_Buffer.data(), Size::Key, m_Buffer.data() + Size::Key);
+    std::memset(m_Buffer.data(), 0, Size::Key + Size::IV);
+    m_Available = Size::Buffer - Size::Key - Size::IV;
+  }
+
+  void Reseed() {
+    std::array<std::uint8_t, Size::Key + Size::IV> seed;
+    CryptoPP::OS_GenerateRandomBlock(false, seed.data(), seed.size());
+    m_Cipher.SetKeyWithIV(seed.data(), Size::Key, seed.data() + Size::Key);
+    std::memset(seed.data(), 0, seed.size());
+    // Bytes generated with the previous key are dropped
+    std::memset(m_Buffer.data(), 0, m_Buffer.size());
+    m_Available = 0;
+    m_Generated = 0;
+    m_ForkGeneration = g_ForkGeneration.load(std::memory_order_relaxed);
+  }
+
+ private:
+  CryptoPP::CTR_Mode<CryptoPP::AES>::Encryption m_Cipher;
+  std::array<std::uint8_t, Size::Buffer> m_Buffer;
+  std::size_t m_Available, m_Generated;
+  std::uint32_t m_ForkGeneration;
+};
+
+DRBG& GetDRBG() {
+  thread_local DRBG drbg;
+  return drbg;
+}
+
+}  // namespace
+
 void RandBytes(
     std::uint8_t* dataptr,
     std::size_t datalen) {
-  CryptoPP::AutoSeededRandomPool prng;
-  prng.GenerateBlock(dataptr, datalen);
+  GetDRBG().Generate(dataptr, datalen);
 }
 
 std::uint32_t RandInRange32(
     std::uint32_t min,
     std::uint32_t max) {
-  CryptoPP::AutoSeededRandomPool prng;
-  return prng.GenerateWord32(min, max);
+  if (min > max)
+    throw std::invalid_argument("RandInRange32: min is greater than max");
+  std::uint32_t const range = max - min;
+  // Rejection sampling under the smallest mask covering the range,
+  // so that no value is more likely than another
+  std::uint32_t mask = range;
+  mask |= mask >> 1;
+  mask |= mask >> 2;
+  mask |= mask >> 4;
+  mask |= mask >> 8;
+  mask |= mask >> 16;
+  std::uint32_t value;
+  do {
+    value = Rand<std::uint32_t>() & mask;
+  } while (value > range);
+  return min + value;
 }
 
 }  // namespace core
@@ -32,6 +32,9 @@
 
 #include "core/crypto/tunnel.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "aesni_macros.h"
 
 #include "core/router/tunnel/base.h"
@@ -39,6 +42,119 @@
 namespace xi2p {
 namespace core {
 
+#if defined(__x86_64__) || defined(_M_X64)  // TODO(unassigned): hack until we implement ARM AES-NI
+
+/// @brief Number of messages interleaved by TunnelEncryption::EncryptBatch()
+const std::size_t TUNNEL_CRYPTO_NUM_LANES = 8;
+
+/// @brief Size of the round keys of all lanes, 15 AES-256 rounds per lane
+const std::size_t TUNNEL_CRYPTO_LANES_SCHEDULE_SIZE =
+  15 * 16 * TUNNEL_CRYPTO_NUM_LANES;
+
+/// @brief CBC over eight messages at once, one block of each per step
+/// @param ks Round keys of the lanes, see InterleaveKeySchedules()
+/// @param ivs IV of each lane, updated to continue the chains
+/// @param in Input of each lane, advanced by 16 bytes per block
+/// @param out Output of each lane, may be the same as the input
+static void EncryptCBCLanes8(
+    const std::uint8_t* ks,
+    CipherBlock* ivs,
+    const std::uint8_t* const* in,
+    std::uint8_t* const* out,
+    int num_blocks) {
+  std::size_t off = 0;
+  __asm__ __volatile__(
+      "movups (%[ivs]), %%xmm8 \n"
+      "movups 16(%[ivs]), %%xmm9 \n"
+      "movups 32(%[ivs]), %%xmm10 \n"
+      "movups 48(%[ivs]), %%xmm11 \n"
+      "movups 64(%[ivs]), %%xmm12 \n"
+      "movups 80(%[ivs]), %%xmm13 \n"
+      "movups 96(%[ivs]), %%xmm14 \n"
+      "movups 112(%[ivs]), %%xmm15 \n"
+      "1: \n"
+      LoadLane(in, 0, 0) "pxor %%xmm0, %%xmm8 \n"
+      LoadLane(in, 1, 0) "pxor %%xmm0, %%xmm9 \n"
+      LoadLane(in, 2, 0) "pxor %%xmm0, %%xmm10 \n"
+      LoadLane(in, 3, 0) "pxor %%xmm0, %%xmm11 \n"
+      LoadLane(in, 4, 0) "pxor %%xmm0, %%xmm12 \n"
+      LoadLane(in, 5, 0) "pxor %%xmm0, %%xmm13 \n"
+      LoadLane(in, 6, 0) "pxor %%xmm0, %%xmm14 \n"
+      LoadLane(in, 7, 0) "pxor %%xmm0, %%xmm15 \n"
+      EncryptAES256Lanes8(ks)
+      StoreLane(out, 0, 8)
+      StoreLane(out, 1, 9)
+      StoreLane(out, 2, 10)
+      StoreLane(out, 3, 11)
+      StoreLane(out, 4, 12)
+      StoreLane(out, 5, 13)
+      StoreLane(out, 6, 14)
+      StoreLane(out, 7, 15)
+      "add $16, %[off] \n"
+      "dec %[num] \n"
+      "jnz 1b \n"
+      "movups %%xmm8, (%[ivs]) \n"
+      "movups %%xmm9, 16(%[ivs]) \n"
+      "movups %%xmm10, 32(%[ivs]) \n"
+      "movups %%xmm11, 48(%[ivs]) \n"
+      "movups %%xmm12, 64(%[ivs]) \n"
+      "movups %%xmm13, 80(%[ivs]) \n"
+      "movups %%xmm14, 96(%[ivs]) \n"
+      "movups %%xmm15, 112(%[ivs]) \n"
+      : [off]"+r"(off), [num]"+r"(num_blocks)
+      : [ks]"r"(ks), [ivs]"r"(ivs), [in]"r"(in), [out]"r"(out)
+      : "%rax", "%xmm0", "%xmm8", "%xmm9", "%xmm10", "%xmm11",
+        "%xmm12", "%xmm13", "%xmm14", "%xmm15", "cc", "memory");
+}
+
+/// @brief Lays out the round keys of all lanes round by round
+static void InterleaveKeySchedules(
+    const std::uint8_t* const* scheds,
+    std::uint8_t* ks) {
+  for (std::size_t round = 0; round < 15; round++)
+    for (std::size_t lane = 0; lane < TUNNEL_CRYPTO_NUM_LANES; lane++)
+      memcpy(
+          ks + (round * TUNNEL_CRYPTO_NUM_LANES + lane) * 16,
+          scheds[lane] + round * 16,
+          16);
+}
+
+/// @brief Runs the double IV scheme on eight messages at once
+static void EncryptTunnelLanes(
+    const std::uint8_t* iv_ks,
+    const std::uint8_t* layer_ks,
+    const std::uint8_t* const* in,
+    std::uint8_t* const* out) {
+  // ECB of the IV is CBC of a single block with a zero IV
+  CipherBlock ivs[TUNNEL_CRYPTO_NUM_LANES] {};
+  EncryptCBCLanes8(iv_ks, ivs, in, out, 1);
+  const std::uint8_t* data_in[TUNNEL_CRYPTO_NUM_LANES];
+  std::uint8_t* data_out[TUNNEL_CRYPTO_NUM_LANES];
+  for (std::size_t lane = 0; lane < TUNNEL_CRYPTO_NUM_LANES; lane++) {
+    memcpy(ivs[lane].buf, out[lane], 16);
+    data_in[lane] = in[lane] + 16;
+    data_out[lane] = out[lane] + 16;
+  }
+  EncryptCBCLanes8(
+      layer_ks,
+      ivs,
+      data_in,
+      data_out,
+      xi2p::core::TUNNEL_DATA_ENCRYPTED_SIZE / 16);
+  memset(ivs, 0, sizeof(ivs));
+  EncryptCBCLanes8(iv_ks, ivs, out, out, 1);  // double iv
+}
+
+/// @brief Scratch message for lanes left over when a batch isn't a multiple
+///   of the number of lanes
+static std::uint8_t* GetPaddingLane() {
+  alignas(16) static thread_local std::uint8_t padding[
+    16 + xi2p::core::TUNNEL_DATA_ENCRYPTED_SIZE];
+  return padding;
+}
+
+#endif
+
 /// @class TunnelEncryptionImpl
 /// @brief Tunnel encryption implementation
 class TunnelEncryption::TunnelEncryptionImpl {
@@ -56,6 +172,15 @@ class TunnelEncryption::TunnelEncryptionImpl {
     m_IVEncryption.SetKey(iv_key);
   }
 
+  // Only for AES-NI
+  const std::uint8_t* GetIVKeySchedule() {
+    return m_IVEncryption.GetKeySchedule();
+  }
+
+  const std::uint8_t* GetLayerKeySchedule() {
+    return m_ECBLayerEncryption.GetKeySchedule();
+  }
+
   void Encrypt(
       const std::uint8_t* in,
       std::uint8_t* out) {
@@ -125,6 +250,41 @@ void TunnelEncryption::Encrypt(
   m_TunnelEncryptionPimpl->Encrypt(in, out);
 }
 
+void TunnelEncryption::EncryptBatch(
+      const Job* jobs,
+      std::size_t num_jobs) {
+  std::size_t i = 0;
+#if defined(__x86_64__) || defined(_M_X64)  // TODO(unassigned): hack until we implement ARM AES-NI
+  if (UsingAESNI()) {
+    // Even half empty, lanes beat the latency bound chain of a lone message
+    while (num_jobs - i > 1) {
+      std::size_t const num_lanes =
+        std::min(num_jobs - i, TUNNEL_CRYPTO_NUM_LANES);
+      const std::uint8_t* iv_scheds[TUNNEL_CRYPTO_NUM_LANES];
+      const std::uint8_t* layer_scheds[TUNNEL_CRYPTO_NUM_LANES];
+      const std::uint8_t* in[TUNNEL_CRYPTO_NUM_LANES];
+      std::uint8_t* out[TUNNEL_CRYPTO_NUM_LANES];
+      for (std::size_t lane = 0; lane < TUNNEL_CRYPTO_NUM_LANES; lane++) {
+        const Job& job = jobs[i + std::min(lane, num_lanes - 1)];
+        auto& impl = job.encryption->m_TunnelEncryptionPimpl;
+        iv_scheds[lane] = impl->GetIVKeySchedule();
+        layer_scheds[lane] = impl->GetLayerKeySchedule();
+        in[lane] = lane < num_lanes ? job.in : GetPaddingLane();
+        out[lane] = lane < num_lanes ? job.out : GetPaddingLane();
+      }
+      alignas(16) std::uint8_t iv_ks[TUNNEL_CRYPTO_LANES_SCHEDULE_SIZE];
+      alignas(16) std::uint8_t layer_ks[TUNNEL_CRYPTO_LANES_SCHEDULE_SIZE];
+      InterleaveKeySchedules(iv_scheds, iv_ks);
+      InterleaveKeySchedules(layer_scheds, layer_ks);
+      EncryptTunnelLanes(iv_ks, layer_ks, in, out);
+      i += num_lanes;
+    }
+  }
+#endif
+  for (; i < num_jobs; i++)
+    jobs[i].encryption->Encrypt(jobs[i].in, jobs[i].out);
+}
+
 /// @class TunnelDecryptionImpl
 /// @brief Tunnel decryption implementation
 class TunnelDecryption::TunnelDecryptionImpl {
@@ -135,62 +295,30 @@ class TunnelDecryption::TunnelDecryptionImpl {
   void SetKeys(
       const AESKey& layer_key,
       const AESKey& iv_key) {
-    if (UsingAESNI())
-      m_ECBLayerDecryption.SetKey(layer_key);
-    else
-      m_CBCLayerDecryption.SetKey(layer_key);
+    m_CBCLayerDecryption.SetKey(layer_key);
     m_IVDecryption.SetKey(iv_key);
   }
 
+  // Unlike encryption, CBC decryption of the layer has no dependency between
+  // blocks: CBCDecryption runs it through the multi-block AES-NI/VAES kernels
   void Decrypt(
       const std::uint8_t* in,
       std::uint8_t* out) {
-    if (UsingAESNI()) {
-#if defined(__x86_64__) || defined(_M_X64)  // TODO(unassigned): hack until we implement ARM AES-NI
-      __asm__(
-          // decrypt IV
-          "movups (%[in]), %%xmm0 \n"
-          DecryptAES256(sched_iv)
-          "movaps %%xmm0, %%xmm1 \n"
-          // double IV encryption
-          DecryptAES256(sched_iv)
-          "movups %%xmm0, (%[out]) \n"
-          // decrypt data, IV is xmm1
-          "1: \n"
-          "add $16, %[in] \n"
-          "add $16, %[out] \n"
-          "movups (%[in]), %%xmm0 \n"
-          "movaps %%xmm0, %%xmm2 \n"
-          DecryptAES256(sched_l)
-          "pxor %%xmm1, %%xmm0 \n"
-          "movups %%xmm0, (%[out]) \n"
-          "movaps %%xmm2, %%xmm1 \n"
-          "dec %[num] \n"
-          "jnz 1b \n"
-          :
-          : [sched_iv]"r"(m_IVDecryption.GetKeySchedule()),
-            [sched_l]"r"(m_ECBLayerDecryption.GetKeySchedule()),
-            [in]"r"(in), [out]"r"(out), [num]"r"(63)  // 63 blocks = 1008 bytes
-          : "%xmm0", "%xmm1", "%xmm2", "cc", "memory");
-#endif
-    } else {
-      m_IVDecryption.Decrypt(
-          (const CipherBlock *)in,
-          reinterpret_cast<CipherBlock *>(out));  // iv
-      m_CBCLayerDecryption.SetIV(out);
-      m_CBCLayerDecryption.Decrypt(  // data
-          in + 16,
-          xi2p::core::TUNNEL_DATA_ENCRYPTED_SIZE,
-          out + 16);
-      m_IVDecryption.Decrypt(  // double iv
-          reinterpret_cast<CipherBlock *>(out),
-          reinterpret_cast<CipherBlock *>(out));
-    }
+    m_IVDecryption.Decrypt(
+        (const CipherBlock *)in,
+        reinterpret_cast<CipherBlock *>(out));  // iv
+    m_CBCLayerDecryption.SetIV(out);
+    m_CBCLayerDecryption.Decrypt(  // data
+        in + 16,
+        xi2p::core::TUNNEL_DATA_ENCRYPTED_SIZE,
+        out + 16);
+    m_IVDecryption.Decrypt(  // double iv
+        reinterpret_cast<CipherBlock *>(out),
+        reinterpret_cast<CipherBlock *>(out));
   }
 
  private:
   ECBDecryption m_IVDecryption;
-  ECBDecryption m_ECBLayerDecryption;  // For AES-NI
   CBCDecryption m_CBCLayerDecryption;
 };
 
@@ -212,5 +340,14 @@ void TunnelDecryption::Decrypt(
   m_TunnelDecryptionPimpl->Decrypt(in, out);
 }
 
+void TunnelDecryption::DecryptBatch(
+      const Job* jobs,
+      std::size_t num_jobs) {
+  // Blocks of a message don't depend on each other when decrypting, so the
+  // multi-block kernel sharing one key schedule already beats interleaving
+  for (std::size_t i = 0; i < num_jobs; i++)
+    jobs[i].decryption->Decrypt(jobs[i].in, jobs[i].out);
+}
+
 }  // namespace core
 }  // namespace xi2p
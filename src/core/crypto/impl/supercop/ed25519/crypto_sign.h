@@ -1,5 +1,6 @@
 #define crypto_sign ed25519_ref10_sign
 #define crypto_sign_pubkey ed25519_ref10_pubkey
 #define crypto_sign_open ed25519_ref10_open
+#define crypto_sign_open_batch ed25519_ref10_open_batch
 
 #include "ed25519_ref10.h"
@@ -12,6 +12,16 @@ int ed25519_ref10_open(
     const unsigned char*pk
 );
 
+/**
+ * Verify num signatures at once, returns 0 only if all of them are valid.
+ */
+int ed25519_ref10_open_batch(
+    const unsigned char* const* sig,
+    const unsigned char* const* m, const size_t* mlen,
+    const unsigned char* const* pk,
+    size_t num
+);
+
 int ed25519_ref10_sign(
     unsigned char* sig,
     const unsigned char* m, size_t mlen,
@@ -0,0 +1,184 @@
+#include <string.h>
+#include <vector>
+#include "crypto_sign.h"
+#include "crypto_hash_sha512.h"
+#include "ge.h"
+#include "sc.h"
+#include "core/crypto/rand.h"
+
+static void slide(signed char *r,const unsigned char *a)
+{
+  int i;
+  int b;
+  int k;
+
+  for (i = 0;i < 256;++i)
+    r[i] = 1 & (a[i >> 3] >> (i & 7));
+
+  for (i = 0;i < 256;++i)
+    if (r[i]) {
+      for (b = 1;b <= 6 && i + b < 256;++b) {
+        if (r[i + b]) {
+          if (r[i] + (r[i + b] << b) <= 15) {
+            r[i] += r[i + b] << b; r[i + b] = 0;
+          } else if (r[i] - (r[i + b] << b) >= -15) {
+            r[i] -= r[i + b] << b;
+            for (k = i + b;k < 256;++k) {
+              if (!r[k]) {
+                r[k] = 1;
+                break;
+              }
+              r[k] = 0;
+            }
+          } else
+            break;
+        }
+      }
+    }
+
+}
+
+static ge_precomp Bi[8] = {
+#include "base2.h"
+} ;
+
+/* Ai = A,3A,5A,7A,9A,11A,13A,15A */
+static void precompute(ge_cached *Ai,const ge_p3 *A)
+{
+  ge_p1p1 t;
+  ge_p3 u;
+  ge_p3 A2;
+  int i;
+
+  ge_p3_to_cached(&Ai[0],A);
+  ge_p3_dbl(&t,A); ge_p1p1_to_p3(&A2,&t);
+  for (i = 0;i < 7;++i) {
+    ge_add(&t,&A2,&Ai[i]); ge_p1p1_to_p3(&u,&t); ge_p3_to_cached(&Ai[i + 1],&u);
+  }
+}
+
+/*
+Verifies num signatures at once.
+
+With random 128-bit z_i, h_i = H(R_i,A_i,M_i) and s = sum z_i S_i,
+checks [8]([s]B - sum [z_i]R_i - sum [z_i h_i]A_i) == 0
+by one interleaved sliding-window multi-scalar multiplication.
+
+Returns 0 if every signature is valid (see below), -1 if at least one
+is not;
+the caller must then verify individually to find which one.
+R_i must be canonically encoded, as for crypto_sign_open.
+
+Unlike crypto_sign_open, the check is cofactored: the sum is multiplied
+by 8 before it is compared to the identity. A cofactorless batch
+equation would let the small-order parts of two signatures cancel out,
+and ruling that out costs a full scalar multiplication per signature,
+more than the batch saves. So a signature whose only error is a
+small-order component passes here, while crypto_sign_open rejects it.
+Only the owner of the key can make such a signature.
+*/
+
+int crypto_sign_open_batch(
+  const unsigned char* const* sig,
+  const unsigned char* const* m, const size_t* mlen,
+  const unsigned char* const* pk,
+  size_t num
+)
+{
+  const unsigned char zero[32] = {0};
+  unsigned char h[64];
+  unsigned char rcheck[32];
+  unsigned char s[32] = {0};
+  ge_p3 R;
+  ge_p3 A;
+  ge_p1p1 t;
+  ge_p3 u;
+  ge_p2 r;
+  fe check;
+  size_t npoints = 2 * num;
+  size_t j;
+  int i;
+
+  if (num == 0) return 0;
+
+  /* z_i and z_i h_i, the scalars of -R_i and -A_i */
+  std::vector<unsigned char> scalars(npoints * 32);
+  std::vector<ge_cached> points(npoints * 8);
+  std::vector<signed char> slides((npoints + 1) * 256);
+
+  for (j = 0;j < num;++j) {
+    unsigned char* z = &scalars[2 * j * 32];
+    unsigned char* zh = z + 32;
+
+    if (sig[j][63] & 224) return -1;
+    if (ge_frombytes_negate_vartime(&A,pk[j]) != 0) return -1;
+    if (ge_frombytes_negate_vartime(&R,sig[j]) != 0) return -1;
+
+    /* reject R encodings which crypto_sign_open could never reproduce */
+    fe_neg(R.X,R.X); fe_neg(R.T,R.T);
+    ge_p3_tobytes(rcheck,&R);
+    if (memcmp(rcheck,sig[j],32) != 0) return -1;
+    fe_neg(R.X,R.X); fe_neg(R.T,R.T);
+
+    crypto_hash_sha512_3(h, sig[j], 32, pk[j], 32, m[j], mlen[j]);
+    sc_reduce(h);
+
+    memset(z,0,32);
+    xi2p::core::RandBytes(z,16);
+
+    sc_muladd(zh,z,h,zero);
+    sc_muladd(s,z,sig[j] + 32,s);
+
+    precompute(&points[2 * j * 8],&R);
+    precompute(&points[(2 * j + 1) * 8],&A);
+  }
+
+  for (j = 0;j < npoints;++j)
+    slide(&slides[j * 256],&scalars[j * 32]);
+  slide(&slides[npoints * 256],s);
+
+  ge_p2_0(&r);
+
+  for (i = 255;i >= 0;--i) {
+    for (j = 0;j <= npoints;++j)
+      if (slides[j * 256 + i]) break;
+    if (j <= npoints) break;
+  }
+
+  for (;i >= 0;--i) {
+    ge_p2_dbl(&t,&r);
+
+    for (j = 0;j < npoints;++j) {
+      signed char d = slides[j * 256 + i];
+      if (d > 0) {
+        ge_p1p1_to_p3(&u,&t);
+        ge_add(&t,&u,&points[j * 8 + d / 2]);
+      } else if (d < 0) {
+        ge_p1p1_to_p3(&u,&t);
+        ge_sub(&t,&u,&points[j * 8 + (-d) / 2]);
+      }
+    }
+
+    signed char d = slides[npoints * 256 + i];
+    if (d > 0) {
+      ge_p1p1_to_p3(&u,&t);
+      ge_madd(&t,&u,&Bi[d / 2]);
+    } else if (d < 0) {
+      ge_p1p1_to_p3(&u,&t);
+      ge_msub(&t,&u,&Bi[(-d) / 2]);
+    }
+
+    ge_p1p1_to_p2(&r,&t);
+  }
+
+  /* clear the small-order part */
+  for (i = 0;i < 3;++i) {
+    ge_p2_dbl(&t,&r); ge_p1p1_to_p2(&r,&t);
+  }
+
+  /* the identity is (0:Z:Z) */
+  if (fe_isnonzero(r.X)) return -1;
+  fe_sub(check,r.Y,r.Z);
+  if (fe_isnonzero(check)) return -1;
+  return 0;
+}
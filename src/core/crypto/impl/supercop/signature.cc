@@ -32,8 +32,10 @@
 
 #include "core/crypto/signature.h"
 
+#include <algorithm>
 #include <cstring>
 #include <cstdint>
+#include <vector>
 
 #include "core/crypto/rand.h"
 
@@ -88,6 +90,78 @@ bool EDDSA25519Verifier::Verify(
   return m_EDDSA25519VerifierPimpl->Verify(buf, len, signature);
 }
 
+/// @class EDDSA25519BatchVerifierImpl
+class EDDSA25519BatchVerifier::EDDSA25519BatchVerifierImpl {
+ public:
+  void Add(
+      const std::uint8_t* signing_key,
+      const std::uint8_t* buf,
+      std::size_t len,
+      const std::uint8_t* signature) {
+    m_PublicKeys.push_back(signing_key);
+    m_Messages.push_back(buf);
+    m_Lengths.push_back(len);
+    m_Signatures.push_back(signature);
+  }
+
+  std::vector<bool> Verify() {
+    std::size_t size = m_Signatures.size();
+    std::vector<bool> valid(size, true);
+    for (std::size_t i = 0; i < size; i += EDDSA25519_MAX_BATCH_SIZE) {
+      std::size_t num = std::min(size - i, EDDSA25519_MAX_BATCH_SIZE);
+      if (ed25519_ref10_open_batch(
+              &m_Signatures[i],
+              &m_Messages[i],
+              &m_Lengths[i],
+              &m_PublicKeys[i],
+              num) >= 0)
+        continue;
+      // At least one is bad, find which
+      for (std::size_t j = i; j < i + num; j++)
+        valid[j] = ed25519_ref10_open(
+            m_Signatures[j],
+            m_Messages[j],
+            m_Lengths[j],
+            m_PublicKeys[j]) >= 0;
+    }
+    m_PublicKeys.clear();
+    m_Messages.clear();
+    m_Lengths.clear();
+    m_Signatures.clear();
+    return valid;
+  }
+
+  std::size_t GetSize() const {
+    return m_Signatures.size();
+  }
+
+ private:
+  std::vector<const std::uint8_t*> m_PublicKeys, m_Messages, m_Signatures;
+  std::vector<std::size_t> m_Lengths;
+};
+
+EDDSA25519BatchVerifier::EDDSA25519BatchVerifier()
+    : m_EDDSA25519BatchVerifierPimpl(
+          std::make_unique<EDDSA25519BatchVerifierImpl>()) {}
+
+EDDSA25519BatchVerifier::~EDDSA25519BatchVerifier() {}
+
+void EDDSA25519BatchVerifier::Add(
+    const std::uint8_t* signing_key,
+    const std::uint8_t* buf,
+    std::size_t len,
+    const std::uint8_t* signature) {
+  m_EDDSA25519BatchVerifierPimpl->Add(signing_key, buf, len, signature);
+}
+
+std::vector<bool> EDDSA25519BatchVerifier::Verify() {
+  return m_EDDSA25519BatchVerifierPimpl->Verify();
+}
+
+std::size_t EDDSA25519BatchVerifier::GetSize() const {
+  return m_EDDSA25519BatchVerifierPimpl->GetSize();
+}
+
 /// @class EDDSA25519SignerImpl
 class EDDSA25519Signer::EDDSA25519SignerImpl {
  public:
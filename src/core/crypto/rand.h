@@ -40,6 +40,8 @@ namespace core {
   /// @brief Generates CSPRNG bytes
   /// @param data Buffer to store result
   /// @param length Size of buffer
+  /// @note Served from a per-thread buffered generator, `benchmark --rand`
+  ///   measures its cost per request size and thread count
   void RandBytes(
       std::uint8_t* data,
       std::size_t length);
@@ -35,6 +35,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "core/crypto/signature_base.h"
 
@@ -506,6 +507,46 @@ class EDDSA25519Verifier : public Verifier {
   std::unique_ptr<EDDSA25519VerifierImpl> m_EDDSA25519VerifierPimpl;
 };
 
+/// @brief Maximum number of signatures checked by one batch equation
+const std::size_t EDDSA25519_MAX_BATCH_SIZE = 64;
+
+/// @class EDDSA25519BatchVerifier
+/// @brief Verifies many Ed25519 signatures at once
+/// @details Each chunk of up to EDDSA25519_MAX_BATCH_SIZE signatures is
+///   checked with one random linear combination; signatures of a chunk
+///   that fails are then verified one by one to find the bad ones
+/// @note The batch equation is cofactored, EDDSA25519Verifier is not: a
+///   signature whose only error is a small-order component, which only the
+///   key owner can make, passes when the rest of its chunk is valid
+class EDDSA25519BatchVerifier {
+ public:
+  EDDSA25519BatchVerifier();
+  ~EDDSA25519BatchVerifier();
+
+  /// @brief Queues a signature for the next Verify()
+  /// @note Buffers are not copied and must outlive Verify()
+  /// @param signing_key Ed25519 public key
+  /// @param buf Signed data
+  /// @param len Size of signed data
+  /// @param signature Signature of buf
+  void Add(
+      const std::uint8_t* signing_key,
+      const std::uint8_t* buf,
+      std::size_t len,
+      const std::uint8_t* signature);
+
+  /// @brief Verifies and clears the queued signatures
+  /// @return Validity of each signature, in the order they were added
+  std::vector<bool> Verify();
+
+  /// @return Number of queued signatures
+  std::size_t GetSize() const;
+
+ private:
+  class EDDSA25519BatchVerifierImpl;
+  std::unique_ptr<EDDSA25519BatchVerifierImpl> m_EDDSA25519BatchVerifierPimpl;
+};
+
 /// @class EDDSA25519Signer
 class EDDSA25519Signer : public Signer {
  public:
@@ -33,6 +33,7 @@
 #ifndef SRC_CORE_CRYPTO_TUNNEL_H_
 #define SRC_CORE_CRYPTO_TUNNEL_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 
@@ -44,6 +45,13 @@ namespace core {
 /// @class TunnelEncryption
 class TunnelEncryption {  // with double IV encryption
  public:
+  /// @brief One message of a batch along with the keys it is encrypted with
+  struct Job {
+    TunnelEncryption* encryption;
+    const std::uint8_t* in;
+    std::uint8_t* out;  // may be the same as in
+  };
+
   TunnelEncryption();
   ~TunnelEncryption();
 
@@ -55,6 +63,13 @@ class TunnelEncryption {  // with double IV encryption
       const std::uint8_t* in,
       std::uint8_t* out);  // 1024 bytes (16 IV + 1008 data)
 
+  /// @brief Encrypts a batch of messages which may belong to different tunnels
+  /// @details CBC is serial within a message, so messages are interleaved
+  ///   block by block to keep the AES units busy
+  static void EncryptBatch(
+      const Job* jobs,
+      std::size_t num_jobs);
+
  private:
   class TunnelEncryptionImpl;
   std::unique_ptr<TunnelEncryptionImpl> m_TunnelEncryptionPimpl;
@@ -63,6 +78,13 @@ class TunnelEncryption {  // with double IV encryption
 /// @class TunnelDecryption
 class TunnelDecryption {  // with double IV encryption
  public:
+  /// @brief One message of a batch along with the keys it is decrypted with
+  struct Job {
+    TunnelDecryption* decryption;
+    const std::uint8_t* in;
+    std::uint8_t* out;  // may be the same as in
+  };
+
   TunnelDecryption();
   ~TunnelDecryption();
 
@@ -74,6 +96,13 @@ class TunnelDecryption {  // with double IV encryption
       const std::uint8_t* in,
       std::uint8_t* out);  // 1024 bytes (16 IV + 1008 data)
 
+  /// @brief Decrypts a batch of messages which may belong to different tunnels
+  /// @details Counterpart of TunnelEncryption::EncryptBatch() for callers
+  ///   draining a burst, each message already uses the multi-block kernel
+  static void DecryptBatch(
+      const Job* jobs,
+      std::size_t num_jobs);
+
  private:
   class TunnelDecryptionImpl;
   std::unique_ptr<TunnelDecryptionImpl> m_TunnelDecryptionPimpl;
@@ -39,6 +39,8 @@
 // TODO(anonimal): we musn't use client code in core...
 #include "client/reseed.h"
 
+#include "core/crypto/elgamal.h"
+
 #include "core/router/context.h"
 #include "core/router/net_db/impl.h"
 #include "core/router/transports/impl.h"
@@ -109,8 +111,14 @@ void Instance::Start()
       LOG(debug) << "Instance: starting transports";
       transports.Start();
 
+      LOG(debug) << "Instance: starting ElGamal ephemeral key supplier";
+      GetElGamalEphemeralSupplier().Start();
+
       LOG(debug) << "Instance: starting tunnels";
-      tunnels.Start();
+      tunnels.Start(
+          m_Config.GetMap()["tunnel-workers"].as<std::uint16_t>(),
+          m_Config.GetMap()["tunnel-build-workers"].as<std::uint16_t>(),
+          m_Config.GetMap()["tunnel-build-queue"].as<std::uint16_t>());
     }
   catch (...)
     {
@@ -133,6 +141,9 @@ void Instance::Stop()
 
       LOG(debug) << "Instance: stopping NetDb";
       netdb.Stop();
+
+      LOG(debug) << "Instance: stopping ElGamal ephemeral key supplier";
+      GetElGamalEphemeralSupplier().Stop();
     }
   catch (...)
     {
@@ -356,6 +356,8 @@ std::size_t GarlicRoutingSession::CreateGarlicClove(
     buf[size] = 0;  //  delivery instructions flag local
     size++;
   }
+  // the full header is carried in the clove
+  msg->FinalizeChks();
   memcpy(buf + size, msg->GetBuffer(), msg->GetLength());
   size += msg->GetLength();
   // CloveID
@@ -396,6 +398,7 @@ std::size_t GarlicRoutingSession::CreateDeliveryStatusClove(
         GarlicRoutingSession garlic(key.data(), tag.data());
         msg = garlic.WrapSingleMessage(msg);
       }
+      msg->FinalizeChks();
       memcpy(buf + size, msg->GetBuffer(), msg->GetLength());
       size += msg->GetLength();
       // fill clove
@@ -429,7 +432,7 @@ void GarlicDestination::AddSessionKey(
       std::uint32_t ts = xi2p::core::GetSecondsSinceEpoch();
       auto decryption = std::make_shared<xi2p::core::CBCDecryption>();
       decryption->SetKey(key);
-      m_Tags[SessionTag(tag, ts)] = decryption;
+      m_Tags.Add(decryption, tag, 1, ts);
     }
   } catch (...) {
     m_Exception.Dispatch(__func__);
@@ -458,30 +461,24 @@ void GarlicDestination::HandleGarlicMessage(
       return;
     }
     buf += 4;  // length
-    auto it = m_Tags.find(SessionTag(buf));
-    if (it != m_Tags.end()) {
+    // tag might be used only once
+    auto tag_decryption = length >= 32 ? m_Tags.Take(buf) : nullptr;
+    if (tag_decryption) {
       // tag found. Use AES
-      if (length >= 32) {
-        std::array<std::uint8_t, 32> iv;  // IV is first 16 bytes
-        xi2p::core::SHA256().CalculateDigest(
-            iv.data(),
-            buf,
-            iv.size());
-        it->second->SetIV(iv.data());
-        it->second->Decrypt(
-            buf + iv.size(),
-            length - iv.size(),
-            buf + iv.size());
-        HandleAESBlock(
-            buf + iv.size(),
-            length - iv.size(),
-            it->second, msg->from);
-      } else {
-        LOG(error)
-          << "GarlicDestination: message length "
-          << length << " is less than 32 bytes";
-      }
-      m_Tags.erase(it);  // tag might be used only once
+      std::array<std::uint8_t, 32> iv;  // IV is first 16 bytes
+      xi2p::core::SHA256().CalculateDigest(
+          iv.data(),
+          buf,
+          iv.size());
+      tag_decryption->SetIV(iv.data());
+      tag_decryption->Decrypt(
+          buf + iv.size(),
+          length - iv.size(),
+          buf + iv.size());
+      HandleAESBlock(
+          buf + iv.size(),
+          length - iv.size(),
+          tag_decryption, msg->from);
     } else {
       // tag not found. Use ElGamal
       ElGamalBlock eg_block;
@@ -505,25 +502,14 @@ void GarlicDestination::HandleGarlicMessage(
         LOG(error) << "GarlicDestination: failed to decrypt garlic";
       }
     }
-    // cleanup expired tags
-    std::uint32_t ts = xi2p::core::GetSecondsSinceEpoch();
-    if (ts > m_LastTagsCleanupTime + INCOMING_TAGS_EXPIRATION_TIMEOUT) {
-      if (m_LastTagsCleanupTime) {
-        int num_expired_tags = 0;
-        for (auto it = m_Tags.begin(); it != m_Tags.end();) {
-          if (ts > it->first.creation_time + INCOMING_TAGS_EXPIRATION_TIMEOUT) {
-            num_expired_tags++;
-            it = m_Tags.erase(it);
-          } else {
-            it++;
-          }
-        }
-        LOG(debug)
-          << "GarlicDestination: " << num_expired_tags
-          << " tags expired for " << GetIdentHash().ToBase64();
-      }
-      m_LastTagsCleanupTime = ts;
-    }
+    // cleanup expired tags, a whole time wheel bucket at once
+    std::size_t const num_expired_tags =
+        m_Tags.Expire(xi2p::core::GetSecondsSinceEpoch());
+    if (num_expired_tags)
+      LOG(debug)
+        << "GarlicDestination: " << num_expired_tags
+        << " tags expired for " << GetIdentHash().ToBase64()
+        << ", " << m_Tags.GetNumTags() << " left";
   } catch (...) {
     m_Exception.Dispatch(__func__);
     // TODO(anonimal): review if we need to safely break control, ensure exception handling by callers
@@ -549,9 +535,11 @@ void GarlicDestination::HandleAESBlock(
           << " exceeds length " << len;
         return;
       }
-      std::uint32_t ts = xi2p::core::GetSecondsSinceEpoch();
-      for (int i = 0; i < tag_count; i++)
-        m_Tags[SessionTag(buf + i * 32, ts)] = decryption;
+      m_Tags.Add(
+          decryption,
+          buf,
+          tag_count,
+          xi2p::core::GetSecondsSinceEpoch());
     }
     buf += tag_count * 32;
     len -= tag_count * 32;
@@ -48,6 +48,7 @@
 #include "core/router/i2np.h"
 #include "core/router/identity.h"
 #include "core/router/lease_set.h"
+#include "core/router/session_tags.h"
 
 #include "core/util/exception.h"
 #include "core/util/tag.h"
@@ -200,7 +201,7 @@ class GarlicDestination
     : public xi2p::core::LocalDestination {
  public:
   GarlicDestination()
-      : m_LastTagsCleanupTime(0),
+      : m_Tags(INCOMING_TAGS_EXPIRATION_TIMEOUT),
         m_Exception(__func__) {}
 
   ~GarlicDestination();
@@ -266,9 +267,7 @@ class GarlicDestination
   std::map<xi2p::core::IdentHash,
            std::shared_ptr<GarlicRoutingSession>> m_Sessions;
   // incoming
-  std::map<SessionTag,
-           std::shared_ptr<xi2p::core::CBCDecryption>> m_Tags;
-  std::uint32_t m_LastTagsCleanupTime;
+  SessionTagStore m_Tags;
   // DeliveryStatus  (msg_ID -> session)
   std::map<std::uint32_t,
            std::shared_ptr<GarlicRoutingSession>> m_CreatedSessions;
@@ -46,6 +46,7 @@
 #include "core/router/transports/impl.h"
 #include "core/router/tunnel/impl.h"
 
+#include "core/util/bloom_filter.h"
 #include "core/util/log.h"
 #include "core/util/timestamp.h"
 
@@ -71,9 +72,32 @@ std::unique_ptr<I2NPMessage> NewI2NPMessage(
       NewI2NPMessage();
 }
 
+static_assert(
+    I2NP_MAX_TUNNEL_DATA_MESSAGE_SIZE >= 2 + I2NP_HEADER_SIZE + TUNNEL_DATA_MSG_SIZE,
+    "TunnelData size class is too small");
+
+std::unique_ptr<I2NPMessage> NewI2NPTunnelDataMessage() {
+  return std::make_unique<I2NPMessageBuffer<I2NP_MAX_TUNNEL_DATA_MESSAGE_SIZE>>();
+}
+
 std::shared_ptr<I2NPMessage> ToSharedI2NPMessage(
     std::unique_ptr<I2NPMessage> msg) {
-  return std::shared_ptr<I2NPMessage>(std::move(msg));
+  // the control block is pooled as well
+  return std::shared_ptr<I2NPMessage>(
+      msg.release(),
+      std::default_delete<I2NPMessage>(),
+      core::PoolAllocator<I2NPMessage>());
+}
+
+I2NPMessagePoolStats GetI2NPMessagePoolStats() {
+  I2NPMessagePoolStats stats;
+  stats.tunnel_data = core::GetPoolStats<
+    I2NPMessageBuffer<I2NP_MAX_TUNNEL_DATA_MESSAGE_SIZE>>();
+  stats.short_msg = core::GetPoolStats<
+    I2NPMessageBuffer<I2NP_MAX_SHORT_MESSAGE_SIZE>>();
+  stats.msg = core::GetPoolStats<I2NPMessageBuffer<I2NP_MAX_MESSAGE_SIZE>>();
+  stats.shared = core::GetPoolStats<I2NPMessage>();
+  return stats;
 }
 
 void I2NPMessage::FillI2NPMessageHeader(
@@ -88,7 +112,8 @@ void I2NPMessage::FillI2NPMessageHeader(
       xi2p::core::GetMillisecondsSinceEpoch() +
       I2NP_HEADER_DEFAULT_EXPIRATION_TIME);
   UpdateSize();
-  UpdateChks();
+  // computed by FinalizeChks, when needed
+  is_chks_updated = false;
 }
 
 void I2NPMessage::RenewI2NPMessageHeader() {
@@ -344,6 +369,15 @@ std::shared_ptr<I2NPMessage> CreateDatabaseStoreMsg(
   return m;
 }
 
+/// @return Filter of the build request records handled recently
+static RotatingBloomFilter& GetBuildRequestFilter() {
+  static RotatingBloomFilter filter(
+      BUILD_REQUEST_FILTER_CAPACITY,
+      BUILD_REQUEST_FILTER_FALSE_POSITIVE,
+      BUILD_REQUEST_FILTER_LIFETIME);
+  return filter;
+}
+
 bool HandleBuildRequestRecords(
     int num,
     std::uint8_t* records,
@@ -362,7 +396,8 @@ bool HandleBuildRequestRecords(
      *
      *   Total: 528 byte record
      *
-     * TODO(unassigned): implement bloom filter, see #58 + #77
+     * A replayed record is dropped before it is decrypted, so that it can
+     * neither create a transit tunnel twice nor cost an ElGamal decryption.
      */
     for (int i = 0; i < num; i++) {
       std::uint8_t* record = records + i * TUNNEL_BUILD_RECORD_SIZE;
@@ -372,6 +407,12 @@ bool HandleBuildRequestRecords(
               (const std::uint8_t *)context.GetRouterInfo().GetIdentHash(),
               16)) {
         LOG(debug) << "I2NPMessage: record " << i << " is ours";
+        if (GetBuildRequestFilter().CheckAndAdd(
+                record + BUILD_REQUEST_RECORD_ENCRYPTED_OFFSET,
+                TUNNEL_BUILD_RECORD_SIZE - BUILD_REQUEST_RECORD_ENCRYPTED_OFFSET)) {
+          LOG(warning) << "I2NPMessage: replayed build request record dropped";
+          return false;
+        }
         // Get session key from encrypted block
         xi2p::core::ElGamalDecrypt(
             context.GetEncryptionPrivateKey(),
@@ -386,10 +427,10 @@ bool HandleBuildRequestRecords(
          * higher levels of rejection.
          */
         if (context.AcceptsTunnels() &&
-            xi2p::core::tunnels.GetTransitTunnels().size() <=
+            xi2p::core::tunnels.GetNumTransitTunnels() <=
             MAX_NUM_TRANSIT_TUNNELS &&
             !xi2p::core::transports.IsBandwidthExceeded()) {
-          xi2p::core::TransitTunnel* transit_tunnel =
+          auto transit_tunnel =
             xi2p::core::CreateTransitTunnel(
                 core::InputByteStream::Read<std::uint32_t>(clear_text + BUILD_REQUEST_RECORD_RECEIVE_TUNNEL_OFFSET),
                 clear_text + BUILD_REQUEST_RECORD_NEXT_IDENT_OFFSET,
@@ -491,33 +532,40 @@ void HandleVariableTunnelBuildMsg(
       tunnel->SetState(xi2p::core::e_TunnelStateBuildFailed);
     }
   } else {
-    std::uint8_t clear_text[BUILD_REQUEST_RECORD_CLEAR_TEXT_SIZE] = {};
-    if (HandleBuildRequestRecords(num, buf + 1, clear_text)) {
-      // we are endpoint of outboud tunnel
-      if (clear_text[BUILD_REQUEST_RECORD_FLAG_OFFSET] & 0x40) {
-        // So, we send it to reply tunnel
-        xi2p::core::transports.SendMessage(
-            clear_text + BUILD_REQUEST_RECORD_NEXT_IDENT_OFFSET,
-            ToSharedI2NPMessage(
-                CreateTunnelGatewayMsg(
-                    core::InputByteStream::Read<std::uint32_t>(
-                        clear_text + BUILD_REQUEST_RECORD_NEXT_TUNNEL_OFFSET),
-                    I2NPVariableTunnelBuildReply,
-                    buf,
-                    len,
-                    core::InputByteStream::Read<std::uint32_t>(
-                        clear_text + BUILD_REQUEST_RECORD_SEND_MSG_ID_OFFSET))));
-      } else {
-        xi2p::core::transports.SendMessage(
-            clear_text + BUILD_REQUEST_RECORD_NEXT_IDENT_OFFSET,
-            ToSharedI2NPMessage(
-                CreateI2NPMessage(
-                    I2NPVariableTunnelBuild,
-                    buf,
-                    len,
-                    core::InputByteStream::Read<std::uint32_t>(
-                        clear_text + BUILD_REQUEST_RECORD_SEND_MSG_ID_OFFSET))));
-      }
+    HandleVariableTunnelBuildRequestMsg(buf, len);
+  }
+}
+
+void HandleVariableTunnelBuildRequestMsg(
+    std::uint8_t* buf,
+    std::size_t len) {
+  int num = buf[0];
+  std::uint8_t clear_text[BUILD_REQUEST_RECORD_CLEAR_TEXT_SIZE] = {};
+  if (HandleBuildRequestRecords(num, buf + 1, clear_text)) {
+    // we are endpoint of outboud tunnel
+    if (clear_text[BUILD_REQUEST_RECORD_FLAG_OFFSET] & 0x40) {
+      // So, we send it to reply tunnel
+      xi2p::core::transports.SendMessage(
+          clear_text + BUILD_REQUEST_RECORD_NEXT_IDENT_OFFSET,
+          ToSharedI2NPMessage(
+              CreateTunnelGatewayMsg(
+                  core::InputByteStream::Read<std::uint32_t>(
+                      clear_text + BUILD_REQUEST_RECORD_NEXT_TUNNEL_OFFSET),
+                  I2NPVariableTunnelBuildReply,
+                  buf,
+                  len,
+                  core::InputByteStream::Read<std::uint32_t>(
+                      clear_text + BUILD_REQUEST_RECORD_SEND_MSG_ID_OFFSET))));
+    } else {
+      xi2p::core::transports.SendMessage(
+          clear_text + BUILD_REQUEST_RECORD_NEXT_IDENT_OFFSET,
+          ToSharedI2NPMessage(
+              CreateI2NPMessage(
+                  I2NPVariableTunnelBuild,
+                  buf,
+                  len,
+                  core::InputByteStream::Read<std::uint32_t>(
+                      clear_text + BUILD_REQUEST_RECORD_SEND_MSG_ID_OFFSET))));
     }
   }
 }
@@ -585,7 +633,7 @@ void HandleVariableTunnelBuildReplyMsg(
 
 std::unique_ptr<I2NPMessage> CreateTunnelDataMsg(
     const std::uint8_t * buf) {
-  std::unique_ptr<I2NPMessage> msg = NewI2NPShortMessage();
+  std::unique_ptr<I2NPMessage> msg = NewI2NPTunnelDataMessage();
   memcpy(msg->GetPayload(), buf, xi2p::core::TUNNEL_DATA_MSG_SIZE);
   msg->len += xi2p::core::TUNNEL_DATA_MSG_SIZE;
   msg->FillI2NPMessageHeader(I2NPTunnelData);
@@ -595,7 +643,7 @@ std::unique_ptr<I2NPMessage> CreateTunnelDataMsg(
 std::unique_ptr<I2NPMessage> CreateTunnelDataMsg(
     std::uint32_t tunnel_ID,
     const std::uint8_t* payload) {
-  std::unique_ptr<I2NPMessage> msg = NewI2NPShortMessage();
+  std::unique_ptr<I2NPMessage> msg = NewI2NPTunnelDataMessage();
   memcpy(msg->GetPayload() + 4, payload, xi2p::core::TUNNEL_DATA_MSG_SIZE - 4);
   core::OutputByteStream::Write<std::uint32_t>(msg->GetPayload(), tunnel_ID);
   msg->len += xi2p::core::TUNNEL_DATA_MSG_SIZE;
@@ -604,9 +652,26 @@ std::unique_ptr<I2NPMessage> CreateTunnelDataMsg(
 }
 
 std::shared_ptr<I2NPMessage> CreateEmptyTunnelDataMsg() {
-  std::unique_ptr<I2NPMessage> msg = NewI2NPShortMessage();
+  // single pooled allocation for message and control block, this is
+  // allocated for every forwarded transit message
+  typedef I2NPMessageBuffer<I2NP_MAX_TUNNEL_DATA_MESSAGE_SIZE> TunnelDataBuffer;
+  auto msg = std::allocate_shared<TunnelDataBuffer>(
+      core::PoolAllocator<TunnelDataBuffer>());
   msg->len += xi2p::core::TUNNEL_DATA_MSG_SIZE;
-  return ToSharedI2NPMessage(std::move(msg));
+  return msg;
+}
+
+std::shared_ptr<I2NPMessage> ToWritableTunnelDataMsg(
+    std::shared_ptr<const I2NPMessage> msg) {
+  // Nobody else can see the message, no need to copy it
+  if (msg.use_count() == 1)
+    return std::const_pointer_cast<I2NPMessage>(msg);
+  auto new_msg = CreateEmptyTunnelDataMsg();
+  memcpy(
+      new_msg->GetPayload(),
+      msg->GetPayload(),
+      xi2p::core::TUNNEL_DATA_MSG_SIZE);
+  return new_msg;
 }
 
 // TODO(anonimal): bytestream refactor
@@ -629,6 +694,8 @@ std::unique_ptr<I2NPMessage> CreateTunnelGatewayMsg(
 std::shared_ptr<I2NPMessage> CreateTunnelGatewayMsg(
     std::uint32_t tunnel_ID,
     std::shared_ptr<I2NPMessage> msg) {
+  // the full header is carried to the tunnel's endpoint
+  msg->FinalizeChks();
   if (msg->offset >= I2NP_HEADER_SIZE + TUNNEL_GATEWAY_HEADER_SIZE) {
     // message is capable to be used without copying
     std::uint8_t* payload = msg->GetBuffer() - TUNNEL_GATEWAY_HEADER_SIZE;
@@ -663,6 +730,7 @@ std::unique_ptr<I2NPMessage> CreateTunnelGatewayMsg(
   memcpy(msg->GetPayload(), buf, len);
   msg->len += len;
   msg->FillI2NPMessageHeader(msg_type, reply_msg_ID);  // create content message
+  msg->FinalizeChks();
   len = msg->GetLength();
   msg->offset -= gateway_msg_offset;
   std::uint8_t* payload = msg->GetPayload();
@@ -47,6 +47,7 @@
 #include "core/router/lease_set.h"
 
 #include "core/util/exception.h"
+#include "core/util/memory_pool.h"
 
 namespace xi2p {
 namespace core {
@@ -69,6 +70,8 @@ const std::size_t I2NP_HEADER_TYPEID_OFFSET = 0,
 
              I2NP_MAX_MESSAGE_SIZE = 32768,
              I2NP_MAX_SHORT_MESSAGE_SIZE = 4096,
+             // NTCP length, header, 1028 bytes of TunnelData and NTCP padding/checksum
+             I2NP_MAX_TUNNEL_DATA_MESSAGE_SIZE = 2 + I2NP_HEADER_SIZE + 1028 + 32,
 
              // Tunnel Gateway header
              TUNNEL_GATEWAY_HEADER_TUNNELID_OFFSET = 0,
@@ -131,6 +134,12 @@ const std::uint8_t DATABASE_LOOKUP_DELIVERY_FLAG = 0x01,
 const int NUM_TUNNEL_BUILD_RECORDS = 8,
           MAX_NUM_TRANSIT_TUNNELS = 2500;
 
+// Replay protection of build request records, each remembered
+// for one to two lifetimes
+const std::size_t BUILD_REQUEST_FILTER_CAPACITY = 1 << 20;
+const double BUILD_REQUEST_FILTER_FALSE_POSITIVE = 1e-6;
+const std::uint32_t BUILD_REQUEST_FILTER_LIFETIME = 3600;  // in seconds
+
 enum I2NPMessageType {
   I2NPDatabaseStore = 1,
   I2NPDatabaseLookup = 2,
@@ -154,6 +163,9 @@ struct I2NPMessage {
   std::uint8_t* buf;
   std::size_t len, offset, max_len;
   std::shared_ptr<xi2p::core::InboundTunnel> from;
+  // checksum byte of the header is up to date with the payload: a header
+  // received from a peer keeps its checksum, a header we fill does not
+  mutable bool is_chks_updated;
   core::Exception exception;
 
   I2NPMessage()
@@ -162,8 +174,12 @@ struct I2NPMessage {
         offset(2),
         max_len(0),
         from(nullptr),
+        is_chks_updated(true),
         exception(__func__) {}
 
+  // messages are deleted through the base class, see I2NPMessageBuffer
+  virtual ~I2NPMessage() = default;
+
   // header accessors
   std::uint8_t* GetHeader() {
     return GetBuffer();
@@ -219,13 +235,28 @@ struct I2NPMessage {
   }
 
   void UpdateChks() {
+    is_chks_updated = false;
+    FinalizeChks();
+  }
+
+  /// @brief Computes the checksum unless it is up to date with the payload
+  /// @details The checksum is only read by peers, from the full header, so it
+  ///   is left to where the full header leaves the router (NTCP, a tunnel or
+  ///   a garlic clove) rather than computed by FillI2NPMessageHeader. SSU and
+  ///   local delivery never need it.
+  /// @note Only the header's checksum byte is written, hence const
+  void FinalizeChks() const {
+    if (is_chks_updated)
+      return;
     // TODO(anonimal): this try block should be handled entirely by caller
     try {
       std::uint8_t hash[32];
       xi2p::core::SHA256().CalculateDigest(hash, GetPayload(), GetPayloadLength());
-      GetHeader()[I2NP_HEADER_CHKS_OFFSET] = hash[0];
+      buf[offset + I2NP_HEADER_CHKS_OFFSET] = hash[0];
+      is_chks_updated = true;
     } catch (...) {
-      exception.Dispatch(__func__);
+      core::Exception ex;
+      ex.Dispatch(__func__);
       // TODO(anonimal): review if we need to safely break control, ensure exception handling by callers
       throw;
     }
@@ -268,6 +299,7 @@ struct I2NPMessage {
     len = offset + other.GetLength();
     from = other.from;
     max_len = other.max_len;
+    is_chks_updated = other.is_chks_updated;
     return *this;
   }
 
@@ -288,6 +320,7 @@ struct I2NPMessage {
         * 1000LL);
     SetSize(len - offset - I2NP_HEADER_SIZE);
     SetChks(0);
+    is_chks_updated = false;
   }
 
   // TODO(anonimal): bytestream refactor
@@ -323,6 +356,23 @@ struct I2NPMessageBuffer : public I2NPMessage {
     max_len = SZ;
   }
   std::uint8_t m_Buffer[SZ + 16] = {};
+
+  // recycled through a pool of this size class instead of the heap
+  static void* operator new(
+      std::size_t size) {
+    if (size != sizeof(I2NPMessageBuffer))
+      return ::operator new(size);
+    return core::BlockPool<sizeof(I2NPMessageBuffer), I2NPMessageBuffer>::Allocate();
+  }
+
+  static void operator delete(
+      void* ptr,
+      std::size_t size) {
+    if (size != sizeof(I2NPMessageBuffer))
+      ::operator delete(ptr);
+    else
+      core::BlockPool<sizeof(I2NPMessageBuffer), I2NPMessageBuffer>::Deallocate(ptr);
+  }
 };
 
 // TODO(rakhimov): Consider shared_ptr instead of unique_ptr
@@ -334,9 +384,21 @@ std::unique_ptr<I2NPMessage> NewI2NPMessage(
 
 std::unique_ptr<I2NPMessage> NewI2NPShortMessage();
 
+/// @brief Message sized for a single TunnelData message
+std::unique_ptr<I2NPMessage> NewI2NPTunnelDataMessage();
+
 std::shared_ptr<I2NPMessage> ToSharedI2NPMessage(
     std::unique_ptr<I2NPMessage> msg);
 
+/// @struct I2NPMessagePoolStats
+/// @brief Pool counters of the message size classes
+struct I2NPMessagePoolStats {
+  core::PoolStats tunnel_data, short_msg, msg;
+  core::PoolStats shared;  ///< shared_ptr control blocks
+};
+
+I2NPMessagePoolStats GetI2NPMessagePoolStats();
+
 std::unique_ptr<I2NPMessage> CreateI2NPMessage(
     I2NPMessageType msg_type,
     const std::uint8_t* buf,
@@ -385,6 +447,14 @@ void HandleVariableTunnelBuildMsg(
     std::uint8_t* buf,
     std::size_t len);
 
+/// @brief Handles a VariableTunnelBuild which is not the reply for one of
+///   our pending inbound tunnels: our record is answered and the message
+///   is passed on to the next hop
+/// @note Safe to call from any thread
+void HandleVariableTunnelBuildRequestMsg(
+    std::uint8_t* buf,
+    std::size_t len);
+
 void HandleVariableTunnelBuildReplyMsg(
     std::uint32_t reply_msg_ID,
     std::uint8_t* buf,
@@ -403,6 +473,12 @@ std::unique_ptr<I2NPMessage> CreateTunnelDataMsg(
 
 std::shared_ptr<I2NPMessage> CreateEmptyTunnelDataMsg();
 
+/// @brief Gives a received tunnel message which can be processed in place
+/// @details The message itself when the caller hands over the only
+///   reference, otherwise a copy of it
+std::shared_ptr<I2NPMessage> ToWritableTunnelDataMsg(
+    std::shared_ptr<const I2NPMessage> msg);
+
 std::unique_ptr<I2NPMessage> CreateTunnelGatewayMsg(
     std::uint32_t tunnel_ID,
     const std::uint8_t* buf,
@@ -529,6 +529,39 @@ void IdentityEx::DropVerifier() {
   m_Verifier.reset(nullptr);
 }
 
+void IdentityBatchVerifier::Add(
+    const IdentityEx& identity,
+    const std::uint8_t* buf,
+    std::size_t len,
+    const std::uint8_t* signature) {
+  m_Signatures.push_back({&identity, buf, len, signature});
+}
+
+std::vector<bool> IdentityBatchVerifier::Verify() {
+  std::vector<bool> valid(m_Signatures.size(), false);
+  xi2p::core::EDDSA25519BatchVerifier batch;
+  std::vector<std::size_t> batched;
+  for (std::size_t i = 0; i < m_Signatures.size(); i++) {
+    auto const& sig = m_Signatures[i];
+    if (sig.identity->GetSigningKeyType() == SIGNING_KEY_TYPE_EDDSA_SHA512_ED25519) {
+      std::size_t padding = 128 - xi2p::core::EDDSA25519_PUBLIC_KEY_LENGTH;  // 96 = 128 - 32
+      batch.Add(
+          sig.identity->GetStandardIdentity().signing_key + padding,
+          sig.buf,
+          sig.len,
+          sig.signature);
+      batched.push_back(i);
+    } else {
+      valid[i] = sig.identity->Verify(sig.buf, sig.len, sig.signature);
+    }
+  }
+  m_Signatures.clear();
+  auto const batch_valid = batch.Verify();
+  for (std::size_t i = 0; i < batched.size(); i++)
+    valid[batched[i]] = batch_valid[i];
+  return valid;
+}
+
 /**
  *
  * PrivateKeys
@@ -40,6 +40,7 @@
 #include <cstring>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "core/crypto/elgamal.h"
 #include "core/crypto/radix.h"
@@ -208,6 +209,33 @@ class IdentityEx {
   core::Exception m_Exception;
 };
 
+/// @class IdentityBatchVerifier
+/// @brief Verifies signatures made by many identities at once
+/// @details Ed25519 signatures are checked together, others one by one
+class IdentityBatchVerifier {
+ public:
+  /// @brief Queues a signature for the next Verify()
+  /// @note Identity and buffers must outlive Verify()
+  void Add(
+      const IdentityEx& identity,
+      const std::uint8_t* buf,
+      std::size_t len,
+      const std::uint8_t* signature);
+
+  /// @brief Verifies and clears the queued signatures
+  /// @return Validity of each signature, in the order they were added
+  std::vector<bool> Verify();
+
+ private:
+  struct Signature {
+    const IdentityEx* identity;
+    const std::uint8_t* buf;
+    std::size_t len;
+    const std::uint8_t* signature;
+  };
+  std::vector<Signature> m_Signatures;
+};
+
 class PrivateKeys {  // for eepsites
  public:
   PrivateKeys();
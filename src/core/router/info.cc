@@ -32,17 +32,22 @@
 
 #include "core/router/info.h"
 
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/endian/conversion.hpp>
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <iterator>
 #include <tuple>
+#include <utility>
 
 #include "core/crypto/radix.h"
 
 #include "core/router/context.h"
 
+#include "core/util/byte_stream.h"
 #include "core/util/filesystem.h"
 #include "core/util/log.h"
 #include "core/util/timestamp.h"
@@ -106,6 +111,15 @@ RouterInfo::RouterInfo(const std::string& path)
 }
 
 RouterInfo::RouterInfo(const std::uint8_t* buf, std::uint16_t len)
+    : RouterInfo(buf, len, true)
+{
+  m_IsUpdated = true;
+}
+
+RouterInfo::RouterInfo(
+    const std::uint8_t* buf,
+    std::uint16_t len,
+    bool verify_signature)
     : m_Exception(__func__),
       m_Buffer(std::make_unique<std::uint8_t[]>(Size::MaxBuffer)),  // TODO(anonimal): buffer refactor
       m_BufferLen(len)
@@ -115,8 +129,7 @@ RouterInfo::RouterInfo(const std::uint8_t* buf, std::uint16_t len)
   if (len < Size::MinBuffer || len > Size::MaxBuffer)
     throw std::length_error("RouterInfo: invalid buffer length");
   std::memcpy(m_Buffer.get(), buf, len);
-  ReadFromBuffer(true);
-  m_IsUpdated = true;
+  ReadFromBuffer(verify_signature);
 }
 
 RouterInfo::~RouterInfo()
@@ -164,11 +177,7 @@ void RouterInfo::ReadFromBuffer(bool verify_signature)
         throw std::length_error("null ident length");
 
       // Parse existing RI from buffer
-      std::string router_info(
-          reinterpret_cast<char*>(m_Buffer.get()) + ident_len,
-          m_BufferLen - ident_len);
-
-      ParseRouterInfo(router_info);
+      ParseRouterInfo(m_Buffer.get() + ident_len, m_BufferLen - ident_len);
 
       // Verify signature
       if (verify_signature)
@@ -195,30 +204,55 @@ void RouterInfo::ReadFromBuffer(bool verify_signature)
 
 // TODO(anonimal): unit-test
 // TODO(anonimal): we could possibly implement by tokenizing the string but this could be more work (i.e., when reading string from byte) or overhead than needed
-void RouterInfo::ParseRouterInfo(const std::string& router_info)
+namespace
+{
+/// @brief Reads a length-prefixed string as a view into the stream's buffer
+boost::string_ref ReadStringFromByte(core::InputByteStream& stream)
+{
+  std::uint8_t const len = stream.Read<std::uint8_t>();
+  if (!len)
+    return boost::string_ref();
+  return boost::string_ref(
+      reinterpret_cast<const char*>(stream.ReadBytes(len)), len);
+}
+
+/// @brief Reads a key/value pair as views into the stream's buffer
+/// @return Size read, including delimiter and terminator
+std::uint16_t ReadKeyPair(
+    core::InputByteStream& stream,
+    boost::string_ref& key,
+    boost::string_ref& value)
+{
+  key = ReadStringFromByte(stream);
+  stream.SkipBytes(1);  // delimiter
+  value = ReadStringFromByte(stream);
+  stream.SkipBytes(1);  // terminator
+  return key.size() + value.size() + 4;
+}
+}  // namespace
+
+void RouterInfo::ParseRouterInfo(const std::uint8_t* buf, std::size_t len)
 {
   LOG(debug) << "RouterInfo: parsing";
 
-  // Create RI stream
-  core::StringStream stream(router_info);
+  // Create RI stream, keys and values are read in place
+  core::InputByteStream stream(buf, len);
 
   // For key/value pair
-  std::string key, value;
+  boost::string_ref key, value;
 
   // RI sizes
-  std::uint16_t read_size{}, given_size{}, remaining_size{};
+  std::uint16_t given_size{}, remaining_size{};
 
   // Does RI have introducers
   bool has_introducers = false;
 
   // Get timestamp
-  stream.Read(&m_Timestamp, sizeof(m_Timestamp));
-  boost::endian::big_to_native_inplace(m_Timestamp);
+  m_Timestamp = stream.Read<std::uint64_t>();
   LOG(debug) << "RouterInfo: timestamp = " << m_Timestamp;
 
   // Get number of IP addresses
-  std::uint8_t num_addresses;
-  stream.Read(&num_addresses, sizeof(num_addresses));
+  std::uint8_t const num_addresses = stream.Read<std::uint8_t>();
   LOG(debug) << "RouterInfo: number of addresses = "
              << static_cast<std::size_t>(num_addresses);
 
@@ -229,12 +263,11 @@ void RouterInfo::ParseRouterInfo(const std::string& router_info)
       bool is_valid_address = true;
 
       // Read cost + date
-      stream.Read(&address.cost, sizeof(address.cost));
-      stream.Read(&address.date, sizeof(address.date));
+      address.cost = stream.Read<std::uint8_t>();
+      address.date = stream.Read<std::uint64_t>(false);  // kept in the byte order it is written in
 
       // Read/set transport
-      std::string transport(stream.ReadStringFromByte());
-      switch (GetTrait(transport))
+      switch (GetTrait(ReadStringFromByte(stream)))
         {
           case Trait::NTCP:
             address.transport = Transport::NTCP;
@@ -248,17 +281,14 @@ void RouterInfo::ParseRouterInfo(const std::string& router_info)
         }
 
       // Get the given size of remaining chunk
-      stream.Read(&given_size, sizeof(given_size));
-      boost::endian::big_to_native_inplace(given_size);
+      given_size = stream.Read<std::uint16_t>();
 
       // Reset remaining size
       remaining_size = 0;
       while (remaining_size < given_size)
         {
           // Get key/value pair
-          // TODO(anonimal): consider member for stream size read, replace tuple with pair
-          std::tie(key, value, read_size) = stream.ReadKeyPair();
-          remaining_size += read_size;
+          remaining_size += ReadKeyPair(stream, key, value);
 
           // Get key / set members
           switch (GetTrait(key))
@@ -267,9 +297,10 @@ void RouterInfo::ParseRouterInfo(const std::string& router_info)
                 {
                   // Process host and transport
                   // TODO(unassigned): we process transport so we can resolve host. This seems like a hack.
+                  std::string const host(value.data(), value.size());
                   boost::system::error_code ecode;
                   address.host =
-                      boost::asio::ip::address::from_string(value, ecode);
+                      boost::asio::ip::address::from_string(host, ecode);
                   if (ecode)
                     {
                       // Unresolved hosts return invalid argument. See TODO below
@@ -286,13 +317,13 @@ void RouterInfo::ParseRouterInfo(const std::string& router_info)
                             // NTCP will (should be) resolved in transports
                             // TODO(unassigned): refactor. Though we will resolve host later, assigning values upon error is simply confusing.
                             m_SupportedTransports |= SupportedTransport::NTCPv4;
-                            address.address = value;
+                            address.address = host;
                             break;
 		          case Transport::SSU:
                             // TODO(unassigned): implement address resolver for SSU (then break from default case)
                             LOG(warning)
                                 << "RouterInfo: unexpected SSU address "
-                                << value;
+                                << host;
                             // fall-through
                           default:
                             is_valid_address = false;
@@ -313,10 +344,12 @@ void RouterInfo::ParseRouterInfo(const std::string& router_info)
                   break;
                 }
               case Trait::Port:
-                address.port = boost::lexical_cast<std::uint16_t>(value);
+                address.port = boost::lexical_cast<std::uint16_t>(
+                    value.data(), value.size());
                 break;
               case Trait::MTU:
-                address.mtu = boost::lexical_cast<std::uint16_t>(value);
+                address.mtu = boost::lexical_cast<std::uint16_t>(
+                    value.data(), value.size());
                 break;
               case Trait::Key:
                 {
@@ -324,7 +357,7 @@ void RouterInfo::ParseRouterInfo(const std::string& router_info)
                   std::vector<std::uint8_t> key;
                   try
                     {
-                      key = core::Base64::Decode(value.c_str(), value.size());
+                      key = core::Base64::Decode(value.data(), value.size());
                     }
                   catch (...)
                     {
@@ -332,8 +365,10 @@ void RouterInfo::ParseRouterInfo(const std::string& router_info)
                       is_valid_address = false;
                     }
 
-                  //TODO(anonimal): let's try to avoid a memcpy
-                  std::memcpy(address.key, key.data(), sizeof(address.key));
+                  std::memcpy(
+                      address.key,
+                      key.data(),
+                      std::min(key.size(), sizeof(address.key)));
                   break;
                 }
               case Trait::Caps:
@@ -342,19 +377,20 @@ void RouterInfo::ParseRouterInfo(const std::string& router_info)
               default:
                 // Test for introducers
                 // TODO(unassigned): this is faster than a regexp, let's try to do this better though
-                if (key.front() == GetTrait(Trait::IntroHost).front())
+                if (!key.empty()
+                    && key.front() == GetTrait(Trait::IntroHost).front())
                   {
                     has_introducers = true;
 
                     // Because of multiple introducers, get/set the introducer number
                     // TODO(unassigned): let's not implement like this, nor do this here
-                    unsigned char index = key[key.size() - 1] - '0';
+                    unsigned char index = key.back() - '0';
                     if (index >= address.introducers.size())
                       address.introducers.resize(index + 1);
                     Introducer& introducer = address.introducers.at(index);
 
                     // Drop number count from introducer key trait
-                    key.pop_back();
+                    key.remove_suffix(1);
 
                     // Set introducer members
                     switch (GetTrait(key))
@@ -364,7 +400,8 @@ void RouterInfo::ParseRouterInfo(const std::string& router_info)
                             boost::system::error_code ecode;
                             introducer.host =
                                 boost::asio::ip::address::from_string(
-                                    value, ecode);
+                                    std::string(value.data(), value.size()),
+                                    ecode);
                             // TODO(unassigned):
                             // Because unresolved hosts return EINVAL,
                             // and since we currently have no implementation to resolve introducer hosts,
@@ -379,23 +416,23 @@ void RouterInfo::ParseRouterInfo(const std::string& router_info)
                           }
                           break;
                         case Trait::IntroPort:
-                          introducer.port = boost::lexical_cast<std::uint16_t>(value);
+                          introducer.port = boost::lexical_cast<std::uint16_t>(
+                              value.data(), value.size());
                           break;
                         case Trait::IntroTag:
-                          introducer.tag =
-                              boost::lexical_cast<std::uint32_t>(value);
+                          introducer.tag = boost::lexical_cast<std::uint32_t>(
+                              value.data(), value.size());
                           break;
                         case Trait::IntroKey:
                           {
                             std::vector<std::uint8_t> const decoded(
                                 core::Base64::Decode(
-                                    value.c_str(), value.size()));
+                                    value.data(), value.size()));
 
-                            //TODO(anonimal): let's try to avoid a memcpy
                             std::memcpy(
                                 introducer.key,
                                 decoded.data(),
-                                sizeof(introducer.key));
+                                std::min(decoded.size(), sizeof(introducer.key)));
                           }
                           break;
                         default:
@@ -412,34 +449,31 @@ void RouterInfo::ParseRouterInfo(const std::string& router_info)
       // Log RI details, save valid addresses
       LOG(debug) << GetDescription(address);
       if (is_valid_address)
-        m_Addresses.push_back(address);
+        m_Addresses.push_back(std::move(address));
     }
 
   // Read peers
   // TODO(unassigned): handle peers
-  std::uint8_t num_peers;
-  stream.Read(&num_peers, sizeof(num_peers));
-  stream.Seekg(num_peers * 32, std::ios_base::cur);
+  std::uint8_t const num_peers = stream.Read<std::uint8_t>();
+  if (num_peers)
+    stream.SkipBytes(num_peers * 32);
 
   // Read remaining options
-  stream.Read(&given_size, sizeof(given_size));
-  boost::endian::big_to_native_inplace(given_size);
+  given_size = stream.Read<std::uint16_t>();
 
   // Reset remaining size
   remaining_size = 0;
   while (remaining_size < given_size)
     {
       // Get key/value pair
-      // TODO(anonimal): consider member for stream size read, replace tuple with pair
-      std::tie(key, value, read_size) = stream.ReadKeyPair();
-      remaining_size += read_size;
+      remaining_size += ReadKeyPair(stream, key, value);
 
-      // Set option
-      SetOption(key, value);
+      // Set option, the only strings materialized from the RI
+      m_Options[key.to_string()].assign(value.data(), value.size());
 
       // Set capabilities
       // TODO(anonimal): review setter implementation
-      if (key == GetTrait(Trait::Caps))
+      if (GetTrait(key) == Trait::Caps)
         SetCaps(value);
     }
 
@@ -453,6 +487,40 @@ void RouterInfo::ParseRouterInfo(const std::string& router_info)
     }
 }
 
+RouterInfoTraits::Trait RouterInfoTraits::GetTrait(
+    boost::string_ref value) const noexcept
+{
+  // Address, introducer and demarcation traits as named by GetTrait(Trait),
+  // sorted by name for a binary search
+  static const std::pair<boost::string_ref, Trait> traits[] = {
+      {";", Trait::Terminator},
+      {"=", Trait::Delimiter},
+      {"NTCP", Trait::NTCP},
+      {"SSU", Trait::SSU},
+      {"caps", Trait::Caps},
+      {"cost", Trait::Cost},
+      {"date", Trait::Date},
+      {"host", Trait::Host},
+      {"ihost", Trait::IntroHost},
+      {"ikey", Trait::IntroKey},
+      {"iport", Trait::IntroPort},
+      {"itag", Trait::IntroTag},
+      {"key", Trait::Key},
+      {"mtu", Trait::MTU},
+      {"port", Trait::Port},
+  };
+  auto const it = std::lower_bound(
+      std::begin(traits),
+      std::end(traits),
+      value,
+      [](const std::pair<boost::string_ref, Trait>& trait, boost::string_ref name) {
+        return trait.first < name;
+      });
+  if (it != std::end(traits) && it->first == value)
+    return it->second;
+  return Trait::Unknown;  // TODO(anonimal): review
+}
+
 void RouterInfo::SetDefaultOptions()
 {
   SetOption(GetTrait(Trait::NetID), std::to_string(I2P_NETWORK_ID));
@@ -462,7 +530,7 @@ void RouterInfo::SetDefaultOptions()
   //   netdb starts. We'll need to ensure the 'known' opts are set *after* netdb starts.
 }
 
-void RouterInfo::SetCaps(const std::string& caps)
+void RouterInfo::SetCaps(boost::string_ref caps)
 {
   LOG(debug) << "RouterInfo: " << __func__ << ": setting caps " << caps;
   for (const auto& cap : caps)
@@ -674,7 +742,10 @@ void RouterInfo::DisableV6()
     }
 }
 
-void RouterInfo::Update(const std::uint8_t* buf, std::uint16_t len)
+void RouterInfo::Update(
+    const std::uint8_t* buf,
+    std::uint16_t len,
+    bool verify_signature)
 {
   if (len < Size::MinBuffer || len > Size::MaxBuffer)
     throw std::length_error(
@@ -689,7 +760,7 @@ void RouterInfo::Update(const std::uint8_t* buf, std::uint16_t len)
   m_Addresses.clear();
   m_Options.clear();
   std::memcpy(m_Buffer.get(), buf, len);
-  ReadFromBuffer(true);
+  ReadFromBuffer(verify_signature);
   // don't delete buffer until saved to file
 }
 
@@ -705,6 +776,19 @@ const std::uint8_t* RouterInfo::LoadBuffer()
   return m_Buffer.get();
 }
 
+const std::uint8_t* RouterInfo::LoadBuffer(
+    const std::uint8_t* buf,
+    std::uint16_t len)
+{
+  if (!m_Buffer && len >= Size::MinBuffer && len <= Size::MaxBuffer)
+    {
+      m_Buffer = std::make_unique<std::uint8_t[]>(Size::MaxBuffer);
+      std::memcpy(m_Buffer.get(), buf, len);
+      m_BufferLen = len;
+    }
+  return m_Buffer.get();
+}
+
 void RouterInfo::CreateBuffer(const PrivateKeys& private_keys)
 {
   try
@@ -921,9 +1005,10 @@ void RouterInfo::SaveToFile(const std::string& path)
     throw std::runtime_error("RouterInfo: cannot save " + path);
 }
 
-std::shared_ptr<RouterProfile> RouterInfo::GetProfile() const
+RouterProfile* RouterInfo::GetProfile() const
 {
-  if (!m_Profile)
+  // Record may have been reclaimed for another peer once expired
+  if (!m_Profile || !m_Profile->IsOf(GetIdentHash()))
     m_Profile = GetRouterProfile(GetIdentHash());
   return m_Profile;
 }
@@ -34,6 +34,7 @@
 #define SRC_CORE_ROUTER_INFO_H_
 
 #include <boost/asio.hpp>
+#include <boost/utility/string_ref.hpp>
 
 #include <cstddef>
 #include <cstdint>
@@ -256,61 +257,7 @@ struct RouterInfoTraits
 
   /// @return Enumerated key trait
   /// @param value String value of potential trait given
-  Trait GetTrait(const std::string& value) const noexcept
-  {
-    // Address-specific
-    if (value == GetTrait(Trait::NTCP))
-      return Trait::NTCP;
-
-    else if (value == GetTrait(Trait::SSU))
-      return Trait::SSU;
-
-    else if (value == GetTrait(Trait::Host))
-      return Trait::Host;
-
-    else if (value == GetTrait(Trait::Port))
-      return Trait::Port;
-
-    else if (value == GetTrait(Trait::MTU))
-      return Trait::MTU;
-
-    else if (value == GetTrait(Trait::Key))
-      return Trait::Key;
-
-    else if (value == GetTrait(Trait::Caps))
-      return Trait::Caps;
-
-    else if (value == GetTrait(Trait::Cost))
-      return Trait::Cost;
-
-    else if (value == GetTrait(Trait::Date))
-      return Trait::Date;
-
-    // Introducer
-    else if (value == GetTrait(Trait::IntroHost))
-      return Trait::IntroHost;
-
-    else if (value == GetTrait(Trait::IntroPort))
-      return Trait::IntroPort;
-
-    else if (value == GetTrait(Trait::IntroTag))
-      return Trait::IntroTag;
-
-    else if (value == GetTrait(Trait::IntroKey))
-      return Trait::IntroKey;
-
-    // Demarcation
-    else if (value == GetTrait(Trait::Delimiter))
-      return Trait::Delimiter;
-
-    else if (value == GetTrait(Trait::Terminator))
-
-      return Trait::Terminator;
-
-    // Unknown
-    else
-      return Trait::Unknown;  // TODO(anonimal): review
-  }
+  Trait GetTrait(boost::string_ref value) const noexcept;
 
   /// @return String value of given transport
   /// @param transport Enumerated transport
@@ -454,6 +401,13 @@ class RouterInfo : public RouterInfoTraits, public RoutingDestination
   /// @param len RI length
   RouterInfo(const std::uint8_t* buf, std::uint16_t len);
 
+  /// @brief Create RI from buffer
+  /// @param buf RI buffer
+  /// @param len RI length
+  /// @param verify_signature False for RIs already verified when received
+  /// @notes RI is not marked as updated
+  RouterInfo(const std::uint8_t* buf, std::uint16_t len, bool verify_signature);
+
   /// @class Introducer
   struct Introducer
   {
@@ -510,13 +464,22 @@ class RouterInfo : public RouterInfoTraits, public RoutingDestination
   /// @brief Updates RI with new RI from buffer
   /// @param buf New RI buffer
   /// @param len New RI length
-  void Update(const std::uint8_t* buf, std::uint16_t len);
+  /// @param verify_signature False if the caller already verified it
+  void Update(
+      const std::uint8_t* buf,
+      std::uint16_t len,
+      bool verify_signature = true);
 
   /// @brief Loads RI buffer (by reading) if buffer is not yet available
   /// @notes Required by NetDb
   /// TODO(anonimal): remove, refactor (buffer should be guaranteed upon object creation)
   const std::uint8_t* LoadBuffer();
 
+  /// @brief Restores RI buffer from a stored copy if buffer is not yet available
+  /// @param buf Stored RI buffer
+  /// @param len Stored RI length
+  const std::uint8_t* LoadBuffer(const std::uint8_t* buf, std::uint16_t len);
+
   /// @brief Create RI and put into buffer
   /// @param private_keys Private keys used to derive signing key
   ///   (and subsequently sign the RI with)
@@ -529,7 +492,7 @@ class RouterInfo : public RouterInfoTraits, public RoutingDestination
   /// @brief Get RI profile
   /// @detail If profile does not exist, creates it
   // TODO(anonimal): not an ideal getter because of detail
-  std::shared_ptr<RouterProfile> GetProfile() const;
+  RouterProfile* GetProfile() const;
 
   // TODO(anonimal): template address getter
 
@@ -739,13 +702,6 @@ class RouterInfo : public RouterInfoTraits, public RoutingDestination
     return false;
   }
 
-  /// @brief Save RI profile
-  void SaveProfile()
-  {
-    if (m_Profile)
-      m_Profile->Save();
-  }
-
   /// @brief Human readable description of Introducer members
   /// @param introducer Introducer class to get description from
   /// @param tabs Prefix for tabulations
@@ -777,12 +733,14 @@ class RouterInfo : public RouterInfoTraits, public RoutingDestination
   /// @param verify_signature True if we should verify RI signature against identity
   void ReadFromBuffer(bool verify_signature);
 
-  /// @brief Parses complete RI
-  /// @param router_info Object to write RI to
-  void ParseRouterInfo(const std::string& router_info);
+  /// @brief Parses complete RI in place, without copying the buffer
+  /// @param buf RI buffer after the identity
+  /// @param len Remaining RI length
+  /// @throw std::length_error if RI is truncated
+  void ParseRouterInfo(const std::uint8_t* buf, std::size_t len);
 
   /// @brief Set RI capabilities from string of caps flag(s)
-  void SetCaps(const std::string& caps);
+  void SetCaps(boost::string_ref caps);
 
   /// @return Capabilities flags in string form
   const std::string GetCapsFlags() const;
@@ -811,7 +769,7 @@ class RouterInfo : public RouterInfoTraits, public RoutingDestination
   std::map<std::string, std::string> m_Options;
   bool m_IsUpdated = false, m_IsUnreachable = false;
   std::uint8_t m_SupportedTransports{}, m_Caps{};
-  mutable std::shared_ptr<RouterProfile> m_Profile;
+  mutable RouterProfile* m_Profile{};
 };
 
 }  // namespace core
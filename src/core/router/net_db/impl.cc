@@ -36,7 +36,9 @@
 
 #include <string.h>
 
-#include <cctype>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 
 #include "core/crypto/radix.h"
@@ -45,6 +47,7 @@
 
 #include "core/router/context.h"
 #include "core/router/garlic.h"
+#include "core/router/profiling.h"
 #include "core/router/transports/impl.h"
 
 #include "core/util/filesystem.h"
@@ -61,6 +64,7 @@ NetDb netdb;
 NetDb::NetDb()
     : m_IsRunning(false),
       m_Thread(nullptr),
+      m_Stores(StoreFilterCapacity, StoreFilterFalsePositive, Time::StoreFilter),
       m_Exception(__func__) {}
 
 NetDb::~NetDb() {
@@ -68,6 +72,8 @@ NetDb::~NetDb() {
 }
 
 bool NetDb::Start() {
+  if (!profiles.Open(core::GetPath(core::Path::Profiles)))
+    LOG(warning) << "NetDb: router profiles will not be saved";
   if (!Load())
     return false;
   m_IsRunning = true;
@@ -77,17 +83,21 @@ bool NetDb::Start() {
 
 void NetDb::Stop() {
   if (m_IsRunning) {
-    for (auto it : m_RouterInfos)
-      it.second->SaveProfile();
-    DeleteObsoleteProfiles();
-    m_RouterInfos.clear();
-    m_Floodfills.clear();
+    profiles.Close();
+    {
+      std::unique_lock<std::mutex> l(m_RouterInfosMutex);
+      m_RouterInfos.clear();
+      for (auto& index : m_RouterIndexes)
+        index.clear();
+    }
+    m_Floodfills.Clear();
     if (m_Thread) {
       m_IsRunning = false;
       m_Queue.WakeUp();
       m_Thread->join();
       m_Thread.reset(nullptr);
     }
+    m_Store.Close();
     m_LeaseSets.clear();
     m_Requests.Stop();
   }
@@ -98,39 +108,40 @@ void NetDb::Run() {
            last_publish = 0,
            last_exploratory = 0,
            last_manage_request = 0;
+  std::vector<std::shared_ptr<const I2NPMessage>> msgs;
+  std::vector<RouterInfoBuffer> routers;
   while (m_IsRunning) {
     try {
       // if there are no messages a timeout is executed to wait
       // for messages to be received
-      auto msg =
-        m_Queue.GetNextWithTimeout(Time::WaitForMessageTimeout);
-      if (msg) {
-        std::uint8_t num_msgs = 0;
-        while (msg) {
-          switch (msg->GetTypeID()) {
-            case I2NPDatabaseStore:
-              LOG(debug) << "NetDb: DatabaseStore";
-              HandleDatabaseStoreMsg(msg);
-            break;
-            case I2NPDatabaseSearchReply:
-              LOG(debug) << "NetDb: DatabaseSearchReply";
-              HandleDatabaseSearchReplyMsg(msg);
-            break;
-            case I2NPDatabaseLookup:
-              LOG(debug) << "NetDb: DatabaseLookup";
-              HandleDatabaseLookupMsg(msg);
-            break;
-            default:
-              // TODO(unassigned): error handling
-              LOG(error) << "NetDb: unexpected message type " << msg->GetTypeID();
-              // xi2p::HandleI2NPMessage(msg);
-          }
-          if (num_msgs > Size::MaxMessagesRead)
-            break;
-          msg = m_Queue.Get();
-          num_msgs++;
+      msgs.clear();
+      m_Queue.GetAllWithTimeout(
+          msgs, Time::WaitForMessageTimeout, Size::MaxMessagesRead);
+      for (auto const& msg : msgs) {
+        switch (msg->GetTypeID()) {
+          case I2NPDatabaseStore:
+            LOG(debug) << "NetDb: DatabaseStore";
+            HandleDatabaseStoreMsg(msg, routers);
+          break;
+          case I2NPDatabaseSearchReply:
+            LOG(debug) << "NetDb: DatabaseSearchReply";
+            HandleDatabaseSearchReplyMsg(msg);
+          break;
+          case I2NPDatabaseLookup:
+            LOG(debug) << "NetDb: DatabaseLookup";
+            HandleDatabaseLookupMsg(msg);
+          break;
+          default:
+            // TODO(unassigned): error handling
+            LOG(error) << "NetDb: unexpected message type " << msg->GetTypeID();
+            // xi2p::HandleI2NPMessage(msg);
         }
       }
+      // RIs of the burst are verified together
+      if (!routers.empty()) {
+        AddRouterInfos(routers);
+        routers.clear();
+      }
       if (!m_IsRunning)
         break;
       std::uint64_t ts = xi2p::core::GetSecondsSinceEpoch();
@@ -192,29 +203,105 @@ bool NetDb::AddRouterInfo(const std::uint8_t* buf, std::uint16_t len)
 void NetDb::AddRouterInfo(
     const IdentHash& ident,
     const std::uint8_t* buf,
-    std::uint16_t len)
+    std::uint16_t len,
+    bool verify_signature)
 {
   auto r = FindRouter(ident);
   if (r) {
     auto ts = r->GetTimestamp();
-    r->Update(buf, len);
+    auto caps = r->GetCaps();
+    r->Update(buf, len, verify_signature);
     if (r->GetTimestamp() > ts)
       LOG(debug) << "NetDb: RouterInfo updated";
+    if (r->GetCaps() != caps) {
+      {
+        // Move router to the capability indexes of its new caps
+        std::unique_lock<std::mutex> l(m_RouterInfosMutex);
+        UnindexRouterCaps(r, caps & ~r->GetCaps());
+        for (std::uint8_t index = FloodfillRouters; index < NumRouterIndexes; index++) {
+          std::uint8_t const cap = GetRouterIndexCap(static_cast<RouterIndex>(index));
+          if ((r->GetCaps() & cap) && !(caps & cap))
+            m_RouterIndexes[index].push_back(r);
+        }
+      }
+      bool const was_floodfill = caps & RouterInfo::Cap::Floodfill;
+      bool const is_floodfill = r->HasCap(RouterInfo::Cap::Floodfill);
+      if (is_floodfill != was_floodfill) {
+        std::unique_lock<std::mutex> l(m_FloodfillsMutex);
+        if (is_floodfill)
+          m_Floodfills.Insert(r->GetIdentHash(), r);
+        else
+          m_Floodfills.Remove(r->GetIdentHash());
+      }
+    }
   } else {
     LOG(debug) << "NetDb: new RouterInfo added";
-    r = std::make_shared<RouterInfo> (buf, len); {
+    r = std::make_shared<RouterInfo>(buf, len, verify_signature);
+    r->SetUpdated(true);
+    bool is_added; {
       std::unique_lock<std::mutex> l(m_RouterInfosMutex);
-      m_RouterInfos[r->GetIdentHash()] = r;
+      // Another thread may have added it meanwhile, keep the indexed instance
+      auto const it = m_RouterInfos.insert(std::make_pair(r->GetIdentHash(), r));
+      is_added = it.second;
+      if (is_added)
+        IndexRouter(r);
+      else
+        r = it.first->second;
     }
-    if (r->HasCap(RouterInfo::Cap::Floodfill)) {
+    if (is_added && r->HasCap(RouterInfo::Cap::Floodfill)) {
       std::unique_lock<std::mutex> l(m_FloodfillsMutex);
-      m_Floodfills.push_back(r);
+      m_Floodfills.Insert(r->GetIdentHash(), r);
     }
   }
   // take care about requested destination
   m_Requests.RequestComplete(ident, r);
 }
 
+std::size_t NetDb::AddRouterInfos(const std::vector<RouterInfoBuffer>& routers)
+{
+  std::vector<IdentityEx> identities(routers.size());
+  std::vector<std::size_t> queued;
+  IdentityBatchVerifier batch;
+  for (std::size_t i = 0; i < routers.size(); i++) {
+    auto const& buf = routers[i].second;
+    try {
+      std::size_t const ident_len = identities[i].FromBuffer(buf.data(), buf.size());
+      std::size_t const signature_len = identities[i].GetSignatureLen();
+      if (!ident_len
+          || buf.size() > RouterInfo::Size::MaxBuffer
+          || buf.size() < ident_len + signature_len) {
+        LOG(error) << "NetDb: unable to add router info";
+        continue;
+      }
+      std::size_t const len = buf.size() - signature_len;
+      batch.Add(identities[i], buf.data(), len, buf.data() + len);
+      queued.push_back(i);
+    } catch (...) {
+      m_Exception.Dispatch(__func__);
+    }
+  }
+  std::size_t num_added = 0;
+  auto const valid = batch.Verify();
+  for (std::size_t i = 0; i < queued.size(); i++) {
+    auto const& router = routers[queued[i]];
+    if (!valid[i]) {
+      LOG(error)
+        << "NetDb: RouterInfo " << router.first.ToBase64()
+        << " signature verification failed, dropped";
+      continue;
+    }
+    try {
+      AddRouterInfo(router.first, router.second.data(), router.second.size(), false);
+      num_added++;
+    } catch (...) {
+      m_Exception.Dispatch(__func__);
+    }
+  }
+  LOG(debug)
+    << "NetDb: " << num_added << " of " << routers.size() << " RouterInfos added";
+  return num_added;
+}
+
 void NetDb::AddLeaseSet(
     const IdentHash& ident,
     const std::uint8_t* buf,
@@ -278,29 +365,6 @@ bool NetDb::CreateNetDb(boost::filesystem::path directory)
     {
       LOG(debug) << "NetDb: ensuring " << directory.string();
       core::EnsurePath(directory);
-// TODO(unassigned): this is a patch for #520 until we implement a database in #385
-#if defined(_WIN32) || defined(__APPLE__)
-      core::EnsurePath(directory / "uppercase");
-      core::EnsurePath(directory / "lowercase");
-#endif
-    // list of chars might appear in base64 string
-    boost::filesystem::path suffix;
-    for (auto const& ch : core::Base64::GetAlphabet())
-      {
-#ifdef _WIN32
-        suffix = std::string("\\r") + ch;
-#else
-        suffix = std::string("/r") + ch;
-#endif
-        // TODO(unassigned): this is a patch for #520 until we implement a database in #385
-        std::string sub_dir;
-#if defined(_WIN32) || defined(__APPLE__)
-        sub_dir = std::isupper(ch) ? "uppercase" : "lowercase";
-#endif
-        const auto& path = directory / sub_dir / suffix;
-        LOG(debug) << "NetDb: ensuring " << path;
-        core::EnsurePath(path);
-      }
     }
   catch (...)
     {
@@ -318,11 +382,14 @@ bool NetDb::Load()
     return false;
   // Cleanup the database from previous attempts
   m_RouterInfos.clear();
-  m_Floodfills.clear();
-  // Load RI's from given path
-  std::size_t num_routers = 0;
-  auto LoadRouterInfos = [&](const boost::filesystem::path& path) {
-    std::uint64_t timestamp = xi2p::core::GetMillisecondsSinceEpoch();
+  for (auto& index : m_RouterIndexes)
+    index.clear();
+  m_Floodfills.Clear();
+  // RI files written before the store existed are imported once, then removed
+  std::vector<std::string> files;
+  auto ListRouterInfos = [&files](const boost::filesystem::path& path) {
+    if (!boost::filesystem::is_directory(path))
+      return;
     boost::filesystem::directory_iterator end;
     for (boost::filesystem::directory_iterator dir(path); dir != end; ++dir)
       {
@@ -331,64 +398,208 @@ bool NetDb::Load()
             for (boost::filesystem::directory_iterator it(dir->path());
                  it != end;
                  ++it)
-              {
-                const std::string& full_path = it->path().string();
-                auto router = std::make_shared<RouterInfo>(full_path);
-                if (!router->IsUnreachable()
-                    && (!router->UsesIntroducer()
-                        || timestamp < router->GetTimestamp()
-                                    + Time::RouterExpiration))
-                  {
-                    router->DeleteBuffer();
-                    router->GetOptions().clear();  // options are not used for regular routers  // TODO(anonimal): review
-                    m_RouterInfos.insert(std::make_pair(router->GetIdentHash(), router));
-                    if (router->HasCap(RouterInfo::Cap::Floodfill))
-                      m_Floodfills.push_back(router);
-                    num_routers++;
-                  }
-                else
-                  {
-                    // Remove unreachable routers
-                    if (boost::filesystem::remove(full_path))
-                      LOG(debug) << "NetDb: " << full_path
-                                 << " unreachable router removed";
-                  }
-              }
+              files.push_back(it->path().string());
           }
       }
   };
 // TODO(unassigned): this is a patch for #520 until we implement a database in #385
 #if defined(_WIN32) || defined(__APPLE__)
-  LoadRouterInfos(path / "uppercase");
-  LoadRouterInfos(path / "lowercase");
+  ListRouterInfos(path / "uppercase");
+  ListRouterInfos(path / "lowercase");
 #else
-  LoadRouterInfos(path);
+  ListRouterInfos(path);
 #endif
+  // Each loader keeps its own results, merged once all are done
+  struct LoadedRouterInfos
+  {
+    std::vector<std::shared_ptr<RouterInfo>> routers;
+    std::vector<std::pair<std::shared_ptr<RouterInfo>, std::string>> imported;
+    std::vector<IdentHash> erased;
+    std::size_t num_removed = 0, num_failed = 0;
+    std::chrono::steady_clock::duration parse_time{};
+  };
+  std::size_t num_files = 0, num_loaders = 0;
+  std::vector<LoadedRouterInfos> loaded;
+  auto const start = std::chrono::steady_clock::now();
+  // Stored and imported RI's are parsed and checked by a pool of loaders
+  auto LoadRecords = [&](const std::vector<NetDbStore::Record>& records) {
+    num_files = files.size() + records.size();
+    std::uint64_t timestamp = xi2p::core::GetMillisecondsSinceEpoch();
+    std::atomic<std::size_t> next(0);
+    auto LoadRouterInfos = [&](LoadedRouterInfos& result) {
+      for (std::size_t i = next++; i < num_files; i = next++)
+        {
+          bool const is_file = i < files.size();
+          auto const parse_start = std::chrono::steady_clock::now();
+          std::shared_ptr<RouterInfo> router;
+          try
+            {
+              if (is_file)
+                {
+                  router = std::make_shared<RouterInfo>(files[i]);
+                }
+              else
+                {
+                  auto const& record = records[i - files.size()];
+                  // Verified when received, before it was stored
+                  router = std::make_shared<RouterInfo>(record.buf, record.len, false);
+                }
+            }
+          catch (...)
+            {
+              LOG(warning) << "NetDb: unable to load "
+                           << (is_file ? files[i] : "stored RouterInfo");
+              result.num_failed++;
+              continue;
+            }
+          result.parse_time += std::chrono::steady_clock::now() - parse_start;
+          if (!router->IsUnreachable()
+              && (!router->UsesIntroducer()
+                  || timestamp < router->GetTimestamp()
+                              + Time::RouterExpiration))
+            {
+              router->GetOptions().clear();  // options are not used for regular routers  // TODO(anonimal): review
+              if (is_file)
+                {
+                  // Buffer is kept until it is written to the store
+                  result.imported.emplace_back(router, files[i]);
+                }
+              else
+                {
+                  router->DeleteBuffer();
+                  result.routers.push_back(router);
+                }
+            }
+          else
+            {
+              // Remove unreachable routers
+              if (is_file)
+                boost::filesystem::remove(files[i]);
+              else
+                result.erased.push_back(router->GetIdentHash());
+              LOG(debug) << "NetDb: " << router->GetIdentHashAbbreviation()
+                         << " unreachable router removed";
+              result.num_removed++;
+            }
+        }
+      // Imported files never passed through the store, verify them together
+      IdentityBatchVerifier batch;
+      for (auto const& import : result.imported)
+        {
+          auto const& router = import.first;
+          std::size_t const len = router->GetBufferLen()
+              - router->GetRouterIdentity().GetSignatureLen();
+          batch.Add(
+              router->GetRouterIdentity(),
+              router->GetBuffer(),
+              len,
+              router->GetBuffer() + len);
+        }
+      std::vector<bool> valid(result.imported.size(), false);
+      try
+        {
+          valid = batch.Verify();
+        }
+      catch (...)
+        {
+          LOG(warning) << "NetDb: unable to verify imported RouterInfos";
+        }
+      std::size_t num_valid = 0;
+      for (std::size_t i = 0; i < result.imported.size(); i++)
+        {
+          if (valid[i])
+            {
+              result.imported[num_valid++] = std::move(result.imported[i]);
+              continue;
+            }
+          LOG(warning) << "NetDb: " << result.imported[i].second
+                       << " has a bad signature, removed";
+          boost::filesystem::remove(result.imported[i].second);
+          result.num_failed++;
+        }
+      result.imported.resize(num_valid);
+    };
+    num_loaders = std::min<std::size_t>(
+        {std::max(1u, std::thread::hardware_concurrency()),
+         Size::MaxLoadThreads,
+         num_files / Size::MinFilesPerLoadThread + 1});
+    loaded.resize(num_loaders);
+    std::vector<std::thread> loaders;
+    for (std::size_t i = 1; i < num_loaders; i++)
+      loaders.emplace_back(LoadRouterInfos, std::ref(loaded[i]));
+    LoadRouterInfos(loaded[0]);
+    for (auto& loader : loaders)
+      loader.join();
+  };
+  if (!m_Store.Open((path / "router_infos.dat").string(), LoadRecords))
+    return false;
+  // Merge into the database
+  std::size_t num_routers = 0, num_removed = 0, num_failed = 0;
+  std::chrono::steady_clock::duration parse_time{};
+  auto AddRouter = [&](const std::shared_ptr<RouterInfo>& router) {
+    if (!m_RouterInfos.insert(
+            std::make_pair(router->GetIdentHash(), router)).second)
+      return false;
+    IndexRouter(router);
+    if (router->HasCap(RouterInfo::Cap::Floodfill))
+      m_Floodfills.Insert(router->GetIdentHash(), router);
+    num_routers++;
+    return true;
+  };
+  for (auto& result : loaded)
+    {
+      for (auto const& router : result.routers)
+        AddRouter(router);
+      for (auto const& import : result.imported)
+        {
+          auto const& router = import.first;
+          if (AddRouter(router))
+            m_Store.Put(
+                router->GetIdentHash(),
+                router->GetBuffer(),
+                router->GetBufferLen());
+          router->DeleteBuffer();
+        }
+      for (auto const& ident : result.erased)
+        m_Store.Erase(ident);
+      num_removed += result.num_removed;
+      num_failed += result.num_failed;
+      parse_time += result.parse_time;
+    }
+  if (!m_Store.Flush())
+    return false;
+  // Imported files are only removed once the store holds them
+  for (auto const& result : loaded)
+    for (auto const& import : result.imported)
+      boost::filesystem::remove(import.second);
+  auto const elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
   LOG(debug) << "NetDb: " << num_routers << " routers loaded";
-  LOG(debug) << "NetDb: " << m_Floodfills.size() << " floodfills loaded";
+  LOG(debug) << "NetDb: " << m_Floodfills.GetSize() << " floodfills loaded";
+  LOG(info)
+    << "NetDb: read " << num_files << " RouterInfos (" << files.size()
+    << " imported files) in " << elapsed << " ms ("
+    << (elapsed ? num_files * 1000 / elapsed : num_files) << " RIs/s) with "
+    << num_loaders << " loaders, parsing took "
+    << std::chrono::duration_cast<std::chrono::milliseconds>(parse_time).count()
+    << " ms, " << num_removed << " unreachable removed, "
+    << num_failed << " failed";
   return true;
 }
 
 void NetDb::SaveUpdated() {
-  auto GetFilePath = [](
-      const boost::filesystem::path& directory,
-      const RouterInfo* router_info) {
-    const std::string base64(router_info->GetIdentHash().ToBase64());
-    // TODO(unassigned): this is a patch for #520 until we implement a database in #385
-    std::string sub_dir;
-#if defined(_WIN32) || defined(__APPLE__)
-    sub_dir = std::isupper(base64[0]) ? "uppercase" : "lowercase";
-#endif
-    return directory / sub_dir / (std::string("r") + base64[0]) / ("router_info_" + base64 + ".dat");
-  };
-  boost::filesystem::path full_directory(core::GetPath(core::Path::NetDb));
   std::size_t count{}, deleted_count{}, total = GetNumRouters();
   std::uint64_t ts = xi2p::core::GetMillisecondsSinceEpoch();
   for (auto it : m_RouterInfos) {
     if (it.second->IsUpdated()) {
-      std::string f = GetFilePath(full_directory, it.second.get()).string();
-      LOG(debug) << "NetDb: " << __func__ << " saving " << f;
-      it.second->SaveToFile(f);
+      LOG(debug)
+        << "NetDb: " << __func__ << " saving "
+        << it.second->GetIdentHashAbbreviation();
+      if (it.second->GetBuffer())
+        m_Store.Put(
+            it.first,
+            it.second->GetBuffer(),
+            it.second->GetBufferLen());
       it.second->SetUpdated(false);
       it.second->SetUnreachable(false);
       it.second->DeleteBuffer();
@@ -431,20 +642,22 @@ void NetDb::SaveUpdated() {
       }
       if (it.second->IsUnreachable()) {
         total--;
-        // delete RI file
-        bool is_removed =
-	  boost::filesystem::remove(
-	      GetFilePath(full_directory, it.second.get()));
-	 if (is_removed)
-	   deleted_count++;
-        // delete from floodfills list
-        if (it.second->HasCap(RouterInfo::Cap::Floodfill)) {
+        // delete stored RI
+        if (m_Store.Erase(it.first))
+          deleted_count++;
+        // delete from floodfills list, caps may have changed since insertion
+        {
           std::unique_lock<std::mutex> l(m_FloodfillsMutex);
-          m_Floodfills.remove(it.second);
+          m_Floodfills.Remove(it.first);
         }
       }
     }
   }
+  // All changes go out with a single append
+  m_Store.Flush();
+  if (auto const expired = profiles.Expire(xi2p::core::GetSecondsSinceEpoch()))
+    LOG(debug) << "NetDb: " << expired << " expired profiles reclaimed";
+  profiles.Flush();
   if (count)
     LOG(debug) << "NetDb: " << count << " new/updated routers saved";
   if (deleted_count) {
@@ -453,12 +666,12 @@ void NetDb::SaveUpdated() {
     std::unique_lock<std::mutex> l(m_RouterInfosMutex);
     for (auto it = m_RouterInfos.begin(); it != m_RouterInfos.end();) {
       if (it->second->IsUnreachable()) {
-        it->second->SaveProfile();
         it = m_RouterInfos.erase(it);
       } else {
         it++;
       }
     }
+    RebuildRouterIndexes();
   }
 }
 
@@ -494,7 +707,8 @@ void NetDb::RequestDestination(
 // TODO(anonimal): bytestream refactor
 
 void NetDb::HandleDatabaseStoreMsg(
-    std::shared_ptr<const I2NPMessage> m) {
+    std::shared_ptr<const I2NPMessage> m,
+    std::vector<RouterInfoBuffer>& routers) {
   const std::uint8_t* buf = m->GetPayload();
   std::uint16_t len = m->GetSize();
   IdentHash ident(buf + DATABASE_STORE_KEY_OFFSET);
@@ -521,25 +735,35 @@ void NetDb::HandleDatabaseStoreMsg(
         LOG(error) << "NetDb: no outbound tunnels for DatabaseStore reply found";
     }
     offset += 32;
-    if (context.IsFloodfill()) {
-      // flood it
-      auto flood_msg = ToSharedI2NPMessage(NewI2NPShortMessage());
-      std::uint8_t* payload = flood_msg->GetPayload();
-      memcpy(payload, buf, 33);  // key + type
-      // zero reply token
-      core::OutputByteStream::Write<std::uint32_t>(
-          payload + DATABASE_STORE_REPLY_TOKEN_OFFSET, 0);
-      memcpy(payload + DATABASE_STORE_HEADER_SIZE, buf + offset, len - offset);
-      flood_msg->len += DATABASE_STORE_HEADER_SIZE + len -offset;
-      flood_msg->FillI2NPMessageHeader(I2NPDatabaseStore);
-      std::set<IdentHash> excluded;
-      for (std::uint8_t i = 0; i < 3; i++) {  // TODO(anonimal): enumerate
-        auto floodfill = GetClosestFloodfill(ident, excluded);
-        if (floodfill)
-          xi2p::core::transports.SendMessage(
-              floodfill->GetIdentHash(),
-              flood_msg);
-      }
+  }
+  if (len < offset) {
+    LOG(error) << "NetDb: database store too short, dropped";
+    return;
+  }
+  // Floodfills flood a store to several of us: once seen, it is not flooded
+  // again. It is still stored below, since it may answer a lookup or replace
+  // an entry that was rejected or has expired.
+  bool const flood = reply_token && context.IsFloodfill();
+  if (flood && m_Stores.CheckAndAdd(buf + offset, len - offset)) {
+    LOG(debug) << "NetDb: duplicate database store, not flooded";
+  } else if (flood) {
+    // flood it
+    auto flood_msg = ToSharedI2NPMessage(NewI2NPShortMessage());
+    std::uint8_t* payload = flood_msg->GetPayload();
+    memcpy(payload, buf, 33);  // key + type
+    // zero reply token
+    core::OutputByteStream::Write<std::uint32_t>(
+        payload + DATABASE_STORE_REPLY_TOKEN_OFFSET, 0);
+    memcpy(payload + DATABASE_STORE_HEADER_SIZE, buf + offset, len - offset);
+    flood_msg->len += DATABASE_STORE_HEADER_SIZE + len -offset;
+    flood_msg->FillI2NPMessageHeader(I2NPDatabaseStore);
+    std::set<IdentHash> excluded;
+    for (std::uint8_t i = 0; i < 3; i++) {  // TODO(anonimal): enumerate
+      auto floodfill = GetClosestFloodfill(ident, excluded);
+      if (floodfill)
+        xi2p::core::transports.SendMessage(
+            floodfill->GetIdentHash(),
+            flood_msg);
     }
   }
   if (buf[DATABASE_STORE_TYPE_OFFSET]) {  // type
@@ -558,7 +782,6 @@ void NetDb::HandleDatabaseStoreMsg(
     try {
       xi2p::core::Gunzip decompressor;
       decompressor.Put(buf + offset, size);
-      std::array<std::uint8_t, RouterInfo::Size::MaxBuffer> uncompressed {{}};
       std::size_t uncompressed_size = decompressor.MaxRetrievable();
       if (uncompressed_size > RouterInfo::Size::MaxBuffer) {
         LOG(error)
@@ -566,8 +789,9 @@ void NetDb::HandleDatabaseStoreMsg(
           << static_cast<int>(uncompressed_size);
 	return;
       }
+      std::vector<std::uint8_t> uncompressed(uncompressed_size);
       decompressor.Get(uncompressed.data(), uncompressed_size);
-      AddRouterInfo(ident, uncompressed.data(), uncompressed_size);
+      routers.emplace_back(ident, std::move(uncompressed));
     } catch (...) {
       m_Exception.Dispatch(__func__);
     }
@@ -713,7 +937,11 @@ void NetDb::HandleDatabaseLookupMsg(
       auto router = FindRouter(ident);
       if (router) {
         LOG(debug) << "NetDb: requested RouterInfo " << key << " found";
-        router->LoadBuffer();
+        if (!router->GetBuffer()) {
+          std::vector<std::uint8_t> buf;
+          if (m_Store.Read(router->GetIdentHash(), buf))
+            router->LoadBuffer(buf.data(), buf.size());
+        }
         if (router->GetBuffer())
           reply_msg = CreateDatabaseStoreMsg(router);
       }
@@ -789,14 +1017,25 @@ void NetDb::Explore(std::uint16_t num_destinations)
   std::set<const RouterInfo *> floodfills;
   // TODO(unassigned): docs
   LOG(debug) << "NetDb: exploring " << num_destinations << " new routers";
+  std::vector<IdentHash> random_hashes;
+  std::vector<std::shared_ptr<RequestedDestination>> dests;
+  std::vector<const std::set<IdentHash>*> excluded;
   for (std::uint16_t i = 0; i < num_destinations; i++) {
     xi2p::core::RandBytes(random_hash.data(), random_hash.size());
     auto dest = m_Requests.CreateRequest(random_hash.data(), true);  // exploratory
     if (!dest) {
       LOG(warning) << "NetDb: exploratory destination was already requested";
-      return;
+      break;
     }
-    auto floodfill = GetClosestFloodfill(random_hash.data(), dest->GetExcludedPeers());
+    random_hashes.push_back(random_hash.data());
+    excluded.push_back(&dest->GetExcludedPeers());
+    dests.push_back(dest);
+  }
+  // Look up all floodfills at once
+  auto const closest = GetClosestFloodfill(random_hashes, excluded);
+  for (std::size_t i = 0; i < dests.size(); i++) {
+    auto const& dest = dests[i];
+    auto const& floodfill = closest[i];
     if (floodfill &&
         !floodfills.count(floodfill.get())) {  // request floodfill only once
       floodfills.insert(floodfill.get());
@@ -826,7 +1065,7 @@ void NetDb::Explore(std::uint16_t num_destinations)
               floodfill->GetIdentHash()));
       }
     } else {
-      m_Requests.RequestComplete(random_hash.data(), nullptr);
+      m_Requests.RequestComplete(random_hashes[i], nullptr);
     }
   }
   if (through_tunnels && !msgs.empty())
@@ -857,9 +1096,9 @@ void NetDb::Publish() {
 
 // TODO(anonimal): refactor these getters into fewer functions
 std::shared_ptr<const RouterInfo> NetDb::GetRandomRouter() const {
-  return GetRandomRouter([](std::shared_ptr<const RouterInfo> router) -> bool {
-    return !router->HasCap(RouterInfo::Cap::Hidden)
-           && (router->GetIdentHash()
+  return GetRandomRouter(AllRouters, [](const RouterInfo& router) -> bool {
+    return !router.HasCap(RouterInfo::Cap::Hidden)
+           && (router.GetIdentHash()
                != core::context.GetRouterInfo().GetIdentHash());
   });
 }
@@ -867,29 +1106,30 @@ std::shared_ptr<const RouterInfo> NetDb::GetRandomRouter() const {
 std::shared_ptr<const RouterInfo> NetDb::GetRandomRouter(
     std::shared_ptr<const RouterInfo> compatible_with) const {
   return GetRandomRouter(
-      [compatible_with](std::shared_ptr<const RouterInfo> router) -> bool {
-        return !router->HasCap(RouterInfo::Cap::Hidden)
-               && router != compatible_with
-               && router->HasCompatibleTransports(*compatible_with)
-               && (router->GetIdentHash()
+      AllRouters,
+      [&compatible_with](const RouterInfo& router) -> bool {
+        return !router.HasCap(RouterInfo::Cap::Hidden)
+               && &router != compatible_with.get()
+               && router.HasCompatibleTransports(*compatible_with)
+               && (router.GetIdentHash()
                    != core::context.GetRouterInfo().GetIdentHash());
       });
 }
 
 std::shared_ptr<const RouterInfo> NetDb::GetRandomPeerTestRouter() const {
-  return GetRandomRouter([](std::shared_ptr<const RouterInfo> router) -> bool {
-    return !router->HasCap(RouterInfo::Cap::Hidden)
-           && router->HasCap(RouterInfo::Cap::SSUTesting)
-           && (router->GetIdentHash()
+  return GetRandomRouter(PeerTestingRouters, [](const RouterInfo& router) -> bool {
+    return !router.HasCap(RouterInfo::Cap::Hidden)
+           && router.HasCap(RouterInfo::Cap::SSUTesting)
+           && (router.GetIdentHash()
                != core::context.GetRouterInfo().GetIdentHash());
   });
 }
 
 std::shared_ptr<const RouterInfo> NetDb::GetRandomIntroducer() const {
-  return GetRandomRouter([](std::shared_ptr<const RouterInfo> router) -> bool {
-    return !router->HasCap(RouterInfo::Cap::Hidden)
-           && router->HasCap(RouterInfo::Cap::SSUIntroducer)
-           && (router->GetIdentHash()
+  return GetRandomRouter(IntroducerRouters, [](const RouterInfo& router) -> bool {
+    return !router.HasCap(RouterInfo::Cap::Hidden)
+           && router.HasCap(RouterInfo::Cap::SSUIntroducer)
+           && (router.GetIdentHash()
                != core::context.GetRouterInfo().GetIdentHash());
   });
 }
@@ -897,39 +1137,102 @@ std::shared_ptr<const RouterInfo> NetDb::GetRandomIntroducer() const {
 std::shared_ptr<const RouterInfo> NetDb::GetHighBandwidthRandomRouter(
     std::shared_ptr<const RouterInfo> compatible_with) const {
   return GetRandomRouter(
-      [compatible_with](std::shared_ptr<const RouterInfo> router) -> bool {
-        return !router->HasCap(RouterInfo::Cap::Hidden)
-               && router != compatible_with
-               && router->HasCompatibleTransports(*compatible_with)
-               && (router->GetCaps() & RouterInfo::Cap::HighBandwidth)
-               && (router->GetIdentHash()
+      HighBandwidthRouters,
+      [&compatible_with](const RouterInfo& router) -> bool {
+        return !router.HasCap(RouterInfo::Cap::Hidden)
+               && &router != compatible_with.get()
+               && router.HasCompatibleTransports(*compatible_with)
+               && (router.GetCaps() & RouterInfo::Cap::HighBandwidth)
+               && (router.GetIdentHash()
                    != core::context.GetRouterInfo().GetIdentHash());
       });
 }
 
-template<typename Filter>
-std::shared_ptr<const RouterInfo> NetDb::GetRandomRouter(
-    Filter filter) const {
+std::uint8_t NetDb::GetRouterIndexCap(
+    RouterIndex index) noexcept {
+  switch (index) {
+    case FloodfillRouters:
+      return RouterInfo::Cap::Floodfill;
+    case HighBandwidthRouters:
+      return RouterInfo::Cap::HighBandwidth;
+    case IntroducerRouters:
+      return RouterInfo::Cap::SSUIntroducer;
+    case PeerTestingRouters:
+      return RouterInfo::Cap::SSUTesting;
+    default:
+      return 0;
+  }
+}
 
-  // Lock RI's
-  std::unique_lock<std::mutex> l(m_RouterInfosMutex);
+void NetDb::IndexRouter(
+    const std::shared_ptr<RouterInfo>& router) {
+  m_RouterIndexes[AllRouters].push_back(router);
+  for (std::uint8_t index = FloodfillRouters; index < NumRouterIndexes; index++)
+    if (router->GetCaps() & GetRouterIndexCap(static_cast<RouterIndex>(index)))
+      m_RouterIndexes[index].push_back(router);
+}
 
-  // Instead of using expensive map copying (in an attempt to shuffle),
-  // we'll create a vector of pointers to map's key, randomize, then iterate
-  // to ensure that a random RI will be selected for test-case
-  std::vector<std::unique_ptr<IdentHash>> idents;
+void NetDb::UnindexRouterCaps(
+    const std::shared_ptr<RouterInfo>& router,
+    std::uint8_t caps) {
+  for (std::uint8_t index = FloodfillRouters; index < NumRouterIndexes; index++) {
+    if (!(caps & GetRouterIndexCap(static_cast<RouterIndex>(index))))
+      continue;
+    // Order is irrelevant for random selection, swap with the last one
+    auto& routers = m_RouterIndexes[index];
+    auto it = std::find(routers.begin(), routers.end(), router);
+    if (it != routers.end()) {
+      std::swap(*it, routers.back());
+      routers.pop_back();
+    }
+  }
+}
 
-  // Save pointers to keys
-  for (auto const& ri : m_RouterInfos)
-    idents.push_back(std::make_unique<IdentHash>(ri.first));
+void NetDb::RebuildRouterIndexes() {
+  for (auto& index : m_RouterIndexes)
+    index.clear();
+  for (auto const& it : m_RouterInfos)
+    IndexRouter(it.second);
+}
 
-  // Randomize they keys for selection
-  xi2p::core::Shuffle(idents.begin(), idents.end());
+template<typename Filter>
+std::shared_ptr<const RouterInfo> NetDb::GetRandomRouter(
+    RouterIndex index,
+    Filter filter) const {
+  auto const& routers = m_RouterIndexes[index];
 
-  // Use keys for test-case
-  for (auto const& i : idents) {
-    if (!m_RouterInfos.at(*i)->IsUnreachable() && filter(m_RouterInfos.at(*i)))
-      return m_RouterInfos.at(*i);
+  // Most filters accept most of the index, so a few probes will do
+  for (std::uint8_t probe = 0; probe < Size::RandomRouterProbes; probe++) {
+    std::shared_ptr<const RouterInfo> router; {
+      std::unique_lock<std::mutex> l(m_RouterInfosMutex);
+      if (routers.empty())
+        return nullptr;
+      router = routers[RandInRange32(0, routers.size() - 1)];
+    }
+    if (!router->IsUnreachable() && filter(*router))
+      return router;
+  }
+
+  // Selective filter: walk the index from a random offset, releasing the lock
+  // between chunks. The index may shrink meanwhile, so bound by its size.
+  std::size_t size, start; {
+    std::unique_lock<std::mutex> l(m_RouterInfosMutex);
+    size = routers.size();
+    if (!size)
+      return nullptr;
+    start = RandInRange32(0, size - 1);
+  }
+  for (std::size_t offset = 0; offset < size;) {
+    std::unique_lock<std::mutex> l(m_RouterInfosMutex);
+    size = std::min(size, routers.size());
+    for (std::size_t const end = std::min<std::size_t>(
+             offset + Size::RouterIndexScanChunk, size);
+         offset < end;
+         offset++) {
+      auto const& router = routers[(start + offset) % size];
+      if (!router->IsUnreachable() && filter(*router))
+        return router;
+    }
   }
 
   // We don't have enough routers which fit criteria
@@ -938,70 +1241,66 @@ std::shared_ptr<const RouterInfo> NetDb::GetRandomRouter(
 
 void NetDb::PostI2NPMsg(
     std::shared_ptr<const I2NPMessage> msg) {
-  if (msg)
-    m_Queue.Put(msg);
+  if (msg && !m_Queue.Put(msg))
+    LOG(warning) << "NetDb: message queue is full, dropped message";
 }
 
 std::shared_ptr<const RouterInfo> NetDb::GetClosestFloodfill(
     const IdentHash& destination,
     const std::set<IdentHash>& excluded) const {
   std::shared_ptr<const RouterInfo> r;
-  XORMetric min_metric;
   IdentHash dest_key = CreateRoutingKey(destination);
-  min_metric.SetMax();
   std::unique_lock<std::mutex> l(m_FloodfillsMutex);
-  for (auto it : m_Floodfills) {
-    if (!it->IsUnreachable()) {
-      XORMetric m = dest_key ^ it->GetIdentHash();
-      if (m < min_metric && !excluded.count(it->GetIdentHash())) {
-        min_metric = m;
-        r = it;
-      }
-    }
-  }
+  m_Floodfills.VisitClosest(
+      dest_key,
+      [&](const IdentHash& ident, const std::shared_ptr<RouterInfo>& router) {
+        if (router->IsUnreachable() || excluded.count(ident))
+          return true;
+        r = router;
+        return false;
+      });
   return r;
 }
 
+std::vector<std::shared_ptr<const RouterInfo>> NetDb::GetClosestFloodfill(
+    const std::vector<IdentHash>& destinations,
+    const std::vector<const std::set<IdentHash>*>& excluded) const {
+  std::vector<IdentHash> dest_keys;
+  dest_keys.reserve(destinations.size());
+  for (auto const& destination : destinations)
+    dest_keys.push_back(CreateRoutingKey(destination));
+  std::vector<std::shared_ptr<const RouterInfo>> res(destinations.size());
+  std::unique_lock<std::mutex> l(m_FloodfillsMutex);
+  for (std::size_t i = 0; i < dest_keys.size(); i++) {
+    m_Floodfills.VisitClosest(
+        dest_keys[i],
+        [&](const IdentHash& ident, const std::shared_ptr<RouterInfo>& router) {
+          if (router->IsUnreachable() || excluded[i]->count(ident))
+            return true;
+          res[i] = router;
+          return false;
+        });
+  }
+  return res;
+}
+
 std::vector<IdentHash> NetDb::GetClosestFloodfills(
     const IdentHash& destination,
     std::uint8_t num,
     std::set<IdentHash>& excluded) const
 {
-  struct Sorted {
-    std::shared_ptr<const RouterInfo> r;
-    XORMetric metric;
-    bool operator<(const Sorted& other) const {
-      return metric < other.metric;
-    }
-  };
-  std::set<Sorted> sorted;
-  IdentHash dest_key = CreateRoutingKey(destination); {
-    std::unique_lock<std::mutex> l(m_FloodfillsMutex);
-    for (auto it : m_Floodfills) {
-      if (!it->IsUnreachable()) {
-        XORMetric m = dest_key ^ it->GetIdentHash();
-        if (sorted.size() < num) {
-          sorted.insert({it, m});
-        } else if (m < sorted.rbegin()->metric) {
-          sorted.insert({it, m});
-          sorted.erase(std::prev(sorted.end()));
-        }
-      }
-    }
-  }
   std::vector<IdentHash> res;
-  std::uint8_t i{};
-  for (auto it : sorted) {
-    if (i < num) {
-      auto& ident = it.r->GetIdentHash();
-      if (!excluded.count(ident)) {
-        res.push_back(ident);
-        i++;
-      }
-    } else {
-      break;
-    }
-  }
+  if (!num)
+    return res;
+  IdentHash dest_key = CreateRoutingKey(destination);
+  std::unique_lock<std::mutex> l(m_FloodfillsMutex);
+  m_Floodfills.VisitClosest(
+      dest_key,
+      [&](const IdentHash& ident, const std::shared_ptr<RouterInfo>& router) {
+        if (!router->IsUnreachable() && !excluded.count(ident))
+          res.push_back(ident);
+        return res.size() < num;
+      });
   return res;
 }
 
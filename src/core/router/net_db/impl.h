@@ -33,24 +33,28 @@
 #ifndef SRC_CORE_ROUTER_NET_DB_IMPL_H_
 #define SRC_CORE_ROUTER_NET_DB_IMPL_H_
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
-#include <list>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include "core/router/i2np.h"
 #include "core/router/info.h"
 #include "core/router/lease_set.h"
 #include "core/router/net_db/requests.h"
+#include "core/router/net_db/store.h"
+#include "core/router/net_db/xor_trie.h"
 #include "core/router/tunnel/pool.h"
 #include "core/router/tunnel/impl.h"
 
+#include "core/util/bloom_filter.h"
 #include "core/util/exception.h"
 #include "core/util/queue.h"
 
@@ -99,8 +103,18 @@ struct NetDbTraits
     ///   exceeds minimum unreachable routers
     /// @notes Measured in hours
     RouterMaxGracePeriod = 72,
+
+    /// @brief Lifetime of a generation of the database stores filter
+    /// @notes Measured in seconds
+    StoreFilter = 600,
   };
 
+  /// @brief Database stores held by a generation of the stores filter
+  static constexpr std::size_t StoreFilterCapacity = 1 << 18;
+
+  /// @brief Highest false positive rate of the stores filter
+  static constexpr double StoreFilterFalsePositive = 1e-6;
+
   /// @enum Size
   /// @brief NetDb sizes/counts-related traits
   enum Size : const std::uint16_t
@@ -139,6 +153,18 @@ struct NetDbTraits
 
     /// @brief the maximum limit for number of routers to be set unreachable
     MaxRouterUnreachable = 300,
+
+    /// @brief Random probes into a router index before falling back to a scan
+    RandomRouterProbes = 16,
+
+    /// @brief Routers examined per lock hold when scanning a router index
+    RouterIndexScanChunk = 64,
+
+    /// @brief Max number of threads parsing RI files when loading NetDb
+    MaxLoadThreads = 8,
+
+    /// @brief RI files per additional loader thread
+    MinFilesPerLoadThread = 256,
   };
 };
 
@@ -153,10 +179,20 @@ class NetDb : public NetDbTraits {
   /// @return False on failure
   bool AddRouterInfo(const std::uint8_t* buf, std::uint16_t len);
 
+  /// @param verify_signature False if the caller already verified it
   void AddRouterInfo(
       const IdentHash& ident,
       const std::uint8_t* buf,
-      std::uint16_t len);
+      std::uint16_t len,
+      bool verify_signature = true);
+
+  /// @brief RI buffer and the key it was stored under
+  typedef std::pair<IdentHash, std::vector<std::uint8_t>> RouterInfoBuffer;
+
+  /// @brief Adds RIs whose signatures are verified as one batch
+  /// @details RIs with a bad signature are dropped
+  /// @return Number of RIs added
+  std::size_t AddRouterInfos(const std::vector<RouterInfoBuffer>& routers);
 
   void AddLeaseSet(
       const IdentHash& ident,
@@ -174,8 +210,11 @@ class NetDb : public NetDbTraits {
       const IdentHash& destination,
       RequestedDestination::RequestComplete request_complete = nullptr);
 
+  /// @param routers Receives the RI of the message, to be added together
+  ///   with the rest of its burst
   void HandleDatabaseStoreMsg(
-      std::shared_ptr<const I2NPMessage> msg);
+      std::shared_ptr<const I2NPMessage> msg,
+      std::vector<RouterInfoBuffer>& routers);
 
   void HandleDatabaseSearchReplyMsg(
       std::shared_ptr<const I2NPMessage> msg);
@@ -199,6 +238,13 @@ class NetDb : public NetDbTraits {
       const IdentHash& destination,
       const std::set<IdentHash>& excluded) const;
 
+  /// @brief Finds the closest floodfill of each destination, taking the
+  ///   floodfills lock once for the whole batch
+  /// @param excluded Excluded peers of each destination, in the same order
+  std::vector<std::shared_ptr<const RouterInfo>> GetClosestFloodfill(
+      const std::vector<IdentHash>& destinations,
+      const std::vector<const std::set<IdentHash>*>& excluded) const;
+
   std::vector<IdentHash> GetClosestFloodfills(
       const IdentHash& destination,
       std::uint8_t num,
@@ -222,7 +268,7 @@ class NetDb : public NetDbTraits {
 
   std::size_t GetNumFloodfills() const
   {
-    return m_Floodfills.size();
+    return m_Floodfills.GetSize();
   }
 
   std::size_t GetNumLeaseSets() const
@@ -230,6 +276,12 @@ class NetDb : public NetDbTraits {
     return m_LeaseSets.size();
   }
 
+  /// @return Number of messages dropped because the queue was full
+  std::size_t GetNumDroppedMsgs() const
+  {
+    return m_Queue.GetNumDropped();
+  }
+
  private:
   bool CreateNetDb(boost::filesystem::path directory);
   /// @brief Loads RI's from disk
@@ -242,19 +294,60 @@ class NetDb : public NetDbTraits {
   void ManageLeaseSets();
   void ManageRequests();
 
-  /// @brief Randomly selects a router from stored RI's according to filter
+  /// @enum RouterIndex
+  /// @brief Contiguous indexes of known routers used for random selection
+  enum RouterIndex : std::uint8_t
+  {
+    AllRouters,
+    FloodfillRouters,
+    HighBandwidthRouters,
+    IntroducerRouters,
+    PeerTestingRouters,
+    NumRouterIndexes,
+  };
+
+  /// @return Cap a router needs to be in given capability index
+  static std::uint8_t GetRouterIndexCap(
+      RouterIndex index) noexcept;
+
+  /// @brief Adds router to the full index and to the indexes of its caps
+  /// @note RouterInfos mutex must be held
+  void IndexRouter(
+      const std::shared_ptr<RouterInfo>& router);
+
+  /// @brief Removes router from the capability indexes of given caps
+  /// @note RouterInfos mutex must be held
+  void UnindexRouterCaps(
+      const std::shared_ptr<RouterInfo>& router,
+      std::uint8_t caps);
+
+  /// @brief Rebuilds all indexes from the RouterInfos table
+  /// @note RouterInfos mutex must be held
+  void RebuildRouterIndexes();
+
+  /// @brief Randomly selects a router from given index according to filter
   ///   (and other criteria determined internally)
+  /// @details Probes random slots of the index first, then walks it from a
+  ///   random offset a chunk at a time. Does not allocate.
+  /// @param index Index to select from, narrowed down by required caps
   /// @param filter Template type which serves as filter for criteria
   template<typename Filter>
   std::shared_ptr<const RouterInfo> GetRandomRouter(
+      RouterIndex index,
       Filter filter) const;
 
  private:
   std::map<IdentHash, std::shared_ptr<LeaseSet>> m_LeaseSets;
   mutable std::mutex m_RouterInfosMutex;
   std::map<IdentHash, std::shared_ptr<RouterInfo>> m_RouterInfos;
+  // Guarded by RouterInfos mutex
+  std::array<std::vector<std::shared_ptr<RouterInfo>>, NumRouterIndexes>
+      m_RouterIndexes;
   mutable std::mutex m_FloodfillsMutex;
-  std::list<std::shared_ptr<RouterInfo>> m_Floodfills;
+  // Used by the NetDb thread only, and at load
+  NetDbStore m_Store;
+  // Keyed on ident hash, queried with the routing key of a destination
+  XORTrie<std::shared_ptr<RouterInfo>> m_Floodfills;
 
   bool m_IsRunning;
   std::unique_ptr<std::thread> m_Thread;
@@ -262,6 +355,9 @@ class NetDb : public NetDbTraits {
   // of I2NPDatabaseStoreMsg
   xi2p::core::Queue<std::shared_ptr<const I2NPMessage>> m_Queue;
 
+  // Contents of the database stores flooded recently
+  RotatingBloomFilter m_Stores;
+
   friend class NetDbRequests;
   NetDbRequests m_Requests;
 
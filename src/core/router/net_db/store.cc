@@ -0,0 +1,384 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#include "core/router/net_db/store.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <cstring>
+#include <utility>
+
+#include "core/util/byte_stream.h"
+#include "core/util/log.h"
+
+namespace xi2p {
+namespace core {
+
+namespace {
+/// @brief Identifies the file format, changed along with the record layout
+const std::uint8_t StoreMagic[] = {'x', 'i', '2', 'p', 'N', 'D', 'B', '1'};
+
+/// @brief Record layout: type, ident hash, buffer length, buffer, checksum
+enum StoreSize : std::uint32_t
+{
+  FileHeader = sizeof(StoreMagic),
+  RecordHeader = 1 + 32 + 2,
+  RecordChecksum = 4,
+  /// @brief Below this size the file is never compacted
+  MinCompactSize = 1024 * 1024,
+};
+
+enum RecordType : std::uint8_t
+{
+  PutRecord = 1,
+  EraseRecord = 2,
+};
+
+std::uint64_t GetRecordSize(std::uint16_t len)
+{
+  return StoreSize::RecordHeader + len + StoreSize::RecordChecksum;
+}
+
+/// @brief Forces the data of a file, or the entries of a directory, to disk
+/// @note Streams only hand data over to the OS, a crash may still lose it
+bool SyncToDisk(const std::string& path)
+{
+#ifdef _WIN32
+  // Directory entries are not synced separately on Windows
+  if (boost::filesystem::is_directory(path))
+    return true;
+  int const fd = _open(path.c_str(), _O_WRONLY | _O_BINARY);
+  if (fd < 0)
+    return false;
+  bool const is_synced = !_commit(fd);
+  _close(fd);
+#else
+  int const fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  bool const is_synced = !::fsync(fd);
+  ::close(fd);
+#endif
+  if (!is_synced)
+    LOG(error) << "NetDbStore: unable to sync " << path;
+  return is_synced;
+}
+}  // namespace
+
+NetDbStore::NetDbStore() : m_FileSize(0), m_LiveSize(0) {}
+
+NetDbStore::~NetDbStore()
+{
+  Close();
+}
+
+bool NetDbStore::Open(
+    const std::string& path,
+    const std::function<void(const std::vector<Record>&)>& records)
+{
+  Close();
+  m_Path = path;
+  m_Index.clear();
+  m_FileSize = m_LiveSize = 0;
+  // Startup reads the whole log sequentially
+  std::vector<std::uint8_t> data;
+  if (boost::filesystem::exists(path))
+    {
+      std::ifstream in(path, std::ifstream::binary);
+      in.seekg(0, std::ios::end);
+      auto const size = in.tellg();
+      if (size > 0)
+        {
+          data.resize(size);
+          in.seekg(0, std::ios::beg);
+          in.read(reinterpret_cast<char*>(data.data()), data.size());
+        }
+      if (!in)
+        {
+          LOG(error) << "NetDbStore: unable to read " << path;
+          return false;
+        }
+    }
+  std::size_t offset = 0;
+  if (data.size() >= StoreSize::FileHeader
+      && !std::memcmp(data.data(), StoreMagic, StoreSize::FileHeader))
+    {
+      offset = StoreSize::FileHeader;
+      while (data.size() - offset >= GetRecordSize(0))
+        {
+          std::uint8_t* record = data.data() + offset;
+          std::uint16_t const len =
+              InputByteStream::Read<std::uint16_t>(record + 1 + 32);
+          std::uint64_t const size = GetRecordSize(len);
+          if (data.size() - offset < size
+              || (record[0] != PutRecord && record[0] != EraseRecord)
+              || !m_Checksum.VerifyDigest(
+                  record + StoreSize::RecordHeader + len,
+                  record,
+                  StoreSize::RecordHeader + len))
+            break;
+          IdentHash const ident(record + 1);
+          auto it = m_Index.find(ident);
+          if (it != m_Index.end())
+            {
+              m_LiveSize -= GetRecordSize(it->second.len);
+              m_Index.erase(it);
+            }
+          if (record[0] == PutRecord)
+            {
+              m_Index[ident] = {offset + StoreSize::RecordHeader, len};
+              m_LiveSize += size;
+            }
+          offset += size;
+        }
+      if (offset < data.size())
+        {
+          // Torn append, the records before it are intact
+          LOG(warning) << "NetDbStore: dropping " << data.size() - offset
+                       << " bytes of incomplete records from " << path;
+          boost::system::error_code ec;
+          boost::filesystem::resize_file(path, offset, ec);
+          if (ec)
+            {
+              LOG(error) << "NetDbStore: " << ec.message();
+              return false;
+            }
+        }
+    }
+  else
+    {
+      if (!data.empty())
+        LOG(error) << "NetDbStore: " << path << " is not a NetDb store, recreating";
+      std::ofstream out(path, std::ofstream::binary | std::ofstream::trunc);
+      out.write(reinterpret_cast<const char*>(StoreMagic), StoreSize::FileHeader);
+      if (!out.flush())
+        {
+          LOG(error) << "NetDbStore: unable to create " << path;
+          return false;
+        }
+      offset = StoreSize::FileHeader;
+    }
+  m_FileSize = offset;
+  if (!OpenFile())
+    return false;
+  std::vector<Record> live;
+  live.reserve(m_Index.size());
+  for (auto const& it : m_Index)
+    live.push_back({it.first, data.data() + it.second.offset, it.second.len});
+  LOG(debug) << "NetDbStore: " << live.size() << " records in "
+             << m_FileSize << " bytes";
+  records(live);
+  return true;
+}
+
+void NetDbStore::Close()
+{
+  if (m_File.is_open())
+    {
+      Flush();
+      m_File.close();
+    }
+}
+
+void NetDbStore::Put(
+    const IdentHash& ident,
+    const std::uint8_t* buf,
+    std::uint16_t len)
+{
+  m_Pending.push_back(
+      {ident, m_PendingData.size() + StoreSize::RecordHeader, len, true});
+  AppendRecord(m_PendingData, true, ident, buf, len);
+}
+
+bool NetDbStore::Erase(
+    const IdentHash& ident)
+{
+  bool is_stored = m_Index.count(ident);
+  for (auto const& pending : m_Pending)
+    if (pending.ident == ident)
+      is_stored = pending.is_put;
+  if (!is_stored)
+    return false;
+  m_Pending.push_back({ident, 0, 0, false});
+  AppendRecord(m_PendingData, false, ident, nullptr, 0);
+  return true;
+}
+
+bool NetDbStore::Flush()
+{
+  if (m_Pending.empty())
+    return true;
+  m_File.clear();
+  m_File.seekp(0, std::ios::end);
+  m_File.write(
+      reinterpret_cast<const char*>(m_PendingData.data()),
+      m_PendingData.size());
+  m_File.flush();
+  if (!m_File || !SyncToDisk(m_Path))
+    {
+      LOG(error) << "NetDbStore: unable to append to " << m_Path;
+      // Cut off what may have been written so later appends stay readable
+      m_File.close();
+      boost::system::error_code ec;
+      boost::filesystem::resize_file(m_Path, m_FileSize, ec);
+      OpenFile();
+      return false;
+    }
+  for (auto const& pending : m_Pending)
+    {
+      auto it = m_Index.find(pending.ident);
+      if (it != m_Index.end())
+        {
+          m_LiveSize -= GetRecordSize(it->second.len);
+          m_Index.erase(it);
+        }
+      if (pending.is_put)
+        {
+          m_Index[pending.ident] = {m_FileSize + pending.offset, pending.len};
+          m_LiveSize += GetRecordSize(pending.len);
+        }
+    }
+  m_FileSize += m_PendingData.size();
+  m_PendingData.clear();
+  m_Pending.clear();
+  if (m_FileSize > StoreSize::MinCompactSize
+      && m_FileSize - StoreSize::FileHeader > 2 * m_LiveSize)
+    return Compact();
+  return true;
+}
+
+bool NetDbStore::Read(
+    const IdentHash& ident,
+    std::vector<std::uint8_t>& buf)
+{
+  auto it = m_Index.find(ident);
+  if (it == m_Index.end())
+    return false;
+  buf.resize(it->second.len);
+  m_File.clear();
+  m_File.seekg(it->second.offset);
+  if (!m_File.read(reinterpret_cast<char*>(buf.data()), buf.size()))
+    {
+      LOG(error) << "NetDbStore: unable to read from " << m_Path;
+      m_File.clear();
+      return false;
+    }
+  return true;
+}
+
+bool NetDbStore::Compact()
+{
+  std::vector<std::uint8_t> data(StoreMagic, StoreMagic + StoreSize::FileHeader);
+  data.reserve(StoreSize::FileHeader + m_LiveSize);
+  std::map<IdentHash, Location> index;
+  std::vector<std::uint8_t> buf;
+  for (auto const& it : m_Index)
+    {
+      if (!Read(it.first, buf))
+        return false;
+      index[it.first] = {data.size() + StoreSize::RecordHeader, it.second.len};
+      AppendRecord(data, true, it.first, buf.data(), it.second.len);
+    }
+  // Readers see either the old or the new file, never a partial one
+  const std::string tmp_path = m_Path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ofstream::binary | std::ofstream::trunc);
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (!out.flush())
+      {
+        LOG(error) << "NetDbStore: unable to write " << tmp_path;
+        return false;
+      }
+  }
+  // The data must be on disk before the rename, or a crash could leave an
+  // empty store in place of the old one
+  if (!SyncToDisk(tmp_path))
+    return false;
+  m_File.close();
+  boost::system::error_code ec;
+  boost::filesystem::rename(tmp_path, m_Path, ec);
+  if (ec)
+    {
+      LOG(error) << "NetDbStore: unable to replace " << m_Path << ": " << ec.message();
+      OpenFile();
+      return false;
+    }
+  auto const dir = boost::filesystem::path(m_Path).parent_path();
+  SyncToDisk(dir.empty() ? "." : dir.string());
+  LOG(debug) << "NetDbStore: compacted " << m_FileSize << " bytes to " << data.size();
+  m_Index.swap(index);
+  m_FileSize = data.size();
+  m_LiveSize = m_FileSize - StoreSize::FileHeader;
+  return OpenFile();
+}
+
+bool NetDbStore::OpenFile()
+{
+  m_File.open(
+      m_Path,
+      std::fstream::in | std::fstream::out | std::fstream::binary | std::fstream::app);
+  if (!m_File.is_open())
+    {
+      LOG(error) << "NetDbStore: unable to open " << m_Path;
+      return false;
+    }
+  return true;
+}
+
+void NetDbStore::AppendRecord(
+    std::vector<std::uint8_t>& data,
+    bool is_put,
+    const IdentHash& ident,
+    const std::uint8_t* buf,
+    std::uint16_t len)
+{
+  std::size_t const offset = data.size();
+  data.resize(offset + GetRecordSize(len));
+  std::uint8_t* record = data.data() + offset;
+  record[0] = is_put ? PutRecord : EraseRecord;
+  std::memcpy(record + 1, ident(), 32);
+  OutputByteStream::Write<std::uint16_t>(record + 1 + 32, len);
+  if (len)
+    std::memcpy(record + StoreSize::RecordHeader, buf, len);
+  m_Checksum.CalculateDigest(
+      record + StoreSize::RecordHeader + len,
+      record,
+      StoreSize::RecordHeader + len);
+}
+
+}  // namespace core
+}  // namespace xi2p
@@ -0,0 +1,155 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#ifndef SRC_CORE_ROUTER_NET_DB_STORE_H_
+#define SRC_CORE_ROUTER_NET_DB_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "core/crypto/util/checksum.h"
+
+#include "core/router/identity.h"
+
+namespace xi2p {
+namespace core {
+
+/// @class NetDbStore
+/// @brief Log-structured store of RouterInfo buffers in a single file
+/// @details The file is a header followed by put and erase records. Each
+///   record carries an Adler-32 checksum, so a torn append left by a crash
+///   is detected and cut off when the store is opened again. Updates are
+///   queued and appended with one write by Flush(), which also compacts the
+///   file once dead records outweigh live ones. Compaction writes a new file
+///   and renames it over the old one. Appends and the new file are synced to
+///   disk, so that a crash never leaves less than the last Flush() wrote.
+/// @note Not thread-safe, used by the NetDb thread only
+class NetDbStore {
+ public:
+  /// @brief A live record of the store
+  struct Record {
+    IdentHash ident;
+    const std::uint8_t* buf;  ///< Valid during the callback only
+    std::uint16_t len;
+  };
+
+  NetDbStore();
+  ~NetDbStore();
+
+  /// @brief Opens store file, creating it if needed, and replays its log
+  /// @param path Path of the store file
+  /// @param records Called once with all live records
+  /// @return False if the file cannot be opened or created
+  bool Open(
+      const std::string& path,
+      const std::function<void(const std::vector<Record>&)>& records);
+
+  /// @brief Flushes queued records and closes the file
+  void Close();
+
+  /// @brief Queues a RouterInfo buffer to be stored under ident
+  void Put(
+      const IdentHash& ident,
+      const std::uint8_t* buf,
+      std::uint16_t len);
+
+  /// @brief Queues removal of ident
+  /// @return False if ident is not stored
+  bool Erase(
+      const IdentHash& ident);
+
+  /// @brief Appends queued records with a single write, then compacts the
+  ///   file if needed
+  /// @return False on I/O failure
+  bool Flush();
+
+  /// @brief Reads the last flushed buffer stored under ident
+  /// @return False if ident is not stored
+  bool Read(
+      const IdentHash& ident,
+      std::vector<std::uint8_t>& buf);
+
+  std::size_t GetNumRecords() const noexcept {
+    return m_Index.size();
+  }
+
+  /// @brief Size of file including dead records
+  std::uint64_t GetFileSize() const noexcept {
+    return m_FileSize;
+  }
+
+ private:
+  /// @brief Rewrites live records into a new file
+  bool Compact();
+
+  /// @brief Opens file for appending and reading back records
+  bool OpenFile();
+
+  /// @brief Serializes a record with its checksum at the end of data
+  void AppendRecord(
+      std::vector<std::uint8_t>& data,
+      bool is_put,
+      const IdentHash& ident,
+      const std::uint8_t* buf,
+      std::uint16_t len);
+
+ private:
+  /// @brief Location of a record's buffer in the file
+  struct Location {
+    std::uint64_t offset;
+    std::uint16_t len;
+  };
+
+  /// @brief A record waiting to be appended
+  struct Pending {
+    IdentHash ident;
+    std::size_t offset;  ///< Of the buffer in pending data, if put
+    std::uint16_t len;
+    bool is_put;
+  };
+
+  std::string m_Path;
+  std::fstream m_File;
+  std::map<IdentHash, Location> m_Index;
+  std::vector<std::uint8_t> m_PendingData;
+  std::vector<Pending> m_Pending;
+  std::uint64_t m_FileSize, m_LiveSize;
+  Adler32 m_Checksum;
+};
+
+}  // namespace core
+}  // namespace xi2p
+
+#endif  // SRC_CORE_ROUTER_NET_DB_STORE_H_
@@ -0,0 +1,256 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#ifndef SRC_CORE_ROUTER_NET_DB_XOR_TRIE_H_
+#define SRC_CORE_ROUTER_NET_DB_XOR_TRIE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "core/util/tag.h"
+
+namespace xi2p {
+namespace core {
+
+/// @class XORTrie
+/// @brief Binary trie over 256-bit keys answering k-closest queries by
+///   Kademlia XOR distance
+/// @details Leaves are buckets of up to LeafSize entries which split on the
+///   next key bit when they overflow, and merge back with their sibling when
+///   both fit in one leaf again. Walking the child that matches the target's
+///   bit first visits entries in increasing XOR distance, so a k-closest
+///   query touches O(k log n) nodes.
+/// @tparam Value Type of value stored along with each key
+/// @tparam LeafSize Max entries per leaf bucket
+template <typename Value, std::size_t LeafSize = 8>
+class XORTrie {
+ public:
+  typedef Tag<32> Key;
+
+  XORTrie() {
+    Clear();
+  }
+
+  /// @brief Adds value under key
+  /// @return False if key is already present
+  bool Insert(
+      const Key& key,
+      const Value& value) {
+    std::size_t depth = 0;
+    std::uint32_t node = FindLeaf(key, depth);
+    auto& entries = m_Nodes[node].entries;
+    for (auto const& entry : entries)
+      if (entry.key == key)
+        return false;
+    entries.push_back({key, value});
+    m_Size++;
+    // Keys are unique, so a leaf at full depth never overflows
+    while (m_Nodes[node].entries.size() > LeafSize && depth < KeyBits) {
+      std::uint32_t const zero = NewNode(), one = NewNode();
+      Node& leaf = m_Nodes[node];
+      for (auto& entry : leaf.entries)
+        m_Nodes[GetBit(entry.key, depth) ? one : zero]
+            .entries.push_back(std::move(entry));
+      leaf.entries.clear();
+      leaf.entries.shrink_to_fit();
+      leaf.children = {{zero, one}};
+      leaf.is_leaf = false;
+      node = m_Nodes[zero].entries.size() > LeafSize ? zero : one;
+      depth++;
+    }
+    return true;
+  }
+
+  /// @brief Removes entry with given key
+  /// @return False if key is not present
+  bool Remove(
+      const Key& key) {
+    std::array<std::uint32_t, KeyBits + 1> path;
+    std::size_t depth = 0;
+    path[0] = Root;
+    while (!m_Nodes[path[depth]].is_leaf) {
+      path[depth + 1] = m_Nodes[path[depth]].children[GetBit(key, depth)];
+      depth++;
+    }
+    auto& entries = m_Nodes[path[depth]].entries;
+    auto it = std::find_if(
+        entries.begin(),
+        entries.end(),
+        [&key](const Entry& entry) { return entry.key == key; });
+    if (it == entries.end())
+      return false;
+    std::swap(*it, entries.back());
+    entries.pop_back();
+    m_Size--;
+    // Fold sibling leaves back into their parent while they fit in one leaf
+    while (depth--) {
+      Node& parent = m_Nodes[path[depth]];
+      Node& zero = m_Nodes[parent.children[0]];
+      Node& one = m_Nodes[parent.children[1]];
+      if (!zero.is_leaf || !one.is_leaf
+          || zero.entries.size() + one.entries.size() > LeafSize)
+        break;
+      parent.entries = std::move(zero.entries);
+      std::move(
+          one.entries.begin(),
+          one.entries.end(),
+          std::back_inserter(parent.entries));
+      parent.is_leaf = true;
+      FreeNode(parent.children[0]);
+      FreeNode(parent.children[1]);
+    }
+    return true;
+  }
+
+  void Clear() {
+    m_Nodes.assign(1, Node());
+    m_FreeNodes.clear();
+    m_Size = 0;
+  }
+
+  std::size_t GetSize() const noexcept {
+    return m_Size;
+  }
+
+  /// @brief Visits entries in increasing XOR distance to target until visitor
+  ///   returns false
+  /// @param visitor Callable as bool(const Key&, const Value&)
+  /// @note Does not allocate
+  template <typename Visitor>
+  void VisitClosest(
+      const Key& target,
+      Visitor visitor) const {
+    // Far child is pushed before near child, so the stack never holds more
+    // than one pending node per level
+    std::array<std::pair<std::uint32_t, std::uint16_t>, KeyBits + 2> stack;
+    std::size_t top = 0;
+    stack[top++] = {Root, 0};
+    while (top) {
+      auto const current = stack[--top];
+      const Node& node = m_Nodes[current.first];
+      if (!node.is_leaf) {
+        bool const bit = GetBit(target, current.second);
+        std::uint16_t const depth = current.second + 1;
+        stack[top++] = {node.children[!bit], depth};
+        stack[top++] = {node.children[bit], depth};
+        continue;
+      }
+      std::array<const Entry*, LeafSize> sorted;
+      std::size_t const num = node.entries.size();
+      for (std::size_t i = 0; i < num; i++)
+        sorted[i] = &node.entries[i];
+      std::sort(
+          sorted.begin(),
+          sorted.begin() + num,
+          [&target](const Entry* lhs, const Entry* rhs) {
+            return IsCloser(lhs->key, rhs->key, target);
+          });
+      for (std::size_t i = 0; i < num; i++)
+        if (!visitor(sorted[i]->key, sorted[i]->value))
+          return;
+    }
+  }
+
+ private:
+  enum : std::uint32_t { Root = 0, KeyBits = 256 };
+
+  struct Entry {
+    Key key;
+    Value value;
+  };
+
+  struct Node {
+    Node() : children{{Root, Root}}, is_leaf(true) {}
+    std::array<std::uint32_t, 2> children;
+    bool is_leaf;
+    std::vector<Entry> entries;
+  };
+
+  static bool GetBit(
+      const Key& key,
+      std::size_t bit) noexcept {
+    return (key()[bit / 8] >> (7 - bit % 8)) & 1;
+  }
+
+  /// @return True if lhs is closer to target than rhs
+  static bool IsCloser(
+      const Key& lhs,
+      const Key& rhs,
+      const Key& target) noexcept {
+    for (std::size_t i = 0; i < KeyBits / 8; i++) {
+      std::uint8_t const l = lhs()[i] ^ target()[i], r = rhs()[i] ^ target()[i];
+      if (l != r)
+        return l < r;
+    }
+    return false;
+  }
+
+  std::uint32_t FindLeaf(
+      const Key& key,
+      std::size_t& depth) const {
+    std::uint32_t node = Root;
+    while (!m_Nodes[node].is_leaf)
+      node = m_Nodes[node].children[GetBit(key, depth++)];
+    return node;
+  }
+
+  std::uint32_t NewNode() {
+    if (m_FreeNodes.empty()) {
+      m_Nodes.emplace_back();
+      return m_Nodes.size() - 1;
+    }
+    std::uint32_t const node = m_FreeNodes.back();
+    m_FreeNodes.pop_back();
+    m_Nodes[node] = Node();
+    return node;
+  }
+
+  void FreeNode(
+      std::uint32_t node) {
+    m_Nodes[node].entries.clear();
+    m_Nodes[node].entries.shrink_to_fit();
+    m_FreeNodes.push_back(node);
+  }
+
+ private:
+  std::vector<Node> m_Nodes;  // root is always first
+  std::vector<std::uint32_t> m_FreeNodes;
+  std::size_t m_Size;
+};
+
+}  // namespace core
+}  // namespace xi2p
+
+#endif  // SRC_CORE_ROUTER_NET_DB_XOR_TRIE_H_
@@ -32,258 +32,330 @@
 
 #include "core/router/profiling.h"
 
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/property_tree/ini_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 
-#include <cctype>
+#include <cstring>
+#include <fstream>
 #include <string>
+#include <vector>
 
 #include "core/util/filesystem.h"
 #include "core/util/log.h"
+#include "core/util/timestamp.h"
 
 namespace xi2p {
 namespace core {
 
-RouterProfile::RouterProfile(
-    const IdentHash& ident_hash)
-    : m_IdentHash(ident_hash),
-      m_LastUpdateTime(boost::posix_time::second_clock::local_time()),
-      m_NumTunnelsAgreed(0),
-      m_NumTunnelsDeclined(0),
-      m_NumTunnelsNonReplied(0),
-      m_NumTimesTaken(0),
-      m_NumTimesRejected(0),
-      m_Exception(__func__) {}
+ProfileStore profiles;
 
-boost::posix_time::ptime RouterProfile::GetTime() const {
-  return boost::posix_time::second_clock::local_time();
+static_assert(
+    sizeof(RouterProfile) == 64,
+    "RouterProfile is a record of the profile table");
+
+void RouterProfile::Reset(
+    const IdentHash& ident_hash,
+    std::uint64_t ts) {
+  std::memcpy(m_IdentHash, ident_hash(), sizeof(m_IdentHash));
+  m_LastUpdateTime.store(ts, std::memory_order_relaxed);
+  m_NumTunnelsAgreed.store(0, std::memory_order_relaxed);
+  m_NumTunnelsDeclined.store(0, std::memory_order_relaxed);
+  m_NumTunnelsNonReplied.store(0, std::memory_order_relaxed);
+  m_NumTimesTaken.store(0, std::memory_order_relaxed);
+  m_NumTimesRejected.store(0, std::memory_order_relaxed);
+  m_Reserved = 0;
 }
 
-void RouterProfile::UpdateTime() {
-  m_LastUpdateTime = GetTime();
+bool RouterProfile::IsExpired(std::uint64_t ts) const {
+  return ts >= m_LastUpdateTime.load(std::memory_order_relaxed)
+      + PEER_PROFILE_EXPIRATION_TIMEOUT * 3600;
 }
 
-void RouterProfile::Save() {
-  // fill sections
-  boost::property_tree::ptree participation;
-  participation.put(
-      PEER_PROFILE_PARTICIPATION_AGREED,
-      m_NumTunnelsAgreed);
-  participation.put(
-      PEER_PROFILE_PARTICIPATION_DECLINED,
-      m_NumTunnelsDeclined);
-  participation.put(
-      PEER_PROFILE_PARTICIPATION_NON_REPLIED,
-      m_NumTunnelsNonReplied);
-  boost::property_tree::ptree usage;
-  usage.put(
-      PEER_PROFILE_USAGE_TAKEN,
-      m_NumTimesTaken);
-  usage.put(
-      PEER_PROFILE_USAGE_REJECTED,
-      m_NumTimesRejected);
-  // fill property tree
-  boost::property_tree::ptree pt;
-  pt.put(
-      PEER_PROFILE_LAST_UPDATE_TIME,
-      boost::posix_time::to_simple_string(
-        m_LastUpdateTime));
-  pt.put_child(
-      PEER_PROFILE_SECTION_PARTICIPATION,
-      participation);
-  pt.put_child(
-      PEER_PROFILE_SECTION_USAGE,
-      usage);
-  // Save to file
-  // TODO(unassigned): this entire block is a patch for #519 until we implement a database in #385
-  try
-    {
-      auto directory = core::GetPath(core::Path::Profiles);
-      std::string sub_dir;
-      if (!boost::filesystem::exists(directory))
-        {
-          LOG(debug) << "RouterProfile: ensuring " << directory;
-          core::EnsurePath(directory);
-#if defined(_WIN32) || defined(__APPLE__)
-          core::EnsurePath(directory / "uppercase");
-          core::EnsurePath(directory / "lowercase");
-#endif
-          for (const auto& ch : core::Base64::GetAlphabet())
-            {
-#if defined(_WIN32) || defined(__APPLE__)
-              sub_dir = std::isupper(ch) ? "uppercase" : "lowercase";
-#endif
-              const auto& path =
-                  directory / sub_dir / (std::string("p") + ch);
-              LOG(debug) << "RouterProfile: ensuring " << path;
-              core::EnsurePath(path);
-            }
-        }
-      std::string base64 = m_IdentHash.ToBase64();
-#if defined(_WIN32) || defined(__APPLE__)
-      sub_dir = std::isupper(base64[0]) ? "uppercase" : "lowercase";
-#endif
-      directory = directory / sub_dir / (std::string("p") + base64[0]);
-      const auto& filename =
-          directory / (std::string(PEER_PROFILE_PREFIX) + base64 + ".txt");
-      LOG(debug) << "RouterProfile: saving " << filename;
-      boost::property_tree::write_ini(filename.string(), pt);
-    }
-  catch (...)
-    {
-      m_Exception.Dispatch(__func__);
-      // TODO(unassigned): surely we don't want to simply return
-      return;
-    }
+bool RouterProfile::IsOf(const IdentHash& ident_hash) const {
+  return !std::memcmp(m_IdentHash, ident_hash(), sizeof(m_IdentHash));
 }
 
-void RouterProfile::Load() {
-  std::string base64 = m_IdentHash.ToBase64();
-  auto directory = core::GetPath(core::Path::Profiles);
-  // TODO(unassigned): this is a patch for #519 until we implement a database in #385
-  std::string sub_dir;
-#if defined(_WIN32) || defined(__APPLE__)
-  sub_dir = std::isupper(base64[0]) ? "uppercase" : "lowercase";
-#endif
-  directory = directory / sub_dir / (std::string("p") + base64[0]);
-  auto filename = directory / sub_dir / (std::string(PEER_PROFILE_PREFIX) + base64 + ".txt");
-  if (boost::filesystem::exists(filename)) {
-    boost::property_tree::ptree pt;
-    try {
-      boost::property_tree::read_ini(filename.string(), pt);
-    } catch (const std::exception& ex) {
-      LOG(error) << "RouterProfile: can't read " << filename << ": " << ex.what();
-      return;
-    }
-    try {
-      auto t = pt.get(PEER_PROFILE_LAST_UPDATE_TIME, "");
-      if (t.length() > 0)
-        m_LastUpdateTime = boost::posix_time::time_from_string(t);
-      if ((GetTime() - m_LastUpdateTime).hours() <
-          PEER_PROFILE_EXPIRATION_TIMEOUT) {
-        try {
-          // read participations
-          auto participations = pt.get_child(
-              PEER_PROFILE_SECTION_PARTICIPATION);
-          m_NumTunnelsAgreed = participations.get(
-              PEER_PROFILE_PARTICIPATION_AGREED,
-              0);
-          m_NumTunnelsDeclined = participations.get(
-              PEER_PROFILE_PARTICIPATION_DECLINED,
-              0);
-          m_NumTunnelsNonReplied = participations.get(
-              PEER_PROFILE_PARTICIPATION_NON_REPLIED,
-              0);
-        } catch (const boost::property_tree::ptree_bad_path&) {
-          LOG(warning)
-            << "RouterProfile: Missing section "
-            << PEER_PROFILE_SECTION_PARTICIPATION;
-        }
-        try {
-          // read usage
-          auto usage = pt.get_child(PEER_PROFILE_SECTION_USAGE);
-          m_NumTimesTaken = usage.get(PEER_PROFILE_USAGE_TAKEN, 0);
-          m_NumTimesRejected = usage.get(PEER_PROFILE_USAGE_REJECTED, 0);
-        } catch (const boost::property_tree::ptree_bad_path&) {
-          LOG(warning)
-            << "RouterProfile: missing section " << PEER_PROFILE_SECTION_USAGE;
-        }
-      } else {
-        *this = RouterProfile(m_IdentHash);
-      }
-    } catch (const std::exception& ex) {
-      LOG(error)
-        << "RouterProfile: can't read profile " << base64 << " :" << ex.what();
-    }
-  }
+void RouterProfile::UpdateTime() {
+  m_LastUpdateTime.store(GetSecondsSinceEpoch(), std::memory_order_relaxed);
 }
 
 void RouterProfile::TunnelBuildResponse(
     std::uint8_t ret) {
   UpdateTime();
   if (ret > 0)
-    m_NumTunnelsDeclined++;
+    m_NumTunnelsDeclined.fetch_add(1, std::memory_order_relaxed);
   else
-    m_NumTunnelsAgreed++;
+    m_NumTunnelsAgreed.fetch_add(1, std::memory_order_relaxed);
 }
 
 void RouterProfile::TunnelNonReplied() {
-  m_NumTunnelsNonReplied++;
+  m_NumTunnelsNonReplied.fetch_add(1, std::memory_order_relaxed);
   UpdateTime();
 }
 
 bool RouterProfile::IsLowPartcipationRate() const {
-  return 4 * m_NumTunnelsAgreed < m_NumTunnelsDeclined;  // < 20% rate
+  return 4 * m_NumTunnelsAgreed.load(std::memory_order_relaxed)
+      < m_NumTunnelsDeclined.load(std::memory_order_relaxed);  // < 20% rate
 }
 
 bool RouterProfile::IsLowReplyRate() const {
-  auto total = m_NumTunnelsAgreed + m_NumTunnelsDeclined;
-  return m_NumTunnelsNonReplied > 10 * (total + 1);
+  auto total = m_NumTunnelsAgreed.load(std::memory_order_relaxed)
+      + m_NumTunnelsDeclined.load(std::memory_order_relaxed);
+  return m_NumTunnelsNonReplied.load(std::memory_order_relaxed) > 10 * (total + 1);
 }
 
 bool RouterProfile::IsBad() {
   auto is_bad =
     IsAlwaysDeclining() || IsLowPartcipationRate() /*|| IsLowReplyRate ()*/;
-  if (is_bad && m_NumTimesRejected > 10 * (m_NumTimesTaken + 1)) {
+  if (is_bad
+      && m_NumTimesRejected.load(std::memory_order_relaxed)
+          > 10 * (m_NumTimesTaken.load(std::memory_order_relaxed) + 1)) {
     // reset profile
-    m_NumTunnelsAgreed = 0;
-    m_NumTunnelsDeclined = 0;
-    m_NumTunnelsNonReplied = 0;
+    m_NumTunnelsAgreed.store(0, std::memory_order_relaxed);
+    m_NumTunnelsDeclined.store(0, std::memory_order_relaxed);
+    m_NumTunnelsNonReplied.store(0, std::memory_order_relaxed);
     is_bad = false;
   }
   if (is_bad)
-    m_NumTimesRejected++;
+    m_NumTimesRejected.fetch_add(1, std::memory_order_relaxed);
   else
-    m_NumTimesTaken++;
+    m_NumTimesTaken.fetch_add(1, std::memory_order_relaxed);
   return is_bad;
 }
 
-std::shared_ptr<RouterProfile> GetRouterProfile(
-    const IdentHash& ident_hash) {
-  auto profile = std::make_shared<RouterProfile>(ident_hash);
-  profile->Load();  // if possible
+/// @brief Leading record of the table file
+struct ProfileStore::Header {
+  char magic[8];
+  std::uint32_t byte_order;
+  std::uint32_t record_size;
+  std::uint32_t num_records;
+  std::uint8_t reserved[44];
+};
+
+namespace {
+const char PROFILE_STORE_FILENAME[] = "profiles.dat";
+const char PROFILE_STORE_MAGIC[8] = {'X', 'I', '2', 'P', 'P', 'R', 'O', 'F'};
+// Read back differently by a machine of another byte order
+const std::uint32_t PROFILE_STORE_BYTE_ORDER = 0x01020304;
+}  // namespace
+
+ProfileStore::ProfileStore()
+    : m_Header(nullptr),
+      m_Records(nullptr) {}
+
+ProfileStore::~ProfileStore() {}
+
+bool ProfileStore::Open(const boost::filesystem::path& directory) {
+  static_assert(sizeof(Header) == 64, "Records must stay aligned");
+  {
+    std::unique_lock<std::mutex> l(m_Mutex);
+    if (m_Records)
+      return true;
+    auto const path = directory / PROFILE_STORE_FILENAME;
+    std::uint64_t const size =
+        sizeof(Header) + std::uint64_t(Size::MaxProfiles) * sizeof(RouterProfile);
+    try {
+      core::EnsurePath(directory);
+      if (!boost::filesystem::exists(path))
+        std::ofstream(path.string(), std::ios::binary);
+      // Sparse, only used records take space
+      if (boost::filesystem::file_size(path) != size)
+        boost::filesystem::resize_file(path, size);
+      m_File = boost::interprocess::file_mapping(
+          path.string().c_str(),
+          boost::interprocess::read_write);
+      m_Region = boost::interprocess::mapped_region(
+          m_File,
+          boost::interprocess::read_write);
+    } catch (const std::exception& ex) {
+      LOG(error) << "ProfileStore: unable to map " << path << ": " << ex.what();
+      return false;
+    }
+    auto header = static_cast<Header*>(m_Region.get_address());
+    if (std::memcmp(header->magic, PROFILE_STORE_MAGIC, sizeof(header->magic))
+        || header->byte_order != PROFILE_STORE_BYTE_ORDER
+        || header->record_size != sizeof(RouterProfile)
+        || header->num_records > Size::MaxProfiles) {
+      LOG(warning) << "ProfileStore: " << path << " is not a valid profile table";
+      std::memset(header, 0, sizeof(Header));
+      std::memcpy(header->magic, PROFILE_STORE_MAGIC, sizeof(header->magic));
+      header->byte_order = PROFILE_STORE_BYTE_ORDER;
+      header->record_size = sizeof(RouterProfile);
+    }
+    auto records = reinterpret_cast<RouterProfile*>(header + 1);
+    // Drop expired profiles, the others move down to stay contiguous
+    std::uint64_t const ts = GetSecondsSinceEpoch();
+    std::uint32_t num_records = 0;
+    for (std::uint32_t i = 0; i < header->num_records; i++) {
+      IdentHash const ident_hash(records[i].m_IdentHash);
+      if (records[i].IsExpired(ts) || m_Index.count(ident_hash))
+        continue;
+      if (i != num_records)
+        std::memcpy(
+            static_cast<void*>(&records[num_records]),
+            static_cast<const void*>(&records[i]),
+            sizeof(RouterProfile));
+      m_Index[ident_hash] = &records[num_records++];
+    }
+    LOG(info)
+      << "ProfileStore: " << num_records << " profiles loaded, "
+      << header->num_records - num_records << " expired";
+    header->num_records = num_records;
+    m_Header = header;
+    m_Records = records;
+  }
+  ImportProfiles(directory);
+  return true;
+}
+
+void ProfileStore::Close() {
+  std::unique_lock<std::mutex> l(m_Mutex);
+  if (m_Records)
+    m_Region.flush(0, 0, false);
+}
+
+void ProfileStore::Flush() {
+  std::unique_lock<std::mutex> l(m_Mutex);
+  if (m_Records)
+    m_Region.flush(0, 0, true);
+}
+
+RouterProfile* ProfileStore::Get(const IdentHash& ident_hash) {
+  std::uint64_t const ts = GetSecondsSinceEpoch();
+  std::unique_lock<std::mutex> l(m_Mutex);
+  auto it = m_Index.find(ident_hash);
+  if (it != m_Index.end()) {
+    if (it->second->IsExpired(ts))
+      it->second->Reset(ident_hash, ts);
+    return it->second;
+  }
+  RouterProfile* profile;
+  if (!m_FreeRecords.empty()) {
+    profile = m_FreeRecords.back();
+    m_FreeRecords.pop_back();
+  } else if (m_Records && m_Header->num_records < Size::MaxProfiles) {
+    profile = &m_Records[m_Header->num_records];
+    // Counted once written
+    m_Header->num_records++;
+  } else if (!m_FreeUnstored.empty()) {
+    profile = m_FreeUnstored.back();
+    m_FreeUnstored.pop_back();
+  } else {
+    m_Unstored.emplace_back();
+    profile = &m_Unstored.back();
+  }
+  profile->Reset(ident_hash, ts);
+  m_Index[ident_hash] = profile;
   return profile;
 }
 
-void DeleteObsoleteProfiles()
-{
-  boost::filesystem::path path(core::GetPath(core::Path::Profiles));
+std::size_t ProfileStore::GetNumProfiles() const {
+  std::unique_lock<std::mutex> l(m_Mutex);
+  return m_Index.size();
+}
+
+std::size_t ProfileStore::Expire(std::uint64_t ts) {
+  std::size_t num_expired = 0;
+  std::unique_lock<std::mutex> l(m_Mutex);
+  for (auto it = m_Index.begin(); it != m_Index.end();) {
+    RouterProfile* profile = it->second;
+    if (!profile->IsExpired(ts)) {
+      ++it;
+      continue;
+    }
+    std::memset(profile->m_IdentHash, 0, sizeof(profile->m_IdentHash));
+    if (m_Records && profile >= m_Records && profile < m_Records + Size::MaxProfiles)
+      m_FreeRecords.push_back(profile);
+    else
+      m_FreeUnstored.push_back(profile);
+    it = m_Index.erase(it);
+    num_expired++;
+  }
+  return num_expired;
+}
+
+void ProfileStore::ImportProfiles(const boost::filesystem::path& directory) {
   std::size_t num_profiles = 0;
-  auto RemoveProfiles = [&](const boost::filesystem::path& path) {
-    auto timestamp = boost::posix_time::second_clock::local_time();
-    if (boost::filesystem::exists(path))
-      {
-        boost::filesystem::directory_iterator end;
-        for (boost::filesystem::directory_iterator dir(path); dir != end; ++dir)
-          {
-            if (boost::filesystem::is_directory(dir->status()))
-              {
-                for (boost::filesystem::directory_iterator it(dir->path());
-                     it != end;
-                     ++it)
-                  {
-                    auto last_modified = boost::posix_time::from_time_t(
-                        boost::filesystem::last_write_time(it->path()));
-                    if ((timestamp - last_modified).hours()
-                        >= PEER_PROFILE_EXPIRATION_TIMEOUT)
-                      {
-                        boost::filesystem::remove(it->path());
-                        num_profiles++;
-                      }
-                  }
-              }
-          }
-      }
+  auto const now = boost::posix_time::second_clock::local_time();
+  std::uint64_t const ts = GetSecondsSinceEpoch();
+  // False if the file is kept, being no profile or not imported
+  auto Import = [&](const boost::filesystem::path& filename) {
+    std::string const name = filename.stem().string();
+    if (name.compare(0, std::strlen(PEER_PROFILE_PREFIX), PEER_PROFILE_PREFIX))
+      return false;
+    boost::property_tree::ptree pt;
+    IdentHash ident_hash;
+    try {
+      ident_hash.FromBase64(name.substr(std::strlen(PEER_PROFILE_PREFIX)));
+      boost::property_tree::read_ini(filename.string(), pt);
+      auto const last_update = boost::posix_time::time_from_string(
+          pt.get<std::string>(PEER_PROFILE_LAST_UPDATE_TIME));
+      if ((now - last_update).hours() >= PEER_PROFILE_EXPIRATION_TIMEOUT)
+        return true;
+      auto profile = Get(ident_hash);
+      profile->m_LastUpdateTime.store(
+          ts - (now - last_update).total_seconds(),
+          std::memory_order_relaxed);
+      profile->m_NumTunnelsAgreed.store(pt.get(
+          std::string(PEER_PROFILE_SECTION_PARTICIPATION)
+              + "." + PEER_PROFILE_PARTICIPATION_AGREED, 0));
+      profile->m_NumTunnelsDeclined.store(pt.get(
+          std::string(PEER_PROFILE_SECTION_PARTICIPATION)
+              + "." + PEER_PROFILE_PARTICIPATION_DECLINED, 0));
+      profile->m_NumTunnelsNonReplied.store(pt.get(
+          std::string(PEER_PROFILE_SECTION_PARTICIPATION)
+              + "." + PEER_PROFILE_PARTICIPATION_NON_REPLIED, 0));
+      profile->m_NumTimesTaken.store(pt.get(
+          std::string(PEER_PROFILE_SECTION_USAGE)
+              + "." + PEER_PROFILE_USAGE_TAKEN, 0));
+      profile->m_NumTimesRejected.store(pt.get(
+          std::string(PEER_PROFILE_SECTION_USAGE)
+              + "." + PEER_PROFILE_USAGE_REJECTED, 0));
+      num_profiles++;
+    } catch (const std::exception& ex) {
+      LOG(warning)
+        << "ProfileStore: can't import " << filename << ": " << ex.what();
+      return false;
+    }
+    return true;
+  };
+  // Profile files are removed once imported, and their directories once
+  // empty, so that files which failed stay for another try
+  auto ImportDirectory = [&](const boost::filesystem::path& path) {
+    if (!boost::filesystem::is_directory(path))
+      return;
+    boost::filesystem::directory_iterator end;
+    std::vector<boost::filesystem::path> directories;
+    for (boost::filesystem::directory_iterator dir(path); dir != end; ++dir)
+      if (boost::filesystem::is_directory(dir->status()))
+        directories.push_back(dir->path());
+    for (auto const& dir : directories) {
+      std::vector<boost::filesystem::path> imported;
+      for (boost::filesystem::directory_iterator it(dir); it != end; ++it)
+        if (Import(it->path()))
+          imported.push_back(it->path());
+      boost::system::error_code ec;
+      for (auto const& filename : imported)
+        boost::filesystem::remove(filename, ec);
+      // Fails unless empty
+      boost::filesystem::remove(dir, ec);
+    }
   };
-// TODO(unassigned): this is a patch for #519 until we implement a database in #385
 #if defined(_WIN32) || defined(__APPLE__)
-  RemoveProfiles(path / "uppercase");
-  RemoveProfiles(path / "lowercase");
+  ImportDirectory(directory / "uppercase");
+  ImportDirectory(directory / "lowercase");
 #else
-  RemoveProfiles(path);
+  ImportDirectory(directory);
 #endif
-  LOG(debug) << "Profiling: " << num_profiles << " obsolete profiles deleted";
+  if (num_profiles)
+    LOG(info) << "ProfileStore: " << num_profiles << " profile files imported";
+}
+
+RouterProfile* GetRouterProfile(
+    const IdentHash& ident_hash) {
+  return profiles.Get(ident_hash);
 }
 
 }  // namespace core
@@ -33,14 +33,20 @@
 #ifndef SRC_CORE_ROUTER_PROFILING_H_
 #define SRC_CORE_ROUTER_PROFILING_H_
 
-#include <boost/date_time/posix_time/posix_time.hpp>
-
-#include <memory>
+#include <boost/filesystem/path.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #include "core/router/identity.h"
 
-#include "core/util/exception.h"
-
 namespace xi2p {
 namespace core {
 
@@ -58,21 +64,29 @@ const char PEER_PROFILE_USAGE_REJECTED[] = "rejected";
 
 const int PEER_PROFILE_EXPIRATION_TIMEOUT = 72;  // in hours (3 days)
 
+/// @class RouterProfile
+/// @brief Tunnel participation and usage counters of a peer
+/// @details A fixed-size record of the ProfileStore table, updated in place
+///   with relaxed atomics by any thread
 class RouterProfile {
  public:
-  explicit RouterProfile(const IdentHash& ident_hash);
-  RouterProfile& operator=(const RouterProfile&) = default;
-
-  void Save();
-  void Load();
-
   bool IsBad();
 
   void TunnelBuildResponse(std::uint8_t ret);
   void TunnelNonReplied();
 
+  /// @return False once the record was reclaimed, holders then fetch a new
+  ///   profile from the store
+  bool IsOf(const IdentHash& ident_hash) const;
+
  private:
-  boost::posix_time::ptime GetTime() const;
+  friend class ProfileStore;
+
+  /// @brief Starts a new profile for ident_hash
+  void Reset(const IdentHash& ident_hash, std::uint64_t ts);
+
+  bool IsExpired(std::uint64_t ts) const;
+
   void UpdateTime();
 
   bool IsAlwaysDeclining() const {
@@ -83,22 +97,84 @@ class RouterProfile {
   bool IsLowReplyRate() const;
 
  private:
-  IdentHash m_IdentHash;
-  boost::posix_time::ptime m_LastUpdateTime;
+  std::uint8_t m_IdentHash[32];
+  std::atomic<std::uint64_t> m_LastUpdateTime;  // seconds since epoch
   // participation
-  std::uint32_t m_NumTunnelsAgreed;
-  std::uint32_t m_NumTunnelsDeclined;
-  std::uint32_t m_NumTunnelsNonReplied;
+  std::atomic<std::uint32_t> m_NumTunnelsAgreed;
+  std::atomic<std::uint32_t> m_NumTunnelsDeclined;
+  std::atomic<std::uint32_t> m_NumTunnelsNonReplied;
   // usage
-  std::uint32_t m_NumTimesTaken;
-  std::uint32_t m_NumTimesRejected;
-  core::Exception m_Exception;
+  std::atomic<std::uint32_t> m_NumTimesTaken;
+  std::atomic<std::uint32_t> m_NumTimesRejected;
+  std::uint32_t m_Reserved;
 };
 
-std::shared_ptr<RouterProfile> GetRouterProfile(
-    const IdentHash& ident_hash);
+/// @class ProfileStore
+/// @brief Table of router profiles in a memory-mapped file
+/// @details The file is a header followed by fixed-size records in native
+///   byte order, mapped once for its maximum size so that records never
+///   move: a profile is a pointer into the mapping, updated without I/O and
+///   written back by Flush(). Expired profiles are dropped when the file is
+///   opened, and while it is open Expire() hands their records over to new
+///   profiles. Profiles beyond the table's capacity, or requested while no
+///   file is open, are kept in memory only.
+class ProfileStore {
+ public:
+  enum Size : std::uint32_t {
+    /// @brief Maximum number of stored profiles, 4 MiB of records
+    MaxProfiles = 65536,
+  };
+
+  ProfileStore();
+  ~ProfileStore();
+
+  /// @brief Maps the table file, creating it if needed, then drops expired
+  ///   profiles and imports profile files of older versions
+  /// @param directory Profiles directory
+  /// @return False if the file cannot be created or mapped
+  bool Open(const boost::filesystem::path& directory);
+
+  /// @brief Writes back and waits for all changes
+  /// @note Mapping is kept until destruction, as peers may keep their
+  ///   profile pointers
+  void Close();
 
-void DeleteObsoleteProfiles();
+  /// @brief Starts writing back changes, without waiting
+  void Flush();
+
+  /// @return Profile of ident_hash, created if needed, never null
+  RouterProfile* Get(const IdentHash& ident_hash);
+
+  std::size_t GetNumProfiles() const;
+
+  /// @brief Reclaims the records of profiles expired by ts for new profiles
+  /// @details Records never move: a reclaimed one is cleared, so that a peer
+  ///   still holding it notices through RouterProfile::IsOf()
+  /// @return Number of reclaimed profiles
+  std::size_t Expire(std::uint64_t ts);
+
+ private:
+  struct Header;
+
+  /// @brief Imports profile files written before the table existed
+  void ImportProfiles(const boost::filesystem::path& directory);
+
+ private:
+  mutable std::mutex m_Mutex;
+  boost::interprocess::file_mapping m_File;
+  boost::interprocess::mapped_region m_Region;
+  Header* m_Header;
+  RouterProfile* m_Records;
+  std::map<IdentHash, RouterProfile*> m_Index;
+  std::deque<RouterProfile> m_Unstored;
+  // Records reclaimed by Expire(), reused before new ones
+  std::vector<RouterProfile*> m_FreeRecords, m_FreeUnstored;
+};
+
+extern ProfileStore profiles;
+
+RouterProfile* GetRouterProfile(
+    const IdentHash& ident_hash);
 
 }  // namespace core
 }  // namespace xi2p
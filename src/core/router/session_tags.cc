@@ -0,0 +1,218 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#include "core/router/session_tags.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "core/crypto/rand.h"
+
+namespace xi2p {
+namespace core {
+
+SessionTagStore::SessionTagStore(std::uint32_t lifetime)
+    // Live intervals, plus the one being expired
+    : m_NumBuckets(lifetime / Time::BucketInterval + 2),
+      m_Slots(Size::MinSlots),
+      m_NumTags(0),
+      m_NumDeleted(0),
+      m_Buckets(m_NumBuckets),
+      m_ExpiredBucket(0) {
+  RandBytes(
+      reinterpret_cast<std::uint8_t*>(m_HashKey.data()),
+      sizeof(m_HashKey));
+}
+
+SessionTagStore::~SessionTagStore() {}
+
+void SessionTagStore::Add(
+    const std::shared_ptr<CBCDecryption>& decryption,
+    const std::uint8_t* tags,
+    std::size_t num,
+    std::uint32_t ts) {
+  Expire(ts);
+  if (!num || !decryption)
+    return;
+  // A clock moved backwards must not add tags to an expired interval
+  std::uint32_t const bucket =
+      std::max(ts / Time::BucketInterval, m_ExpiredBucket + 1);
+  if ((m_NumTags + m_NumDeleted + num) * 4 > m_Slots.size() * 3)
+    Resize(m_NumTags + num);
+  std::uint32_t const session = GetSession(decryption);
+  for (std::size_t i = 0; i < num; i++) {
+    const std::uint8_t* tag = tags + i * 32;
+    std::size_t const index = Find(tag);
+    Slot& slot = m_Slots[index];
+    m_Sessions[session].num_tags++;
+    if (slot.session == SlotState::EmptySlot
+        || slot.session == SlotState::DeletedSlot) {
+      if (slot.session == SlotState::DeletedSlot)
+        m_NumDeleted--;
+      m_NumTags++;
+      slot.tag = Tag<32>(tag);
+    } else {
+      // Same tag received again, it now belongs to the new session
+      Session& previous = m_Sessions[slot.session - 1];
+      if (!--previous.num_tags) {
+        m_SessionIndexes.erase(previous.decryption.get());
+        previous.decryption.reset();
+        m_FreeSessions.push_back(slot.session - 1);
+      }
+    }
+    slot.session = session + 1;
+    slot.bucket = bucket;
+    m_Buckets[bucket % m_NumBuckets].push_back(index);
+  }
+}
+
+std::shared_ptr<CBCDecryption> SessionTagStore::Take(
+    const std::uint8_t* tag) {
+  std::size_t const index = Find(tag);
+  Slot const& slot = m_Slots[index];
+  if (slot.session == SlotState::EmptySlot
+      || slot.session == SlotState::DeletedSlot)
+    return nullptr;
+  auto decryption = m_Sessions[slot.session - 1].decryption;
+  Remove(index);
+  return decryption;
+}
+
+std::size_t SessionTagStore::Expire(
+    std::uint32_t ts) {
+  std::uint32_t const current = ts / Time::BucketInterval;
+  if (current < m_NumBuckets)
+    return 0;
+  // Intervals up to this one have expired
+  std::uint32_t const expired = current - (m_NumBuckets - 1);
+  // Every bucket expired since last time, each is visited once
+  if (expired > m_ExpiredBucket + m_NumBuckets)
+    m_ExpiredBucket = expired - m_NumBuckets;
+  std::size_t num_expired = 0;
+  for (; m_ExpiredBucket < expired; m_ExpiredBucket++) {
+    auto& bucket = m_Buckets[(m_ExpiredBucket + 1) % m_NumBuckets];
+    for (auto const index : bucket) {
+      Slot const& slot = m_Slots[index];
+      // Slot may have been freed, or reused by a newer tag
+      if (slot.session != SlotState::EmptySlot
+          && slot.session != SlotState::DeletedSlot
+          && slot.bucket <= expired) {
+        Remove(index);
+        num_expired++;
+      }
+    }
+    bucket.clear();
+  }
+  // Give memory back once most tags are gone
+  if (m_Slots.size() > Size::MinSlots && m_NumTags * 8 < m_Slots.size())
+    Resize(m_NumTags);
+  return num_expired;
+}
+
+std::size_t SessionTagStore::GetHash(const std::uint8_t* tag) const {
+  // Tags are random, but chosen by peers: keyed so that they cannot pick
+  // tags which collide
+  std::uint64_t a, b;
+  std::memcpy(&a, tag, sizeof(a));
+  std::memcpy(&b, tag + sizeof(a), sizeof(b));
+  std::uint64_t hash = (a ^ m_HashKey[0]) * 0x9E3779B97F4A7C15ULL;
+  hash = (hash ^ b ^ m_HashKey[1]) * 0xC2B2AE3D27D4EB4FULL;
+  return hash ^ (hash >> 32);
+}
+
+std::size_t SessionTagStore::Find(const std::uint8_t* tag) const {
+  std::size_t const mask = m_Slots.size() - 1;
+  std::size_t index = GetHash(tag) & mask, free = m_Slots.size();
+  // Never full, so the probe ends on an empty slot
+  for (;; index = (index + 1) & mask) {
+    Slot const& slot = m_Slots[index];
+    if (slot.session == SlotState::EmptySlot)
+      return free < m_Slots.size() ? free : index;
+    if (slot.session == SlotState::DeletedSlot) {
+      if (free == m_Slots.size())
+        free = index;
+    } else if (!std::memcmp(slot.tag(), tag, 32)) {
+      return index;
+    }
+  }
+}
+
+void SessionTagStore::Remove(std::size_t index) {
+  Slot& slot = m_Slots[index];
+  Session& session = m_Sessions[slot.session - 1];
+  if (!--session.num_tags) {
+    m_SessionIndexes.erase(session.decryption.get());
+    session.decryption.reset();
+    m_FreeSessions.push_back(slot.session - 1);
+  }
+  slot.session = SlotState::DeletedSlot;
+  m_NumTags--;
+  m_NumDeleted++;
+}
+
+void SessionTagStore::Resize(std::size_t num_tags) {
+  std::size_t size = Size::MinSlots;
+  while (size < num_tags * 2)
+    size *= 2;
+  std::vector<Slot> slots(size);
+  slots.swap(m_Slots);
+  m_NumDeleted = 0;
+  for (auto& bucket : m_Buckets)
+    bucket.clear();
+  for (auto const& slot : slots) {
+    if (slot.session == SlotState::EmptySlot
+        || slot.session == SlotState::DeletedSlot)
+      continue;
+    std::size_t const index = Find(slot.tag());
+    m_Slots[index] = slot;
+    m_Buckets[slot.bucket % m_NumBuckets].push_back(index);
+  }
+}
+
+std::uint32_t SessionTagStore::GetSession(
+    const std::shared_ptr<CBCDecryption>& decryption) {
+  auto it = m_SessionIndexes.find(decryption.get());
+  if (it != m_SessionIndexes.end())
+    return it->second;
+  std::uint32_t index;
+  if (!m_FreeSessions.empty()) {
+    index = m_FreeSessions.back();
+    m_FreeSessions.pop_back();
+  } else {
+    index = m_Sessions.size();
+    m_Sessions.emplace_back();
+  }
+  m_Sessions[index] = {decryption, 0};
+  m_SessionIndexes.emplace(decryption.get(), index);
+  return index;
+}
+
+}  // namespace core
+}  // namespace xi2p
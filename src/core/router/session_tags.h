@@ -0,0 +1,151 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#ifndef SRC_CORE_ROUTER_SESSION_TAGS_H_
+#define SRC_CORE_ROUTER_SESSION_TAGS_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "core/crypto/aes.h"
+
+#include "core/util/tag.h"
+
+namespace xi2p {
+namespace core {
+
+/// @class SessionTagStore
+/// @brief Incoming garlic session tags, each mapped to its session's key
+/// @details Tags live in an open-addressing table indexed by a keyed hash of
+///   their random bytes, so a lookup is a short linear probe. A tag refers
+///   to its session by index, and the session's decryption (with its key
+///   schedule) is kept once for all of its tags. Tags expire through a time
+///   wheel: each bucket lists the slots of the tags added during one
+///   interval, and is dropped as a whole once the interval expires.
+/// @note Not thread-safe
+class SessionTagStore {
+ public:
+  enum Time : std::uint32_t {
+    /// @brief Width of a time wheel bucket, in seconds
+    BucketInterval = 60,
+  };
+
+  /// @param lifetime Seconds after which a tag expires
+  explicit SessionTagStore(std::uint32_t lifetime);
+  ~SessionTagStore();
+
+  /// @brief Adds tags of a session, then expires older tags
+  /// @param decryption Session's decryption, shared by all of its tags
+  /// @param tags num contiguous 32-byte tags
+  /// @param ts Seconds since epoch
+  void Add(
+      const std::shared_ptr<CBCDecryption>& decryption,
+      const std::uint8_t* tags,
+      std::size_t num,
+      std::uint32_t ts);
+
+  /// @brief Finds a tag and removes it, as a tag is used only once
+  /// @return Decryption of the tag's session, null if not found
+  std::shared_ptr<CBCDecryption> Take(
+      const std::uint8_t* tag);
+
+  /// @brief Drops the tags of every bucket which expired by ts
+  /// @return Number of expired tags
+  std::size_t Expire(
+      std::uint32_t ts);
+
+  std::size_t GetNumTags() const noexcept {
+    return m_NumTags;
+  }
+
+  std::size_t GetNumSessions() const noexcept {
+    return m_SessionIndexes.size();
+  }
+
+ private:
+  enum Size : std::uint32_t {
+    MinSlots = 64,
+  };
+
+  enum SlotState : std::uint32_t {
+    EmptySlot = 0,
+    DeletedSlot = 0xFFFFFFFF,
+  };
+
+  struct Slot {
+    Tag<32> tag;
+    std::uint32_t session = SlotState::EmptySlot;  ///< Index + 1, or a SlotState
+    std::uint32_t bucket = 0;  ///< Time wheel interval the tag was added in
+  };
+
+  struct Session {
+    std::shared_ptr<CBCDecryption> decryption;
+    std::uint32_t num_tags;
+  };
+
+  /// @return Start of the probe sequence of tag
+  std::size_t GetHash(const std::uint8_t* tag) const;
+
+  /// @return Index of the slot holding tag, or of the first free slot
+  ///   where it can be inserted
+  std::size_t Find(const std::uint8_t* tag) const;
+
+  /// @brief Frees slot and releases its session
+  void Remove(std::size_t slot);
+
+  /// @brief Rebuilds table with room for num_tags live tags
+  void Resize(std::size_t num_tags);
+
+  /// @return Index of session owning decryption, added if new
+  std::uint32_t GetSession(const std::shared_ptr<CBCDecryption>& decryption);
+
+ private:
+  std::uint32_t m_NumBuckets;
+  std::vector<Slot> m_Slots;
+  std::size_t m_NumTags, m_NumDeleted;
+  std::array<std::uint64_t, 2> m_HashKey;
+  std::vector<Session> m_Sessions;
+  std::vector<std::uint32_t> m_FreeSessions;
+  std::unordered_map<const CBCDecryption*, std::uint32_t> m_SessionIndexes;
+  /// @brief Slots of the tags added in each interval, indexed by interval
+  ///   modulo number of buckets
+  std::vector<std::vector<std::uint32_t>> m_Buckets;
+  /// @brief Last interval expired
+  std::uint32_t m_ExpiredBucket;
+};
+
+}  // namespace core
+}  // namespace xi2p
+
+#endif  // SRC_CORE_ROUTER_SESSION_TAGS_H_
@@ -46,76 +46,136 @@
 namespace xi2p {
 namespace core {
 
+constexpr std::chrono::milliseconds DHKeysPairSupplier::DefaultRateWindow;
+
 DHKeysPairSupplier::DHKeysPairSupplier(
-    std::size_t size)
-    : m_QueueSize(size),
+    std::size_t min_size,
+    std::size_t max_size,
+    std::chrono::milliseconds rate_window)
+    : m_MinSize(min_size),
+      m_MaxSize(std::max(min_size, max_size)),
+      m_RateWindow(rate_window),
+      m_TargetSize(min_size),
+      m_NumGenerating(0),
+      m_NumAcquired(0),
+      m_RateWindowStart(std::chrono::steady_clock::now()),
       m_IsRunning(false),
-      m_Thread(nullptr),
+      m_NumEmpty(0),
       m_Exception(__func__) {}
 
 DHKeysPairSupplier::~DHKeysPairSupplier() {
   Stop();
 }
 
-void DHKeysPairSupplier::Start() {
+void DHKeysPairSupplier::Start(
+    std::size_t num_threads) {
   LOG(debug) << "DHKeysPairSupplier: starting";
+  if (!m_Threads.empty())
+    return;
+  if (!num_threads)
+    num_threads = std::max(1u, std::thread::hardware_concurrency() / 2);
   m_IsRunning = true;
-  m_Thread =
-    std::make_unique<std::thread>(
-        std::bind(
-            &DHKeysPairSupplier::Run,
-            this));
+  for (std::size_t i = 0; i < num_threads; i++)
+    m_Threads.push_back(
+        std::make_unique<std::thread>(
+            std::bind(
+                &DHKeysPairSupplier::Run,
+                this)));
 }
 
 void DHKeysPairSupplier::Stop() {
-  m_IsRunning = false;
-  m_Acquired.notify_one();
-  if (m_Thread) {
-    m_Thread->join();
-    m_Thread.reset(nullptr);
+  {
+    std::unique_lock<std::mutex> l(m_AcquiredMutex);
+    m_IsRunning = false;
   }
+  m_Acquired.notify_all();
+  for (auto& thread : m_Threads)
+    thread->join();
+  m_Threads.clear();
 }
 
 void DHKeysPairSupplier::Run() {
   LOG(debug) << "DHKeysPairSupplier: running";
+  // One instance per thread, generation uses the shared fixed-base table
+  std::unique_ptr<xi2p::core::DiffieHellman> dh;
+  std::unique_lock<std::mutex> l(m_AcquiredMutex);
   while (m_IsRunning) {
-    if (m_QueueSize > m_Queue.size ())
-      CreateDHKeysPairs(m_QueueSize - m_Queue.size());
-    std::unique_lock<std::mutex> l(m_AcquiredMutex);
-    m_Acquired.wait(l);  // wait for element gets acquired
+    // Decay the target while no acquire closes the windows
+    UpdateTargetSize(false);
+    // Count pairs being generated so threads don't overshoot the target
+    if (m_Queue.size() + m_NumGenerating < m_TargetSize) {
+      m_NumGenerating++;
+      l.unlock();
+      std::unique_ptr<xi2p::core::DHKeysPair> pair;
+      try {
+        if (!dh)
+          dh = std::make_unique<xi2p::core::DiffieHellman>();
+        pair = std::make_unique<xi2p::core::DHKeysPair>();
+        dh->GenerateKeyPair(
+            pair->private_key.data(),
+            pair->public_key.data());
+      } catch (...) {
+        m_Exception.Dispatch(__func__);
+        // Start over with a new instance, after a window so a lasting
+        // failure doesn't spin
+        dh.reset();
+        pair.reset();
+      }
+      l.lock();
+      m_NumGenerating--;
+      if (pair)
+        m_Queue.push(std::move(pair));
+      else if (m_IsRunning)
+        m_Acquired.wait_for(l, m_RateWindow);
+    } else {
+      // Wait for an acquire, or for the window to end
+      m_Acquired.wait_for(l, m_RateWindow);
+    }
   }
 }
 
-void DHKeysPairSupplier::CreateDHKeysPairs(
-    std::size_t num) {
-  LOG(debug) << "DHKeysPairSupplier: creating";
-  // TODO(anonimal): this try block should be handled entirely by caller
-  try {
-    for (std::size_t i = 0; i < num; i++) {
-      auto pair = std::make_unique<xi2p::core::DHKeysPair>();
-      xi2p::core::DiffieHellman().GenerateKeyPair(
-          pair->private_key.data(),
-          pair->public_key.data());
-      std::unique_lock<std::mutex>  l(m_AcquiredMutex);
-      m_Queue.push(std::move(pair));
-    }
-  } catch (...) {
-    m_Exception.Dispatch(__func__);
-    // TODO(anonimal): review if we need to safely break control, ensure exception handling by callers
-    throw;
+void DHKeysPairSupplier::UpdateTargetSize(
+    bool is_empty) {
+  auto const now = std::chrono::steady_clock::now();
+  std::size_t target = m_TargetSize;
+  if (is_empty) {
+    // A storm outran the pool, grow right away
+    target *= 2;
+  } else if (now - m_RateWindowStart >= m_RateWindow) {
+    auto const elapsed =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          now - m_RateWindowStart).count();
+    std::size_t const demand =
+      m_NumAcquired * RateReserve * 1000 / std::max<std::int64_t>(1, elapsed);
+    // Grow to the demand at once, shrink back by a quarter per window
+    target = demand >= target ? demand : std::max(demand, target - target / 4);
+    m_NumAcquired = 0;
+    m_RateWindowStart = now;
+  }
+  target = std::min(std::max(target, m_MinSize), m_MaxSize);
+  if (target != m_TargetSize) {
+    LOG(debug) << "DHKeysPairSupplier: target size " << target;
+    m_TargetSize = target;
   }
 }
 
 std::unique_ptr<DHKeysPair> DHKeysPairSupplier::Acquire() {
   LOG(debug) << "DHKeysPairSupplier: acquiring";
   std::unique_lock<std::mutex> l(m_AcquiredMutex);
-  if (!m_Queue.empty()) {
+  bool const is_empty = m_Queue.empty();
+  m_NumAcquired++;
+  UpdateTargetSize(is_empty);
+  if (!is_empty) {
     auto pair = std::move(m_Queue.front());
     m_Queue.pop();
-    m_Acquired.notify_one();
+    l.unlock();
+    m_Acquired.notify_all();
     return pair;
   }
   l.unlock();
+  m_Acquired.notify_all();
+  m_NumEmpty++;
+  LOG(debug) << "DHKeysPairSupplier: pool is empty, generating inline";
   // queue is empty, create new key pair
   auto pair = std::make_unique<DHKeysPair>();
   // TODO(anonimal): this try block should be larger or handled entirely by caller
@@ -135,7 +195,8 @@ void DHKeysPairSupplier::Return(
     std::unique_ptr<DHKeysPair> pair) {
   LOG(debug) << "DHKeysPairSupplier: returning";
   std::unique_lock<std::mutex> l(m_AcquiredMutex);
-  m_Queue.push(std::move(pair));
+  if (m_Queue.size() < m_TargetSize)
+    m_Queue.push(std::move(pair));
 }
 
 void Peer::Done() {
@@ -154,8 +215,9 @@ Transports::Transports()
       m_PeerCleanupTimer(m_Service),
       m_NTCPServer(nullptr),
       m_SSUServer(nullptr),
-      // TODO(unassigned): get rid of magic number
-      m_DHKeysPairSupplier(5),  // 5 pre-generated keys
+      m_DHKeysPairSupplier(
+          DH_KEYS_PAIRS_MIN_SIZE,
+          DH_KEYS_PAIRS_MAX_SIZE),
       m_TotalSentBytes(0),
       m_TotalReceivedBytes(0),
       m_InBandwidth(0),
@@ -36,6 +36,7 @@
 #include <boost/asio.hpp>
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
 #include <functional>
@@ -67,15 +68,28 @@ namespace core {
 
 /// @class DHKeysPairSupplier
 /// @brief Pregenerates Diffie-Hellman key pairs for use in key exchange
-/// TODO(unassigned): Does this really need to run on a separate thread?
+/// @details Key pairs are generated on several threads. The number kept
+///   ready follows the observed acquire rate, so that connection storms are
+///   served from the pool instead of generating keys on transport threads.
+///   Generating threads close the rate windows too, so an idle pool shrinks.
 class DHKeysPairSupplier {
  public:
+  /// @brief Acquire rate is measured over windows of this length
+  static constexpr std::chrono::milliseconds DefaultRateWindow{1000};
+
+  /// @param min_size Number of key pairs kept ready when idle
+  /// @param max_size Upper bound for the adaptive pool size
+  /// @param rate_window Length of the acquire rate windows
   DHKeysPairSupplier(
-      std::size_t size);
+      std::size_t min_size,
+      std::size_t max_size,
+      std::chrono::milliseconds rate_window = DefaultRateWindow);
 
   ~DHKeysPairSupplier();
 
-  void Start();
+  /// @param num_threads Number of generating threads, 0 for one per two cores
+  void Start(
+      std::size_t num_threads = 0);
 
   void Stop();
 
@@ -84,19 +98,40 @@ class DHKeysPairSupplier {
   void Return(
       std::unique_ptr<DHKeysPair> pair);
 
+  /// @return Number of acquires which found the pool empty and generated inline
+  std::uint64_t GetNumEmpty() const {
+    return m_NumEmpty;
+  }
+
+  /// @return Number of key pairs currently aimed for
+  std::size_t GetTargetSize() const {
+    std::unique_lock<std::mutex> l(m_AcquiredMutex);
+    return m_TargetSize;
+  }
+
  private:
+  /// @brief Seconds of demand at the last observed rate kept ready
+  static const std::uint16_t RateReserve = 2;  // in seconds
+
   void Run();
 
-  void CreateDHKeysPairs(
-      std::size_t num);
+  /// @brief Adapts the target size, to the demand of the last window once
+  ///   it has ended and right away when an acquire found the pool empty
+  /// @note Must be called with m_AcquiredMutex held
+  void UpdateTargetSize(
+      bool is_empty);
 
  private:
-  const std::size_t m_QueueSize;
+  const std::size_t m_MinSize, m_MaxSize;
+  const std::chrono::milliseconds m_RateWindow;
+  std::size_t m_TargetSize, m_NumGenerating, m_NumAcquired;
+  std::chrono::steady_clock::time_point m_RateWindowStart;
   bool m_IsRunning;
+  std::atomic<std::uint64_t> m_NumEmpty;
   std::queue<std::unique_ptr<DHKeysPair>> m_Queue;
-  std::unique_ptr<std::thread> m_Thread;
+  std::vector<std::unique_ptr<std::thread>> m_Threads;
   std::condition_variable m_Acquired;
-  std::mutex m_AcquiredMutex;
+  mutable std::mutex m_AcquiredMutex;
   core::Exception m_Exception;
 };
 
@@ -114,6 +149,8 @@ struct Peer {
 
 const std::size_t SESSION_CREATION_TIMEOUT = 10;  // in seconds
 const std::uint32_t LOW_BANDWIDTH_LIMIT = 32 * 1024;  // 32KBps
+const std::size_t DH_KEYS_PAIRS_MIN_SIZE = 5;  // pre-generated when idle
+const std::size_t DH_KEYS_PAIRS_MAX_SIZE = 256;  // pre-generated during storms
 
 /// @class Transports
 /// @brief Provides functions to pass messages to a given peer.
@@ -146,6 +183,11 @@ class Transports {
   void ReuseDHKeysPair(
       std::unique_ptr<DHKeysPair> pair);
 
+  /// @return Number of DH key pairs generated inline because none was ready
+  std::uint64_t GetNumDHKeysPairsEmpty() const {
+    return m_DHKeysPairSupplier.GetNumEmpty();
+  }
+
   /// @brief Asynchronously sends a message to a peer.
   /// @param ident the router hash of the remote peer
   /// @param msg the I2NP message to deliver
@@ -35,6 +35,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
 #include <vector>
 #include <boost/endian/conversion.hpp>
 
@@ -942,6 +943,8 @@ boost::asio::const_buffers_1 NTCPSession::CreateMsgBuffer(
           << "NTCPSession:" << GetFormattedSessionInfo()
           << "!!! malformed I2NP message";  // TODO(unassigned): Error handling
       }
+      // NTCP carries the full header, checksum included
+      msg->FinalizeChks();
       send_buffer = msg->GetBuffer() - NTCPSize::Phase3AliceRI;
       len = msg->GetLength();
       core::OutputByteStream::Write<std::uint16_t>(send_buffer, len);
@@ -1023,19 +1026,19 @@ void NTCPSession::HandleReceivedPayload(
     << GetNumReceivedBytes() << " total bytes received";
   xi2p::core::transports.UpdateReceivedBytes(bytes_transferred);
   m_ReceiveBufferOffset += bytes_transferred;
-  // Decrypt as many 16 byte blocks as possible
-  std::uint8_t* next_block = m_ReceiveBuffer;
-  while(m_ReceiveBufferOffset >= block_size) {
-    // Try to decrypt one block
-    if (!DecryptNextBlock(next_block)) {
-      Terminate();
-      return;
-    }
-    next_block += block_size;
-    m_ReceiveBufferOffset -= block_size;
+  // Decrypt all complete 16 byte blocks
+  std::size_t const decrypted_len =
+    m_ReceiveBufferOffset - m_ReceiveBufferOffset % block_size;
+  if (!DecryptBlocks(m_ReceiveBuffer, decrypted_len)) {
+    Terminate();
+    return;
   }
-  if (m_ReceiveBufferOffset) // Do we have an incomplete block?
-    std::memcpy(m_ReceiveBuffer, next_block, m_ReceiveBufferOffset);
+  m_ReceiveBufferOffset -= decrypted_len;
+  if (decrypted_len && m_ReceiveBufferOffset) // Do we have an incomplete block?
+    std::memcpy(
+        m_ReceiveBuffer,
+        m_ReceiveBuffer + decrypted_len,
+        m_ReceiveBufferOffset);
   // Flush and reset termination timer if a full message was read
   if (m_NextMessage == nullptr) {
     m_Handler.Flush();
@@ -1050,18 +1053,28 @@ void NTCPSession::HandleReceivedPayload(
     ReceivePayload();
 }
 
-bool NTCPSession::DecryptNextBlock(
-    const std::uint8_t* encrypted) {  // 16 bytes
+bool NTCPSession::DecryptBlocks(
+    const std::uint8_t* encrypted,
+    std::size_t len) {
   // TODO(anonimal): this try block should be larger or handled entirely by caller
   try {
-    // New message, header expected
-    if (!m_NextMessage) {
-      // Decrypt header and extract length
-      std::array<std::uint8_t, NTCPSize::IV> buf;
-      m_Decryption.Decrypt(encrypted, buf.data());
-      std::uint16_t const data_size =
-          core::InputByteStream::Read<std::uint16_t>(buf.data());
-      if (data_size) {
+    const std::size_t block_size = NTCPSize::IV;
+    const std::uint8_t* const end = encrypted + len;
+    while (encrypted < end) {
+      // New message, header expected
+      if (!m_NextMessage) {
+        // Decrypt header and extract length
+        std::array<std::uint8_t, NTCPSize::IV> buf;
+        m_Decryption.Decrypt(encrypted, buf.data());
+        encrypted += block_size;
+        std::uint16_t const data_size =
+            core::InputByteStream::Read<std::uint16_t>(buf.data());
+        if (!data_size) {
+          // Timestamp
+          LOG(debug)
+            << "NTCPSession:" << GetFormattedSessionInfo() << "*** timestamp";
+          continue;
+        }
         // New message
         if (data_size > NTCPSize::MaxMessage) {
           LOG(error)
@@ -1080,29 +1093,35 @@ bool NTCPSession::DecryptNextBlock(
         m_NextMessageOffset = NTCPSize::IV;
         m_NextMessage->offset = NTCPSize::Phase3AliceRI;  // size field
         m_NextMessage->len = data_size + NTCPSize::Phase3AliceRI;
-      } else {
-        // Timestamp
-        LOG(debug)
-          << "NTCPSession:" << GetFormattedSessionInfo() << "*** timestamp";
-        return true;
+      } else {  // Message continues
+        // Rest of the message (padded to whole blocks) or whatever of it
+        // was received, in one call
+        std::size_t const remaining =
+          m_NextMessage->len + NTCPSize::Adler32 - m_NextMessageOffset;
+        std::size_t const decrypt_len = std::min<std::size_t>(
+            (remaining + block_size - 1) / block_size * block_size,
+            end - encrypted);
+        m_Decryption.Decrypt(
+            encrypted,
+            decrypt_len,
+            m_NextMessage->buf + m_NextMessageOffset);
+        encrypted += decrypt_len;
+        m_NextMessageOffset += decrypt_len;
+      }
+      if (m_NextMessageOffset >=
+          m_NextMessage->len + NTCPSize::Adler32) {
+        // We have a complete I2NP message
+        if (xi2p::core::Adler32().VerifyDigest(
+              m_NextMessage->buf + m_NextMessageOffset - NTCPSize::Adler32,
+              m_NextMessage->buf,
+              m_NextMessageOffset - NTCPSize::Adler32))
+          m_Handler.PutNextMessage(m_NextMessage);
+        else
+          LOG(warning)
+            << "NTCPSession:" << GetFormattedSessionInfo()
+            << "!!! incorrect Adler checksum of NTCP message, dropped";
+        m_NextMessage = nullptr;
       }
-    } else {  // Message continues
-      m_Decryption.Decrypt(encrypted, m_NextMessage->buf + m_NextMessageOffset);
-      m_NextMessageOffset += NTCPSize::IV;
-    }
-    if (m_NextMessageOffset >=
-        m_NextMessage->len + NTCPSize::Adler32) {
-      // We have a complete I2NP message
-      if (xi2p::core::Adler32().VerifyDigest(
-            m_NextMessage->buf + m_NextMessageOffset - NTCPSize::Adler32,
-            m_NextMessage->buf,
-            m_NextMessageOffset - NTCPSize::Adler32))
-        m_Handler.PutNextMessage(m_NextMessage);
-      else
-        LOG(warning)
-          << "NTCPSession:" << GetFormattedSessionInfo()
-          << "!!! incorrect Adler checksum of NTCP message, dropped";
-      m_NextMessage = nullptr;
     }
   } catch (...) {
     m_Exception.Dispatch(__func__);
@@ -223,8 +223,15 @@ class NTCPSession
       const boost::system::error_code& ecode,
       std::size_t bytes_transferred);
 
-  bool DecryptNextBlock(
-      const std::uint8_t* encrypted);
+  /// @brief Decrypts received blocks and hands over completed messages
+  /// @details Message bodies are decrypted straight into their I2NP buffers,
+  ///   as many blocks per call as the message and the receive buffer allow
+  /// @param encrypted Received data
+  /// @param len Length of received data, a multiple of the block size
+  /// @return False if the peer sent an invalid message
+  bool DecryptBlocks(
+      const std::uint8_t* encrypted,
+      std::size_t len);
 
   /// @brief Send payload (I2NP message)
   /// @param msg shared pointer to payload (I2NPMessage)
@@ -0,0 +1,129 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#include "core/router/transports/ssu/acks.h"
+
+#include <algorithm>
+
+#include "core/router/transports/ssu/packet.h"
+#include "core/util/byte_stream.h"
+
+namespace xi2p {
+namespace core {
+
+void SSUPendingACKs::AddMessage(
+    std::uint32_t msg_id) {
+  m_Fragments.erase(msg_id);
+  if (std::find(m_Messages.begin(), m_Messages.end(), msg_id)
+      == m_Messages.end())
+    m_Messages.push_back(msg_id);
+}
+
+bool SSUPendingACKs::AddFragment(
+    std::uint32_t msg_id,
+    std::size_t fragment_num) {
+  if (fragment_num >= Size::MaxBitfieldFragments)
+    return false;
+  m_Fragments[msg_id] |= std::uint64_t(1) << fragment_num;
+  return true;
+}
+
+std::size_t SSUPendingACKs::GetSize() const {
+  std::size_t size = 0;
+  if (!m_Messages.empty())
+    size += 1 + m_Messages.size() * 4;
+  if (!m_Fragments.empty())
+    size++;
+  for (auto const& fragments : m_Fragments)
+    size += 4 + GetBitfieldSize(fragments.second);
+  return size;
+}
+
+void SSUPendingACKs::Write(
+    std::uint8_t*& buf,
+    std::size_t size,
+    std::uint8_t& flag) {
+  // explicit ACKs: count, then message IDs
+  if (!m_Messages.empty() && size >= 1 + 4) {
+    std::size_t const num_ACKs = std::min<std::size_t>(
+        {m_Messages.size(), (size - 1) / 4, Size::MaxACKs});
+    *buf = num_ACKs;
+    buf++;
+    for (std::size_t i = 0; i < num_ACKs; i++) {
+      core::OutputByteStream::Write<std::uint32_t>(buf, m_Messages[i]);
+      buf += 4;
+    }
+    m_Messages.erase(m_Messages.begin(), m_Messages.begin() + num_ACKs);
+    size -= 1 + num_ACKs * 4;
+    flag |= SSUFlag::DataExplicitACKsIncluded;
+  }
+  // ACK bitfields: count, then message IDs each followed by its bitfield
+  if (!m_Fragments.empty() && size >= 1 + 4 + 1) {
+    auto num_bitfields = buf;
+    *num_bitfields = 0;
+    buf++;
+    size--;
+    for (auto it = m_Fragments.begin();
+         it != m_Fragments.end() && *num_bitfields < Size::MaxACKs;) {
+      auto const bitfield_size = GetBitfieldSize(it->second);
+      if (4 + bitfield_size > size) {
+        it++;
+        continue;
+      }
+      core::OutputByteStream::Write<std::uint32_t>(buf, it->first);
+      buf += 4;
+      // 7 fragments per byte, the MSB telling if another byte follows
+      for (std::size_t i = 0; i < bitfield_size; i++) {
+        *buf = (it->second >> (7 * i)) & 0x7F;
+        if (i + 1 < bitfield_size)
+          *buf |= SSUFlag::DataACKBitFieldHasNext;
+        buf++;
+      }
+      size -= 4 + bitfield_size;
+      (*num_bitfields)++;
+      it = m_Fragments.erase(it);
+    }
+    if (*num_bitfields)
+      flag |= SSUFlag::DataACKBitfieldsIncluded;
+    else
+      buf--;
+  }
+}
+
+std::size_t SSUPendingACKs::GetBitfieldSize(
+    std::uint64_t fragments) {
+  std::size_t size = 1;
+  while (fragments >>= 7)
+    size++;
+  return size;
+}
+
+}  // namespace core
+}  // namespace xi2p
@@ -0,0 +1,98 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#ifndef SRC_CORE_ROUTER_TRANSPORTS_SSU_ACKS_H_
+#define SRC_CORE_ROUTER_TRANSPORTS_SSU_ACKS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace xi2p {
+namespace core {
+
+/// @class SSUPendingACKs
+/// @brief ACKs of the messages and fragments received from a peer, waiting
+///   to be sent, alone or along with data
+/// @details Fragment ACKs of a message are merged into one bitfield, and
+///   superseded by the explicit ACK of the message once it is complete
+/// @note Not thread-safe
+class SSUPendingACKs {
+ public:
+  enum Size : std::size_t {
+    /// @brief Fragments of a message which can be ACKed by bitfield
+    MaxBitfieldFragments = 64,
+    /// @brief Explicit ACKs or bitfields in a packet (1 byte count)
+    MaxACKs = 0xFF,
+  };
+
+  /// @brief Queues the explicit ACK of a complete message
+  void AddMessage(
+      std::uint32_t msg_id);
+
+  /// @brief Queues the ACK of a fragment
+  /// @return False if the fragment number is too high to be ACKed
+  bool AddFragment(
+      std::uint32_t msg_id,
+      std::size_t fragment_num);
+
+  bool IsEmpty() const {
+    return m_Messages.empty() && m_Fragments.empty();
+  }
+
+  /// @return Bytes needed to write all queued ACKs, counts included
+  std::size_t GetSize() const;
+
+  /// @brief Writes, and dequeues, as many ACKs as fit: explicit ones first,
+  ///   then bitfields
+  /// @param buf Where ACKs are written, after the data flag. Advanced past
+  ///   what is written
+  /// @param size Bytes available, counts included
+  /// @param flag Data flag, to which the flags of the ACKs written are added
+  void Write(
+      std::uint8_t*& buf,
+      std::size_t size,
+      std::uint8_t& flag);
+
+ private:
+  /// @return Bytes taken by a bitfield of fragments
+  static std::size_t GetBitfieldSize(
+      std::uint64_t fragments);
+
+ private:
+  std::vector<std::uint32_t> m_Messages;
+  std::map<std::uint32_t, std::uint64_t> m_Fragments;  // bit per fragment
+};
+
+}  // namespace core
+}  // namespace xi2p
+
+#endif  // SRC_CORE_ROUTER_TRANSPORTS_SSU_ACKS_H_
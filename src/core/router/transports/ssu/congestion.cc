@@ -0,0 +1,190 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#include "core/router/transports/ssu/congestion.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace xi2p {
+namespace core {
+
+SSUCongestionControl::SSUCongestionControl(
+    std::size_t packet_size)
+    : m_PacketSize(packet_size),
+      m_Window(Size::InitialWindow * packet_size),
+      m_SlowStartThreshold(Size::MaxWindow),
+      m_BytesInFlight(0),
+      m_BytesACKed(0),
+      m_SRTT(0),
+      m_RTTVar(0),
+      m_RTO(Time::InitialRTO),
+      m_RecoveryTime(0) {}
+
+void SSUCongestionControl::SetPacketSize(
+    std::size_t packet_size) {
+  m_PacketSize = packet_size;
+  m_Window = std::max<std::size_t>(m_Window, Size::MinWindow * m_PacketSize);
+}
+
+void SSUCongestionControl::OnSent(
+    std::size_t bytes) {
+  m_BytesInFlight += bytes;
+}
+
+void SSUCongestionControl::OnACKed(
+    std::size_t bytes,
+    std::uint64_t send_time,
+    bool is_resent,
+    std::uint64_t ts) {
+  m_BytesInFlight -= std::min(bytes, m_BytesInFlight);
+  if (!is_resent && ts >= send_time)
+    OnRTTSample(ts - send_time);
+  // Sent before the last reduction: the window already accounts for it
+  if (send_time <= m_RecoveryTime)
+    return;
+  if (IsSlowStart()) {
+    m_Window += bytes;
+  } else {
+    m_BytesACKed += bytes;
+    if (m_BytesACKed >= m_Window) {
+      m_BytesACKed -= m_Window;
+      m_Window += m_PacketSize;
+    }
+  }
+  m_Window = std::min<std::size_t>(m_Window, Size::MaxWindow);
+}
+
+void SSUCongestionControl::OnLost(
+    std::size_t bytes,
+    std::uint64_t send_time,
+    std::uint64_t ts) {
+  m_BytesInFlight -= std::min(bytes, m_BytesInFlight);
+  if (send_time <= m_RecoveryTime)
+    return;
+  m_SlowStartThreshold =
+      std::max<std::size_t>(m_Window / 2, Size::MinWindow * m_PacketSize);
+  m_Window = m_SlowStartThreshold;
+  m_BytesACKed = 0;
+  m_RecoveryTime = ts;
+}
+
+void SSUCongestionControl::OnTimeout(
+    std::uint64_t ts) {
+  m_SlowStartThreshold =
+      std::max<std::size_t>(m_Window / 2, Size::MinWindow * m_PacketSize);
+  m_Window = m_PacketSize;
+  m_BytesACKed = 0;
+  m_RTO = std::min<std::uint64_t>(m_RTO * 2, Time::MaxRTO);
+  m_RecoveryTime = ts;
+}
+
+void SSUCongestionControl::OnDropped(
+    std::size_t bytes) {
+  m_BytesInFlight -= std::min(bytes, m_BytesInFlight);
+}
+
+std::uint64_t SSUCongestionControl::GetPacingRate() const {
+  if (!m_SRTT)
+    return 0;
+  // Ahead of the window in slow start, so that pacing does not slow growth
+  double const gain = IsSlowStart() ? 2.0 : 1.25;
+  return static_cast<std::uint64_t>(gain * m_Window * 1000 / m_SRTT);
+}
+
+std::uint64_t SSUCongestionControl::GetReorderWindow() const {
+  return std::max<std::uint64_t>(m_SRTT / 4, Time::MinReorderWindow);
+}
+
+// RFC 6298, with a clock granularity of 1 ms
+void SSUCongestionControl::OnRTTSample(
+    std::uint64_t rtt) {
+  rtt = std::max<std::uint64_t>(rtt, 1);
+  if (!m_SRTT) {
+    m_SRTT = rtt;
+    m_RTTVar = rtt / 2;
+  } else {
+    std::uint64_t const delta = m_SRTT > rtt ? m_SRTT - rtt : rtt - m_SRTT;
+    m_RTTVar = (3 * m_RTTVar + delta) / 4;
+    m_SRTT = std::max<std::uint64_t>((7 * m_SRTT + rtt) / 8, 1);
+  }
+  m_RTO = std::min<std::uint64_t>(
+      std::max<std::uint64_t>(
+          m_SRTT + std::max<std::uint64_t>(4 * m_RTTVar, 1),
+          Time::MinRTO),
+      Time::MaxRTO);
+}
+
+SSUPacer::SSUPacer()
+    : m_Rate(0),
+      m_Tokens(0),
+      m_Burst(0),
+      m_LastRefillTime(0) {}
+
+void SSUPacer::SetRate(
+    std::uint64_t rate,
+    std::size_t packet_size) {
+  if (!m_Rate)
+    m_LastRefillTime = 0;  // refilled to a full burst
+  m_Rate = rate;
+  // Timers have a granularity of a millisecond, so allow two of them
+  m_Burst = std::max(
+      static_cast<double>(Size::MinBurst * packet_size),
+      rate * 2 / 1000.0);
+  m_Tokens = std::min(m_Tokens, m_Burst);
+}
+
+std::uint64_t SSUPacer::Consume(
+    std::size_t bytes,
+    std::uint64_t ts) {
+  if (!m_Rate)
+    return 0;
+  Refill(ts);
+  if (m_Tokens >= bytes) {
+    m_Tokens -= bytes;
+    return 0;
+  }
+  return std::max<std::uint64_t>(
+      static_cast<std::uint64_t>(std::ceil((bytes - m_Tokens) * 1000 / m_Rate)),
+      1);
+}
+
+void SSUPacer::Refill(
+    std::uint64_t ts) {
+  if (ts > m_LastRefillTime) {
+    m_Tokens = std::min(
+        m_Burst,
+        m_Tokens + (ts - m_LastRefillTime) * static_cast<double>(m_Rate) / 1000);
+    m_LastRefillTime = ts;
+  }
+}
+
+}  // namespace core
+}  // namespace xi2p
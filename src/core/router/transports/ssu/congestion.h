@@ -0,0 +1,209 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#ifndef SRC_CORE_ROUTER_TRANSPORTS_SSU_CONGESTION_H_
+#define SRC_CORE_ROUTER_TRANSPORTS_SSU_CONGESTION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace xi2p {
+namespace core {
+
+/// @class SSUCongestionControl
+/// @brief Congestion window and retransmission timeout of an SSU session
+/// @details The window, in bytes, limits the fragments in flight. It grows
+///   by the bytes ACKed during slow start, then by one packet per window
+///   ACKed, and is halved on loss, at most once per round trip. A timeout
+///   collapses it to one packet. RTT is estimated from the ACKs of fragments
+///   sent once (Karn's algorithm) and gives the RTO as in RFC 6298.
+///   Fragments are declared lost either on timeout or when a fragment sent
+///   later than them by more than a reordering window has been ACKed.
+/// @note Times are in milliseconds. Not thread-safe
+class SSUCongestionControl {
+ public:
+  enum Time : std::uint64_t {
+    InitialRTO = 1000,
+    MinRTO = 200,
+    MaxRTO = 3000,
+    MinReorderWindow = 5,
+  };
+
+  enum Size : std::size_t {
+    /// @brief Initial window, in packets (as RFC 6928)
+    InitialWindow = 10,
+    /// @brief Window after a loss, at least, in packets
+    MinWindow = 2,
+    /// @brief Highest window, in bytes
+    MaxWindow = 1 << 20,
+  };
+
+  /// @param packet_size Largest packet sent on the session
+  explicit SSUCongestionControl(
+      std::size_t packet_size);
+
+  /// @brief Updates the packet size, after the MTU of the peer is known
+  void SetPacketSize(
+      std::size_t packet_size);
+
+  /// @return True if bytes can be sent without exceeding the window
+  bool CanSend(
+      std::size_t bytes) const {
+    return m_BytesInFlight + bytes <= m_Window;
+  }
+
+  /// @brief Accounts for a fragment sent (or resent)
+  void OnSent(
+      std::size_t bytes);
+
+  /// @brief Accounts for a fragment ACKed
+  /// @param bytes Size of the fragment
+  /// @param send_time Time the fragment was last sent
+  /// @param is_resent Whether the fragment was sent more than once, so that
+  ///   its ACK gives no RTT sample
+  /// @param ts Current time
+  void OnACKed(
+      std::size_t bytes,
+      std::uint64_t send_time,
+      bool is_resent,
+      std::uint64_t ts);
+
+  /// @brief Accounts for a fragment declared lost, before it is resent
+  /// @param bytes Size of the fragment
+  /// @param send_time Time the fragment was last sent, so that the losses
+  ///   of one window reduce it only once
+  /// @param ts Current time
+  void OnLost(
+      std::size_t bytes,
+      std::uint64_t send_time,
+      std::uint64_t ts);
+
+  /// @brief Collapses the window and backs off the RTO after a timeout
+  void OnTimeout(
+      std::uint64_t ts);
+
+  /// @brief Accounts for a fragment in flight given up on
+  void OnDropped(
+      std::size_t bytes);
+
+  /// @return True if a fragment sent at send_time, not ACKed, is lost
+  ///   because one sent at acked_send_time has been ACKed
+  bool IsLost(
+      std::uint64_t send_time,
+      std::uint64_t acked_send_time) const {
+    return send_time + GetReorderWindow() < acked_send_time;
+  }
+
+  /// @return True if a fragment sent at send_time, not ACKed, timed out
+  bool IsTimedOut(
+      std::uint64_t send_time,
+      std::uint64_t ts) const {
+    return send_time + m_RTO <= ts;
+  }
+
+  std::uint64_t GetRTO() const {
+    return m_RTO;
+  }
+
+  /// @return Smoothed RTT, 0 until sampled
+  std::uint64_t GetSRTT() const {
+    return m_SRTT;
+  }
+
+  std::size_t GetWindow() const {
+    return m_Window;
+  }
+
+  std::size_t GetBytesInFlight() const {
+    return m_BytesInFlight;
+  }
+
+  bool IsSlowStart() const {
+    return m_Window < m_SlowStartThreshold;
+  }
+
+  /// @return Rate at which the window is sent over one RTT, in bytes per
+  ///   second, 0 (unpaced) until the RTT is sampled
+  std::uint64_t GetPacingRate() const;
+
+ private:
+  std::uint64_t GetReorderWindow() const;
+
+  void OnRTTSample(
+      std::uint64_t rtt);
+
+ private:
+  std::size_t m_PacketSize, m_Window, m_SlowStartThreshold, m_BytesInFlight;
+  // Bytes ACKed towards the next window increase, in congestion avoidance
+  std::size_t m_BytesACKed;
+  std::uint64_t m_SRTT, m_RTTVar, m_RTO;
+  // Losses of fragments sent before this time belong to the last reduction
+  std::uint64_t m_RecoveryTime;
+};
+
+/// @class SSUPacer
+/// @brief Token bucket which spreads the packets of a window over an RTT
+/// @note Times are in milliseconds. Not thread-safe
+class SSUPacer {
+ public:
+  enum Size : std::size_t {
+    /// @brief Burst allowed, at least, in packets
+    MinBurst = 4,
+  };
+
+  SSUPacer();
+
+  /// @param rate Bytes per second, 0 for unpaced
+  /// @param packet_size Largest packet sent
+  void SetRate(
+      std::uint64_t rate,
+      std::size_t packet_size);
+
+  /// @brief Takes tokens for bytes sent
+  /// @return Milliseconds to wait before bytes can be sent, 0 if they were
+  ///   taken
+  std::uint64_t Consume(
+      std::size_t bytes,
+      std::uint64_t ts);
+
+ private:
+  void Refill(
+      std::uint64_t ts);
+
+ private:
+  std::uint64_t m_Rate;
+  double m_Tokens, m_Burst;
+  std::uint64_t m_LastRefillTime;
+};
+
+}  // namespace core
+}  // namespace xi2p
+
+#endif  // SRC_CORE_ROUTER_TRANSPORTS_SSU_CONGESTION_H_
@@ -35,6 +35,8 @@
 #include <boost/bind.hpp>
 #include <boost/endian/conversion.hpp>
 
+#include <algorithm>
+
 #include "core/router/net_db/impl.h"
 #include "core/router/transports/ssu/server.h"
 
@@ -46,6 +48,19 @@ namespace core {
 
 // TODO(anonimal): bytestream refactor
 
+void IncompleteMessage::Reset(
+    std::shared_ptr<I2NPMessage> m,
+    std::uint32_t ts) {
+  msg = m;
+  next_fragment_num = 0;
+  last_fragment_insert_time = ts;
+  saved.reset();
+  saved_fragments.clear();
+  if (saved_data.capacity() > SSU_MAX_REUSED_BUFFER)
+    std::vector<std::uint8_t>().swap(saved_data);
+  saved_data.clear();
+}
+
 void IncompleteMessage::AttachNextFragment(
     const std::uint8_t* fragment,
     std::size_t fragment_size) {
@@ -62,16 +77,97 @@ void IncompleteMessage::AttachNextFragment(
   next_fragment_num++;
 }
 
+bool IncompleteMessage::SaveFragment(
+    std::uint8_t fragment_num,
+    const std::uint8_t* fragment,
+    std::size_t fragment_size,
+    bool is_last) {
+  if (saved.test(fragment_num))
+    return false;
+  saved.set(fragment_num);
+  saved_fragments.push_back(
+      {fragment_num, is_last, saved_data.size(), fragment_size});
+  saved_data.insert(saved_data.end(), fragment, fragment + fragment_size);
+  return true;
+}
+
+bool IncompleteMessage::AttachSavedFragments() {
+  bool is_last = false;
+  while (!is_last) {
+    auto it = std::find_if(
+        saved_fragments.begin(),
+        saved_fragments.end(),
+        [this](const SavedFragment& fragment) {
+          return fragment.fragment_num == next_fragment_num;
+        });
+    if (it == saved_fragments.end())
+      break;
+    auto const fragment = *it;
+    saved_fragments.erase(it);
+    AttachNextFragment(saved_data.data() + fragment.offset, fragment.len);
+    is_last = fragment.is_last;
+  }
+  if (saved_fragments.empty())
+    saved_data.clear();
+  return is_last;
+}
+
+void SentMessage::Reset(
+    std::uint32_t id,
+    const std::uint8_t* buf,
+    std::size_t len,
+    std::size_t size) {
+  msg_id = id;
+  fragment_size = size;
+  if (data.capacity() > SSU_MAX_REUSED_BUFFER)
+    std::vector<std::uint8_t>().swap(data);
+  data.assign(buf, buf + len);
+  fragments.assign((len + size - 1) / size, FragmentState {0, 0});
+  acked.reset();
+}
+
+std::size_t SentMessage::GetFragmentSize(
+    std::size_t fragment_num) const {
+  return SSUSize::FragmentHeader
+    + (fragment_num + 1 < fragments.size()
+        ? fragment_size
+        : data.size() - fragment_num * fragment_size);
+}
+
+std::size_t SentMessage::WriteFragment(
+    std::size_t fragment_num,
+    std::uint8_t* buf) const {
+  auto const size = GetFragmentSize(fragment_num) - SSUSize::FragmentHeader;
+  core::OutputByteStream::Write<std::uint32_t>(buf, msg_id);
+  std::uint32_t fragment_info = (fragment_num << 17);
+  if (fragment_num + 1 == fragments.size())
+    fragment_info |= 0x010000;
+  fragment_info |= size;
+  boost::endian::native_to_big_inplace(fragment_info);
+  memcpy(buf + 4, reinterpret_cast<std::uint8_t *>((&fragment_info)) + 1, 3);
+  memcpy(
+      buf + SSUSize::FragmentHeader,
+      data.data() + fragment_num * fragment_size,
+      size);
+  return SSUSize::FragmentHeader + size;
+}
+
 SSUData::SSUData(
     SSUSession& session)
     : m_Session(session),
       m_ResendTimer(session.GetService()),
-      m_DecayTimer(session.GetService()),
-      m_IncompleteMessagesCleanupTimer(session.GetService()) {
+      m_IncompleteMessagesCleanupTimer(session.GetService()),
+      m_PaceTimer(session.GetService()),
+      m_FlushTimer(session.GetService()),
+      m_CongestionControl(SSUSize::PacketMaxIPv4),
+      m_IsResendScheduled(false),
+      m_IsPacing(false),
+      m_IsFlushScheduled(false) {
   m_MaxPacketSize = session.IsV6()
     ? SSUSize::PacketMaxIPv6
     : SSUSize::PacketMaxIPv4;
   m_PacketSize = m_MaxPacketSize;
+  m_CongestionControl.SetPacketSize(m_PacketSize);
   auto remote_router = session.GetRemoteRouter();
   if (remote_router)
     AdjustPacketSize(*remote_router);
@@ -87,8 +183,9 @@ void SSUData::Start() {
 void SSUData::Stop() {
   LOG(debug) << "SSUData: stopping";
   m_ResendTimer.cancel();
-  m_DecayTimer.cancel();
   m_IncompleteMessagesCleanupTimer.cancel();
+  m_PaceTimer.cancel();
+  m_FlushTimer.cancel();
 }
 
 void SSUData::AdjustPacketSize(
@@ -119,6 +216,7 @@ void SSUData::AdjustPacketSize(
       LOG(warning) << "SSUData: unexpected MTU " << ssu_address->mtu;
       m_PacketSize = m_MaxPacketSize;
     }
+    m_CongestionControl.SetPacketSize(m_PacketSize);
   }
 }
 
@@ -133,17 +231,79 @@ void SSUData::UpdatePacketSize(
 }
 
 void SSUData::ProcessSentMessageACK(
-    std::uint32_t msg_id) {
+    SentMessage& message,
+    std::uint64_t ts,
+    std::uint64_t& acked_send_time) {
   // TODO(unassigned): too spammy? keep?
   //LOG(debug) <<
       //"SSUData:", m_Session.GetFormattedSessionInfo(),
       //"processing sent message ACK");
-  auto it = m_SentMessages.find(msg_id);
-  if (it != m_SentMessages.end()) {
-    m_SentMessages.erase(it);
-    if (m_SentMessages.empty())
-      m_ResendTimer.cancel();
+  for (std::size_t i = 0; i < message.GetNumFragments(); i++)
+    ProcessFragmentACK(message, i, ts, acked_send_time);
+}
+
+void SSUData::ProcessFragmentACK(
+    SentMessage& message,
+    std::size_t fragment_num,
+    std::uint64_t ts,
+    std::uint64_t& acked_send_time) {
+  if (message.IsACKed(fragment_num))
+    return;
+  // A fragment declared lost is no longer in flight: only its resend is
+  // spared
+  auto const& fragment = message.fragments[fragment_num];
+  if (fragment.send_time) {
+    bool const is_resent = fragment.num_sends > 1;
+    m_CongestionControl.OnACKed(
+        message.GetFragmentSize(fragment_num), fragment.send_time, is_resent, ts);
+    // The ACK of a resent fragment may be that of an earlier send
+    if (!is_resent)
+      acked_send_time = std::max(acked_send_time, fragment.send_time);
+  }
+  message.acked.set(fragment_num);
+}
+
+void SSUData::DetectLostFragments(
+    std::uint64_t acked_send_time,
+    std::uint64_t ts) {
+  m_SentMessages.ForEach(
+      [this, acked_send_time, ts](std::uint32_t, SentMessage& message) {
+        for (std::size_t i = 0; i < message.GetNumFragments(); i++) {
+          auto const send_time = message.fragments[i].send_time;
+          if (!message.IsACKed(i) && send_time
+              && m_CongestionControl.IsLost(send_time, acked_send_time)) {
+            m_CongestionControl.OnLost(
+                message.GetFragmentSize(i), send_time, ts);
+            if (!ResendFragment(message, i, ts))
+              return false;
+          }
+        }
+        return true;
+      });
+}
+
+bool SSUData::ResendFragment(
+    SentMessage& message,
+    std::size_t fragment_num,
+    std::uint64_t ts) {
+  auto& fragment = message.fragments[fragment_num];
+  fragment.send_time = 0;
+  if (fragment.num_sends > SSUDuration::MaxResends) {
+    LOG(error)
+      << "SSUData:" << m_Session.GetFormattedSessionInfo()
+      << "SSU message has not been ACKed after "
+      << static_cast<std::size_t>(SSUDuration::MaxResends) << " resends. Deleted";
+    for (std::size_t i = 0; i < message.GetNumFragments(); i++)
+      if (!message.IsACKed(i) && message.fragments[i].send_time)
+        m_CongestionControl.OnDropped(message.GetFragmentSize(i));
+    return false;
   }
+  LOG(debug)
+    << "SSUData:" << m_Session.GetFormattedSessionInfo()
+    << "fragment " << fragment_num << " of message " << message.msg_id
+    << " lost at " << ts;
+  m_LostFragments.emplace_back(message.msg_id, fragment_num);
+  return true;
 }
 
 void SSUData::ProcessACKs(
@@ -151,13 +311,22 @@ void SSUData::ProcessACKs(
     std::uint8_t flag) {
   LOG(debug)
     << "SSUData:" << m_Session.GetFormattedSessionInfo() << "processing ACKs";
+  auto const ts = xi2p::core::GetMillisecondsSinceEpoch();
+  // Latest send time of the fragments ACKed, for loss detection
+  std::uint64_t acked_send_time = 0;
   if (flag & SSUFlag::DataExplicitACKsIncluded) {
     // explicit ACKs
     auto num_ACKs = *buf;
     buf++;
-    for (auto i = 0; i < num_ACKs; i++)
-      ProcessSentMessageACK(
-          core::InputByteStream::Read<std::uint32_t>(buf + i * 4));
+    for (auto i = 0; i < num_ACKs; i++) {
+      auto const msg_id =
+        core::InputByteStream::Read<std::uint32_t>(buf + i * 4);
+      auto message = m_SentMessages.Find(msg_id);
+      if (message) {
+        ProcessSentMessageACK(*message, ts, acked_send_time);
+        m_SentMessages.Erase(msg_id);
+      }
+    }
     buf += num_ACKs * 4;
   }
   if (flag & SSUFlag::DataACKBitfieldsIncluded) {
@@ -167,7 +336,7 @@ void SSUData::ProcessACKs(
     for (auto i = 0; i < num_bitfields; i++) {
       auto const msg_id = core::InputByteStream::Read<std::uint32_t>(buf);
       buf += 4;  // message ID
-      auto it = m_SentMessages.find(msg_id);
+      auto message = m_SentMessages.Find(msg_id);
       // process individual ACK bitfields
       bool is_not_last = false;
       std::size_t fragment = 0;
@@ -175,14 +344,15 @@ void SSUData::ProcessACKs(
         auto bitfield = *buf;
         is_not_last = bitfield & 0x80;
         bitfield &= 0x7F;  // clear MSB
-        if (bitfield && it != m_SentMessages.end()) {
-          auto num_send_fragments = it->second->fragments.size();
+        if (bitfield && message) {
+          auto num_send_fragments = message->GetNumFragments();
           // process bits
           std::uint8_t mask = 0x01;
           for (auto j = 0; j < 7; j++) {
             if (bitfield & mask) {
               if (fragment < num_send_fragments)
-                it->second->fragments[fragment].reset(nullptr);
+                ProcessFragmentACK(
+                    *message, fragment, ts, acked_send_time);
             }
             fragment++;
             mask <<= 1;
@@ -191,8 +361,18 @@ void SSUData::ProcessACKs(
         buf++;
       }
       while (is_not_last);
+      if (message && message->IsACKed())
+        m_SentMessages.Erase(msg_id);
     }
   }
+  if (acked_send_time)
+    DetectLostFragments(acked_send_time, ts);
+  if (m_SentMessages.IsEmpty()) {
+    m_ResendTimer.cancel();
+    m_IsResendScheduled = false;
+  }
+  // ACKs open the window
+  SendPendingFragments(false);
 }
 
 void SSUData::ProcessFragments(
@@ -221,38 +401,21 @@ void SSUData::ProcessFragments(
       return;
     }
     //  find message with message ID
-    auto it = m_IncompleteMessages.find(msg_id);
-    if (it == m_IncompleteMessages.end()) {
+    auto incomplete_message = m_IncompleteMessages.Find(msg_id);
+    if (!incomplete_message) {
       // create new message
       auto msg = ToSharedI2NPMessage(NewI2NPShortMessage());
       msg->len -= I2NP_SHORT_HEADER_SIZE;
-      it = m_IncompleteMessages.insert(
-          std::make_pair(
-              msg_id,
-              std::unique_ptr<IncompleteMessage>(
-                  std::make_unique<IncompleteMessage>(msg)))).first;
+      incomplete_message = &m_IncompleteMessages.Insert(msg_id);
+      incomplete_message->Reset(msg, xi2p::core::GetSecondsSinceEpoch());
     }
-    std::unique_ptr<IncompleteMessage>& incomplete_message = it->second;
     // handle current fragment
     if (fragment_num == incomplete_message->next_fragment_num) {
       // expected fragment
       incomplete_message->AttachNextFragment(buf, fragment_size);
-      if (!is_last && !incomplete_message->saved_fragments.empty()) {
+      if (!is_last && incomplete_message->saved.any()) {
         // try saved fragments
-        for (auto saved_fragment = incomplete_message->saved_fragments.begin();
-            saved_fragment != incomplete_message->saved_fragments.end();) {
-          auto& fragment = *saved_fragment;
-          if (fragment->fragment_num ==
-              incomplete_message->next_fragment_num) {
-            incomplete_message->AttachNextFragment(
-                fragment->buffer.data(),
-                fragment->len);
-            is_last = fragment->is_last;
-            incomplete_message->saved_fragments.erase(saved_fragment++);
-          } else {
-            break;
-          }
-        }
+        is_last = incomplete_message->AttachSavedFragments();
         if (is_last)
           LOG(debug)
             << "SSUData:" << m_Session.GetFormattedSessionInfo()
@@ -272,10 +435,8 @@ void SSUData::ProcessFragments(
           << "missing fragments from "
           << static_cast<int>(incomplete_message->next_fragment_num)
           << " to " << fragment_num - 1 << " of message " << msg_id;
-        auto saved_fragment =
-          std::make_unique<Fragment>(fragment_num, buf, fragment_size, is_last);
-        if (incomplete_message->saved_fragments.insert(
-              std::unique_ptr<Fragment>(std::move(saved_fragment))).second)
+        if (incomplete_message->SaveFragment(
+                fragment_num, buf, fragment_size, is_last))
           incomplete_message->last_fragment_insert_time =
             xi2p::core::GetSecondsSinceEpoch();
         else
@@ -290,17 +451,12 @@ void SSUData::ProcessFragments(
       // delete incomplete message
       auto msg = incomplete_message->msg;
       incomplete_message->msg = nullptr;
-      m_IncompleteMessages.erase(msg_id);
+      m_IncompleteMessages.Erase(msg_id);
       // process message
       SendMsgACK(msg_id);
       msg->FromSSU(msg_id);
       if (m_Session.GetState() == SessionState::Established) {
-        if (!m_ReceivedMessages.count(msg_id)) {
-          if (m_ReceivedMessages.size() > SSUSize::MaxReceivedMessages)
-            m_ReceivedMessages.clear();
-          else
-            ScheduleDecay();
-          m_ReceivedMessages.insert(msg_id);
+        if (!CheckAndAddReceivedMessage(msg_id)) {
           m_Handler.PutNextMessage(msg);
         } else {
           LOG(warning)
@@ -320,7 +476,7 @@ void SSUData::ProcessFragments(
           LOG(debug)
             << "SSUData:" << m_Session.GetFormattedSessionInfo()
             << "Got DSM From SSU";
-          m_ReceivedMessages.insert(msg_id);
+          CheckAndAddReceivedMessage(msg_id);
           m_Handler.PutNextMessage(msg);
         } else {
           LOG(error)
@@ -379,74 +535,161 @@ void SSUData::Send(
     << "SSUData:" << m_Session.GetFormattedSessionInfo()
     << "sending message";
   auto msg_id = msg->ToSSU();
-  if (m_SentMessages.count(msg_id) > 0) {
+  if (m_SentMessages.Find(msg_id)) {
     LOG(warning)
       << "SSUData:" << m_Session.GetFormattedSessionInfo()
       << "message " << msg_id << " was already sent";
     return;
   }
-  if (m_SentMessages.empty())  // schedule resend at first message only
-    ScheduleResend();
-  auto ret =
-    m_SentMessages.insert(
-        std::make_pair(
-            msg_id,
-            std::unique_ptr<SentMessage>(std::make_unique<SentMessage>())));
-  std::unique_ptr<SentMessage>& sent_message = ret.first->second;
-  if (ret.second) {
-    sent_message->next_resend_time =
-      xi2p::core::GetSecondsSinceEpoch()
-      + SSUDuration::ResendInterval;
-    sent_message->num_resends = 0;
-  }
-  auto& fragments = sent_message->fragments;
-  // 9 = flag + #frg(1) + messageID(4) + frag info (3)
-  auto payload_size = m_PacketSize - SSUSize::HeaderMin - 9;
+  // 9 = flag + #frg(1) + messageID(4) + frag info (3), and room is left for
+  // ACKs to share the packet
+  auto payload_size =
+    m_PacketSize - SSUSize::HeaderMin - 9 - SSUSize::PiggybackedACKs;
   auto len = msg->GetLength();
-  auto msg_buf = msg->GetSSUHeader();
-  std::size_t fragment_num = 0;
-  while (len > 0) {
-    auto fragment = std::make_unique<Fragment>();
-    fragment->fragment_num = fragment_num;
-    auto buf = fragment->buffer.data();
-    auto payload = buf + SSUSize::HeaderMin;
-    *payload = SSUFlag::DataWantReply;  // for compatibility
+  if (len > payload_size * SSUSize::MaxFragments) {
+    LOG(error)
+      << "SSUData:" << m_Session.GetFormattedSessionInfo()
+      << "message " << msg_id << " of " << len << " bytes is too long";
+    return;
+  }
+  auto& sent_message = m_SentMessages.Insert(msg_id);
+  sent_message.Reset(msg_id, msg->GetSSUHeader(), len, payload_size);
+  for (std::size_t i = 0; i < sent_message.GetNumFragments(); i++)
+    m_PendingFragments.emplace_back(msg_id, i);
+  SendPendingFragments(false);
+}
+
+void SSUData::SendPendingFragments(
+    bool is_flush) {
+  auto const ts = xi2p::core::GetMillisecondsSinceEpoch();
+  m_Pacer.SetRate(m_CongestionControl.GetPacingRate(), m_PacketSize);
+  // Fragments wait for the pace timer, ACKs do not
+  bool is_blocked = m_IsPacing;
+  while (is_flush || HasFullPacket(is_blocked)) {
+    // 2 = flag + #frg(1)
+    std::size_t size = SSUSize::HeaderMin + 2;
+    std::array<std::pair<const SentMessage*, std::size_t>, 0xFF> packet_fragments;
+    std::size_t num_fragments = 0;
+    while (!is_blocked && num_fragments < packet_fragments.size()
+           && (!m_LostFragments.empty() || !m_PendingFragments.empty())) {
+      auto& queue =
+        m_LostFragments.empty() ? m_PendingFragments : m_LostFragments;
+      auto const msg_id = queue.front().first;
+      auto const fragment_num = queue.front().second;
+      auto message = m_SentMessages.Find(msg_id);
+      // ACKed or given up since queued
+      if (!message || message->IsACKed(fragment_num)) {
+        queue.pop_front();
+        continue;
+      }
+      auto const fragment_size = message->GetFragmentSize(fragment_num);
+      // Fragments cut for a larger packet size still go, alone
+      if (size + fragment_size > m_PacketSize && num_fragments)
+        break;
+      // Resumed by ACKs or the resend timer. With nothing in flight, a
+      // fragment larger than a collapsed window still goes
+      if (m_CongestionControl.GetBytesInFlight()
+          && !m_CongestionControl.CanSend(fragment_size)) {
+        is_blocked = true;
+        break;
+      }
+      auto const delay = m_Pacer.Consume(fragment_size, ts);
+      if (delay) {
+        SchedulePace(delay);
+        is_blocked = true;
+        break;
+      }
+      queue.pop_front();
+      // Lost if unsent, as if dropped on the way
+      message->fragments[fragment_num].send_time = ts;
+      message->fragments[fragment_num].num_sends++;
+      m_CongestionControl.OnSent(fragment_size);
+      packet_fragments[num_fragments++] = {message, fragment_num};
+      size += fragment_size;
+    }
+    std::array<std::uint8_t, SSUSize::FragmentBuffer> buf {};
+    auto payload = buf.data() + SSUSize::HeaderMin;
+    auto& flag = *payload;
     payload++;
-    *payload = 1;  // always 1 message fragment per message
+    m_PendingACKs.Write(
+        payload, size < m_PacketSize ? m_PacketSize - size : 0, flag);
+    if (!num_fragments && !flag)
+      break;
+    if (num_fragments)
+      flag |= SSUFlag::DataWantReply;  // for compatibility
+    *payload = num_fragments;
     payload++;
-    core::OutputByteStream::Write<std::uint32_t>(payload, msg_id);
-    payload += 4;
-    bool is_last = (len <= payload_size);
-    auto size = is_last ? len : payload_size;
-    std::uint32_t fragment_info = (fragment_num << 17);
-    if (is_last)
-      fragment_info |= 0x010000;
-    fragment_info |= size;
-    boost::endian::native_to_big_inplace(fragment_info);
-    memcpy(payload, reinterpret_cast<std::uint8_t *>((&fragment_info)) + 1, 3);
-    payload += 3;
-    memcpy(payload, msg_buf, size);
-    size += payload - buf;
+    for (std::size_t i = 0; i < num_fragments; i++)
+      payload += packet_fragments[i].first->WriteFragment(
+          packet_fragments[i].second, payload);
+    size = payload - buf.data();
     if (size & 0x0F)  // make sure 16 bytes boundary
       size = ((size >> 4) + 1) << 4;  // (/16 + 1) * 16
-    fragment->len = size;
-    fragments.push_back(std::unique_ptr<Fragment>(std::move(fragment)));
     // encrypt message with session key
-    m_Session.FillHeaderAndEncrypt(SSUPayloadType::Data, buf, size);
+    m_Session.FillHeaderAndEncrypt(SSUPayloadType::Data, buf.data(), size);
     try {
-      m_Session.Send(buf, size);
+      m_Session.Send(buf.data(), size);
     } catch (const boost::system::system_error& ec) {
       LOG(error)
         << "SSUData:" << m_Session.GetFormattedSessionInfo()
-        << "can't send SSU fragment: '" << ec.what() << "'";
+        << "can't send SSU packet: '" << ec.what() << "'";
     }
-    if (!is_last) {
-      len -= payload_size;
-      msg_buf += payload_size;
-    } else {
-      len = 0;
+    if (num_fragments && !m_IsResendScheduled)
+      ScheduleResend(m_CongestionControl.GetRTO());
+  }
+  if (!m_PendingACKs.IsEmpty()
+      || (!is_blocked
+          && (!m_LostFragments.empty() || !m_PendingFragments.empty())))
+    ScheduleFlush();
+}
+
+bool SSUData::HasFullPacket(
+    bool is_blocked) const {
+  // 2 = flag + #frg(1)
+  std::size_t size = SSUSize::HeaderMin + 2 + m_PendingACKs.GetSize();
+  if (size >= m_PacketSize)
+    return true;
+  if (is_blocked)
+    return false;
+  // Waiting would not grow a packet beyond what the window allows
+  auto const bytes_in_flight = m_CongestionControl.GetBytesInFlight();
+  auto const window = m_CongestionControl.GetWindow();
+  std::size_t const available =
+    !bytes_in_flight
+      ? SIZE_MAX
+      : window > bytes_in_flight ? window - bytes_in_flight : 0;
+  std::size_t bytes = 0;
+  for (auto queue : {&m_LostFragments, &m_PendingFragments})
+    for (auto const& pending : *queue) {
+      auto message = m_SentMessages.Find(pending.first);
+      if (!message || message->IsACKed(pending.second))
+        continue;
+      bytes += message->GetFragmentSize(pending.second);
+      if (size + bytes >= m_PacketSize || bytes >= available)
+        return true;
     }
-    fragment_num++;
+  return false;
+}
+
+void SSUData::ScheduleFlush() {
+  if (m_IsFlushScheduled)
+    return;
+  m_IsFlushScheduled = true;
+  m_FlushTimer.expires_from_now(
+      boost::posix_time::milliseconds(
+          static_cast<std::int64_t>(SSUDuration::FlushDelay)));
+  auto s = m_Session.shared_from_this();
+  m_FlushTimer.async_wait(
+      [s](const boost::system::error_code& ecode) {
+      s->m_Data.HandleFlushTimer(ecode);
+      });
+}
+
+void SSUData::HandleFlushTimer(
+    const boost::system::error_code& ecode) {
+  if (ecode != boost::asio::error::operation_aborted) {
+    m_IsFlushScheduled = false;
+    SendPendingFragments(true);
   }
 }
 
@@ -454,20 +697,9 @@ void SSUData::SendMsgACK(
     std::uint32_t msg_id) {
   LOG(debug)
     << "SSUData:" << m_Session.GetFormattedSessionInfo()
-    << "sending message ACK";
-  // actual length is 44 = 37 + 7 but pad it to multiple of 16
-  std::array<std::uint8_t, 48 + 18> buf;
-  auto payload = buf.data() + SSUSize::HeaderMin;
-  *payload = SSUFlag::DataExplicitACKsIncluded;  // flag
-  payload++;
-  *payload = 1;  // number of ACKs
-  payload++;
-  *(reinterpret_cast<std::uint32_t *>(payload)) = boost::endian::native_to_big(msg_id);  // msg_id
-  payload += 4;
-  *payload = 0;  // number of fragments
-  // encrypt message with session key
-  m_Session.FillHeaderAndEncrypt(SSUPayloadType::Data, buf.data(), 48);
-  m_Session.Send(buf.data(), 48);
+    << "queuing message ACK";
+  m_PendingACKs.AddMessage(msg_id);
+  ScheduleFlush();
 }
 
 void SSUData::SendFragmentACK(
@@ -475,42 +707,25 @@ void SSUData::SendFragmentACK(
     std::size_t fragment_num) {
   LOG(debug)
     << "SSUData:" << m_Session.GetFormattedSessionInfo()
-    << "sending fragment ACK";
-  if (fragment_num > 64) {
+    << "queuing fragment ACK";
+  if (!m_PendingACKs.AddFragment(msg_id, fragment_num)) {
     LOG(warning)
       << "SSUData:" << m_Session.GetFormattedSessionInfo()
       << "fragment number " << fragment_num << " exceeds 64";
     return;
   }
-  std::array<std::uint8_t, 64 + 18> buf;  // TODO(unassigned): document values
-  auto payload = buf.data() + SSUSize::HeaderMin;
-  *payload = SSUFlag::DataACKBitfieldsIncluded;  // flag
-  payload++;
-  *payload = 1;  // number of ACK bitfields
-  payload++;
-  // one ack
-  *(reinterpret_cast<std::uint32_t *>(payload)) = boost::endian::native_to_big(msg_id);  // msg_id
-  payload += 4;
-  div_t d = div(fragment_num, 7);
-  memset(payload, 0x80, d.quot);  // 0x80 means non-last
-  payload += d.quot;
-  *payload = 0x01 << d.rem;  // set corresponding bit
-  payload++;
-  *payload = 0;  // number of fragments
-  auto len = d.quot < 4 ? 48 : 64;  // 48 = 37 + 7 + 4 (3+1)
-  // encrypt message with session key
-  m_Session.FillHeaderAndEncrypt(SSUPayloadType::Data, buf.data(), len);
-  m_Session.Send(buf.data(), len);
-}
-
-void SSUData::ScheduleResend() {
+  ScheduleFlush();
+}
+
+void SSUData::ScheduleResend(
+    std::uint64_t delay) {
   LOG(debug)
     << "SSUData:" << m_Session.GetFormattedSessionInfo()
     << "scheduling resend";
+  m_IsResendScheduled = true;
   m_ResendTimer.cancel();
   m_ResendTimer.expires_from_now(
-      boost::posix_time::seconds(
-          SSUDuration::ResendInterval));
+      boost::posix_time::milliseconds(delay));
   auto s = m_Session.shared_from_this();
   m_ResendTimer.async_wait(
       [s](const boost::system::error_code& ecode) {
@@ -524,60 +739,85 @@ void SSUData::HandleResendTimer(
     << "SSUData:" << m_Session.GetFormattedSessionInfo()
     << "handling resend timer";
   if (ecode != boost::asio::error::operation_aborted) {
-    auto ts = xi2p::core::GetSecondsSinceEpoch();
-    for (auto it = m_SentMessages.begin(); it != m_SentMessages.end();) {
-      if (ts >= it->second->next_resend_time) {
-        if (it->second->num_resends < SSUDuration::MaxResends) {
-          for (auto& fragment : it->second->fragments)
-            if (fragment) {
-              try {
-                m_Session.Send(fragment->buffer.data(), fragment->len);  // resend
-              } catch (const boost::system::system_error& ec) {
-                LOG(error)
-                  << "SSUData:" << m_Session.GetFormattedSessionInfo()
-                  << "can't resend SSU fragment: '" << ec.what() << "'";
+    m_IsResendScheduled = false;
+    auto const ts = xi2p::core::GetMillisecondsSinceEpoch();
+    bool is_timed_out = false;
+    std::uint64_t first_send_time = 0;
+    m_SentMessages.ForEach(
+        [this, ts, &is_timed_out, &first_send_time](
+            std::uint32_t, SentMessage& message) {
+          for (std::size_t i = 0; i < message.GetNumFragments(); i++) {
+            auto const send_time = message.fragments[i].send_time;
+            if (!message.IsACKed(i) && send_time) {
+              if (m_CongestionControl.IsTimedOut(send_time, ts))
+                is_timed_out = true;
+              if (!first_send_time || send_time < first_send_time)
+                first_send_time = send_time;
+            }
+          }
+          return true;
+        });
+    if (is_timed_out) {
+      // Everything in flight is resent, from a window of one packet
+      m_CongestionControl.OnTimeout(ts);
+      m_SentMessages.ForEach(
+          [this, ts](std::uint32_t, SentMessage& message) {
+            for (std::size_t i = 0; i < message.GetNumFragments(); i++) {
+              auto const send_time = message.fragments[i].send_time;
+              if (!message.IsACKed(i) && send_time) {
+                m_CongestionControl.OnLost(
+                    message.GetFragmentSize(i), send_time, ts);
+                if (!ResendFragment(message, i, ts))
+                  return false;
               }
             }
-          it->second->num_resends++;
-          it->second->next_resend_time
-             += it->second->num_resends * SSUDuration::ResendInterval;
-          it++;
-        } else {
-          LOG(error)
-            << "SSUData:" << m_Session.GetFormattedSessionInfo()
-            << "SSU message has not been ACKed after "
-            << static_cast<std::size_t>(SSUDuration::MaxResends) << " attempts. Deleted";
-          it = m_SentMessages.erase(it);
-        }
-      } else {
-        it++;
-      }
+            return true;
+          });
+    } else if (first_send_time) {
+      ScheduleResend(first_send_time + m_CongestionControl.GetRTO() - ts);
     }
-    ScheduleResend();
+    SendPendingFragments(true);
   }
 }
 
-void SSUData::ScheduleDecay() {
-  LOG(debug)
-    << "SSUData:" << m_Session.GetFormattedSessionInfo() << "scheduling decay";
-  m_DecayTimer.cancel();
-  m_DecayTimer.expires_from_now(
-      boost::posix_time::seconds(
-          SSUDuration::DecayInterval));
+void SSUData::SchedulePace(
+    std::uint64_t delay) {
+  m_IsPacing = true;
+  m_PaceTimer.expires_from_now(
+      boost::posix_time::milliseconds(delay));
   auto s = m_Session.shared_from_this();
-  m_ResendTimer.async_wait(
+  m_PaceTimer.async_wait(
       [s](const boost::system::error_code& ecode) {
-      s->m_Data.HandleDecayTimer(ecode);
+      s->m_Data.HandlePaceTimer(ecode);
       });
 }
 
-void SSUData::HandleDecayTimer(
+void SSUData::HandlePaceTimer(
     const boost::system::error_code& ecode) {
-  LOG(debug)
-    << "SSUData:" << m_Session.GetFormattedSessionInfo()
-    << "handling decay";
-  if (ecode != boost::asio::error::operation_aborted)
-    m_ReceivedMessages.clear();
+  if (ecode != boost::asio::error::operation_aborted) {
+    m_IsPacing = false;
+    SendPendingFragments(false);
+  }
+}
+
+bool SSUData::CheckAndAddReceivedMessage(
+    std::uint32_t msg_id) {
+  // Message IDs are chosen by each peer, so the filter shared by all
+  // sessions is keyed by the peer's endpoint too
+  std::array<std::uint8_t, 16 + 2 + 4> key {};
+  auto const& endpoint = m_Session.GetRemoteEndpoint();
+  if (endpoint.address().is_v6()) {
+    auto const address = endpoint.address().to_v6().to_bytes();
+    memcpy(key.data(), address.data(), address.size());
+  } else {
+    auto const address = endpoint.address().to_v4().to_bytes();
+    memcpy(key.data(), address.data(), address.size());
+  }
+  core::OutputByteStream::Write<std::uint16_t>(key.data() + 16, endpoint.port());
+  core::OutputByteStream::Write<std::uint32_t>(key.data() + 18, msg_id);
+  return m_Session.m_Server.GetReceivedMessages().CheckAndAdd(
+      key.data(),
+      key.size());
 }
 
 void SSUData::ScheduleIncompleteMessagesCleanup() {
@@ -603,17 +843,18 @@ void SSUData::HandleIncompleteMessagesCleanupTimer(
   if (ecode != boost::asio::error::operation_aborted) {
     auto ts = xi2p::core::GetSecondsSinceEpoch();
     std::uint8_t const timeout = SSUDuration::IncompleteMessagesCleanupTimeout;
-    for (auto it = m_IncompleteMessages.begin(); it != m_IncompleteMessages.end();) {
-      if (ts > it->second->last_fragment_insert_time + timeout) {
-        LOG(error)
-          << "SSUData:" << m_Session.GetFormattedSessionInfo()
-          << "SSU message " << it->first << " was not completed in "
-          << timeout << " seconds. Deleted";
-        it = m_IncompleteMessages.erase(it);
-      } else {
-        it++;
-      }
-    }
+    m_IncompleteMessages.ForEach(
+        [this, ts, timeout](std::uint32_t msg_id, IncompleteMessage& message) {
+          if (ts > message.last_fragment_insert_time + timeout) {
+            LOG(error)
+              << "SSUData:" << m_Session.GetFormattedSessionInfo()
+              << "SSU message " << msg_id << " was not completed in "
+              << timeout << " seconds. Deleted";
+            message.msg = nullptr;
+            return false;
+          }
+          return true;
+        });
     ScheduleIncompleteMessagesCleanup();
   }
 }
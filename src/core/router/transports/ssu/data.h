@@ -36,15 +36,18 @@
 #include <boost/asio.hpp>
 
 #include <array>
+#include <bitset>
 #include <cstdint>
-#include <map>
+#include <deque>
 #include <memory>
-#include <set>
 #include <vector>
 
 #include "core/router/i2np.h"
 #include "core/router/identity.h"
 #include "core/router/info.h"
+#include "core/router/transports/ssu/acks.h"
+#include "core/router/transports/ssu/congestion.h"
+#include "core/router/transports/ssu/message_table.h"
 #include "core/router/transports/ssu/packet.h"
 
 namespace xi2p {
@@ -55,9 +58,9 @@ namespace core {
 ///   of duration used during SSU activity
 enum SSUDuration : std::uint16_t
 {
-  ResendInterval = 3,  // Seconds
-  MaxResends = 5,
-  DecayInterval = 20,  // Number of message IDs we store for duplicates check
+  MaxResends = 5,  // Of a fragment, before its message is given up
+  FlushDelay = 5,  // Milliseconds, at most, fragments and ACKs wait to share a packet
+  ReceivedMessagesLifetime = 60,  // Seconds, at least, a received message ID is remembered
   IncompleteMessagesCleanupTimeout = 30,  // Seconds
   ConnectTimeout = 5,  // Seconds
   TerminationTimeout = 330,  // 5 1/2 minutes
@@ -66,54 +69,101 @@ enum SSUDuration : std::uint16_t
   ToIntroducerSessionDuration = 3600,  // 1 hour
 };
 
-struct Fragment {
-  Fragment() = default;
+/// @brief Message IDs held by a generation of the received messages filter,
+///   shared by all sessions
+const std::size_t SSU_RECEIVED_MESSAGES_CAPACITY = 1 << 20;
+const double SSU_RECEIVED_MESSAGES_FALSE_POSITIVE = 1e-6;
 
-  Fragment(
-      std::size_t num,
-      const std::uint8_t* buf,
-      std::size_t last_len,
-      bool last)
-      : fragment_num(num),
-        len(last_len),
-        is_last(last) {
-          memcpy(buffer.data(), buf, len);
-        }
-
-  std::size_t fragment_num, len;
-  bool is_last;
-  std::array<std::uint8_t, SSUSize::FragmentBuffer> buffer;
-};
-
-struct FragmentCmp {
-  bool operator() (
-      const std::unique_ptr<Fragment>& f1,
-      const std::unique_ptr<Fragment>& f2) const {
-    return f1->fragment_num < f2->fragment_num;
-  }
-};
+/// @brief Buffers of a reused message slot larger than this are released
+const std::size_t SSU_MAX_REUSED_BUFFER = 4096;
 
+/// @struct IncompleteMessage
+/// @brief Message being received, until its last fragment is attached
 struct IncompleteMessage {
-  IncompleteMessage(
-      std::shared_ptr<I2NPMessage> m)
-      : msg(m),
-        next_fragment_num(0),
-        last_fragment_insert_time(0) {}
+  /// @brief Fragment received ahead of the next one to attach
+  struct SavedFragment {
+    std::uint8_t fragment_num;
+    bool is_last;
+    std::size_t offset, len;  // in saved_data
+  };
+
+  /// @brief Starts receiving a new message, keeping the buffers of the
+  ///   previous one
+  void Reset(
+      std::shared_ptr<I2NPMessage> m,
+      std::uint32_t ts);
 
   void AttachNextFragment(
       const std::uint8_t* fragment,
       std::size_t fragment_size);
 
+  /// @brief Saves a fragment received ahead of the next one
+  /// @return False if it was already saved
+  bool SaveFragment(
+      std::uint8_t fragment_num,
+      const std::uint8_t* fragment,
+      std::size_t fragment_size,
+      bool is_last);
+
+  /// @brief Attaches the saved fragments which follow the attached ones
+  /// @return True if the last fragment was attached
+  bool AttachSavedFragments();
+
   std::shared_ptr<I2NPMessage> msg;
   std::size_t next_fragment_num;
   std::uint32_t last_fragment_insert_time;  // in seconds
-  std::set<std::unique_ptr<Fragment>, FragmentCmp> saved_fragments;
+  std::bitset<SSUSize::MaxFragments> saved;
+  std::vector<SavedFragment> saved_fragments;
+  std::vector<std::uint8_t> saved_data;  // data of all saved fragments
 };
 
+/// @struct SentMessage
+/// @brief Message sent, until all its fragments are ACKed or it is given up
 struct SentMessage {
-  std::vector<std::unique_ptr<Fragment>> fragments;
-  std::uint32_t next_resend_time;  // in seconds
-  std::size_t num_resends;
+  struct FragmentState {
+    std::uint64_t send_time;  // in milliseconds, 0 unless in flight
+    std::uint8_t num_sends;
+  };
+
+  /// @brief Takes a new message, keeping the buffers of the previous one
+  /// @param buf Message, SSU header included
+  /// @param fragment_size Data of each fragment but the last
+  void Reset(
+      std::uint32_t id,
+      const std::uint8_t* buf,
+      std::size_t len,
+      std::size_t fragment_size);
+
+  std::size_t GetNumFragments() const {
+    return fragments.size();
+  }
+
+  bool IsACKed(
+      std::size_t fragment_num) const {
+    return acked.test(fragment_num);
+  }
+
+  /// @return True once all fragments are ACKed
+  bool IsACKed() const {
+    return acked.count() == fragments.size();
+  }
+
+  /// @return Size of a fragment as written in a data packet
+  std::size_t GetFragmentSize(
+      std::size_t fragment_num) const;
+
+  /// @brief Writes a fragment as in a data packet: message ID, fragment
+  ///   info, then data
+  /// @return Bytes written
+  std::size_t WriteFragment(
+      std::size_t fragment_num,
+      std::uint8_t* buf) const;
+
+  std::uint32_t msg_id;
+  std::size_t fragment_size;
+  std::vector<std::uint8_t> data;  // of all fragments
+  std::vector<FragmentState> fragments;
+  std::bitset<SSUSize::MaxFragments> acked;
 };
 
 class SSUSession;
@@ -141,9 +191,11 @@ class SSUData {
       const xi2p::core::IdentHash& remote_ident);
 
  private:
+  /// @brief Queues the ACK of a message received, sent within FlushDelay
   void SendMsgACK(
       std::uint32_t msg_id);
 
+  /// @brief Queues the ACK of a fragment received, sent within FlushDelay
   void SendFragmentACK(
       std::uint32_t msg_id,
       std::size_t fragment_num);
@@ -156,18 +208,66 @@ class SSUData {
       std::uint8_t * buf);
 
   void ProcessSentMessageACK(
-      std::uint32_t msg_id);
+      SentMessage& message,
+      std::uint64_t ts,
+      std::uint64_t& acked_send_time);
+
+  /// @brief Accounts for a fragment ACKed, fully or by bitfield
+  /// @param acked_send_time Latest send time of the fragments ACKed
+  void ProcessFragmentACK(
+      SentMessage& message,
+      std::size_t fragment_num,
+      std::uint64_t ts,
+      std::uint64_t& acked_send_time);
+
+  /// @brief Declares lost the fragments in flight which were sent well
+  ///   before a fragment since ACKed
+  void DetectLostFragments(
+      std::uint64_t acked_send_time,
+      std::uint64_t ts);
+
+  /// @brief Queues a fragment for resending, or gives up on its message
+  /// @return False if the message was given up
+  bool ResendFragment(
+      SentMessage& message,
+      std::size_t fragment_num,
+      std::uint64_t ts);
+
+  /// @brief Sends queued fragments, resent ones first, as far as the
+  ///   congestion window and the pacer allow, along with queued ACKs.
+  ///   Several fragments and ACKs share each packet
+  /// @param is_flush If false, a packet is only sent once full (or once the
+  ///   window is), the rest waits for the flush timer
+  void SendPendingFragments(
+      bool is_flush);
+
+  /// @return True if enough is queued to fill the next packet
+  /// @param is_blocked If fragments can not be sent until the pace timer
+  bool HasFullPacket(
+      bool is_blocked) const;
+
+  void ScheduleFlush();
+
+  void HandleFlushTimer(
+      const boost::system::error_code& ecode);
 
-  void ScheduleResend();
+  void ScheduleResend(
+      std::uint64_t delay);
 
   void HandleResendTimer(
       const boost::system::error_code& ecode);
 
-  void ScheduleDecay();
+  void SchedulePace(
+      std::uint64_t delay);
 
-  void HandleDecayTimer(
+  void HandlePaceTimer(
       const boost::system::error_code& ecode);
 
+  /// @brief Remembers a message received from the remote peer
+  /// @return True if the message was (probably) received before
+  bool CheckAndAddReceivedMessage(
+      std::uint32_t msg_id);
+
   void ScheduleIncompleteMessagesCleanup();
 
   void HandleIncompleteMessagesCleanupTimer(
@@ -178,11 +278,18 @@ class SSUData {
 
  private:
   SSUSession& m_Session;
-  std::map<std::uint32_t, std::unique_ptr<IncompleteMessage>> m_IncompleteMessages;
-  std::map<std::uint32_t, std::unique_ptr<SentMessage>> m_SentMessages;
-  std::set<std::uint32_t> m_ReceivedMessages;
-  boost::asio::deadline_timer m_ResendTimer, m_DecayTimer,
-                              m_IncompleteMessagesCleanupTimer;
+  SSUMessageTable<IncompleteMessage> m_IncompleteMessages;
+  SSUMessageTable<SentMessage> m_SentMessages;
+  boost::asio::deadline_timer m_ResendTimer, m_IncompleteMessagesCleanupTimer,
+                              m_PaceTimer, m_FlushTimer;
+  SSUCongestionControl m_CongestionControl;
+  SSUPacer m_Pacer;
+  // fragments (message ID, fragment number) waiting for the window or the
+  // pacer: lost ones go first
+  std::deque<std::pair<std::uint32_t, std::size_t>> m_PendingFragments,
+                                                     m_LostFragments;
+  SSUPendingACKs m_PendingACKs;
+  bool m_IsResendScheduled, m_IsPacing, m_IsFlushScheduled;
   std::size_t m_MaxPacketSize, m_PacketSize;
   xi2p::core::I2NPMessagesHandler m_Handler;
 };
@@ -0,0 +1,228 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#ifndef SRC_CORE_ROUTER_TRANSPORTS_SSU_MESSAGE_TABLE_H_
+#define SRC_CORE_ROUTER_TRANSPORTS_SSU_MESSAGE_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace xi2p {
+namespace core {
+
+/// @class SSUMessageTable
+/// @brief Messages of an SSU session, by message ID
+/// @details Messages sit in a ring of slots, oldest first: a message takes
+///   the slot after the newest one, and the oldest slot is freed as soon as
+///   its message is erased. Message IDs are random, so a linear probing index
+///   finds the slot of an ID. Slots are reused as they are, so that messages
+///   can keep their buffers from one message to the next: nothing is
+///   allocated per message unless the ring is full, which only doubles it
+///   if more than half of it is in use, and compacts it otherwise.
+/// @tparam Message Default constructible, movable
+/// @note Not thread-safe
+template <typename Message>
+class SSUMessageTable {
+  struct Slot {
+    std::uint32_t id = 0;
+    bool is_used = false;
+    Message message;
+  };
+
+ public:
+  /// @param capacity Initial number of slots, rounded up to a power of 2
+  explicit SSUMessageTable(
+      std::size_t capacity = 16)
+      : m_Head(0),
+        m_Tail(0),
+        m_Size(0) {
+    std::size_t slots = 1;
+    while (slots < capacity)
+      slots <<= 1;
+    Relayout(slots);
+  }
+
+  /// @return Message of the ID, nullptr if there is none
+  Message* Find(
+      std::uint32_t id) {
+    auto const pos = FindIndex(id);
+    return pos == NotFound ? nullptr : &m_Slots[m_Index[pos] - 1].message;
+  }
+
+  const Message* Find(
+      std::uint32_t id) const {
+    auto const pos = FindIndex(id);
+    return pos == NotFound ? nullptr : &m_Slots[m_Index[pos] - 1].message;
+  }
+
+  /// @brief Adds a message, which the ID must not have
+  /// @return Message of the slot taken, as left by its previous message,
+  ///   to be reset by the caller
+  Message& Insert(
+      std::uint32_t id) {
+    if (m_Tail - m_Head == m_Slots.size())
+      Relayout(2 * m_Size > m_Slots.size() ? 2 * m_Slots.size() : m_Slots.size());
+    auto const slot = m_Tail & (m_Slots.size() - 1);
+    m_Slots[slot].id = id;
+    m_Slots[slot].is_used = true;
+    m_Tail++;
+    m_Size++;
+    AddIndex(id, slot);
+    return m_Slots[slot].message;
+  }
+
+  /// @brief Erases the message of the ID, if any
+  void Erase(
+      std::uint32_t id) {
+    auto const pos = FindIndex(id);
+    if (pos == NotFound)
+      return;
+    m_Slots[m_Index[pos] - 1].is_used = false;
+    RemoveIndex(pos);
+    m_Size--;
+    while (m_Head != m_Tail && !m_Slots[m_Head & (m_Slots.size() - 1)].is_used)
+      m_Head++;
+  }
+
+  /// @brief Calls f(id, message) for each message, oldest first
+  /// @param f Returns false for the message to be erased. Must not insert
+  template <typename Function>
+  void ForEach(
+      Function f) {
+    for (auto seq = m_Head; seq != m_Tail; seq++) {
+      auto& slot = m_Slots[seq & (m_Slots.size() - 1)];
+      if (slot.is_used && !f(slot.id, slot.message))
+        Erase(slot.id);
+    }
+  }
+
+  bool IsEmpty() const {
+    return !m_Size;
+  }
+
+  std::size_t GetSize() const {
+    return m_Size;
+  }
+
+  /// @return Number of slots
+  std::size_t GetCapacity() const {
+    return m_Slots.size();
+  }
+
+ private:
+  static constexpr std::size_t NotFound = static_cast<std::size_t>(-1);
+
+  /// @return Position in the index where the probing for an ID starts
+  std::size_t GetHome(
+      std::uint32_t id) const {
+    // Fibonacci hashing: the top bits of the product are well mixed
+    return (static_cast<std::uint32_t>(id * 2654435769u) >> m_IndexShift)
+      & (m_Index.size() - 1);
+  }
+
+  std::size_t FindIndex(
+      std::uint32_t id) const {
+    auto const mask = m_Index.size() - 1;
+    for (auto pos = GetHome(id); m_Index[pos]; pos = (pos + 1) & mask)
+      if (m_Slots[m_Index[pos] - 1].id == id)
+        return pos;
+    return NotFound;
+  }
+
+  void AddIndex(
+      std::uint32_t id,
+      std::size_t slot) {
+    auto const mask = m_Index.size() - 1;
+    auto pos = GetHome(id);
+    while (m_Index[pos])
+      pos = (pos + 1) & mask;
+    m_Index[pos] = slot + 1;
+  }
+
+  /// @brief Empties a position of the index, shifting back the entries
+  ///   after it which would no longer be found
+  void RemoveIndex(
+      std::size_t pos) {
+    auto const mask = m_Index.size() - 1;
+    for (auto next = (pos + 1) & mask; m_Index[next]; next = (next + 1) & mask) {
+      auto const home = GetHome(m_Slots[m_Index[next] - 1].id);
+      // Whether home is cyclically outside of (pos, next]
+      if (((next - home) & mask) >= ((next - pos) & mask)) {
+        m_Index[pos] = m_Index[next];
+        pos = next;
+      }
+    }
+    m_Index[pos] = 0;
+  }
+
+  /// @brief Moves the messages, oldest first, to the front of a ring of the
+  ///   given number of slots, and rebuilds the index
+  void Relayout(
+      std::size_t capacity) {
+    std::vector<Slot> slots(capacity);
+    std::size_t size = 0;
+    for (auto seq = m_Head; seq != m_Tail; seq++) {
+      auto& slot = m_Slots[seq & (m_Slots.size() - 1)];
+      if (slot.is_used)
+        slots[size++] = std::move(slot);
+    }
+    // Free slots keep their messages' buffers for reuse
+    auto free_slot = size;
+    for (auto& slot : m_Slots)
+      if (!slot.is_used && free_slot < capacity)
+        std::swap(slots[free_slot++].message, slot.message);
+    m_Slots.swap(slots);
+    m_Head = 0;
+    m_Tail = size;
+    // Twice as many positions as slots keeps probing short
+    m_Index.assign(2 * capacity, 0);
+    m_IndexShift = 32;
+    for (auto positions = m_Index.size(); positions > 1; positions >>= 1)
+      m_IndexShift--;
+    for (std::size_t slot = 0; slot < size; slot++)
+      AddIndex(m_Slots[slot].id, slot);
+  }
+
+ private:
+  std::vector<Slot> m_Slots;  // power of 2
+  // Slot + 1 of the message at each position, 0 if none
+  std::vector<std::uint32_t> m_Index;
+  std::size_t m_IndexShift;
+  // Sequence numbers of the oldest slot in use and of the next slot to take
+  std::uint64_t m_Head, m_Tail;
+  std::size_t m_Size;
+};
+
+}  // namespace core
+}  // namespace xi2p
+
+#endif  // SRC_CORE_ROUTER_TRANSPORTS_SSU_MESSAGE_TABLE_H_
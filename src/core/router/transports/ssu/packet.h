@@ -64,7 +64,11 @@ enum SSUSize : std::uint16_t
       + BufferMargin,
   KeyingMaterial = 64,
   DHPublic = 256,
-  MaxReceivedMessages = 1000,  // TODO(unassigned): research this value
+  MaxReceiveBatch = 32,  ///< Datagrams read per wakeup of the receive handler
+  MaxSendBatch = 32,  ///< Datagrams queued for one batched send
+  PiggybackedACKs = 16,  ///< Left by a full data fragment for ACKs to share its packet
+  FragmentHeader = 7,  ///< Message ID and fragment info of a data fragment
+  MaxFragments = 128,  ///< Fragments of a message (7 bit fragment number)
   MaxIntroducers = 3,
   // Session buffer sizes imply *before* non-mod-16 padding. See SSU spec.
   RelayRequestBuffer = 96,  ///< 96 bytes (no Alice IP included) or 112 bytes (4-byte Alice IP included)
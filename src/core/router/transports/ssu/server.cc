@@ -34,7 +34,14 @@
 
 #include <boost/bind.hpp>
 
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
 #include <array>
+#include <cerrno>
+#include <cstring>
 
 #include "core/crypto/rand.h"
 
@@ -57,7 +64,15 @@ SSUServer::SSUServer(
       m_SocketV6(m_Service),
       m_IntroducersUpdateTimer(m_Service),
       m_PeerTestsCleanupTimer(m_Service),
-      m_IsRunning(false) {
+      m_IsRunning(false),
+      m_ReceivedMessages(
+          SSU_RECEIVED_MESSAGES_CAPACITY,
+          SSU_RECEIVED_MESSAGES_FALSE_POSITIVE,
+          SSUDuration::ReceivedMessagesLifetime) {
+#ifdef __linux__
+  m_ReceiveBuffers.fill(nullptr);
+  m_ReceiveBuffersV6.fill(nullptr);
+#endif
   m_Socket.set_option(boost::asio::socket_base::receive_buffer_size(65535));
   m_Socket.set_option(boost::asio::socket_base::send_buffer_size(65535));
   if (context.SupportsV6()) {
@@ -69,7 +84,14 @@ SSUServer::SSUServer(
   }
 }
 
-SSUServer::~SSUServer() {}
+SSUServer::~SSUServer() {
+#ifdef __linux__
+  for (auto packet : m_ReceiveBuffers)
+    delete packet;
+  for (auto packet : m_ReceiveBuffersV6)
+    delete packet;
+#endif
+}
 
 void SSUServer::Start() {
   LOG(debug) << "SSUServer: starting";
@@ -92,6 +114,9 @@ void SSUServer::Start() {
 void SSUServer::Stop() {
   LOG(debug) << "SSUServer: stopping";
   DeleteAllSessions();
+#ifdef __linux__
+  FlushSendQueues();
+#endif
   m_IsRunning = false;
   m_Socket.close();
   m_SocketV6.close();
@@ -118,6 +143,35 @@ void SSUServer::Send(
     std::size_t len,
     const boost::asio::ip::udp::endpoint& to) {
   LOG(debug) << "SSUServer: sending data";
+#ifdef __linux__
+  // Queue the datagram, everything sent during this round of the service
+  // goes out with one sendmmsg() per socket
+  if (len <= SSUSize::RawPacketBuffer) {
+    bool const is_v4 = to.protocol() == boost::asio::ip::udp::v4();
+    SendQueue& queue = is_v4 ? m_SendQueue : m_SendQueueV6;
+    std::unique_ptr<SendBatch> filled;
+    bool is_first; {
+      std::unique_lock<std::mutex> l(queue.mutex);
+      if (queue.batch->num_packets == queue.batch->packets.size())
+        filled = queue.Take();
+      RawSSUPacket& packet = queue.batch->packets[queue.batch->num_packets++];
+      std::memcpy(packet.buf, buf, len);
+      packet.len = len;
+      packet.from = to;
+      is_first = queue.batch->num_packets == 1;
+    }
+    if (filled) {
+      SendPackets(is_v4 ? m_Socket : m_SocketV6, *filled);
+      queue.Release(std::move(filled));
+    }
+    if (is_first)
+      m_Service.post(
+          std::bind(
+              &SSUServer::FlushSendQueues,
+              this));
+    return;
+  }
+#endif
   if (to.protocol() == boost::asio::ip::udp::v4()) {
     try {
       m_Socket.send_to(boost::asio::buffer(buf, len), to);
@@ -135,6 +189,15 @@ void SSUServer::Send(
 
 void SSUServer::Receive() {
   LOG(debug) << "SSUServer: receiving data";
+#ifdef __linux__
+  m_Socket.async_receive(
+      boost::asio::null_buffers(),
+      std::bind(
+          &SSUServer::HandleReceivable,
+          this,
+          std::placeholders::_1,
+          false));
+#else
   RawSSUPacket* packet = new RawSSUPacket();  // always freed in ensuing handlers
   m_Socket.async_receive_from(
       boost::asio::buffer(
@@ -147,10 +210,20 @@ void SSUServer::Receive() {
           std::placeholders::_1,
           std::placeholders::_2,
           packet));
+#endif
 }
 
 void SSUServer::ReceiveV6() {
   LOG(debug) << "SSUServer: V6: receiving data";
+#ifdef __linux__
+  m_SocketV6.async_receive(
+      boost::asio::null_buffers(),
+      std::bind(
+          &SSUServer::HandleReceivable,
+          this,
+          std::placeholders::_1,
+          true));
+#else
   RawSSUPacket* packet = new RawSSUPacket();  // always freed in ensuing handlers
   m_SocketV6.async_receive_from(
       boost::asio::buffer(
@@ -163,6 +236,7 @@ void SSUServer::ReceiveV6() {
           std::placeholders::_1,
           std::placeholders::_2,
           packet));
+#endif
 }
 
 // coverity[+free : arg-2]
@@ -179,7 +253,7 @@ void SSUServer::HandleReceivedFrom(
     std::size_t more_bytes = m_Socket.available(ec);
     // TODO(anonimal): but what about 0 length HolePunch?
     //   Current handler's null length check done in vain?
-    while (more_bytes && packets.size() < 25) {
+    while (more_bytes && packets.size() < SSUSize::MaxReceiveBatch) {
       packet = new RawSSUPacket();
       packet->len = m_Socket.receive_from(
           boost::asio::buffer(
@@ -213,7 +287,7 @@ void SSUServer::HandleReceivedFromV6(
     std::vector<RawSSUPacket *> packets;
     packets.push_back(packet);
     std::size_t more_bytes = m_SocketV6.available();
-    while (more_bytes && packets.size() < 25) {
+    while (more_bytes && packets.size() < SSUSize::MaxReceiveBatch) {
       packet = new RawSSUPacket();
       packet->len = m_SocketV6.receive_from(
           boost::asio::buffer(
@@ -236,6 +310,147 @@ void SSUServer::HandleReceivedFromV6(
   }
 }
 
+#ifdef __linux__
+void SSUServer::HandleReceivable(
+    const boost::system::error_code& ecode,
+    bool is_v6) {
+  LOG(debug) << "SSUServer: handling received data";
+  if (ecode) {
+    if (ecode != boost::asio::error::operation_aborted)
+      LOG(error) << "SSUServer: receive error: " << ecode.message();
+    return;
+  }
+  auto& socket = is_v6 ? m_SocketV6 : m_Socket;
+  auto& buffers = is_v6 ? m_ReceiveBuffersV6 : m_ReceiveBuffers;
+  std::size_t const mtu = is_v6 ? SSUSize::MTUv6 : SSUSize::MTUv4;
+  std::vector<RawSSUPacket *> packets;
+  // Keep reading while batches come back full, but stay fair to other handlers
+  for (std::size_t i = 0; i < 4; i++) {
+    std::size_t const num = packets.size();
+    if (!ReceiveBatch(socket, mtu, buffers, packets))
+      return;  // packets already handed off are freed in ensuing handler
+    if (packets.size() - num < SSUSize::MaxReceiveBatch)
+      break;
+  }
+  if (!packets.empty()) {
+    // packets are freed in ensuing handler
+    m_Service.post(
+        std::bind(
+            &SSUServer::HandleReceivedPackets,
+            this,
+            packets));
+  }
+  if (is_v6)
+    ReceiveV6();
+  else
+    Receive();
+}
+
+bool SSUServer::ReceiveBatch(
+    boost::asio::ip::udp::socket& socket,
+    std::size_t mtu,
+    ReceiveBuffers& buffers,
+    std::vector<RawSSUPacket *>& packets) {
+  std::array<iovec, SSUSize::MaxReceiveBatch> iovs;
+  std::array<mmsghdr, SSUSize::MaxReceiveBatch> msgs {};
+  for (std::size_t i = 0; i < buffers.size(); i++) {
+    // Only packets handed off by the previous read are missing
+    if (!buffers[i])
+      buffers[i] = new RawSSUPacket;  // no value-init, buffer is overwritten
+    iovs[i].iov_base = buffers[i]->buf;
+    iovs[i].iov_len = mtu;
+    msgs[i].msg_hdr.msg_name = buffers[i]->from.data();
+    msgs[i].msg_hdr.msg_namelen = buffers[i]->from.capacity();
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  int const received = recvmmsg(
+      socket.native_handle(), msgs.data(), msgs.size(), MSG_DONTWAIT, nullptr);
+  std::size_t const num = received > 0 ? received : 0;
+  for (std::size_t i = 0; i < num; i++) {
+    buffers[i]->len = msgs[i].msg_len;
+    buffers[i]->from.resize(msgs[i].msg_hdr.msg_namelen);
+    packets.push_back(buffers[i]);
+    buffers[i] = nullptr;  // now owned by HandleReceivedPackets()
+  }
+  if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+    LOG(error) << "SSUServer: receive error: " << std::strerror(errno);
+    if (!packets.empty())
+      m_Service.post(
+          std::bind(
+              &SSUServer::HandleReceivedPackets,
+              this,
+              packets));
+    return false;
+  }
+  return true;
+}
+
+void SSUServer::FlushSendQueues() {
+  FlushSendQueue(m_Socket, m_SendQueue);
+  FlushSendQueue(m_SocketV6, m_SendQueueV6);
+}
+
+void SSUServer::FlushSendQueue(
+    boost::asio::ip::udp::socket& socket,
+    SendQueue& queue) {
+  std::unique_ptr<SendBatch> filled; {
+    std::unique_lock<std::mutex> l(queue.mutex);
+    if (!queue.batch->num_packets)
+      return;
+    filled = queue.Take();
+  }
+  SendPackets(socket, *filled);
+  queue.Release(std::move(filled));
+}
+
+void SSUServer::SendPackets(
+    boost::asio::ip::udp::socket& socket,
+    SendBatch& batch) {
+  std::size_t const num = batch.num_packets;
+  if (!num || !socket.is_open())
+    return;
+  std::array<iovec, SSUSize::MaxSendBatch> iovs;
+  std::array<mmsghdr, SSUSize::MaxSendBatch> msgs {};
+  for (std::size_t i = 0; i < num; i++) {
+    RawSSUPacket& packet = batch.packets[i];
+    iovs[i].iov_base = packet.buf;
+    iovs[i].iov_len = packet.len;
+    msgs[i].msg_hdr.msg_name = packet.from.data();
+    msgs[i].msg_hdr.msg_namelen = packet.from.size();
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  std::size_t sent = 0;
+  while (sent < num) {
+    int const ret = sendmmsg(
+        socket.native_handle(), &msgs[sent], num - sent, 0);
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // Socket buffer is full: like the send_to() this replaces, wait
+        // for the socket to become writable rather than drop the rest
+        for (; sent < num; sent++) {
+          RawSSUPacket& packet = batch.packets[sent];
+          boost::system::error_code ec;
+          socket.send_to(
+              boost::asio::buffer(packet.buf, packet.len), packet.from, 0, ec);
+          if (ec)
+            LOG(error) << "SSUServer: send error: '" << ec.message() << "'";
+        }
+        break;
+      }
+      // Same as a failed send_to(): report and drop that datagram only
+      LOG(error) << "SSUServer: send error: '" << std::strerror(errno) << "'";
+      sent++;
+    } else {
+      sent += ret;
+    }
+  }
+}
+#endif
+
 void SSUServer::HandleReceivedPackets(
     std::vector<RawSSUPacket *> packets) {
   LOG(debug) << "SSUServer: handling received packets";
@@ -35,6 +35,7 @@
 
 #include <boost/asio.hpp>
 
+#include <array>
 #include <cstdint>
 #include <list>
 #include <map>
@@ -52,14 +53,34 @@
 #include "core/router/transports/ssu/packet.h"
 #include "core/router/transports/ssu/session.h"
 
+#include "core/util/bloom_filter.h"
+#include "core/util/memory_pool.h"
+
 
 namespace xi2p {
 namespace core {
 
 struct RawSSUPacket {
   xi2p::core::AESAlignedBuffer<SSUSize::RawPacketBuffer> buf;
-  boost::asio::ip::udp::endpoint from;
+  boost::asio::ip::udp::endpoint from;  // or destination, when sending
   std::size_t len;
+
+  // Received packets are allocated and freed at line rate
+  static void* operator new(
+      std::size_t size) {
+    if (size != sizeof(RawSSUPacket))
+      return ::operator new(size);
+    return core::BlockPool<sizeof(RawSSUPacket), RawSSUPacket>::Allocate();
+  }
+
+  static void operator delete(
+      void* ptr,
+      std::size_t size) {
+    if (size != sizeof(RawSSUPacket))
+      ::operator delete(ptr);
+    else
+      core::BlockPool<sizeof(RawSSUPacket), RawSSUPacket>::Deallocate(ptr);
+  }
 };
 
 class SSUServer {
@@ -100,6 +121,12 @@ class SSUServer {
     return m_Endpoint;
   }
 
+  /// @return Filter of the messages received by all sessions,
+  ///   for duplicates check
+  RotatingBloomFilter& GetReceivedMessages() {
+    return m_ReceivedMessages;
+  }
+
   void Send(
       const uint8_t* buf,
       std::size_t len,
@@ -148,6 +175,71 @@ class SSUServer {
   void HandleReceivedPackets(
       std::vector<RawSSUPacket *> packets);
 
+#ifdef __linux__
+  /// @brief Datagrams going out with a single sendmmsg()
+  struct SendBatch {
+    SendBatch() : num_packets(0) {}
+    std::array<RawSSUPacket, SSUSize::MaxSendBatch> packets;
+    std::size_t num_packets;
+  };
+
+  /// @brief Batch being filled, swapped out to be sent without the lock
+  ///   so senders never wait on a send syscall
+  struct SendQueue {
+    SendQueue()
+        : batch(std::make_unique<SendBatch>()),
+          spare(std::make_unique<SendBatch>()) {}
+
+    /// @brief Swaps in an empty batch and returns the filled one
+    /// @note Mutex must be held
+    std::unique_ptr<SendBatch> Take() {
+      auto filled = std::move(batch);
+      batch = spare ? std::move(spare) : std::make_unique<SendBatch>();
+      return filled;
+    }
+
+    /// @brief Keeps a sent batch for reuse
+    void Release(
+        std::unique_ptr<SendBatch> sent) {
+      sent->num_packets = 0;
+      std::unique_lock<std::mutex> l(mutex);
+      if (!spare)
+        spare = std::move(sent);
+    }
+
+    std::mutex mutex;
+    std::unique_ptr<SendBatch> batch, spare;
+  };
+
+  /// @brief Packets recvmmsg() reads into, kept per socket across reads.
+  ///   Only those handed off to HandleReceivedPackets() are replaced.
+  typedef std::array<RawSSUPacket *, SSUSize::MaxReceiveBatch> ReceiveBuffers;
+
+  /// @brief Reads all pending datagrams, in batches, once the socket is readable
+  void HandleReceivable(
+      const boost::system::error_code& ecode,
+      bool is_v6);
+
+  /// @brief Reads up to SSUSize::MaxReceiveBatch datagrams with recvmmsg()
+  /// @return False on socket error
+  bool ReceiveBatch(
+      boost::asio::ip::udp::socket& socket,
+      std::size_t mtu,
+      ReceiveBuffers& buffers,
+      std::vector<RawSSUPacket *>& packets);
+
+  void FlushSendQueues();
+
+  void FlushSendQueue(
+      boost::asio::ip::udp::socket& socket,
+      SendQueue& queue);
+
+  /// @note Called without the queue mutex, may block until sent
+  void SendPackets(
+      boost::asio::ip::udp::socket& socket,
+      SendBatch& batch);
+#endif
+
   template<typename Filter>
   std::shared_ptr<SSUSession> GetRandomSession(
       Filter filter);
@@ -193,6 +285,13 @@ class SSUServer {
 
   // nonce -> creation time in milliseconds
   std::map<std::uint32_t, PeerTest> m_PeerTests;
+
+  RotatingBloomFilter m_ReceivedMessages;
+
+#ifdef __linux__
+  SendQueue m_SendQueue, m_SendQueueV6;
+  ReceiveBuffers m_ReceiveBuffers, m_ReceiveBuffersV6;
+#endif
 };
 
 }  // namespace core
@@ -36,6 +36,9 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <vector>
+
+#include "core/crypto/tunnel.h"
 
 #include "core/router/i2np.h"
 #include "core/router/identity.h"
@@ -77,10 +80,28 @@ class TunnelBase {
 
   virtual void FlushTunnelDataMsgs() {}
 
+  /// @brief Hands the layer encryption of pending messages over to a batch
+  ///   shared with the other tunnels of a drained queue
+  /// @return False if the tunnel doesn't take part, and is flushed on its own
+  virtual bool AddEncryptionJobs(
+      std::vector<TunnelEncryption::Job>&) {
+    return false;
+  }
+
+  /// @brief Forwards pending messages once their shared batch is encrypted
+  virtual void FlushEncryptedTunnelDataMsgs() {}
+
   virtual void EncryptTunnelMsg(
       std::shared_ptr<const I2NPMessage> in,
       std::shared_ptr<I2NPMessage> out) = 0;
 
+  /// @brief Encrypts a burst of messages in place
+  virtual void EncryptTunnelMsgs(
+      const std::vector<std::shared_ptr<I2NPMessage> >& msgs) {
+    for (auto const& msg : msgs)
+      EncryptTunnelMsg(msg, msg);
+  }
+
   virtual std::uint32_t GetNextTunnelID() const = 0;
 
   virtual const xi2p::core::IdentHash& GetNextIdentHash() const = 0;
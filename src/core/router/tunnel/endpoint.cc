@@ -132,6 +132,8 @@ void TunnelEndpoint::HandleDecryptedTunnelDataMsg(
       fragment += 2;
       msg->offset = fragment - msg->buf;
       msg->len = msg->offset + size;
+      // as sent by the tunnel's gateway, checksum included
+      msg->is_chks_updated = true;
       if (fragment + size < decrypted + TUNNEL_DATA_ENCRYPTED_SIZE) {
         // this is not last message. we have to copy it
         m.data = ToSharedI2NPMessage(NewI2NPShortMessage());
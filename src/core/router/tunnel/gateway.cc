@@ -85,6 +85,8 @@ void TunnelGatewayBuffer::PutI2NPMsg(
   di[0] = block.delivery_type << 5;
   // create fragments
   std::shared_ptr<I2NPMessage> msg = block.data;
+  // the full header is carried to the tunnel's endpoint
+  msg->FinalizeChks();
   // delivery instructions + payload + 2 bytes length
   auto full_msg_len = di_len + msg->GetLength() + 2;
   if (full_msg_len <= m_RemainingSize) {
@@ -248,8 +250,8 @@ void TunnelGateway::PutTunnelDataMsg(
 void TunnelGateway::SendBuffer() {
   m_Buffer.CompleteCurrentTunnelDataMessage();
   auto tunnel_msgs = m_Buffer.GetTunnelDataMsgs();
+  m_Tunnel->EncryptTunnelMsgs(tunnel_msgs);
   for (auto tunnel_msg : tunnel_msgs) {
-    m_Tunnel->EncryptTunnelMsg(tunnel_msg, tunnel_msg);
     tunnel_msg->FillI2NPMessageHeader(I2NPTunnelData);
     m_NumSentBytes += TUNNEL_DATA_MSG_SIZE;
   }
@@ -209,6 +209,31 @@ void Tunnel::EncryptTunnelMsg(
   }
 }
 
+void Tunnel::EncryptTunnelMsgs(
+    const std::vector<std::shared_ptr<I2NPMessage> >& msgs) {
+  // TODO(anonimal): this try block should be handled entirely by caller
+  try {
+    static thread_local std::vector<TunnelDecryption::Job> jobs;
+    jobs.clear();
+    for (auto const& msg : msgs) {
+      std::uint8_t* payload = msg->GetPayload() + 4;
+      jobs.push_back({nullptr, payload, payload});
+    }
+    // Layers are peeled hop by hop across the whole burst
+    TunnelHopConfig* hop = m_Config->GetLastHop();
+    while (hop) {
+      for (auto& job : jobs)
+        job.decryption = &hop->GetDecryption();
+      TunnelDecryption::DecryptBatch(jobs.data(), jobs.size());
+      hop = hop->GetPreviousHop();
+    }
+  } catch (...) {
+    m_Exception.Dispatch(__func__);
+    // TODO(anonimal): review if we need to safely break control, ensure exception handling by callers
+    throw;
+  }
+}
+
 void Tunnel::SendTunnelDataMsg(
     std::shared_ptr<xi2p::core::I2NPMessage>) {
   // TODO(unassigned): review for missing code
@@ -220,10 +245,19 @@ void InboundTunnel::HandleTunnelDataMsg(
   // incoming messages means a tunnel is alive
   if (IsFailed())
     SetState(e_TunnelStateEstablished);
-  auto new_msg = CreateEmptyTunnelDataMsg();
-  EncryptTunnelMsg(msg, new_msg);
+  // Decrypted on flush, along with the rest of the burst
+  auto new_msg = ToWritableTunnelDataMsg(std::move(msg));
   new_msg->from = shared_from_this();
-  m_Endpoint.HandleDecryptedTunnelDataMsg(new_msg);
+  m_TunnelDataMsgs.push_back(new_msg);
+}
+
+void InboundTunnel::FlushTunnelDataMsgs() {
+  if (!m_TunnelDataMsgs.empty()) {
+    EncryptTunnelMsgs(m_TunnelDataMsgs);
+    for (auto const& msg : m_TunnelDataMsgs)
+      m_Endpoint.HandleDecryptedTunnelDataMsg(msg);
+    m_TunnelDataMsgs.clear();
+  }
 }
 
 void OutboundTunnel::SendTunnelDataMsg(
@@ -269,31 +303,55 @@ Tunnels tunnels;
 Tunnels::Tunnels()
     : m_IsRunning(false),
       m_Thread(nullptr),
+      m_DataPlane(
+          std::bind(
+              &Tunnels::GetDataTunnel,
+              this,
+              std::placeholders::_1,
+              std::placeholders::_2)),
+      m_BuildPool(
+          std::bind(
+              &Tunnels::HandleTunnelBuildRequest,
+              this,
+              std::placeholders::_1)),
       m_NumSuccesiveTunnelCreations(0),
       m_NumFailedTunnelCreations(0) {}
 
 Tunnels::~Tunnels() {
-  for (auto& it : m_TransitTunnels)
-    delete it.second;
+  m_BuildPool.Stop();
+  m_DataPlane.Stop();
   m_TransitTunnels.clear();
 }
 
 std::shared_ptr<InboundTunnel> Tunnels::GetInboundTunnel(
     std::uint32_t tunnel_ID) {
+  std::unique_lock<std::mutex> l(m_InboundTunnelsMutex);
   auto it = m_InboundTunnels.find(tunnel_ID);
   if (it != m_InboundTunnels.end())
     return it->second;
   return nullptr;
 }
 
-TransitTunnel* Tunnels::GetTransitTunnel(
+std::shared_ptr<TransitTunnel> Tunnels::GetTransitTunnel(
     std::uint32_t tunnel_ID) {
+  std::unique_lock<std::mutex> l(m_TransitTunnelsMutex);
   auto it = m_TransitTunnels.find(tunnel_ID);
   if (it != m_TransitTunnels.end())
     return it->second;
   return nullptr;
 }
 
+std::shared_ptr<TunnelBase> Tunnels::GetDataTunnel(
+    std::uint8_t type_ID,
+    std::uint32_t tunnel_ID) {
+  std::shared_ptr<TunnelBase> tunnel;
+  if (type_ID == I2NPTunnelData)
+    tunnel = GetInboundTunnel(tunnel_ID);
+  if (!tunnel)
+    tunnel = GetTransitTunnel(tunnel_ID);
+  return tunnel;
+}
+
 std::shared_ptr<InboundTunnel> Tunnels::GetPendingInboundTunnel(
     std::uint32_t reply_msg_ID) {
   return GetPendingTunnel(
@@ -391,7 +449,7 @@ void Tunnels::StopTunnelPool(
 }
 
 void Tunnels::AddTransitTunnel(
-    TransitTunnel* tunnel) {
+    std::shared_ptr<TransitTunnel> tunnel) {
   std::unique_lock<std::mutex> l(m_TransitTunnelsMutex);
   if (!m_TransitTunnels.insert(
         std::make_pair(
@@ -400,11 +458,26 @@ void Tunnels::AddTransitTunnel(
     LOG(error)
       << "Tunnels: transit tunnel "
       << tunnel->GetTunnelID() << " already exists";
-    delete tunnel;
   }
 }
 
-void Tunnels::Start() {
+std::size_t Tunnels::GetNumTransitTunnels() {
+  std::unique_lock<std::mutex> l(m_TransitTunnelsMutex);
+  return m_TransitTunnels.size();
+}
+
+void Tunnels::Start(
+    std::size_t num_workers,
+    std::size_t num_build_workers,
+    std::size_t max_pending_builds) {
+  m_DataPlane.Start(num_workers);
+  LOG(info)
+    << "Tunnels: data plane running with "
+    << m_DataPlane.GetNumWorkers() << " workers";
+  m_BuildPool.Start(num_build_workers, max_pending_builds);
+  LOG(info)
+    << "Tunnels: build requests handled by "
+    << m_BuildPool.GetNumWorkers() << " workers";
   m_IsRunning = true;
   m_Thread =
     std::make_unique<std::thread>(
@@ -420,69 +493,64 @@ void Tunnels::Stop() {
     m_Thread->join();
     m_Thread.reset(nullptr);
   }
+  m_BuildPool.Stop();
+  m_DataPlane.Stop();
 }
 
 void Tunnels::Run() {
   // wait for other parts are ready
   std::this_thread::sleep_for(std::chrono::seconds(1));
   std::uint64_t last_ts = 0;
+  std::uint64_t num_rejected_builds = 0;
+  std::vector<std::shared_ptr<I2NPMessage> > msgs;
   while (m_IsRunning) {
     try {
-      auto msg = m_Queue.GetNextWithTimeout(1000);  // 1 sec
-      if (msg) {
-        std::uint32_t prev_tunnel_ID = 0,
-                 tunnel_ID = 0;
-        TunnelBase* prev_tunnel = nullptr;
-        do {
-          TunnelBase* tunnel = nullptr;
-          std::uint8_t type_ID = msg->GetTypeID();
-          switch (type_ID) {
-            case I2NPTunnelData:
-            case I2NPTunnelGateway: {
-              tunnel_ID = core::InputByteStream::Read<std::uint32_t>(msg->GetPayload());
-              if (tunnel_ID == prev_tunnel_ID)
-                tunnel = prev_tunnel;
-              else if (prev_tunnel)
-                prev_tunnel->FlushTunnelDataMsgs();
-              if (!tunnel && type_ID == I2NPTunnelData)
-                tunnel = GetInboundTunnel(tunnel_ID).get();
-              if (!tunnel)
-                tunnel = GetTransitTunnel(tunnel_ID);
-              if (tunnel) {
-                if (type_ID == I2NPTunnelData)
-                  tunnel->HandleTunnelDataMsg(msg);
-                else  // tunnel gateway assumed
-                  HandleTunnelGatewayMsg(tunnel, msg);
-              } else {
-                LOG(warning) << "Tunnels: tunnel " << tunnel_ID << " not found";
-              }
+      // TunnelData/TunnelGateway are handled by the data plane and build
+      // requests by build workers, this thread only manages tunnels and
+      // handles replies to our own builds
+      msgs.clear();
+      m_Queue.GetAllWithTimeout(msgs, 1000);  // 1 sec
+      for (auto const& msg : msgs) {
+        std::uint8_t type_ID = msg->GetTypeID();
+        switch (type_ID) {
+          case I2NPTunnelData:
+          case I2NPTunnelGateway:
+            // posted before the data plane was started
+            if (!m_DataPlane.PostTunnelData(msg))
+              LOG(warning) << "Tunnels: data plane is not running, dropped";
+          break;
+          case I2NPVariableTunnelBuild:
+            // the reply for one of our inbound tunnels arrives as a request
+            if (GetPendingInboundTunnel(msg->GetMsgID())) {
+              HandleI2NPMessage(msg->GetBuffer(), msg->GetLength());
               break;
             }
-            case I2NPVariableTunnelBuild:
-            case I2NPVariableTunnelBuildReply:
-            case I2NPTunnelBuild:
-            case I2NPTunnelBuildReply:
-              HandleI2NPMessage(msg->GetBuffer(), msg->GetLength());
-            break;
-            default:
-              LOG(error)
-                << "Tunnels: unexpected messsage type "
-                << static_cast<int>(type_ID);
-          }
-          msg = m_Queue.Get();
-          if (msg) {
-            prev_tunnel_ID = tunnel_ID;
-            prev_tunnel = tunnel;
-          } else if (tunnel) {
-            tunnel->FlushTunnelDataMsgs();
-          }
+            // fall through
+          case I2NPTunnelBuild:
+            if (!m_BuildPool.PostBuildRequest(msg))
+              LOG(debug) << "Tunnels: build workers are saturated, dropped request";
+          break;
+          case I2NPVariableTunnelBuildReply:
+          case I2NPTunnelBuildReply:
+            HandleI2NPMessage(msg->GetBuffer(), msg->GetLength());
+          break;
+          default:
+            LOG(error)
+              << "Tunnels: unexpected messsage type "
+              << static_cast<int>(type_ID);
         }
-        while (msg);
       }
       std::uint64_t ts = xi2p::core::GetSecondsSinceEpoch();
       if (ts - last_ts >= 15) {  // manage tunnels every 15 seconds
         ManageTunnels();
         last_ts = ts;
+        std::uint64_t const rejected = m_BuildPool.GetNumRejected();
+        if (rejected != num_rejected_builds) {
+          LOG(warning)
+            << "Tunnels: dropped " << rejected - num_rejected_builds
+            << " build requests, build workers are saturated";
+          num_rejected_builds = rejected;
+        }
       }
     } catch (const std::exception& ex) {
       LOG(error) << "Tunnels: " << __func__ << " exception: " << ex.what();
@@ -490,29 +558,12 @@ void Tunnels::Run() {
   }
 }
 
-void Tunnels::HandleTunnelGatewayMsg(
-    TunnelBase* tunnel,
+void Tunnels::HandleTunnelBuildRequest(
     std::shared_ptr<I2NPMessage> msg) {
-  if (!tunnel) {
-    LOG(error) << "Tunnels: missing tunnel for TunnelGateway";
-    return;
-  }
-  const std::uint8_t* payload = msg->GetPayload();
-  std::uint16_t const len = core::InputByteStream::Read<std::uint16_t>(
-      payload + TUNNEL_GATEWAY_HEADER_LENGTH_OFFSET);
-  // we make payload as new I2NP message to send
-  msg->offset += I2NP_HEADER_SIZE + TUNNEL_GATEWAY_HEADER_SIZE;
-  msg->len = msg->offset + len;
-  auto type_ID = msg->GetTypeID();
-  LOG(debug)
-    << "Tunnels: TunnelGateway of " << len
-    << " bytes for tunnel " << tunnel->GetTunnelID()
-    << ". Msg type " << static_cast<int>(type_ID);
-  if (type_ID == I2NPDatabaseStore || type_ID == I2NPDatabaseSearchReply)
-    // transit DatabaseStore my contain new/updated RI
-    // or DatabaseSearchReply with new routers
-    xi2p::core::netdb.PostI2NPMsg(msg);
-  tunnel->SendTunnelDataMsg(msg);
+  if (msg->GetTypeID() == I2NPVariableTunnelBuild)
+    HandleVariableTunnelBuildRequestMsg(msg->GetPayload(), msg->GetSize());
+  else
+    HandleTunnelBuildMsg(msg->GetPayload(), msg->GetSize());
 }
 
 void Tunnels::ManageTunnels() {
@@ -628,6 +679,7 @@ void Tunnels::ManageInboundTunnels() {
         auto pool = tunnel->GetTunnelPool();
         if (pool)
           pool->TunnelExpired(tunnel);
+        std::unique_lock<std::mutex> l(m_InboundTunnelsMutex);
         it = m_InboundTunnels.erase(it);
       } else {
         if (tunnel->IsEstablished()) {
@@ -668,14 +720,13 @@ void Tunnels::ManageInboundTunnels() {
 
 void Tunnels::ManageTransitTunnels() {
   std::uint64_t ts = xi2p::core::GetSecondsSinceEpoch();
+  // build workers add transit tunnels concurrently
+  std::unique_lock<std::mutex> l(m_TransitTunnelsMutex);
   for (auto it = m_TransitTunnels.begin(); it != m_TransitTunnels.end();) {
     if (ts > it->second->GetCreationTime() + TUNNEL_EXPIRATION_TIMEOUT) {
-      auto tmp = it->second;
-      LOG(debug) << "Tunnels: transit tunnel " << tmp->GetTunnelID() << " expired"; {
-        std::unique_lock<std::mutex> l(m_TransitTunnelsMutex);
-        it = m_TransitTunnels.erase(it);
-      }
-      delete tmp;
+      // a worker still handling this tunnel keeps it alive until it's done
+      LOG(debug) << "Tunnels: transit tunnel " << it->second->GetTunnelID() << " expired";
+      it = m_TransitTunnels.erase(it);
     } else {
       it++;
     }
@@ -695,13 +746,21 @@ void Tunnels::ManageTunnelPools() {
 
 void Tunnels::PostTunnelData(
     std::shared_ptr<I2NPMessage> msg) {
-  if (msg)
-    m_Queue.Put(msg);
+  if (!msg)
+    return;
+  auto type_ID = msg->GetTypeID();
+  if ((type_ID == I2NPTunnelData || type_ID == I2NPTunnelGateway) &&
+      m_DataPlane.PostTunnelData(msg))
+    return;
+  if (!m_Queue.Put(msg))
+    LOG(warning) << "Tunnels: message queue is full, dropped message";
 }
 
 void Tunnels::PostTunnelData(
     const std::vector<std::shared_ptr<I2NPMessage> >& msgs) {
-  m_Queue.Put(msgs);
+  // only TunnelData/TunnelGateway messages are posted in bulk
+  if (!m_DataPlane.PostTunnelData(msgs) && m_Queue.PutAll(msgs) < msgs.size())
+    LOG(warning) << "Tunnels: message queue is full, dropped messages";
 }
 
 template<class TTunnel>
@@ -739,7 +798,10 @@ void Tunnels::AddOutboundTunnel(
 
 void Tunnels::AddInboundTunnel(
     std::shared_ptr<InboundTunnel> new_tunnel) {
-  m_InboundTunnels[new_tunnel->GetTunnelID()] = new_tunnel;
+  {
+    std::unique_lock<std::mutex> l(m_InboundTunnelsMutex);
+    m_InboundTunnels[new_tunnel->GetTunnelID()] = new_tunnel;
+  }
   auto pool = new_tunnel->GetTunnelPool();
   if (!pool) {
     // build symmetric outbound tunnel
@@ -50,6 +50,7 @@
 #include "core/router/tunnel/gateway.h"
 #include "core/router/tunnel/pool.h"
 #include "core/router/tunnel/transit.h"
+#include "core/router/tunnel/worker.h"
 
 #include "core/util/exception.h"
 #include "core/util/queue.h"
@@ -135,6 +136,9 @@ class Tunnel : public TunnelBase {
       std::shared_ptr<const I2NPMessage> in,
       std::shared_ptr<I2NPMessage> out);
 
+  void EncryptTunnelMsgs(
+      const std::vector<std::shared_ptr<I2NPMessage> >& msgs);
+
   std::uint32_t GetNextTunnelID() const {
     return m_Config->GetFirstHop()->GetTunnelID();
   }
@@ -204,6 +208,8 @@ class InboundTunnel
   void HandleTunnelDataMsg(
       std::shared_ptr<const I2NPMessage> msg);
 
+  void FlushTunnelDataMsgs();
+
   std::size_t GetNumReceivedBytes() const {
     return m_Endpoint.GetNumReceivedBytes();
   }
@@ -215,6 +221,7 @@ class InboundTunnel
 
  private:
   TunnelEndpoint m_Endpoint;
+  std::vector<std::shared_ptr<I2NPMessage> > m_TunnelDataMsgs;
 };
 
 
@@ -222,7 +229,16 @@ class Tunnels {
  public:
   Tunnels();
   ~Tunnels();
-  void Start();
+
+  /// @brief Starts tunnel management, the tunnel data plane and build workers
+  /// @param num_workers Number of data plane threads, 0 for one per core
+  /// @param num_build_workers Number of build request threads, 0 for one per two cores
+  /// @param max_pending_builds Build requests admitted at once, beyond this they are dropped
+  void Start(
+      std::size_t num_workers = 0,
+      std::size_t num_build_workers = 0,
+      std::size_t max_pending_builds = TunnelBuildPool::DefaultMaxPending);
+
   void Stop();
 
   std::shared_ptr<InboundTunnel> GetInboundTunnel(
@@ -242,13 +258,15 @@ class Tunnels {
     return m_ExploratoryPool;
   }
 
-  TransitTunnel* GetTransitTunnel(
+  std::shared_ptr<TransitTunnel> GetTransitTunnel(
       std::uint32_t tunnel_ID);
 
   std::uint64_t GetTransitTunnelsExpirationTimeout();
 
   void AddTransitTunnel(
-      TransitTunnel* tunnel);
+      std::shared_ptr<TransitTunnel> tunnel);
+
+  std::size_t GetNumTransitTunnels();
 
   void AddOutboundTunnel(
       std::shared_ptr<OutboundTunnel> new_tunnel);
@@ -294,12 +312,17 @@ class Tunnels {
       const std::map<std::uint32_t,
       std::shared_ptr<TTunnel> >& pending_tunnels);
 
-  void HandleTunnelGatewayMsg(
-      TunnelBase* tunnel,
-      std::shared_ptr<I2NPMessage> msg);
+  /// @brief Data plane lookup of the inbound or transit tunnel for a message
+  std::shared_ptr<TunnelBase> GetDataTunnel(
+      std::uint8_t type_ID,
+      std::uint32_t tunnel_ID);
 
   void Run();
 
+  /// @brief Build worker handler for TunnelBuild and VariableTunnelBuild requests
+  void HandleTunnelBuildRequest(
+      std::shared_ptr<I2NPMessage> msg);
+
   void ManageTunnels();
 
   void ManageOutboundTunnels();
@@ -327,14 +350,21 @@ class Tunnels {
   // by reply_msg_ID
   std::map<std::uint32_t, std::shared_ptr<OutboundTunnel> > m_PendingOutboundTunnels;
 
+  // written by the management thread only, looked up by data plane workers
+  std::mutex m_InboundTunnelsMutex;
   std::map<std::uint32_t, std::shared_ptr<InboundTunnel> > m_InboundTunnels;
   std::list<std::shared_ptr<OutboundTunnel> > m_OutboundTunnels;
   std::mutex m_TransitTunnelsMutex;
-  std::map<std::uint32_t, TransitTunnel *> m_TransitTunnels;
+  std::map<std::uint32_t, std::shared_ptr<TransitTunnel> > m_TransitTunnels;
   std::mutex m_PoolsMutex;
   std::list<std::shared_ptr<TunnelPool>> m_Pools;
   std::shared_ptr<TunnelPool> m_ExploratoryPool;
+  // tunnel build messages for the management thread
   xi2p::core::Queue<std::shared_ptr<I2NPMessage> > m_Queue;
+  // TunnelData/TunnelGateway messages, sharded by tunnel ID
+  TunnelDataPlane m_DataPlane;
+  // build requests from other routers, decrypted off the management thread
+  TunnelBuildPool m_BuildPool;
 
   // some stats
   int m_NumSuccesiveTunnelCreations,
@@ -355,7 +385,13 @@ class Tunnels {
   }
 
   int GetQueueSize() const {
-    return m_Queue.GetSize();
+    return m_Queue.GetSize() + m_DataPlane.GetQueueSize()
+           + m_BuildPool.GetNumPending();
+  }
+
+  /// @return Number of tunnel messages dropped by full queues
+  std::size_t GetNumDroppedMsgs() const {
+    return m_Queue.GetNumDropped() + m_DataPlane.GetNumDropped();
   }
 
   int GetTunnelCreationSuccessRate() const {  // in percents
@@ -100,6 +100,7 @@ void TunnelPool::DetachTunnels() {
       it->SetTunnelPool(nullptr);
     m_OutboundTunnels.clear();
   }
+  std::unique_lock<std::mutex> l(m_TestsMutex);
   m_Tests.clear();
 }
 
@@ -119,9 +120,12 @@ void TunnelPool::TunnelExpired(
     std::shared_ptr<InboundTunnel> expired_tunnel) {
   if (expired_tunnel) {
     expired_tunnel->SetTunnelPool(nullptr);
-    for (auto it : m_Tests)
-      if (it.second.second == expired_tunnel)
-        it.second.second = nullptr;
+    {
+      std::unique_lock<std::mutex> l(m_TestsMutex);
+      for (auto it : m_Tests)
+        if (it.second.second == expired_tunnel)
+          it.second.second = nullptr;
+    }
     std::unique_lock<std::mutex> l(m_InboundTunnelsMutex);
     m_InboundTunnels.erase(expired_tunnel);
   }
@@ -143,9 +147,12 @@ void TunnelPool::TunnelExpired(
     std::shared_ptr<OutboundTunnel> expired_tunnel) {
   if (expired_tunnel) {
     expired_tunnel->SetTunnelPool(nullptr);
-    for (auto it : m_Tests)
-      if (it.second.first == expired_tunnel)
-        it.second.first = nullptr;
+    {
+      std::unique_lock<std::mutex> l(m_TestsMutex);
+      for (auto it : m_Tests)
+        if (it.second.first == expired_tunnel)
+          it.second.first = nullptr;
+    }
     std::unique_lock<std::mutex> l(m_OutboundTunnelsMutex);
     m_OutboundTunnels.erase(expired_tunnel);
   }
@@ -242,6 +249,7 @@ void TunnelPool::CreateTunnels() {
 }
 
 void TunnelPool::TestTunnels() {
+  std::unique_lock<std::mutex> tests_lock(m_TestsMutex);
   for (auto it : m_Tests) {
     LOG(warning) << "TunnelPool: tunnel test " << it.first << " failed";
     // if test failed again with another tunnel we consider it failed
@@ -310,6 +318,7 @@ void TunnelPool::ProcessDeliveryStatus(
   buf += 4;
   std::uint64_t const timestamp =
       core::InputByteStream::Read<std::uint64_t>(buf);
+  std::unique_lock<std::mutex> l(m_TestsMutex);
   auto it = m_Tests.find(msg_ID);
   if (it != m_Tests.end()) {
     // restore from test failed state if any
@@ -323,6 +332,7 @@ void TunnelPool::ProcessDeliveryStatus(
       << " milliseconds";
     m_Tests.erase(it);
   } else {
+    l.unlock();
     if (m_LocalDestination)
       m_LocalDestination->ProcessDeliveryStatusMessage(msg);
     else
@@ -169,6 +169,8 @@ class TunnelPool
 
   mutable std::mutex m_OutboundTunnelsMutex;
   std::set<std::shared_ptr<OutboundTunnel>, TunnelCreationTimeCmp> m_OutboundTunnels;
+  // delivery status replies are processed by tunnel data plane workers
+  std::mutex m_TestsMutex;
   std::map<std::uint32_t, std::pair<std::shared_ptr<OutboundTunnel>, std::shared_ptr<InboundTunnel> > > m_Tests;
   bool m_IsActive;
 
@@ -75,34 +75,82 @@ void TransitTunnel::EncryptTunnelMsg(
   }
 }
 
+void TransitTunnel::EncryptTunnelMsgs(
+    const std::vector<std::shared_ptr<I2NPMessage> >& msgs) {
+  // TODO(anonimal): this try block should be handled entirely by caller
+  try {
+    static thread_local std::vector<TunnelEncryption::Job> jobs;
+    jobs.clear();
+    for (auto const& msg : msgs)
+      AddEncryptionJob(msg, jobs);
+    TunnelEncryption::EncryptBatch(jobs.data(), jobs.size());
+  } catch (...) {
+    m_Exception.Dispatch(__func__);
+    // TODO(anonimal): review if we need to safely break control, ensure exception handling by callers
+    throw;
+  }
+}
+
+std::shared_ptr<I2NPMessage> TransitTunnel::ReEncryptTunnelMsg(
+    std::shared_ptr<const I2NPMessage> tunnel_msg) {
+  // Nobody else can see the message, no need to copy it
+  if (tunnel_msg.use_count() == 1) {
+    auto msg = std::const_pointer_cast<I2NPMessage>(tunnel_msg);
+    EncryptTunnelMsg(msg, msg);
+    return msg;
+  }
+  auto new_msg = CreateEmptyTunnelDataMsg();
+  EncryptTunnelMsg(tunnel_msg, new_msg);
+  return new_msg;
+}
+
 TransitTunnelParticipant::~TransitTunnelParticipant() {}
 
 void TransitTunnelParticipant::HandleTunnelDataMsg(
     std::shared_ptr<const xi2p::core::I2NPMessage> tunnel_msg) {
-  auto new_msg = CreateEmptyTunnelDataMsg();
-  EncryptTunnelMsg(tunnel_msg, new_msg);
   m_NumTransmittedBytes += tunnel_msg->GetLength();
-  core::OutputByteStream::Write<std::uint32_t>(
-      new_msg->GetPayload(), GetNextTunnelID());
-  new_msg->FillI2NPMessageHeader(I2NPTunnelData);
-  m_TunnelDataMsgs.push_back(new_msg);
+  // Encrypted on flush, along with the rest of the burst
+  m_TunnelDataMsgs.push_back(ToWritableTunnelDataMsg(std::move(tunnel_msg)));
 }
 
 void TransitTunnelParticipant::FlushTunnelDataMsgs() {
   if (!m_TunnelDataMsgs.empty()) {
+    EncryptTunnelMsgs(m_TunnelDataMsgs);
+    FlushEncryptedTunnelDataMsgs();
+  }
+}
+
+bool TransitTunnelParticipant::AddEncryptionJobs(
+    std::vector<TunnelEncryption::Job>& jobs) {
+  for (; m_NumEncryptionJobs < m_TunnelDataMsgs.size(); m_NumEncryptionJobs++)
+    AddEncryptionJob(m_TunnelDataMsgs[m_NumEncryptionJobs], jobs);
+  return true;
+}
+
+void TransitTunnelParticipant::FlushEncryptedTunnelDataMsgs() {
+  if (!m_TunnelDataMsgs.empty()) {
+    for (auto const& msg : m_TunnelDataMsgs) {
+      core::OutputByteStream::Write<std::uint32_t>(
+          msg->GetPayload(), GetNextTunnelID());
+      msg->FillI2NPMessageHeader(I2NPTunnelData);
+    }
     auto num = m_TunnelDataMsgs.size();
     if (num > 1)
       LOG(debug)
         << "TransitTunnelParticipant: " << GetTunnelID()
         << "->" << GetNextTunnelID()
         << " " << num;
-    xi2p::core::transports.SendMessages(
-        GetNextIdentHash(),
-        m_TunnelDataMsgs);
+    SendTunnelDataMsgs(m_TunnelDataMsgs);
     m_TunnelDataMsgs.clear();
+    m_NumEncryptionJobs = 0;
   }
 }
 
+void TransitTunnelParticipant::SendTunnelDataMsgs(
+    const std::vector<std::shared_ptr<xi2p::core::I2NPMessage> >& msgs) {
+  xi2p::core::transports.SendMessages(GetNextIdentHash(), msgs);
+}
+
 void TransitTunnel::SendTunnelDataMsg(
     std::shared_ptr<xi2p::core::I2NPMessage>) {
   LOG(error)
@@ -131,13 +179,12 @@ void TransitTunnelGateway::FlushTunnelDataMsgs() {
 
 void TransitTunnelEndpoint::HandleTunnelDataMsg(
     std::shared_ptr<const xi2p::core::I2NPMessage> tunnel_msg) {
-  auto new_msg = CreateEmptyTunnelDataMsg();
-  EncryptTunnelMsg(tunnel_msg, new_msg);
+  auto new_msg = ReEncryptTunnelMsg(std::move(tunnel_msg));
   LOG(debug) << "TransitTunnelEndpoint: endpoint for " << GetTunnelID();
   m_Endpoint.HandleDecryptedTunnelDataMsg(new_msg);
 }
 
-TransitTunnel* CreateTransitTunnel(
+std::shared_ptr<TransitTunnel> CreateTransitTunnel(
     std::uint32_t receive_tunnel_ID,
     const std::uint8_t* next_ident,
     std::uint32_t next_tunnel_ID,
@@ -147,7 +194,7 @@ TransitTunnel* CreateTransitTunnel(
     bool is_endpoint) {
   if (is_endpoint) {
     LOG(debug) << "TransitTunnel: endpoint " << receive_tunnel_ID << " created";
-    return new TransitTunnelEndpoint(
+    return std::make_shared<TransitTunnelEndpoint>(
         receive_tunnel_ID,
         next_ident,
         next_tunnel_ID,
@@ -155,7 +202,7 @@ TransitTunnel* CreateTransitTunnel(
         iv_key);
   } else if (is_gateway) {
     LOG(debug) << "TransitTunnel: gateway: " << receive_tunnel_ID << " created";
-    return new TransitTunnelGateway(
+    return std::make_shared<TransitTunnelGateway>(
         receive_tunnel_ID,
         next_ident,
         next_tunnel_ID,
@@ -164,7 +211,7 @@ TransitTunnel* CreateTransitTunnel(
   } else {
     LOG(debug)
       << "TransitTunnel: " << receive_tunnel_ID << "->" << next_tunnel_ID << " created";
-    return new TransitTunnelParticipant(
+    return std::make_shared<TransitTunnelParticipant>(
         receive_tunnel_ID,
         next_ident,
         next_tunnel_ID,
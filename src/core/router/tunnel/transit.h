@@ -79,6 +79,15 @@ class TransitTunnel : public TunnelBase {
       std::shared_ptr<const I2NPMessage> in,
       std::shared_ptr<I2NPMessage> out);
 
+  void EncryptTunnelMsgs(
+      const std::vector<std::shared_ptr<I2NPMessage> >& msgs);
+
+  /// @brief Re-encrypts a received tunnel message for the next hop
+  /// @details When the caller hands over the only reference the message is
+  ///   re-encrypted in place and returned, otherwise into a new message
+  std::shared_ptr<I2NPMessage> ReEncryptTunnelMsg(
+      std::shared_ptr<const I2NPMessage> tunnel_msg);
+
   std::uint32_t GetNextTunnelID() const {
     return m_NextTunnelID;
   }
@@ -87,6 +96,15 @@ class TransitTunnel : public TunnelBase {
     return m_NextIdent;
   }
 
+ protected:
+  /// @brief Appends the in place layer encryption of msg to jobs
+  void AddEncryptionJob(
+      const std::shared_ptr<I2NPMessage>& msg,
+      std::vector<TunnelEncryption::Job>& jobs) {
+    std::uint8_t* payload = msg->GetPayload() + 4;
+    jobs.push_back({&m_Encryption, payload, payload});
+  }
+
  private:
   std::uint32_t m_TunnelID,
            m_NextTunnelID;
@@ -109,7 +127,8 @@ class TransitTunnelParticipant : public TransitTunnel {
           next_tunnel_ID,
           layer_key,
           iv_key),
-      m_NumTransmittedBytes(0) {}
+      m_NumTransmittedBytes(0),
+      m_NumEncryptionJobs(0) {}
   ~TransitTunnelParticipant();
 
   std::size_t GetNumTransmittedBytes() const {
@@ -119,11 +138,24 @@ class TransitTunnelParticipant : public TransitTunnel {
   void HandleTunnelDataMsg(
       std::shared_ptr<const xi2p::core::I2NPMessage> tunnel_msg);
 
+  /// @note Not to be mixed with AddEncryptionJobs() within a batch
   void FlushTunnelDataMsgs();
 
+  bool AddEncryptionJobs(
+      std::vector<TunnelEncryption::Job>& jobs);
+
+  void FlushEncryptedTunnelDataMsgs();
+
+ protected:
+  /// @brief Forwards a burst of re-encrypted messages to the next hop
+  virtual void SendTunnelDataMsgs(
+      const std::vector<std::shared_ptr<xi2p::core::I2NPMessage> >& msgs);
+
  private:
   std::size_t m_NumTransmittedBytes;
   std::vector<std::shared_ptr<xi2p::core::I2NPMessage> > m_TunnelDataMsgs;
+  // Pending messages already handed over to a shared batch
+  std::size_t m_NumEncryptionJobs;
 };
 
 class TransitTunnelGateway : public TransitTunnel {
@@ -183,7 +215,7 @@ class TransitTunnelEndpoint : public TransitTunnel {
   TunnelEndpoint m_Endpoint;
 };
 
-TransitTunnel* CreateTransitTunnel(
+std::shared_ptr<TransitTunnel> CreateTransitTunnel(
     std::uint32_t receive_tunnel_ID,
     const std::uint8_t* next_ident,
     std::uint32_t next_tunnel_ID,
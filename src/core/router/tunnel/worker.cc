@@ -0,0 +1,354 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#include "core/router/tunnel/worker.h"
+
+#include <algorithm>
+
+#include "core/router/net_db/impl.h"
+
+#include "core/util/byte_stream.h"
+#include "core/util/log.h"
+
+namespace xi2p {
+namespace core {
+
+TunnelDataWorker::TunnelDataWorker(
+    TunnelDataLookup lookup)
+    : m_Lookup(lookup),
+      m_IsRunning(false),
+      m_Thread(nullptr) {}
+
+TunnelDataWorker::~TunnelDataWorker() {
+  Stop();
+}
+
+void TunnelDataWorker::Start() {
+  if (m_Thread)
+    return;
+  m_IsRunning = true;
+  m_Thread =
+    std::make_unique<std::thread>(
+        std::bind(
+          &TunnelDataWorker::Run,
+          this));
+}
+
+void TunnelDataWorker::Stop() {
+  m_IsRunning = false;
+  m_Queue.WakeUp();
+  if (m_Thread) {
+    m_Thread->join();
+    m_Thread.reset(nullptr);
+  }
+}
+
+void TunnelDataWorker::PostTunnelData(
+    std::shared_ptr<I2NPMessage> msg) {
+  if (msg && !m_Queue.Put(msg))
+    LOG(debug) << "TunnelDataWorker: queue is full, dropped message";
+}
+
+void TunnelDataWorker::PostTunnelData(
+    const std::vector<std::shared_ptr<I2NPMessage> >& msgs) {
+  if (m_Queue.PutAll(msgs) < msgs.size())
+    LOG(debug) << "TunnelDataWorker: queue is full, dropped messages";
+}
+
+void TunnelDataWorker::Run() {
+  std::vector<std::shared_ptr<I2NPMessage> > msgs;
+  // Tunnels whose layer encryption is batched across the drained messages
+  std::vector<std::shared_ptr<TunnelBase> > batched;
+  std::vector<TunnelEncryption::Job> jobs;
+  auto flush = [&batched, &jobs](const std::shared_ptr<TunnelBase>& tunnel) {
+    if (tunnel->AddEncryptionJobs(jobs))
+      batched.push_back(tunnel);
+    else
+      tunnel->FlushTunnelDataMsgs();
+  };
+  while (m_IsRunning) {
+    try {
+      msgs.clear();
+      batched.clear();
+      jobs.clear();
+      if (!m_Queue.GetAllWithTimeout(msgs, 1000))  // 1 sec
+        continue;
+      std::uint32_t prev_tunnel_ID = 0;
+      std::shared_ptr<TunnelBase> prev_tunnel;
+      // Keep draining while the burst lasts so the last tunnel is
+      // flushed only once the queue runs dry
+      do {
+        for (auto& msg : msgs) {
+          std::shared_ptr<TunnelBase> tunnel;
+          std::uint8_t type_ID = msg->GetTypeID();
+          std::uint32_t tunnel_ID =
+            core::InputByteStream::Read<std::uint32_t>(msg->GetPayload());
+          if (tunnel_ID == prev_tunnel_ID)
+            tunnel = prev_tunnel;
+          else if (prev_tunnel)
+            flush(prev_tunnel);
+          if (!tunnel)
+            tunnel = m_Lookup(type_ID, tunnel_ID);
+          if (tunnel) {
+            if (type_ID == I2NPTunnelData)
+              // handing over our reference lets transit tunnels work in place
+              tunnel->HandleTunnelDataMsg(std::move(msg));
+            else  // tunnel gateway assumed
+              HandleTunnelGatewayMsg(tunnel, msg);
+          } else {
+            LOG(warning) << "TunnelDataWorker: tunnel " << tunnel_ID << " not found";
+          }
+          prev_tunnel_ID = tunnel_ID;
+          prev_tunnel = tunnel;
+        }
+        msgs.clear();
+        // One batch for all participants of the drained messages, a tunnel
+        // seen again later in them is listed twice but only sent once
+        if (prev_tunnel && prev_tunnel->AddEncryptionJobs(jobs))
+          batched.push_back(prev_tunnel);
+        if (!batched.empty()) {
+          TunnelEncryption::EncryptBatch(jobs.data(), jobs.size());
+          LOG(debug)
+            << "TunnelDataWorker: encrypted " << jobs.size()
+            << " messages of " << batched.size() << " bursts as a batch";
+          for (auto const& tunnel : batched)
+            tunnel->FlushEncryptedTunnelDataMsgs();
+          batched.clear();
+          jobs.clear();
+        }
+      }
+      while (m_Queue.GetAll(msgs));
+      if (prev_tunnel)
+        prev_tunnel->FlushTunnelDataMsgs();
+    } catch (const std::exception& ex) {
+      LOG(error) << "TunnelDataWorker: " << __func__ << " exception: " << ex.what();
+    }
+  }
+}
+
+void TunnelDataWorker::HandleTunnelGatewayMsg(
+    std::shared_ptr<TunnelBase> tunnel,
+    std::shared_ptr<I2NPMessage> msg) {
+  const std::uint8_t* payload = msg->GetPayload();
+  std::uint16_t const len = core::InputByteStream::Read<std::uint16_t>(
+      payload + TUNNEL_GATEWAY_HEADER_LENGTH_OFFSET);
+  // we make payload as new I2NP message to send
+  msg->offset += I2NP_HEADER_SIZE + TUNNEL_GATEWAY_HEADER_SIZE;
+  msg->len = msg->offset + len;
+  // as sent by the tunnel's creator, checksum included
+  msg->is_chks_updated = true;
+  auto type_ID = msg->GetTypeID();
+  LOG(debug)
+    << "TunnelDataWorker: TunnelGateway of " << len
+    << " bytes for tunnel " << tunnel->GetTunnelID()
+    << ". Msg type " << static_cast<int>(type_ID);
+  if (type_ID == I2NPDatabaseStore || type_ID == I2NPDatabaseSearchReply)
+    // transit DatabaseStore my contain new/updated RI
+    // or DatabaseSearchReply with new routers
+    xi2p::core::netdb.PostI2NPMsg(msg);
+  tunnel->SendTunnelDataMsg(msg);
+}
+
+TunnelDataPlane::TunnelDataPlane(
+    TunnelDataLookup lookup)
+    : m_Lookup(lookup),
+      m_NumWorkers(0) {}
+
+TunnelDataPlane::~TunnelDataPlane() {
+  Stop();
+}
+
+void TunnelDataPlane::Start(
+    std::size_t num_workers) {
+  if (m_Workers.empty()) {
+    if (!num_workers)
+      num_workers = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t i = 0; i < num_workers; i++)
+      m_Workers.push_back(std::make_unique<TunnelDataWorker>(m_Lookup));
+  }
+  for (auto& worker : m_Workers)
+    worker->Start();
+  LOG(debug) << "TunnelDataPlane: started " << m_Workers.size() << " workers";
+  m_NumWorkers = m_Workers.size();
+}
+
+void TunnelDataPlane::Stop() {
+  m_NumWorkers = 0;
+  for (auto& worker : m_Workers)
+    worker->Stop();
+}
+
+bool TunnelDataPlane::PostTunnelData(
+    std::shared_ptr<I2NPMessage> msg) {
+  std::size_t const num_workers = m_NumWorkers;
+  if (!num_workers)
+    return false;
+  if (msg)
+    m_Workers[GetWorkerIndex(*msg, num_workers)]->PostTunnelData(msg);
+  return true;
+}
+
+bool TunnelDataPlane::PostTunnelData(
+    const std::vector<std::shared_ptr<I2NPMessage> >& msgs) {
+  std::size_t const num_workers = m_NumWorkers;
+  if (!num_workers)
+    return false;
+  if (num_workers == 1) {
+    m_Workers.front()->PostTunnelData(msgs);
+    return true;
+  }
+  // Split by shard so that each worker queue is locked once per batch
+  std::vector<std::vector<std::shared_ptr<I2NPMessage> > > shards(num_workers);
+  for (auto const& msg : msgs)
+    if (msg)
+      shards[GetWorkerIndex(*msg, num_workers)].push_back(msg);
+  for (std::size_t i = 0; i < num_workers; i++)
+    m_Workers[i]->PostTunnelData(shards[i]);
+  return true;
+}
+
+int TunnelDataPlane::GetQueueSize() const {
+  int size = 0;
+  for (std::size_t i = 0; i < m_NumWorkers; i++)
+    size += m_Workers[i]->GetQueueSize();
+  return size;
+}
+
+std::size_t TunnelDataPlane::GetNumDropped() const {
+  std::size_t dropped = 0;
+  for (std::size_t i = 0; i < m_NumWorkers; i++)
+    dropped += m_Workers[i]->GetNumDropped();
+  return dropped;
+}
+
+std::size_t TunnelDataPlane::GetWorkerIndex(
+    const I2NPMessage& msg,
+    std::size_t num_workers) const {
+  // Tunnel IDs are random so they spread evenly across workers
+  return core::InputByteStream::Read<std::uint32_t>(msg.GetPayload())
+         % num_workers;
+}
+
+TunnelBuildPool::TunnelBuildPool(
+    TunnelBuildHandler handler)
+    : m_Handler(handler),
+      m_IsRunning(false),
+      m_NumWorkers(0),
+      m_MaxPending(DefaultMaxPending),
+      m_NumPending(0),
+      m_NextWorker(0),
+      m_NumRejected(0) {}
+
+TunnelBuildPool::~TunnelBuildPool() {
+  Stop();
+}
+
+void TunnelBuildPool::Start(
+    std::size_t num_workers,
+    std::size_t max_pending) {
+  if (m_IsRunning)
+    return;
+  m_MaxPending = std::max<std::size_t>(1, max_pending);
+  if (m_Workers.empty()) {
+    if (!num_workers)
+      num_workers = std::max(1u, std::thread::hardware_concurrency() / 2);
+    // Admission keeps worker queues from ever filling up
+    for (std::size_t i = 0; i < num_workers; i++)
+      m_Workers.push_back(std::make_unique<Worker>(m_MaxPending));
+  }
+  m_IsRunning = true;
+  for (auto& worker : m_Workers)
+    worker->thread =
+      std::make_unique<std::thread>(
+          std::bind(
+            &TunnelBuildPool::Run,
+            this,
+            std::ref(*worker)));
+  LOG(debug)
+    << "TunnelBuildPool: started " << m_Workers.size()
+    << " workers, admitting " << m_MaxPending << " requests";
+  m_NumWorkers = m_Workers.size();
+}
+
+void TunnelBuildPool::Stop() {
+  m_NumWorkers = 0;
+  m_IsRunning = false;
+  for (auto& worker : m_Workers) {
+    worker->queue.WakeUp();
+    if (worker->thread) {
+      worker->thread->join();
+      worker->thread.reset(nullptr);
+    }
+    // Workers are joined, this thread is now the only consumer
+    while (worker->queue.Get())
+      m_NumPending--;
+  }
+}
+
+bool TunnelBuildPool::PostBuildRequest(
+    std::shared_ptr<I2NPMessage> msg) {
+  std::size_t const num_workers = m_NumWorkers;
+  if (!num_workers || !msg)
+    return false;
+  // Cheap rejection: nothing is decrypted before a request is admitted
+  if (m_NumPending.fetch_add(1) >= m_MaxPending) {
+    m_NumPending--;
+    m_NumRejected++;
+    return false;
+  }
+  // ElGamal decryption takes about the same time for every request
+  if (!m_Workers[m_NextWorker++ % num_workers]->queue.Put(msg)) {
+    m_NumPending--;
+    m_NumRejected++;
+    return false;
+  }
+  return true;
+}
+
+void TunnelBuildPool::Run(
+    Worker& worker) {
+  std::vector<std::shared_ptr<I2NPMessage> > msgs;
+  while (m_IsRunning) {
+    msgs.clear();
+    if (!worker.queue.GetAllWithTimeout(msgs, 1000))  // 1 sec
+      continue;
+    for (auto& msg : msgs) {
+      try {
+        m_Handler(std::move(msg));
+      } catch (const std::exception& ex) {
+        LOG(error) << "TunnelBuildPool: " << __func__ << " exception: " << ex.what();
+      }
+      m_NumPending--;
+    }
+  }
+}
+
+}  // namespace core
+}  // namespace xi2p
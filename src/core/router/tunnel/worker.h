@@ -0,0 +1,227 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#ifndef SRC_CORE_ROUTER_TUNNEL_WORKER_H_
+#define SRC_CORE_ROUTER_TUNNEL_WORKER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "core/router/i2np.h"
+#include "core/router/tunnel/base.h"
+
+#include "core/util/queue.h"
+
+namespace xi2p {
+namespace core {
+
+/// @brief Finds the tunnel which handles a TunnelData/TunnelGateway message
+/// @param type_ID I2NP message type
+/// @param tunnel_ID Tunnel ID as read from the message payload
+typedef std::function<std::shared_ptr<TunnelBase>(
+    std::uint8_t type_ID,
+    std::uint32_t tunnel_ID)> TunnelDataLookup;
+
+/// @class TunnelDataWorker
+/// @brief Drains TunnelData/TunnelGateway messages for one shard of tunnel IDs
+/// @details Consecutive messages for the same tunnel are handled as a burst
+///   and flushed together, as the single tunnel thread used to do
+class TunnelDataWorker {
+ public:
+  explicit TunnelDataWorker(
+      TunnelDataLookup lookup);
+
+  ~TunnelDataWorker();
+
+  void Start();
+
+  void Stop();
+
+  void PostTunnelData(
+      std::shared_ptr<I2NPMessage> msg);
+
+  void PostTunnelData(
+      const std::vector<std::shared_ptr<I2NPMessage> >& msgs);
+
+  int GetQueueSize() const {
+    return m_Queue.GetSize();
+  }
+
+  /// @return Number of messages dropped because the queue was full
+  std::size_t GetNumDropped() const {
+    return m_Queue.GetNumDropped();
+  }
+
+ private:
+  void Run();
+
+  void HandleTunnelGatewayMsg(
+      std::shared_ptr<TunnelBase> tunnel,
+      std::shared_ptr<I2NPMessage> msg);
+
+ private:
+  TunnelDataLookup m_Lookup;
+  std::atomic<bool> m_IsRunning;
+  std::unique_ptr<std::thread> m_Thread;
+  xi2p::core::Queue<std::shared_ptr<I2NPMessage> > m_Queue;
+};
+
+/// @class TunnelDataPlane
+/// @brief Shards tunnel messages by tunnel ID across a set of workers
+/// @details A tunnel is always handled by the same worker, so per-tunnel
+///   message ordering is preserved while distinct tunnels run in parallel
+/// @note Workers are only created once and live as long as the data plane.
+///   Stop() only stops them, so that a thread posting concurrently with
+///   Stop() still finds a valid worker, whose message is then not handled.
+class TunnelDataPlane {
+ public:
+  explicit TunnelDataPlane(
+      TunnelDataLookup lookup);
+
+  ~TunnelDataPlane();
+
+  /// @brief Starts workers
+  /// @param num_workers Number of worker threads, 0 for one per core
+  /// @note Number of workers is fixed by the first start
+  void Start(
+      std::size_t num_workers = 0);
+
+  void Stop();
+
+  /// @return False if data plane isn't running and message was not taken
+  bool PostTunnelData(
+      std::shared_ptr<I2NPMessage> msg);
+
+  /// @return False if data plane isn't running and messages were not taken
+  bool PostTunnelData(
+      const std::vector<std::shared_ptr<I2NPMessage> >& msgs);
+
+  std::size_t GetNumWorkers() const {
+    return m_NumWorkers;
+  }
+
+  int GetQueueSize() const;
+
+  /// @return Number of messages dropped by full worker queues
+  std::size_t GetNumDropped() const;
+
+ private:
+  std::size_t GetWorkerIndex(
+      const I2NPMessage& msg,
+      std::size_t num_workers) const;
+
+ private:
+  TunnelDataLookup m_Lookup;
+  // Set only after workers are created and started, read by posting threads
+  std::atomic<std::size_t> m_NumWorkers;
+  std::vector<std::unique_ptr<TunnelDataWorker> > m_Workers;
+};
+
+/// @brief Handles a tunnel build request on a build worker
+typedef std::function<void(std::shared_ptr<I2NPMessage>)> TunnelBuildHandler;
+
+/// @class TunnelBuildPool
+/// @brief Handles tunnel build requests, which cost an ElGamal decryption
+///   each, on dedicated workers so bursts don't stall tunnel management
+/// @details Admission is bounded: once the limit of queued or running
+///   requests is reached new requests are dropped without being decrypted.
+///   The requester can't tell a drop from a lost reply and builds elsewhere.
+/// @note Workers live as long as the pool, as those of TunnelDataPlane do
+class TunnelBuildPool {
+ public:
+  /// @brief Default number of requests admitted at once
+  static const std::size_t DefaultMaxPending = 64;
+
+  explicit TunnelBuildPool(
+      TunnelBuildHandler handler);
+
+  ~TunnelBuildPool();
+
+  /// @brief Starts workers
+  /// @param num_workers Number of worker threads, 0 for one per two cores
+  /// @param max_pending Requests admitted at once, queued or being handled
+  /// @note Number of workers is fixed by the first start
+  void Start(
+      std::size_t num_workers = 0,
+      std::size_t max_pending = DefaultMaxPending);
+
+  /// @brief Stops workers, queued requests are dropped
+  void Stop();
+
+  /// @return False if the request was not admitted
+  bool PostBuildRequest(
+      std::shared_ptr<I2NPMessage> msg);
+
+  std::size_t GetNumWorkers() const {
+    return m_NumWorkers;
+  }
+
+  /// @return Number of requests queued or being handled
+  std::size_t GetNumPending() const {
+    return m_NumPending;
+  }
+
+  /// @return Number of requests dropped by admission since construction
+  std::uint64_t GetNumRejected() const {
+    return m_NumRejected;
+  }
+
+ private:
+  struct Worker {
+    explicit Worker(
+        std::size_t capacity)
+        : queue(capacity) {}
+
+    std::unique_ptr<std::thread> thread;
+    xi2p::core::Queue<std::shared_ptr<I2NPMessage> > queue;
+  };
+
+  void Run(
+      Worker& worker);
+
+ private:
+  TunnelBuildHandler m_Handler;
+  std::atomic<bool> m_IsRunning;
+  // Set only after workers are created and started, read by posting threads
+  std::atomic<std::size_t> m_NumWorkers;
+  std::vector<std::unique_ptr<Worker> > m_Workers;
+  std::atomic<std::size_t> m_MaxPending, m_NumPending, m_NextWorker;
+  std::atomic<std::uint64_t> m_NumRejected;
+};
+
+}  // namespace core
+}  // namespace xi2p
+
+#endif  // SRC_CORE_ROUTER_TUNNEL_WORKER_H_
@@ -0,0 +1,212 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#include "core/util/bloom_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "core/crypto/rand.h"
+#include "core/util/timestamp.h"
+
+namespace xi2p {
+namespace core {
+
+namespace {
+
+inline std::uint64_t RotateLeft(std::uint64_t x, int b) {
+  return (x << b) | (x >> (64 - b));
+}
+
+inline void SipRound(std::array<std::uint64_t, 4>& v) {
+  v[0] += v[1]; v[1] = RotateLeft(v[1], 13); v[1] ^= v[0];
+  v[0] = RotateLeft(v[0], 32);
+  v[2] += v[3]; v[3] = RotateLeft(v[3], 16); v[3] ^= v[2];
+  v[0] += v[3]; v[3] = RotateLeft(v[3], 21); v[3] ^= v[0];
+  v[2] += v[1]; v[1] = RotateLeft(v[1], 17); v[1] ^= v[2];
+  v[2] = RotateLeft(v[2], 32);
+}
+
+/// @brief SipHash-2-4 of data
+std::uint64_t SipHash(
+    const std::array<std::uint64_t, 2>& key,
+    const std::uint8_t* buf,
+    std::size_t len) {
+  std::array<std::uint64_t, 4> v {{
+      key[0] ^ 0x736F6D6570736575ULL,
+      key[1] ^ 0x646F72616E646F6DULL,
+      key[0] ^ 0x6C7967656E657261ULL,
+      key[1] ^ 0x7465646279746573ULL }};
+  std::size_t const blocks = len / 8;
+  for (std::size_t i = 0; i < blocks; i++) {
+    std::uint64_t m = 0;
+    for (std::size_t j = 0; j < 8; j++)
+      m |= static_cast<std::uint64_t>(buf[i * 8 + j]) << (8 * j);
+    v[3] ^= m;
+    SipRound(v);
+    SipRound(v);
+    v[0] ^= m;
+  }
+  std::uint64_t last = static_cast<std::uint64_t>(len & 0xFF) << 56;
+  for (std::size_t j = 0; j < len % 8; j++)
+    last |= static_cast<std::uint64_t>(buf[blocks * 8 + j]) << (8 * j);
+  v[3] ^= last;
+  SipRound(v);
+  SipRound(v);
+  v[0] ^= last;
+  v[2] ^= 0xFF;
+  for (int i = 0; i < 4; i++)
+    SipRound(v);
+  return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+}  // namespace
+
+RotatingBloomFilter::RotatingBloomFilter(
+    std::size_t capacity,
+    double false_positive,
+    std::uint32_t lifetime)
+    : m_Capacity(std::max<std::size_t>(capacity, 1)),
+      m_Lifetime(lifetime),
+      m_Current(0),
+      m_RotationTime(GetSecondsSinceEpoch()) {
+  // A lookup tests both generations, so each gets half of the rate
+  double const rate = std::min(std::max(false_positive, 1e-12), 0.5) / 2;
+  double const ln2 = std::log(2.0);
+  double const bits =
+      std::ceil(-static_cast<double>(m_Capacity) * std::log(rate) / (ln2 * ln2));
+  m_NumBits = (static_cast<std::size_t>(bits) + 63) / 64 * 64;
+  m_NumHashes = std::min<std::size_t>(
+      std::max<std::size_t>(
+          std::lround(static_cast<double>(m_NumBits) / m_Capacity * ln2), 1),
+      32);
+  for (auto& generation : m_Generations) {
+    generation.bits.assign(m_NumBits / 64, 0);
+    generation.size = 0;
+  }
+  RandBytes(
+      reinterpret_cast<std::uint8_t*>(m_HashKey.data()),
+      sizeof(m_HashKey));
+}
+
+RotatingBloomFilter::~RotatingBloomFilter() {}
+
+bool RotatingBloomFilter::CheckAndAdd(
+    const std::uint8_t* buf,
+    std::size_t len,
+    std::uint64_t ts) {
+  std::uint64_t const hash = GetHash(buf, len);
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  Generation& current = m_Generations[m_Current];
+  if (Test(current, hash) || Test(m_Generations[m_Current ^ 1], hash))
+    return true;
+  // A clock moved backwards rotates too, rather than keeping entries longer
+  if (current.size >= m_Capacity
+      || ts < m_RotationTime
+      || ts - m_RotationTime >= m_Lifetime)
+    Rotate(ts);
+  Set(m_Generations[m_Current], hash);
+  return false;
+}
+
+bool RotatingBloomFilter::CheckAndAdd(
+    const std::uint8_t* buf,
+    std::size_t len) {
+  return CheckAndAdd(buf, len, GetSecondsSinceEpoch());
+}
+
+bool RotatingBloomFilter::Contains(
+    const std::uint8_t* buf,
+    std::size_t len) const {
+  std::uint64_t const hash = GetHash(buf, len);
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return Test(m_Generations[0], hash) || Test(m_Generations[1], hash);
+}
+
+void RotatingBloomFilter::Clear() {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  for (auto& generation : m_Generations) {
+    std::fill(generation.bits.begin(), generation.bits.end(), 0);
+    generation.size = 0;
+  }
+}
+
+std::size_t RotatingBloomFilter::GetSize() const {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Generations[m_Current].size;
+}
+
+std::uint64_t RotatingBloomFilter::GetHash(
+    const std::uint8_t* buf,
+    std::size_t len) const {
+  return SipHash(m_HashKey, buf, len);
+}
+
+// Enhanced double hashing: the k indexes follow from the two halves of one
+// hash, with a growing step so that they do not repeat when h2 is 0
+bool RotatingBloomFilter::Test(
+    const Generation& generation,
+    std::uint64_t hash) const {
+  std::uint64_t index = hash % m_NumBits;
+  std::uint64_t step = (hash >> 32) % m_NumBits;
+  for (std::size_t i = 0; i < m_NumHashes; i++) {
+    if (!(generation.bits[index / 64] & (1ULL << (index % 64))))
+      return false;
+    index = (index + step) % m_NumBits;
+    step = (step + i + 1) % m_NumBits;
+  }
+  return true;
+}
+
+void RotatingBloomFilter::Set(
+    Generation& generation,
+    std::uint64_t hash) {
+  std::uint64_t index = hash % m_NumBits;
+  std::uint64_t step = (hash >> 32) % m_NumBits;
+  for (std::size_t i = 0; i < m_NumHashes; i++) {
+    generation.bits[index / 64] |= 1ULL << (index % 64);
+    index = (index + step) % m_NumBits;
+    step = (step + i + 1) % m_NumBits;
+  }
+  generation.size++;
+}
+
+void RotatingBloomFilter::Rotate(
+    std::uint64_t ts) {
+  m_Current ^= 1;
+  Generation& current = m_Generations[m_Current];
+  std::fill(current.bits.begin(), current.bits.end(), 0);
+  current.size = 0;
+  m_RotationTime = ts;
+}
+
+}  // namespace core
+}  // namespace xi2p
@@ -0,0 +1,140 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#ifndef SRC_CORE_UTIL_BLOOM_FILTER_H_
+#define SRC_CORE_UTIL_BLOOM_FILTER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace xi2p {
+namespace core {
+
+/// @class RotatingBloomFilter
+/// @brief Probabilistic set of recently seen data, for duplicate and replay
+///   detection with bounded memory
+/// @details Entries are added to the current of two generations of Bloom
+///   filter bits. Once it holds its capacity or reaches its lifetime, the
+///   current generation becomes the previous one and the oldest is cleared,
+///   so that an entry is remembered for at least one lifetime (unless more
+///   than capacity entries are added meanwhile) and at most two. Lookups
+///   test both generations, each sized for half of the false positive rate.
+///   Bits are indexed by a keyed hash so that peers cannot pick data which
+///   collide. A false positive reports unseen data as seen, never the
+///   opposite.
+/// @note Thread-safe
+class RotatingBloomFilter {
+ public:
+  /// @param capacity Entries held by a generation before it is rotated
+  /// @param false_positive Highest false positive rate of a lookup
+  /// @param lifetime Seconds after which a generation is rotated
+  RotatingBloomFilter(
+      std::size_t capacity,
+      double false_positive,
+      std::uint32_t lifetime);
+
+  ~RotatingBloomFilter();
+
+  /// @brief Adds data unless it was already added
+  /// @param buf Data
+  /// @param len Length of data
+  /// @param ts Current time in seconds
+  /// @return True if the data was (probably) added before
+  bool CheckAndAdd(
+      const std::uint8_t* buf,
+      std::size_t len,
+      std::uint64_t ts);
+
+  /// @brief Adds data unless it was already added, at the current time
+  bool CheckAndAdd(
+      const std::uint8_t* buf,
+      std::size_t len);
+
+  /// @return True if the data was (probably) added before
+  bool Contains(
+      const std::uint8_t* buf,
+      std::size_t len) const;
+
+  /// @brief Forgets all entries
+  void Clear();
+
+  /// @return Bits of a generation
+  std::size_t GetNumBits() const {
+    return m_NumBits;
+  }
+
+  /// @return Bits set for each entry
+  std::size_t GetNumHashes() const {
+    return m_NumHashes;
+  }
+
+  /// @return Entries added to the current generation
+  std::size_t GetSize() const;
+
+ private:
+  struct Generation {
+    std::vector<std::uint64_t> bits;
+    std::size_t size;
+  };
+
+  /// @brief Keyed hash of data, giving the first index and the step between
+  ///   the indexes of its bits
+  std::uint64_t GetHash(
+      const std::uint8_t* buf,
+      std::size_t len) const;
+
+  bool Test(
+      const Generation& generation,
+      std::uint64_t hash) const;
+
+  void Set(
+      Generation& generation,
+      std::uint64_t hash);
+
+  void Rotate(
+      std::uint64_t ts);
+
+ private:
+  std::size_t m_Capacity, m_NumBits, m_NumHashes;
+  std::uint32_t m_Lifetime;
+  std::array<std::uint64_t, 2> m_HashKey;
+  mutable std::mutex m_Mutex;
+  std::array<Generation, 2> m_Generations;
+  std::size_t m_Current;
+  std::uint64_t m_RotationTime;
+};
+
+}  // namespace core
+}  // namespace xi2p
+
+#endif  // SRC_CORE_UTIL_BLOOM_FILTER_H_
@@ -130,7 +130,15 @@ void Configuration::ParseConfig()
       "enable-https",
       bpo::value<bool>()->default_value(true)->value_name("bool"))(
       "enable-su3-verification",
-      bpo::value<bool>()->default_value(true)->value_name("bool"));
+      bpo::value<bool>()->default_value(true)->value_name("bool"))(
+      // 0 = one worker per core
+      "tunnel-workers",
+      bpo::value<std::uint16_t>()->default_value(0))(
+      // 0 = one worker per two cores
+      "tunnel-build-workers",
+      bpo::value<std::uint16_t>()->default_value(0))(
+      "tunnel-build-queue",
+      bpo::value<std::uint16_t>()->default_value(64));
 
   bpo::options_description client("\nclient");
   client.add_options()("httpproxyport", bpo::value<int>()->default_value(4446))(
@@ -0,0 +1,295 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#ifndef SRC_CORE_UTIL_MEMORY_POOL_H_
+#define SRC_CORE_UTIL_MEMORY_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+namespace xi2p {
+namespace core {
+
+/// @struct PoolStats
+/// @brief Counters of a block pool
+struct PoolStats {
+  std::uint64_t hits = 0;    ///< Allocations served from a free list
+  std::uint64_t misses = 0;  ///< Allocations that fell back to the heap
+};
+
+/// @struct PoolCounters
+/// @brief Counters shared by all pools of a tag
+template<typename Tag>
+struct PoolCounters {
+  static std::atomic<std::uint64_t> hits, misses;
+};
+
+template<typename Tag>
+std::atomic<std::uint64_t> PoolCounters<Tag>::hits{0};
+
+template<typename Tag>
+std::atomic<std::uint64_t> PoolCounters<Tag>::misses{0};
+
+/// @return Counters published so far by all threads for pools of a tag
+template<typename Tag>
+PoolStats GetPoolStats() {
+  PoolStats stats;
+  stats.hits = PoolCounters<Tag>::hits.load(std::memory_order_relaxed);
+  stats.misses = PoolCounters<Tag>::misses.load(std::memory_order_relaxed);
+  return stats;
+}
+
+/// @class BlockPool
+/// @brief Free-list pool of fixed size blocks
+/// @details Each thread keeps its own free list and only touches the shared
+///   depot, a batch at a time, when its list runs empty or overflows. Blocks
+///   freed on another thread than the one which allocated them (e.g. a
+///   message received by a transport and forwarded by a tunnel worker) flow
+///   back to the allocating thread through the depot. Free lists are linked
+///   through the free blocks themselves so that recycling never allocates.
+///   Blocks may be freed during shutdown, by static objects or by threads
+///   outliving main(): the depot is therefore never destroyed, and blocks go
+///   straight to the heap once the thread's own cache is gone.
+/// @tparam BlockSize Size of the blocks in bytes
+/// @tparam Tag Type the counters are accounted to, see GetPoolStats
+template<std::size_t BlockSize, typename Tag = void>
+class BlockPool {
+  /// @brief Header written into a free block
+  struct Node {
+    Node* next;        ///< Next block of the same batch
+    Node* next_batch;  ///< Next batch in the depot, valid on the first block
+    std::size_t size;  ///< Number of blocks in the batch, valid on the first block
+  };
+
+  static constexpr std::size_t AllocSize =
+    BlockSize > sizeof(Node) ? BlockSize : sizeof(Node);
+  /// @brief Bytes each thread keeps in its own free list
+  static constexpr std::size_t CacheBytes = 256 * 1024;
+  /// @brief Bytes kept in the shared depot, the rest goes back to the heap
+  static constexpr std::size_t DepotBytes = 4 * 1024 * 1024;
+  static constexpr std::size_t CacheBlocks =
+    CacheBytes / AllocSize > 4 ? CacheBytes / AllocSize : 4;
+  static constexpr std::size_t BatchBlocks = CacheBlocks / 2;
+  static constexpr std::size_t DepotBatches =
+    DepotBytes / (BatchBlocks * AllocSize) > 1 ?
+      DepotBytes / (BatchBlocks * AllocSize) : 1;
+  /// @brief Thread-local counts are published every that many allocations
+  static constexpr std::uint64_t StatsInterval = 1024;
+
+ public:
+  static void* Allocate() {
+    Cache* const cached = GetCache();
+    if (!cached)
+      return ::operator new(AllocSize);
+    Cache& cache = *cached;
+    if (!cache.head)
+      cache.head = GetDepot().Take(cache.size);
+    if (!cache.head) {
+      cache.Count(false);
+      return ::operator new(AllocSize);
+    }
+    Node* node = cache.head;
+    cache.head = node->next;
+    cache.size--;
+    cache.Count(true);
+    return node;
+  }
+
+  static void Deallocate(
+      void* block) {
+    Cache* const cached = GetCache();
+    if (!cached) {
+      ::operator delete(block);
+      return;
+    }
+    Cache& cache = *cached;
+    Node* node = static_cast<Node*>(block);
+    node->next = cache.head;
+    cache.head = node;
+    if (++cache.size > CacheBlocks) {
+      // Hand the most recently freed half over to the depot
+      Node* last = cache.head;
+      for (std::size_t i = 1; i < BatchBlocks; i++)
+        last = last->next;
+      Node* batch = cache.head;
+      cache.head = last->next;
+      cache.size -= BatchBlocks;
+      last->next = nullptr;
+      batch->size = BatchBlocks;
+      GetDepot().Give(batch);
+    }
+  }
+
+ private:
+  static void Free(
+      Node* node) {
+    while (node) {
+      Node* next = node->next;
+      ::operator delete(node);
+      node = next;
+    }
+  }
+
+  struct Depot {
+    std::mutex mutex;
+    Node* batches = nullptr;
+    std::size_t num_batches = 0;
+
+    /// @return First block of a batch or nullptr if the depot is empty
+    Node* Take(
+        std::size_t& size) {
+      std::unique_lock<std::mutex> l(mutex);
+      Node* batch = batches;
+      if (batch) {
+        batches = batch->next_batch;
+        num_batches--;
+        size = batch->size;
+      }
+      return batch;
+    }
+
+    /// @param batch First block of a batch with its size set
+    void Give(
+        Node* batch) {
+      {
+        std::unique_lock<std::mutex> l(mutex);
+        if (num_batches < DepotBatches) {
+          batch->next_batch = batches;
+          batches = batch;
+          num_batches++;
+          return;
+        }
+      }
+      Free(batch);
+    }
+  };
+
+  struct Cache {
+    Node* head = nullptr;
+    std::size_t size = 0;
+    std::uint64_t hits = 0, misses = 0;
+
+    ~Cache() {
+      Publish();
+      if (head) {
+        head->size = size;
+        GetDepot().Give(head);
+      }
+      IsCacheDestroyed() = true;
+    }
+
+    void Count(
+        bool hit) {
+      (hit ? hits : misses)++;
+      if (hits + misses >= StatsInterval)
+        Publish();
+    }
+
+    void Publish() {
+      PoolCounters<Tag>::hits.fetch_add(hits, std::memory_order_relaxed);
+      PoolCounters<Tag>::misses.fetch_add(misses, std::memory_order_relaxed);
+      hits = misses = 0;
+    }
+  };
+
+  static Depot& GetDepot() {
+    static Depot& depot = *new Depot;  // leaked on purpose, see class details
+    return depot;
+  }
+
+  /// @note Trivially destructible, so still valid after the cache is gone
+  static bool& IsCacheDestroyed() {
+    thread_local bool destroyed = false;
+    return destroyed;
+  }
+
+  /// @return Free list of the calling thread, nullptr once it was destroyed
+  static Cache* GetCache() {
+    if (IsCacheDestroyed())
+      return nullptr;
+    thread_local Cache cache;
+    return &cache;
+  }
+};
+
+/// @class PoolAllocator
+/// @brief Standard allocator backed by BlockPool for single objects
+/// @details Meant for std::allocate_shared and shared_ptr control blocks.
+///   Rebinding keeps the tag so that the counters of the blocks actually
+///   allocated end up with the tag, arrays go straight to the heap.
+template<typename T, typename Tag = T>
+class PoolAllocator {
+ public:
+  typedef T value_type;
+
+  PoolAllocator() = default;
+
+  template<typename U>
+  PoolAllocator(const PoolAllocator<U, Tag>&) {}
+
+  template<typename U>
+  struct rebind {
+    typedef PoolAllocator<U, Tag> other;
+  };
+
+  T* allocate(
+      std::size_t n) {
+    if (n == 1)
+      return static_cast<T*>(BlockPool<sizeof(T), Tag>::Allocate());
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(
+      T* p,
+      std::size_t n) {
+    if (n == 1)
+      BlockPool<sizeof(T), Tag>::Deallocate(p);
+    else
+      ::operator delete(p);
+  }
+
+  template<typename U>
+  bool operator==(const PoolAllocator<U, Tag>&) const {
+    return true;
+  }
+
+  template<typename U>
+  bool operator!=(const PoolAllocator<U, Tag>&) const {
+    return false;
+  }
+};
+
+}  // namespace core
+}  // namespace xi2p
+
+#endif  // SRC_CORE_UTIL_MEMORY_POOL_H_
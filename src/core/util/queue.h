@@ -33,113 +33,333 @@
 #ifndef SRC_CORE_UTIL_QUEUE_H_
 #define SRC_CORE_UTIL_QUEUE_H_
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
 #include <functional>
+#include <limits>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <utility>
 #include <vector>
 
 namespace xi2p {
 namespace core {
 
+/// @class Queue
+/// @brief Bounded lock-free multi-producer/single-consumer queue
+/// @details Producers claim slots with a CAS on the enqueue position and
+///   publish each slot through its sequence number; the consumer owns the
+///   dequeue position. The consumer only sleeps on the condition variable
+///   once the queue is empty and it has announced itself as waiting, so
+///   producers take the mutex only to wake a sleeping consumer.
+/// @note Get*, Peek and Wait* must only be called from a single thread
 template<typename Element>
 class Queue {
  public:
-  void Put(
+  /// @brief Default number of slots
+  static constexpr std::size_t DefaultCapacity = 1 << 16;
+
+  /// @param capacity Number of slots, rounded up to a power of two
+  explicit Queue(
+      std::size_t capacity = DefaultCapacity)
+      : m_Mask(RoundUpPowerOfTwo(capacity) - 1),
+        m_Cells(std::make_unique<Cell[]>(m_Mask + 1)),
+        m_EnqueuePos(0),
+        m_NumDropped(0),
+        m_DequeuePos(0),
+        m_IsWaiting(false),
+        m_IsWokenUp(false) {
+    for (std::size_t i = 0; i <= m_Mask; i++)
+      m_Cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  Queue(const Queue&) = delete;
+  Queue& operator=(const Queue&) = delete;
+
+  /// @brief Adds an element, safe to call from any thread
+  /// @return False if the queue is full and the element was dropped
+  /// @note A dropped element is left to the caller, who must release it
+  ///   when it is an owning pointer, as with MsgQueue
+  bool Put(
       Element e) {
-    std::unique_lock<std::mutex> l(m_QueueMutex);
-    m_Queue.push(e);
-    m_NonEmpty.notify_one();
+    std::size_t pos;
+    if (!Claim(1, pos)) {
+      m_NumDropped++;
+      return false;
+    }
+    Publish(pos, std::move(e));
+    Notify();
+    return true;
   }
-  void Put(
+
+  /// @brief Adds elements with a single claim and a single wakeup
+  /// @return Number of elements added, the remaining ones were dropped
+  std::size_t PutAll(
       const std::vector<Element>& vec) {
-    if (!vec.empty()) {
-      std::unique_lock<std::mutex> l(m_QueueMutex);
-      for (auto it : vec)
-        m_Queue.push(it);
-      m_NonEmpty.notify_one();
+    if (vec.empty())
+      return 0;
+    std::size_t pos;
+    std::size_t const count = Claim(vec.size(), pos);
+    for (std::size_t i = 0; i < count; i++)
+      Publish(pos + i, vec[i]);
+    if (count < vec.size())
+      m_NumDropped += vec.size() - count;
+    if (count)
+      Notify();
+    return count;
+  }
+
+  std::size_t Put(
+      const std::vector<Element>& vec) {
+    return PutAll(vec);
+  }
+
+  /// @return Next element or a default constructed one if empty
+  Element Get() {
+    Element e = Element();
+    Dequeue(e);
+    return e;
+  }
+
+  /// @brief Moves up to max elements to the end of out
+  /// @return Number of elements moved
+  std::size_t GetAll(
+      std::vector<Element>& out,
+      std::size_t max = std::numeric_limits<std::size_t>::max()) {
+    std::size_t pos = m_DequeuePos.load(std::memory_order_relaxed);
+    std::size_t count = 0;
+    for (; count < max; count++, pos++) {
+      Cell& cell = m_Cells[pos & m_Mask];
+      if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+        break;
+      out.push_back(std::move(cell.data));
+      Release(cell, pos);
     }
+    if (count)
+      m_DequeuePos.store(pos, std::memory_order_release);
+    return count;
+  }
+
+  /// @brief Like GetAll but sleeps up to msec when the queue is empty
+  std::size_t GetAllWithTimeout(
+      std::vector<Element>& out,
+      int msec,
+      std::size_t max = std::numeric_limits<std::size_t>::max()) {
+    std::size_t const count = GetAll(out, max);
+    if (count)
+      return count;
+    Wait(0, msec);
+    return GetAll(out, max);
   }
 
   Element GetNext() {
-    std::unique_lock<std::mutex> l(m_QueueMutex);
-    auto el = GetNonThreadSafe();
-    if (!el) {
-      m_NonEmpty.wait(l);
-      el = GetNonThreadSafe();
+    Element e = Element();
+    if (!Dequeue(e)) {
+      Wait();
+      Dequeue(e);
     }
-    return el;
+    return e;
   }
 
   Element GetNextWithTimeout(
-      int usec) {
-    std::unique_lock<std::mutex> l(m_QueueMutex);
-    auto el = GetNonThreadSafe();
-    if (!el) {
-      m_NonEmpty.wait_for(l, std::chrono::milliseconds(usec));
-      el = GetNonThreadSafe();
+      int msec) {
+    Element e = Element();
+    if (!Dequeue(e)) {
+      Wait(0, msec);
+      Dequeue(e);
     }
-    return el;
+    return e;
+  }
+
+  Element Peek() {
+    std::size_t const pos = m_DequeuePos.load(std::memory_order_relaxed);
+    Cell& cell = m_Cells[pos & m_Mask];
+    if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+      return Element();
+    return cell.data;
   }
 
+  /// @brief Sleeps until the queue is not empty or WakeUp is called
   void Wait() {
-    std::unique_lock<std::mutex> l(m_QueueMutex);
-    m_NonEmpty.wait(l);
+    Sleep(nullptr);
   }
+
+  /// @return False on timeout
   bool Wait(
       int sec,
-      int usec) {
-    std::unique_lock<std::mutex> l(m_QueueMutex);
-    return m_NonEmpty.wait_for(
-        l,
-        std::chrono::seconds(sec) +
-        std::chrono::milliseconds(usec))
-      != std::cv_status::timeout;
+      int msec) {
+    auto const timeout =
+      std::chrono::seconds(sec) + std::chrono::milliseconds(msec);
+    return Sleep(&timeout);
   }
 
   bool IsEmpty() const {
-    std::unique_lock<std::mutex> l(m_QueueMutex);
-    return m_Queue.empty();
+    return !GetSize();
+  }
+
+  /// @return Number of claimed slots, including ones being published
+  std::size_t GetSize() const {
+    // Dequeue position first: it never overtakes the enqueue position
+    std::size_t const dequeue_pos =
+      m_DequeuePos.load(std::memory_order_acquire);
+    return m_EnqueuePos.load(std::memory_order_acquire) - dequeue_pos;
+  }
+
+  std::size_t GetCapacity() const {
+    return m_Mask + 1;
   }
 
-  int GetSize() const {
-    std::unique_lock<std::mutex> l(m_QueueMutex);
-    return m_Queue.size();
+  /// @return Number of elements dropped because the queue was full
+  std::size_t GetNumDropped() const {
+    return m_NumDropped.load(std::memory_order_relaxed);
   }
 
+  /// @brief Interrupts the current or next Wait of the consumer
   void WakeUp() {
+    std::unique_lock<std::mutex> l(m_WaitMutex);
+    m_IsWokenUp = true;
     m_NonEmpty.notify_all();
   }
 
-  Element Get() {
-    std::unique_lock<std::mutex> l(m_QueueMutex);
-    return GetNonThreadSafe();
+ private:
+  /// @brief Number of yields before the consumer goes to sleep
+  static constexpr std::size_t SpinCount = 16;
+
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    Element data;
+  };
+
+  static std::size_t RoundUpPowerOfTwo(
+      std::size_t value) {
+    std::size_t result = 2;
+    while (result < value)
+      result <<= 1;
+    return result;
   }
 
-  Element Peek() {
-    std::unique_lock<std::mutex> l(m_QueueMutex);
-    return GetNonThreadSafe(true);
+  /// @brief Claims up to count consecutive slots starting at pos
+  /// @return Number of slots claimed, 0 if the queue is full
+  std::size_t Claim(
+      std::size_t count,
+      std::size_t& pos) {
+    std::size_t const capacity = m_Mask + 1;
+    pos = m_EnqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+      // Slots below the dequeue position plus capacity have been released
+      std::size_t const used =
+        pos - m_DequeuePos.load(std::memory_order_acquire);
+      if (used > capacity) {  // stale position, consumer already passed it
+        pos = m_EnqueuePos.load(std::memory_order_relaxed);
+        continue;
+      }
+      std::size_t const claimed = std::min(count, capacity - used);
+      if (!claimed)
+        return 0;
+      if (m_EnqueuePos.compare_exchange_weak(
+              pos,
+              pos + claimed,
+              std::memory_order_relaxed))
+        return claimed;
+    }
   }
 
- private:
-  Element GetNonThreadSafe(
-      bool peek = false) {
-    if (!m_Queue.empty()) {
-      auto el = m_Queue.front();
-      if (!peek)
-        m_Queue.pop();
-      return el;
+  template<typename Value>
+  void Publish(
+      std::size_t pos,
+      Value&& value) {
+    Cell& cell = m_Cells[pos & m_Mask];
+    cell.data = std::forward<Value>(value);
+    cell.sequence.store(pos + 1, std::memory_order_release);
+  }
+
+  void Release(
+      Cell& cell,
+      std::size_t pos) {
+    cell.data = Element();
+    cell.sequence.store(pos + m_Mask + 1, std::memory_order_release);
+  }
+
+  bool Dequeue(
+      Element& e) {
+    std::size_t const pos = m_DequeuePos.load(std::memory_order_relaxed);
+    Cell& cell = m_Cells[pos & m_Mask];
+    if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+      return false;
+    e = std::move(cell.data);
+    Release(cell, pos);
+    m_DequeuePos.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool HasNext() const {
+    std::size_t const pos = m_DequeuePos.load(std::memory_order_relaxed);
+    return m_Cells[pos & m_Mask].sequence.load(std::memory_order_acquire)
+      == pos + 1;
+  }
+
+  /// @brief Wakes the consumer if it announced itself as waiting
+  void Notify() {
+    // Pairs with the fence in Sleep: either the consumer sees the published
+    // slot or we see it waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_IsWaiting.load(std::memory_order_relaxed)) {
+      { std::unique_lock<std::mutex> l(m_WaitMutex); }
+      m_NonEmpty.notify_one();
+    }
+  }
+
+  bool Sleep(
+      const std::chrono::milliseconds* timeout) {
+    // Producers usually come in bursts, give them a chance to fill the queue
+    // before paying for a sleep and a wakeup per element
+    for (std::size_t i = 0; i < SpinCount; i++) {
+      if (HasNext())
+        return true;
+      std::this_thread::yield();
     }
-    return nullptr;
+    std::unique_lock<std::mutex> l(m_WaitMutex);
+    m_IsWaiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto const ready = [this] { return m_IsWokenUp || HasNext(); };
+    bool woken = true;
+    if (timeout)
+      woken = m_NonEmpty.wait_for(l, *timeout, ready);
+    else
+      m_NonEmpty.wait(l, ready);
+    m_IsWaiting.store(false, std::memory_order_relaxed);
+    m_IsWokenUp = false;
+    return woken;
   }
 
  private:
-  std::queue<Element> m_Queue;
-  mutable std::mutex m_QueueMutex;
+  const std::size_t m_Mask;
+  std::unique_ptr<Cell[]> m_Cells;
+  // Producer and consumer positions live on separate cache lines
+  std::atomic<std::size_t> m_EnqueuePos;
+  std::atomic<std::size_t> m_NumDropped;
+  char m_ProducerPadding[64];
+  std::atomic<std::size_t> m_DequeuePos;
+  std::atomic<bool> m_IsWaiting;
+  bool m_IsWokenUp;  // guarded by m_WaitMutex
+  std::mutex m_WaitMutex;
   std::condition_variable m_NonEmpty;
 };
 
+template<typename Element>
+constexpr std::size_t Queue<Element>::DefaultCapacity;
+
+template<typename Element>
+constexpr std::size_t Queue<Element>::SpinCount;
+
+/// @class MsgQueue
+/// @brief Processes and deletes queued messages on its own thread
+/// @note The queue owns a message only once Put returned true, callers
+///   delete the messages that were dropped
 template<class Msg>
 class MsgQueue : public Queue<Msg *> {
  public:
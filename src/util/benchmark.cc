@@ -31,13 +31,163 @@
 
 #include "util/benchmark.h"
 
+#include <cryptopp/osrng.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include "core/crypto/diffie_hellman.h"
+#include "core/crypto/elgamal.h"
+#include "core/crypto/rand.h"
+#include "core/crypto/tunnel.h"
+#include "core/router/i2np.h"
+#include "core/router/identity.h"
+#include "core/router/info.h"
+#include "core/router/tunnel/transit.h"
+#include "core/router/tunnel/worker.h"
+
 #include "core/util/exception.h"
 #include "core/util/log.h"
+#include "core/util/queue.h"
 
 
 namespace bpo = boost::program_options;
+
+namespace
+{
+/// @class BenchmarkTransitTunnel
+/// @brief Transit participant which counts forwarded messages instead of sending them
+class BenchmarkTransitTunnel : public xi2p::core::TransitTunnelParticipant
+{
+ public:
+  BenchmarkTransitTunnel(
+      std::uint32_t tunnel_ID,
+      const std::uint8_t* next_ident,
+      const std::uint8_t* layer_key,
+      const std::uint8_t* iv_key,
+      std::atomic<std::size_t>& forwarded)
+      : xi2p::core::TransitTunnelParticipant(
+            tunnel_ID,
+            next_ident,
+            tunnel_ID + 1,
+            layer_key,
+            iv_key),
+        m_Forwarded(forwarded)
+  {
+  }
+
+ protected:
+  void SendTunnelDataMsgs(
+      const std::vector<std::shared_ptr<xi2p::core::I2NPMessage> >& msgs)
+  {
+    m_Forwarded += msgs.size();
+  }
+
+ private:
+  std::atomic<std::size_t>& m_Forwarded;
+};
+
+/// @class LockedQueue
+/// @brief The mutex/condvar queue core::Queue replaced, kept as a baseline
+template <typename Element>
+class LockedQueue
+{
+ public:
+  bool Put(Element e)
+  {
+    std::unique_lock<std::mutex> l(m_QueueMutex);
+    m_Queue.push(e);
+    m_NonEmpty.notify_one();
+    return true;
+  }
+
+  Element Get()
+  {
+    std::unique_lock<std::mutex> l(m_QueueMutex);
+    return GetNonThreadSafe();
+  }
+
+  Element GetNextWithTimeout(int msec)
+  {
+    std::unique_lock<std::mutex> l(m_QueueMutex);
+    auto el = GetNonThreadSafe();
+    if (!el)
+      {
+        m_NonEmpty.wait_for(l, std::chrono::milliseconds(msec));
+        el = GetNonThreadSafe();
+      }
+    return el;
+  }
+
+ private:
+  Element GetNonThreadSafe()
+  {
+    if (m_Queue.empty())
+      return nullptr;
+    auto el = m_Queue.front();
+    m_Queue.pop();
+    return el;
+  }
+
+  std::queue<Element> m_Queue;
+  std::mutex m_QueueMutex;
+  std::condition_variable m_NonEmpty;
+};
+
+/// @brief Pushes count elements from each producer, the calling thread
+///   drains them one at a time
+/// @return Duration in microseconds
+template <class TQueue>
+std::int64_t RunQueue(
+    TQueue& queue,
+    std::size_t producers,
+    std::size_t count,
+    const std::uint8_t* element)
+{
+  auto begin = std::chrono::high_resolution_clock::now();
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < producers; i++)
+    threads.emplace_back([&queue, count, element] {
+      for (std::size_t j = 0; j < count; j++)
+        while (!queue.Put(element))
+          std::this_thread::yield();
+    });
+  for (std::size_t received = 0; received < producers * count;)
+    if (queue.GetNextWithTimeout(100))
+      {
+        received++;
+        while (queue.Get())
+          received++;
+      }
+  for (auto& thread : threads)
+    thread.join();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::high_resolution_clock::now() - begin)
+      .count();
+}
+}  // namespace
+
 /// @brief perfrom all benchmark tests
 void Benchmark::PerformTests()
+{
+  BenchmarkSignatures();
+  BenchmarkBatchVerify();
+  BenchmarkTunnelData(0);
+  BenchmarkQueue(0);
+  BenchmarkRouterInfo();
+  BenchmarkElGamal();
+  BenchmarkRand(0);
+}
+
+void Benchmark::BenchmarkSignatures()
 {
   uint8_t private_key_DSA[xi2p::core::DSA_PRIVATE_KEY_LENGTH];
   uint8_t public_key_DSA[xi2p::core::DSA_PUBLIC_KEY_LENGTH];
@@ -95,10 +245,409 @@ void Benchmark::PerformTests()
       xi2p::core::CreateEDDSARandomKeys);
 }
 
+void Benchmark::BenchmarkBatchVerify()
+{
+  LOG(info) << "-----EDDSA25519 batch-----";
+  // Whole batches, as NetDb loads and reseeds verify them
+  std::size_t const count = BenchmarkCount / xi2p::core::EDDSA25519_MAX_BATCH_SIZE
+                            * xi2p::core::EDDSA25519_MAX_BATCH_SIZE;
+  std::vector<std::array<std::uint8_t, xi2p::core::EDDSA25519_PUBLIC_KEY_LENGTH>>
+      public_keys(count);
+  std::vector<std::array<std::uint8_t, 512>> messages(count);
+  std::vector<std::array<std::uint8_t, xi2p::core::EDDSA25519_SIGNATURE_LENGTH>>
+      signatures(count);
+  std::uint8_t private_key[xi2p::core::EDDSA25519_PRIVATE_KEY_LENGTH];
+  for (std::size_t i = 0; i < count; i++)
+    {
+      xi2p::core::CreateEDDSARandomKeys(private_key, public_keys[i].data());
+      xi2p::core::RandBytes(messages[i].data(), messages[i].size());
+      xi2p::core::EDDSA25519Signer(private_key, public_keys[i].data())
+          .Sign(messages[i].data(), messages[i].size(), signatures[i].data());
+    }
+  auto report = [count](const char* name, std::chrono::microseconds duration) {
+    LOG(info) << name << ": "
+              << count * 1000000 / std::max<std::int64_t>(1, duration.count())
+              << " signatures/sec";
+  };
+  auto begin = std::chrono::high_resolution_clock::now();
+  std::size_t valid = 0;
+  for (std::size_t i = 0; i < count; i++)
+    valid += xi2p::core::EDDSA25519Verifier(public_keys[i].data())
+                 .Verify(messages[i].data(), messages[i].size(), signatures[i].data());
+  report("One at a time", std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::high_resolution_clock::now() - begin));
+  begin = std::chrono::high_resolution_clock::now();
+  xi2p::core::EDDSA25519BatchVerifier batch;
+  for (std::size_t i = 0; i < count; i++)
+    batch.Add(
+        public_keys[i].data(),
+        messages[i].data(),
+        messages[i].size(),
+        signatures[i].data());
+  auto const results = batch.Verify();
+  report("Batch", std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::high_resolution_clock::now() - begin));
+  valid += std::count(results.begin(), results.end(), true);
+  if (valid != 2 * count)
+    LOG(error) << "Benchmark: " << 2 * count - valid << " signatures failed";
+}
+
+void Benchmark::BenchmarkTunnelData(std::size_t max_workers)
+{
+  typedef std::chrono::time_point<std::chrono::high_resolution_clock> TimePoint;
+  LOG(info) << "-----TunnelData-----";
+  if (!max_workers)
+    max_workers = std::max(1u, std::thread::hardware_concurrency());
+  // As the router does when the CPU supports it
+  xi2p::core::SetupAESNI();
+  LOG(info) << "AES-NI: " << xi2p::core::UsingAESNI()
+            << ", VAES: " << xi2p::core::UsingVAES();
+  // Transit tunnels with random keys
+  std::atomic<std::size_t> forwarded(0);
+  std::map<std::uint32_t, std::shared_ptr<xi2p::core::TunnelBase> > tunnels;
+  while (tunnels.size() < TunnelDataTunnels)
+    {
+      std::uint8_t keys[32 * 3];
+      xi2p::core::RandBytes(keys, sizeof(keys));
+      auto tunnel_ID = xi2p::core::Rand<std::uint32_t>();
+      tunnels[tunnel_ID] = std::make_shared<BenchmarkTransitTunnel>(
+          tunnel_ID, keys, keys + 32, keys + 64, forwarded);
+    }
+  // Synthetic traffic, in short bursts per tunnel like real transit traffic
+  const std::size_t burst = 4;
+  std::vector<std::shared_ptr<xi2p::core::I2NPMessage> > msgs;
+  std::uint8_t payload[xi2p::core::TUNNEL_DATA_MSG_SIZE];
+  auto it = tunnels.begin();
+  while (msgs.size() < TunnelDataCount)
+    {
+      for (std::size_t i = 0; i < burst; i++)
+        {
+          xi2p::core::RandBytes(payload, sizeof(payload));
+          msgs.push_back(xi2p::core::ToSharedI2NPMessage(
+              xi2p::core::CreateTunnelDataMsg(it->first, payload)));
+        }
+      if (++it == tunnels.end())
+        it = tunnels.begin();
+    }
+  // Layer encryption alone, one message at a time versus batches
+  // interleaving messages of different tunnels
+  {
+    std::vector<std::unique_ptr<xi2p::core::TunnelEncryption> > encryptions;
+    while (encryptions.size() < TunnelDataTunnels)
+      {
+        std::uint8_t keys[32 * 2];
+        xi2p::core::RandBytes(keys, sizeof(keys));
+        encryptions.push_back(std::make_unique<xi2p::core::TunnelEncryption>());
+        encryptions.back()->SetKeys(keys, keys + 32);
+      }
+    const std::size_t count = TunnelDataCount / 10;
+    std::vector<std::uint8_t> buf(count * xi2p::core::TUNNEL_DATA_MSG_SIZE);
+    xi2p::core::RandBytes(buf.data(), buf.size());
+    std::vector<xi2p::core::TunnelEncryption::Job> jobs;
+    for (std::size_t i = 0; i < count; i++)
+      {
+        std::uint8_t* msg = &buf[i * xi2p::core::TUNNEL_DATA_MSG_SIZE];
+        jobs.push_back({encryptions[i % encryptions.size()].get(), msg, msg});
+      }
+    for (bool const batched : {false, true})
+      {
+        TimePoint begin = std::chrono::high_resolution_clock::now();
+        if (batched)
+          for (std::size_t i = 0; i < count; i += 64)
+            xi2p::core::TunnelEncryption::EncryptBatch(
+                &jobs[i], std::min<std::size_t>(64, count - i));
+        else
+          for (auto const& job : jobs)
+            job.encryption->Encrypt(job.in, job.out);
+        TimePoint end = std::chrono::high_resolution_clock::now();
+        auto duration =
+            std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+        LOG(info) << (batched ? "Batched" : "Serial") << " layer encryption: "
+                  << count * 1000000 / std::max<std::int64_t>(1, duration.count())
+                  << " messages/sec per core";
+      }
+  }
+  // Per core cost of a hop: into a new message while the sender still holds
+  // the received one, and in place once the sender hands it over
+  for (bool const in_place : {false, true})
+    {
+      std::vector<std::shared_ptr<xi2p::core::I2NPMessage> > owned;
+      if (in_place)
+        for (auto const& msg : msgs)
+          owned.push_back(xi2p::core::ToSharedI2NPMessage(
+              xi2p::core::CreateTunnelDataMsg(msg->GetPayload())));
+      forwarded = 0;
+      TimePoint begin = std::chrono::high_resolution_clock::now();
+      auto tunnel = tunnels.begin();
+      for (std::size_t i = 0; i < msgs.size(); i++)
+        {
+          if (in_place)
+            tunnel->second->HandleTunnelDataMsg(std::move(owned[i]));
+          else
+            tunnel->second->HandleTunnelDataMsg(msgs[i]);
+          if ((i + 1) % burst == 0)
+            {
+              tunnel->second->FlushTunnelDataMsgs();
+              if (++tunnel == tunnels.end())
+                tunnel = tunnels.begin();
+            }
+        }
+      tunnel->second->FlushTunnelDataMsgs();
+      TimePoint end = std::chrono::high_resolution_clock::now();
+      auto duration =
+          std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+      LOG(info) << (in_place ? "In place" : "Copy") << " re-encryption: "
+                << forwarded << " messages, "
+                << msgs.size() * 1000000 / std::max<std::int64_t>(1, duration.count())
+                << " messages/sec per core";
+    }
+  auto lookup = [&tunnels](std::uint8_t, std::uint32_t tunnel_ID) {
+    auto found = tunnels.find(tunnel_ID);
+    return found != tunnels.end() ? found->second : nullptr;
+  };
+  // Posted in the batches transports hand over to tunnels
+  const std::size_t batch = 64;
+  std::vector<std::size_t> runs;
+  for (std::size_t workers = 1; workers < max_workers; workers *= 2)
+    runs.push_back(workers);
+  runs.push_back(max_workers);
+  for (auto workers : runs)
+    {
+      xi2p::core::TunnelDataPlane data_plane(lookup);
+      data_plane.Start(workers);
+      forwarded = 0;
+      TimePoint begin = std::chrono::high_resolution_clock::now();
+      // Worker queues are bounded, stay below their capacity
+      std::size_t const backlog =
+          workers * xi2p::core::Queue<const std::uint8_t*>::DefaultCapacity / 2;
+      for (std::size_t i = 0; i < msgs.size(); i += batch)
+        {
+          while (static_cast<std::size_t>(data_plane.GetQueueSize()) > backlog)
+            std::this_thread::yield();
+          data_plane.PostTunnelData(std::vector<std::shared_ptr<xi2p::core::I2NPMessage> >(
+              msgs.begin() + i, msgs.begin() + std::min(i + batch, msgs.size())));
+        }
+      while (forwarded < msgs.size())
+        std::this_thread::yield();
+      TimePoint end = std::chrono::high_resolution_clock::now();
+      data_plane.Stop();
+      auto duration =
+          std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+      LOG(info) << "Workers: " << workers << ", " << msgs.size()
+                << " messages in "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(
+                       duration)
+                       .count()
+                << " ms, "
+                << msgs.size() * 1000000 / std::max<std::int64_t>(1, duration.count())
+                << " messages/sec";
+    }
+  // In steady state forwarded messages come from the pool, not the heap
+  auto const stats = xi2p::core::GetI2NPMessagePoolStats();
+  LOG(info) << "TunnelData pool hits: " << stats.tunnel_data.hits
+            << ", misses: " << stats.tunnel_data.misses;
+}
+
+void Benchmark::BenchmarkQueue(std::size_t max_producers)
+{
+  LOG(info) << "-----Queue-----";
+  if (!max_producers)
+    max_producers = std::max(1u, std::thread::hardware_concurrency());
+  static const std::uint8_t element = 0;
+  auto report = [](const char* name, std::size_t producers, std::int64_t usec) {
+    LOG(info) << name << " producers: " << producers << ", "
+              << QueueCount * 1000000 / std::max<std::int64_t>(1, usec)
+              << " elements/sec";
+  };
+  std::vector<std::size_t> runs;
+  for (std::size_t producers = 1; producers < max_producers; producers *= 2)
+    runs.push_back(producers);
+  runs.push_back(max_producers);
+  for (auto producers : runs)
+    {
+      std::size_t const count = QueueCount / producers;
+      LockedQueue<const std::uint8_t*> locked;
+      report("Locked", producers, RunQueue(locked, producers, count, &element));
+      xi2p::core::Queue<const std::uint8_t*> lock_free;
+      report("Lock-free", producers, RunQueue(lock_free, producers, count, &element));
+      // Same producers, drained in batches
+      xi2p::core::Queue<const std::uint8_t*> batched;
+      auto begin = std::chrono::high_resolution_clock::now();
+      std::vector<std::thread> threads;
+      for (std::size_t i = 0; i < producers; i++)
+        threads.emplace_back([&batched, count] {
+          for (std::size_t j = 0; j < count; j++)
+            while (!batched.Put(&element))
+              std::this_thread::yield();
+        });
+      std::vector<const std::uint8_t*> out;
+      for (std::size_t received = 0; received < producers * count;)
+        {
+          out.clear();
+          received += batched.GetAllWithTimeout(out, 100);
+        }
+      for (auto& thread : threads)
+        thread.join();
+      report("Lock-free batch", producers,
+             std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::high_resolution_clock::now() - begin)
+                 .count());
+    }
+}
+
+void Benchmark::BenchmarkRouterInfo()
+{
+  LOG(info) << "-----RouterInfo-----";
+  // A typical published RI: both transports, both address families, options
+  auto const keys = xi2p::core::PrivateKeys::CreateRandomKeys(
+      xi2p::core::DEFAULT_ROUTER_SIGNING_KEY_TYPE);
+  xi2p::core::RouterInfo router(
+      keys,
+      {"198.51.100.7", 9111},
+      {true, true},
+      xi2p::core::RouterInfo::Cap::Reachable
+          | xi2p::core::RouterInfo::Cap::HighBandwidth);
+  router.AddAddress(
+      std::make_tuple(xi2p::core::RouterInfo::Transport::NTCP, "2001:db8::7", 9111));
+  router.AddAddress(
+      std::make_tuple(xi2p::core::RouterInfo::Transport::SSU, "2001:db8::7", 9111),
+      router.GetIdentHash());
+  router.CreateBuffer(keys);
+  std::vector<std::uint8_t> const buf(
+      router.GetBuffer(), router.GetBuffer() + router.GetBufferLen());
+  LOG(info) << "RouterInfo size: " << buf.size() << " bytes";
+  // Verification dominates, so fewer verified parses are needed
+  for (bool const verify : {false, true})
+    {
+      std::size_t const count = verify ? BenchmarkCount : RouterInfoCount;
+      auto begin = std::chrono::high_resolution_clock::now();
+      for (std::size_t i = 0; i < count; i++)
+        xi2p::core::RouterInfo parsed(buf.data(), buf.size(), verify);
+      auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::high_resolution_clock::now() - begin);
+      LOG(info) << (verify ? "Parse and verify: " : "Parse: ")
+                << count * 1000000 / std::max<std::int64_t>(1, duration.count())
+                << " RouterInfos/sec";
+    }
+}
+
+void Benchmark::BenchmarkElGamal()
+{
+  LOG(info) << "-------ElGamal-------";
+  auto report = [](const char* name, std::chrono::microseconds duration) {
+    LOG(info) << name << ": "
+              << BenchmarkCount * 1000000
+                     / std::max<std::int64_t>(1, duration.count())
+              << " ops/sec";
+  };
+  auto time = [](std::function<void()> op) {
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < BenchmarkCount; i++)
+      op();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - begin);
+  };
+  std::uint8_t private_key[256], public_key[256];
+  xi2p::core::GenerateElGamalKeyPair(private_key, public_key);
+  xi2p::core::ElGamalEncryption encryption(public_key);
+  std::uint8_t data[222], encrypted[512], decrypted[222];
+  xi2p::core::RandBytes(data, sizeof(data));
+  encryption.Encrypt(data, sizeof(data), encrypted);
+  // Decryption is one full-width exponentiation, what computing g^k
+  // cost before the fixed-base table
+  report("Full-width exponentiation (decrypt)", time([&] {
+    xi2p::core::ElGamalDecrypt(private_key, encrypted, decrypted);
+  }));
+  report("Fixed-base exponentiation (key pair)", time([&] {
+    xi2p::core::GenerateElGamalKeyPair(private_key, public_key);
+  }));
+  report("DH key pair", time([&] {
+    xi2p::core::DiffieHellman().GenerateKeyPair(private_key, public_key);
+  }));
+  // Before precomputation encryption paid for both g^k and y^k
+  auto& supplier = xi2p::core::GetElGamalEphemeralSupplier();
+  supplier.Stop();
+  report("Encrypt, g^k inline", time([&] {
+    encryption.Encrypt(data, sizeof(data), encrypted);
+  }));
+  supplier.Start(BenchmarkCount);
+  while (supplier.GetNumReady() < BenchmarkCount)
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  supplier.Stop();
+  report("Encrypt, g^k precomputed", time([&] {
+    encryption.Encrypt(data, sizeof(data), encrypted);
+  }));
+}
+
+void Benchmark::BenchmarkRand(std::size_t max_threads)
+{
+  LOG(info) << "-------Rand-------";
+  if (!max_threads)
+    max_threads = std::max(1u, std::thread::hardware_concurrency());
+  // Nanoseconds per request, on each thread
+  auto time = [](std::size_t count, std::function<void()> op) {
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < count; i++)
+      op();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::high_resolution_clock::now() - begin)
+               .count()
+           / static_cast<double>(count);
+  };
+  std::uint8_t buf[1024];
+  // What every request cost before the per-thread generator
+  LOG(info) << "OS seeded per call, 4 bytes: "
+            << time(RandCount / 1000, [&buf] {
+                 CryptoPP::AutoSeededRandomPool prng;
+                 prng.GenerateBlock(buf, 4);
+               })
+            << " ns";
+  for (std::size_t size : {4, 16, 64, 1024})
+    LOG(info) << "RandBytes, " << size << " bytes: "
+              << time(RandCount, [&buf, size] {
+                   xi2p::core::RandBytes(buf, size);
+                 })
+              << " ns";
+  LOG(info) << "RandInRange32: "
+            << time(RandCount, [] { xi2p::core::RandInRange32(0, 1000); })
+            << " ns";
+  // Each thread has its own generator, so this should scale with cores
+  std::vector<std::size_t> runs;
+  for (std::size_t threads = 2; threads < max_threads; threads *= 2)
+    runs.push_back(threads);
+  if (max_threads > 1)
+    runs.push_back(max_threads);
+  for (auto threads : runs)
+    {
+      std::atomic<std::int64_t> total{0};
+      std::vector<std::thread> workers;
+      for (std::size_t i = 0; i < threads; i++)
+        workers.emplace_back([&total, &time] {
+          std::uint8_t bytes[4];
+          total += time(RandCount, [&bytes] {
+            xi2p::core::RandBytes(bytes, sizeof(bytes));
+          });
+        });
+      for (auto& worker : workers)
+        worker.join();
+      LOG(info) << "RandBytes, 4 bytes, threads: " << threads << ", "
+                << total / static_cast<double>(threads) << " ns";
+    }
+}
+
 Benchmark::Benchmark() : m_Desc("Options")
 {
   m_Desc.add_options()("help,h", "produce this help message")
-     ("test,t", bpo::bool_switch()->default_value(true), "all tests");
+     ("test,t", bpo::bool_switch()->default_value(false), "all tests (default)")
+     ("signature,s", bpo::bool_switch()->default_value(false), "signature schemes")
+     ("batch-verify,b", bpo::bool_switch()->default_value(false), "Ed25519 batch verification")
+     ("tunnel-data,d", bpo::bool_switch()->default_value(false), "tunnel data plane")
+     ("queue,q", bpo::bool_switch()->default_value(false), "queue contention")
+     ("router-info,r", bpo::bool_switch()->default_value(false), "RouterInfo parsing")
+     ("elgamal,e", bpo::bool_switch()->default_value(false), "ElGamal encryption")
+     ("rand,n", bpo::bool_switch()->default_value(false), "random generation")
+     ("workers,w", bpo::value<std::size_t>()->default_value(0),
+      "max tunnel data workers, queue producers or random threads, 0 for one per core");
 }
 /// @brief parse options and perform action
 bool Benchmark::Impl(const std::string& cmd_name,
@@ -124,10 +673,34 @@ bool Benchmark::Impl(const std::string& cmd_name,
       PrintUsage(cmd_name);
       return false;
     }
-  if (vm["test"].as<bool>() == true)  // run all tests
+  bool const signature = vm["signature"].as<bool>();
+  bool const tunnel_data = vm["tunnel-data"].as<bool>();
+  bool const queue = vm["queue"].as<bool>();
+  bool const router_info = vm["router-info"].as<bool>();
+  bool const elgamal = vm["elgamal"].as<bool>();
+  bool const rand = vm["rand"].as<bool>();
+  bool const batch_verify = vm["batch-verify"].as<bool>();
+  if (vm["test"].as<bool>()
+      || (!signature && !tunnel_data && !queue && !router_info
+          && !elgamal && !rand && !batch_verify))  // run all tests
     {
       PerformTests();
+      return true;
     }
+  if (signature)
+    BenchmarkSignatures();
+  if (batch_verify)
+    BenchmarkBatchVerify();
+  if (tunnel_data)
+    BenchmarkTunnelData(vm["workers"].as<std::size_t>());
+  if (queue)
+    BenchmarkQueue(vm["workers"].as<std::size_t>());
+  if (router_info)
+    BenchmarkRouterInfo();
+  if (elgamal)
+    BenchmarkElGamal();
+  if (rand)
+    BenchmarkRand(vm["workers"].as<std::size_t>());
   return true;
 }
 /// @brief perform single benchmark test
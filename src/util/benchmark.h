@@ -45,6 +45,16 @@ class Benchmark : public Command
  public:
   typedef void (*KeyGenerator)(uint8_t*, uint8_t*);
   static const std::size_t BenchmarkCount = 1000;
+  /// @brief Number of synthetic TunnelData messages replayed per run
+  static const std::size_t TunnelDataCount = 100000;
+  /// @brief Number of transit tunnels the messages are spread across
+  static const std::size_t TunnelDataTunnels = 256;
+  /// @brief Number of elements passed through the queue per run
+  static const std::size_t QueueCount = 1000000;
+  /// @brief Number of RouterInfos parsed per run
+  static const std::size_t RouterInfoCount = 100000;
+  /// @brief Number of random requests per run
+  static const std::size_t RandCount = 1000000;
   Benchmark();
   boost::program_options::options_description m_Desc;
   std::string m_OptType;
@@ -64,6 +74,33 @@ class Benchmark : public Command
   void PrintUsage(const std::string& cmd_name) const;
   void PerformTests();
 
+  /// @brief Sign/verify for each signature scheme
+  void BenchmarkSignatures();
+
+  /// @brief Replays synthetic TunnelData through the tunnel data plane
+  /// @param max_workers Highest number of workers to measure, 0 for one per core
+  void BenchmarkTunnelData(std::size_t max_workers);
+
+  /// @brief Producer contention on the lock-free queue versus a locked queue
+  /// @param max_producers Highest number of producers to measure, 0 for one per core
+  void BenchmarkQueue(std::size_t max_producers);
+
+  /// @brief Ed25519 verification of a batch of signatures at once versus
+  ///   one at a time
+  void BenchmarkBatchVerify();
+
+  /// @brief RouterInfo parsing, with and without signature verification
+  void BenchmarkRouterInfo();
+
+  /// @brief ElGamal encryption with ephemeral keys computed inline versus
+  ///   precomputed, against a full-width exponentiation
+  void BenchmarkElGamal();
+
+  /// @brief Random bytes of data path sizes from the per-thread generator,
+  ///   against a generator seeded by the OS on each call
+  /// @param max_threads Highest number of threads to measure, 0 for one per core
+  void BenchmarkRand(std::size_t max_threads);
+
   template <class Verifier, class Signer>
   void BenchmarkTest(
       std::size_t count,
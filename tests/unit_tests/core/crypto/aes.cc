@@ -218,4 +218,52 @@ BOOST_FIXTURE_TEST_CASE(AesCbcDecrypt, AesCbcFixture) {
   }
 }
 
+BOOST_FIXTURE_TEST_CASE(AesCbcMultiBlockInPlace, AesCbcFixture) {
+  // Spans the 8-block kernel and its single-block tail
+  constexpr int num_blocks = 19;
+  xi2p::core::CipherBlock plain[num_blocks];
+  for (int i = 0; i < num_blocks; ++i)
+    for (int j = 0; j < 16; ++j)
+      plain[i].buf[j] = static_cast<uint8_t>(i * 16 + j);
+  xi2p::core::CipherBlock buf[num_blocks];
+  cbc_encrypt.Encrypt(num_blocks, plain, buf);
+  cbc_decrypt.Decrypt(num_blocks, buf, buf);
+  for (int i = 0; i < num_blocks; ++i) {
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+      buf[i].buf, buf[i].buf + 16,
+      plain[i].buf, plain[i].buf + 16);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(AesEcbMultiBlock) {
+  const uint8_t key[32] = {
+    0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe, 0x2b, 0x73,
+    0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81, 0x1f, 0x35, 0x2c, 0x07,
+    0x3b, 0x61, 0x08, 0xd7, 0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14,
+    0xdf, 0xf4
+  };
+  xi2p::core::ECBEncryption encryption;
+  xi2p::core::ECBDecryption decryption;
+  encryption.SetKey(xi2p::core::AESKey(key));
+  decryption.SetKey(xi2p::core::AESKey(key));
+  constexpr int num_blocks = 11;
+  xi2p::core::CipherBlock plain[num_blocks], batch[num_blocks], single;
+  for (int i = 0; i < num_blocks; ++i)
+    for (int j = 0; j < 16; ++j)
+      plain[i].buf[j] = static_cast<uint8_t>(i ^ (j * 7));
+  encryption.Encrypt(num_blocks, plain, batch);
+  for (int i = 0; i < num_blocks; ++i) {
+    encryption.Encrypt(&plain[i], &single);
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+      batch[i].buf, batch[i].buf + 16,
+      single.buf, single.buf + 16);
+  }
+  decryption.Decrypt(num_blocks, batch, batch);
+  for (int i = 0; i < num_blocks; ++i) {
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+      batch[i].buf, batch[i].buf + 16,
+      plain[i].buf, plain[i].buf + 16);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
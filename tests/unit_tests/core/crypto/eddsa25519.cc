@@ -34,6 +34,9 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <array>
+#include <vector>
+
 #include "core/crypto/signature.h"
 
 BOOST_AUTO_TEST_SUITE(EdDSA25519Tests)
@@ -138,4 +141,104 @@ BOOST_FIXTURE_TEST_CASE(EdDSA25519VerifyBadSignature, EDDSAFixture) {
   BOOST_CHECK(!verifier.Verify(message, 33, signature));
 }
 
+struct EDDSABatchFixture {
+  // Enough signatures to span more than one batch equation
+  EDDSABatchFixture()
+      : public_keys(xi2p::core::EDDSA25519_MAX_BATCH_SIZE + 8),
+        messages(public_keys.size()),
+        signatures(public_keys.size()) {
+    uint8_t private_key[32];
+    for (std::size_t i = 0; i < public_keys.size(); i++) {
+      xi2p::core::CreateEDDSARandomKeys(private_key, public_keys[i].data());
+      messages[i].fill(static_cast<uint8_t>(i));
+      xi2p::core::EDDSA25519Signer(private_key, public_keys[i].data())
+          .Sign(messages[i].data(), messages[i].size(), signatures[i].data());
+    }
+  }
+
+  void AddAll() {
+    for (std::size_t i = 0; i < public_keys.size(); i++)
+      batch.Add(
+          public_keys[i].data(),
+          messages[i].data(),
+          messages[i].size(),
+          signatures[i].data());
+  }
+
+  std::vector<std::array<uint8_t, 32>> public_keys;
+  std::vector<std::array<uint8_t, 40>> messages;
+  std::vector<std::array<uint8_t, 64>> signatures;
+  xi2p::core::EDDSA25519BatchVerifier batch;
+};
+
+BOOST_FIXTURE_TEST_CASE(EdDSA25519BatchVerify, EDDSABatchFixture) {
+  AddAll();
+  BOOST_CHECK_EQUAL(batch.GetSize(), public_keys.size());
+  std::vector<bool> valid = batch.Verify();
+  BOOST_CHECK_EQUAL(valid.size(), public_keys.size());
+  for (std::size_t i = 0; i < valid.size(); i++)
+    BOOST_CHECK(valid[i]);
+  BOOST_CHECK_EQUAL(batch.GetSize(), 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(EdDSA25519BatchVerifyBadSignature, EDDSABatchFixture) {
+  const std::size_t bad = 5, bad_message = public_keys.size() - 1;
+  signatures[bad][10] ^= 0x01;
+  messages[bad_message][0] ^= 0x01;
+  AddAll();
+  std::vector<bool> valid = batch.Verify();
+  BOOST_REQUIRE_EQUAL(valid.size(), public_keys.size());
+  for (std::size_t i = 0; i < valid.size(); i++)
+    BOOST_CHECK_EQUAL(valid[i], i != bad && i != bad_message);
+}
+
+BOOST_FIXTURE_TEST_CASE(EdDSA25519BatchVerifySmallOrder, EDDSAFixture) {
+  // Signed with R + T, T of order 2 in place of R: individual verification
+  // is cofactorless and rejects them, the batch equation is cofactored and
+  // accepts them
+  const uint8_t message[2][33] = {
+    {
+      0x54, 0x68, 0x69, 0x73, 0x20, 0x69, 0x73, 0x20, 0x61, 0x20,
+      0x74, 0x65, 0x73, 0x74, 0x20, 0x6d, 0x65, 0x73, 0x73, 0x61,
+      0x67, 0x65, 0x21, 0x20, 0x2d, 0x45, 0x69, 0x6e, 0x4d, 0x42,
+      0x79, 0x74, 0x65
+    },
+    {
+      0x54, 0x68, 0x69, 0x73, 0x20, 0x69, 0x73, 0x20, 0x61, 0x20,
+      0x74, 0x65, 0x73, 0x74, 0x20, 0x6d, 0x65, 0x73, 0x73, 0x61,
+      0x67, 0x65, 0x21, 0x20, 0x2d, 0x45, 0x69, 0x6e, 0x4d, 0x42,
+      0x79, 0x74, 0x66
+    }
+  };
+  const uint8_t signature[2][64] = {
+    {
+      0xf3, 0x95, 0xce, 0xdd, 0x9e, 0x4a, 0xb0, 0x0a, 0x81, 0xdf,
+      0x59, 0xfa, 0x6e, 0x18, 0x54, 0xbe, 0xbc, 0xb7, 0x7a, 0xfd,
+      0x53, 0x30, 0xc0, 0xe8, 0xec, 0xf6, 0xc1, 0xda, 0xc3, 0xea,
+      0x92, 0x3c, 0x07, 0x7c, 0x2a, 0x24, 0xf9, 0x81, 0x99, 0xcb,
+      0xf9, 0x57, 0x55, 0x62, 0x8c, 0xe4, 0x56, 0x3c, 0x81, 0x8f,
+      0xae, 0x3a, 0xf8, 0xb0, 0x79, 0x8b, 0x3b, 0xca, 0x64, 0x47,
+      0xdc, 0x9b, 0x0a, 0x03
+    },
+    {
+      0x20, 0xd6, 0x23, 0x6a, 0xf8, 0x8a, 0xc6, 0xcf, 0x4d, 0x55,
+      0xa7, 0x6b, 0x9e, 0x6e, 0x44, 0xe4, 0x93, 0xcb, 0xfa, 0xa6,
+      0x14, 0xa1, 0x8d, 0xda, 0xc5, 0x35, 0x31, 0xad, 0x8a, 0x3d,
+      0x37, 0x14, 0x2c, 0x56, 0xb5, 0x2a, 0x4f, 0x6d, 0xdd, 0x5d,
+      0xa3, 0x1c, 0xa8, 0x59, 0xc4, 0x55, 0x99, 0x73, 0xb9, 0xac,
+      0x5d, 0x0a, 0xba, 0x79, 0xea, 0xd6, 0xe4, 0xf4, 0xf3, 0xac,
+      0x1e, 0xfb, 0xe8, 0x0d
+    }
+  };
+  xi2p::core::EDDSA25519BatchVerifier batch;
+  for (std::size_t i = 0; i < 2; i++) {
+    BOOST_CHECK(!verifier.Verify(message[i], 33, signature[i]));
+    batch.Add(public_key, message[i], 33, signature[i]);
+  }
+  std::vector<bool> valid = batch.Verify();
+  BOOST_REQUIRE_EQUAL(valid.size(), 2);
+  BOOST_CHECK(valid[0]);
+  BOOST_CHECK(valid[1]);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
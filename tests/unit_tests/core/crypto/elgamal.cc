@@ -32,7 +32,10 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
+#include <thread>
 
 #include "core/crypto/elgamal.h"
 #include "core/crypto/rand.h"
@@ -114,4 +117,33 @@ BOOST_FIXTURE_TEST_CASE(ElgamalEncryptDecryptZeroPadSmallMessageSuccess, Elgamal
     result, result + key_message_len - key_smaller);
 }
 
+BOOST_FIXTURE_TEST_CASE(ElgamalEncryptFreshEphemeralKey, ElgamalFixture) {
+  uint8_t plaintext[key_message_len] = {};
+  uint8_t ciphertext1[key_ciphertext_len];
+  uint8_t ciphertext2[key_ciphertext_len];
+  enc->Encrypt(plaintext, key_message_len, ciphertext1, false);
+  enc->Encrypt(plaintext, key_message_len, ciphertext2, false);
+  // a = g^k must differ between messages to the same recipient
+  BOOST_CHECK(!std::equal(ciphertext1, ciphertext1 + 256, ciphertext2));
+}
+
+BOOST_FIXTURE_TEST_CASE(ElgamalEncryptDecryptSupplierSuccess, ElgamalFixture) {
+  auto& supplier = xi2p::core::GetElGamalEphemeralSupplier();
+  supplier.Start(4);
+  for (int i = 0; i < 100 && supplier.GetNumReady() < 4; i++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  uint8_t plaintext[key_message_len];
+  uint8_t ciphertext[key_ciphertext_len];
+  uint8_t result[key_message_len];
+  for (int i = 0; i < 8; i++) {
+    xi2p::core::RandBytes(plaintext, key_message_len);
+    enc->Encrypt(plaintext, key_message_len, ciphertext, false);
+    BOOST_CHECK(xi2p::core::ElGamalDecrypt(private_key, ciphertext, result, false));
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+      plaintext, plaintext + key_message_len,
+      result, result + key_message_len);
+  }
+  supplier.Stop();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
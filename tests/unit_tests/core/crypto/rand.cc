@@ -32,16 +32,25 @@
 
 #include <boost/test/unit_test.hpp>
 
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <array>
 #include <cstdint>
+#include <cstring>
 #include <limits>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 #include "core/crypto/rand.h"
 
 /// Note:
 ///
-///  These tests were needed for home-brewed crypto. Now that we use cryptopp
-///  for random ranges, these unit-tests are no longer needed. Referencing #515
+///  Random ranges are drawn from our own per-thread generator again, by
+///  rejection sampling. Referencing #515
 ///
 
 BOOST_AUTO_TEST_SUITE(RandInRange)
@@ -129,3 +138,150 @@ BOOST_AUTO_TEST_CASE(Outer) {
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+/// FIPS 140-2 statistical tests (section 4.9.1) over 20000 bits, each
+/// expected to fail for about one in ten thousand runs of a perfect source
+BOOST_AUTO_TEST_SUITE(RandBytes)
+
+namespace {
+
+std::vector<std::uint8_t> Sample() {
+  std::vector<std::uint8_t> sample(20000 / 8);
+  // Many small requests, as on the data path
+  for (std::size_t i = 0; i < sample.size(); i += 4)
+    xi2p::core::RandBytes(sample.data() + i, 4);
+  return sample;
+}
+
+bool Bit(const std::vector<std::uint8_t>& sample, std::size_t i) {
+  return (sample[i / 8] >> (i % 8)) & 1;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(Monobit) {
+  auto const sample = Sample();
+  std::size_t ones = 0;
+  for (std::size_t i = 0; i < 20000; i++)
+    ones += Bit(sample, i);
+  BOOST_CHECK_GT(ones, 9725);
+  BOOST_CHECK_LT(ones, 10275);
+}
+
+BOOST_AUTO_TEST_CASE(Poker) {
+  auto const sample = Sample();
+  std::array<std::size_t, 16> counts {};
+  for (auto byte : sample) {
+    counts[byte & 0x0F]++;
+    counts[byte >> 4]++;
+  }
+  double sum = 0;
+  for (auto count : counts)
+    sum += static_cast<double>(count) * count;
+  double const x = 16.0 / 5000 * sum - 5000;
+  BOOST_CHECK_GT(x, 2.16);
+  BOOST_CHECK_LT(x, 46.17);
+}
+
+BOOST_AUTO_TEST_CASE(Runs) {
+  auto const sample = Sample();
+  // Runs of 1 to 6+ bits, of zeros and of ones
+  std::array<std::array<std::size_t, 6>, 2> runs {};
+  std::size_t longest = 0, length = 0;
+  for (std::size_t i = 0; i < 20000; i++) {
+    length++;
+    if (i == 19999 || Bit(sample, i) != Bit(sample, i + 1)) {
+      runs[Bit(sample, i)][std::min<std::size_t>(length, 6) - 1]++;
+      longest = std::max(longest, length);
+      length = 0;
+    }
+  }
+  std::array<std::size_t, 6> const low {{2315, 1114, 527, 240, 103, 103}},
+                                   high {{2685, 1386, 723, 384, 209, 209}};
+  for (auto const& run : runs)
+    for (std::size_t i = 0; i < 6; i++) {
+      BOOST_CHECK_GE(run[i], low[i]);
+      BOOST_CHECK_LE(run[i], high[i]);
+    }
+  BOOST_CHECK_LT(longest, 26);
+}
+
+BOOST_AUTO_TEST_CASE(LargeRequests) {
+  // Spanning several refills of the generator's buffer
+  std::vector<std::uint8_t> first(10000), second(10000), zeros(10000);
+  xi2p::core::RandBytes(first.data(), first.size());
+  xi2p::core::RandBytes(second.data(), second.size());
+  BOOST_CHECK(first != second);
+  BOOST_CHECK(first != zeros);
+  std::size_t ones = 0;
+  for (auto byte : first)
+    for (; byte; byte &= byte - 1)
+      ones++;
+  // Within 6 standard deviations (~141) of 40000
+  BOOST_CHECK_GT(ones, 40000 - 850);
+  BOOST_CHECK_LT(ones, 40000 + 850);
+}
+
+BOOST_AUTO_TEST_CASE(DistinctThreads) {
+  std::array<std::array<std::uint8_t, 32>, 4> outputs;
+  std::vector<std::thread> threads;
+  for (auto& output : outputs)
+    threads.emplace_back([&output] {
+      xi2p::core::RandBytes(output.data(), output.size());
+    });
+  for (auto& thread : threads)
+    thread.join();
+  for (std::size_t i = 0; i < outputs.size(); i++)
+    for (std::size_t j = i + 1; j < outputs.size(); j++)
+      BOOST_CHECK(outputs[i] != outputs[j]);
+}
+
+#ifndef _WIN32
+BOOST_AUTO_TEST_CASE(DistinctAfterFork) {
+  // Buffered bytes of the parent must not be handed out by the child too
+  xi2p::core::Rand<std::uint32_t>();
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(pipe(fds), 0);
+  pid_t const pid = fork();
+  BOOST_REQUIRE_GE(pid, 0);
+  std::array<std::uint8_t, 32> output;
+  xi2p::core::RandBytes(output.data(), output.size());
+  if (!pid) {
+    ssize_t const written = write(fds[1], output.data(), output.size());
+    _exit(written == static_cast<ssize_t>(output.size()) ? 0 : 1);
+  }
+  std::array<std::uint8_t, 32> child;
+  BOOST_REQUIRE_EQUAL(
+      read(fds[0], child.data(), child.size()),
+      static_cast<ssize_t>(child.size()));
+  int status;
+  waitpid(pid, &status, 0);
+  close(fds[0]);
+  close(fds[1]);
+  BOOST_CHECK(output != child);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(UniformRange) {
+  // Chi-squared over 7 values: a range which is not a power of 2
+  std::array<std::size_t, 7> counts {};
+  std::size_t const draws = 70000;
+  for (std::size_t i = 0; i < draws; i++)
+    counts[xi2p::core::RandInRange32(10, 16) - 10]++;
+  double chi2 = 0;
+  for (auto count : counts) {
+    double const delta = static_cast<double>(count) - draws / 7.0;
+    chi2 += delta * delta / (draws / 7.0);
+  }
+  // p < 0.0001 for 6 degrees of freedom
+  BOOST_CHECK_LT(chi2, 27.86);
+}
+
+BOOST_AUTO_TEST_CASE(RangeBounds) {
+  BOOST_CHECK_EQUAL(xi2p::core::RandInRange32(5, 5), 5);
+  BOOST_CHECK_THROW(xi2p::core::RandInRange32(6, 5), std::invalid_argument);
+  // Full range, no overflow
+  xi2p::core::RandInRange32(0, std::numeric_limits<std::uint32_t>::max());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,108 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "core/crypto/aes.h"
+#include "core/crypto/tunnel.h"
+
+namespace core = xi2p::core;
+
+// Enough messages for a full set of lanes plus a partial one
+struct TunnelCryptoFixture {
+  TunnelCryptoFixture() {
+    core::SetupAESNI();
+    for (std::size_t i = 0; i < num_msgs; i++) {
+      std::uint8_t keys[64];
+      for (std::size_t j = 0; j < sizeof(keys); j++)
+        keys[j] = static_cast<std::uint8_t>(i * 31 + j);
+      encryptions.push_back(std::make_unique<core::TunnelEncryption>());
+      encryptions.back()->SetKeys(keys, keys + 32);
+      decryptions.push_back(std::make_unique<core::TunnelDecryption>());
+      decryptions.back()->SetKeys(keys, keys + 32);
+      for (std::size_t j = 0; j < msgs[i].size(); j++)
+        msgs[i][j] = static_cast<std::uint8_t>(i ^ (j * 7));
+    }
+  }
+
+  static const std::size_t num_msgs = 13;
+  std::vector<std::unique_ptr<core::TunnelEncryption> > encryptions;
+  std::vector<std::unique_ptr<core::TunnelDecryption> > decryptions;
+  std::array<std::array<std::uint8_t, 1024>, num_msgs> msgs;
+};
+
+BOOST_FIXTURE_TEST_SUITE(TunnelCryptoTests, TunnelCryptoFixture)
+
+BOOST_AUTO_TEST_CASE(EncryptBatchMatchesSingle)
+{
+  for (std::size_t num = 0; num <= num_msgs; num++)
+    {
+      auto expected = msgs;
+      auto out = msgs;
+      std::vector<core::TunnelEncryption::Job> jobs;
+      for (std::size_t i = 0; i < num; i++)
+        {
+          encryptions[i]->Encrypt(msgs[i].data(), expected[i].data());
+          // in place
+          jobs.push_back({encryptions[i].get(), out[i].data(), out[i].data()});
+        }
+      core::TunnelEncryption::EncryptBatch(jobs.data(), jobs.size());
+      for (std::size_t i = 0; i < num_msgs; i++)
+        BOOST_CHECK(out[i] == expected[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(DecryptBatchReversesEncryptBatch)
+{
+  std::array<std::array<std::uint8_t, 1024>, num_msgs> encrypted, decrypted;
+  std::vector<core::TunnelEncryption::Job> encryption_jobs;
+  std::vector<core::TunnelDecryption::Job> decryption_jobs;
+  for (std::size_t i = 0; i < num_msgs; i++)
+    {
+      encryption_jobs.push_back(
+          {encryptions[i].get(), msgs[i].data(), encrypted[i].data()});
+      decryption_jobs.push_back(
+          {decryptions[i].get(), encrypted[i].data(), decrypted[i].data()});
+    }
+  core::TunnelEncryption::EncryptBatch(
+      encryption_jobs.data(), encryption_jobs.size());
+  core::TunnelDecryption::DecryptBatch(
+      decryption_jobs.data(), decryption_jobs.size());
+  for (std::size_t i = 0; i < num_msgs; i++)
+    BOOST_CHECK(decrypted[i] == msgs[i]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,114 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "core/crypto/hash.h"
+#include "core/router/i2np.h"
+
+namespace core = xi2p::core;
+
+struct I2NPMessageFixture {
+  I2NPMessageFixture() : msg(core::NewI2NPShortMessage()) {
+    // as received from a peer, with some checksum
+    std::array<std::uint8_t, 64> payload;
+    payload.fill(0x5A);
+    std::memcpy(msg->GetPayload(), payload.data(), payload.size());
+    msg->len += payload.size();
+    msg->SetTypeID(core::I2NPData);
+    msg->UpdateSize();
+    msg->SetChks(0xAB);
+  }
+
+  std::uint8_t GetExpectedChks() const {
+    std::uint8_t hash[32];
+    core::SHA256().CalculateDigest(
+        hash, msg->GetPayload(), msg->GetPayloadLength());
+    return hash[0];
+  }
+
+  std::uint8_t GetChks() const {
+    return msg->GetHeader()[core::I2NP_HEADER_CHKS_OFFSET];
+  }
+
+  std::unique_ptr<core::I2NPMessage> msg;
+};
+
+BOOST_FIXTURE_TEST_SUITE(I2NPMessageTests, I2NPMessageFixture)
+
+BOOST_AUTO_TEST_CASE(ReceivedChecksumKept)
+{
+  msg->FinalizeChks();
+  BOOST_CHECK_EQUAL(GetChks(), 0xAB);
+}
+
+BOOST_AUTO_TEST_CASE(ChecksumComputedOnce)
+{
+  msg->is_chks_updated = false;
+  msg->FinalizeChks();
+  BOOST_CHECK_EQUAL(GetChks(), GetExpectedChks());
+  BOOST_CHECK(msg->is_chks_updated);
+  // cached until the header is filled again
+  msg->SetChks(GetExpectedChks() ^ 1);
+  msg->FinalizeChks();
+  BOOST_CHECK_EQUAL(GetChks(), GetExpectedChks() ^ 1);
+  msg->UpdateChks();
+  BOOST_CHECK_EQUAL(GetChks(), GetExpectedChks());
+}
+
+BOOST_AUTO_TEST_CASE(SSUDropsChecksum)
+{
+  // SSU's short header has no checksum
+  msg->FromSSU(1);
+  BOOST_CHECK(!msg->is_chks_updated);
+  BOOST_CHECK_EQUAL(msg->GetSize(), 64);
+  msg->FinalizeChks();
+  BOOST_CHECK_EQUAL(GetChks(), GetExpectedChks());
+}
+
+BOOST_AUTO_TEST_CASE(CopyKeepsChecksumState)
+{
+  msg->is_chks_updated = false;
+  auto copy = core::NewI2NPShortMessage();
+  *copy = *msg;
+  BOOST_CHECK(!copy->is_chks_updated);
+  copy->FinalizeChks();
+  BOOST_CHECK_EQUAL(
+      copy->GetHeader()[core::I2NP_HEADER_CHKS_OFFSET], GetExpectedChks());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
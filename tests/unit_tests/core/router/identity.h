@@ -31,7 +31,10 @@
 #ifndef TESTS_UNIT_TESTS_CORE_ROUTER_IDENTITY_H_
 #define TESTS_UNIT_TESTS_CORE_ROUTER_IDENTITY_H_
 
+#include <boost/filesystem.hpp>
+
 #include <array>
+#include <cstdint>
 #include <memory>
 
 #include "core/router/identity.h"
@@ -104,4 +107,29 @@ struct IdentityExFixture
   }};
 };
 
+/// @brief Temporary path for stores keyed on ident hashes, removed with
+///   everything under it
+struct IdentStoreFixture
+{
+  IdentStoreFixture()
+      : temp_path(
+            boost::filesystem::temp_directory_path()
+            / boost::filesystem::unique_path()) {}
+
+  ~IdentStoreFixture()
+  {
+    boost::filesystem::remove_all(temp_path);
+  }
+
+  /// @return Ident hash told apart from others by its first byte only
+  static core::IdentHash Ident(std::uint8_t id)
+  {
+    core::IdentHash ident;
+    ident()[0] = id;
+    return ident;
+  }
+
+  boost::filesystem::path temp_path;
+};
+
 #endif  // TESTS_UNIT_TESTS_CORE_ROUTER_IDENTITY_H_
@@ -0,0 +1,90 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <utility>
+
+#include "core/router/identity.h"
+#include "core/router/info.h"
+#include "core/router/net_db/impl.h"
+
+namespace core = xi2p::core;
+
+struct NetDbFixture {
+  NetDbFixture()
+      : keys(core::PrivateKeys::CreateRandomKeys()),
+        router(
+            keys,
+            std::make_pair("127.0.0.1", 9111),
+            std::make_pair(true, false),
+            core::RouterInfo::Cap::Reachable | core::RouterInfo::Cap::Floodfill) {}
+
+  /// @brief Re-signs the RI with new caps and adds it to the NetDb
+  void Publish(std::uint8_t caps) {
+    router.SetCaps(caps);
+    router.CreateBuffer(keys);
+    net_db.AddRouterInfo(
+        router.GetIdentHash(), router.GetBuffer(), router.GetBufferLen());
+  }
+
+  std::shared_ptr<const core::RouterInfo> ClosestFloodfill() const {
+    return net_db.GetClosestFloodfill(
+        router.GetIdentHash(), std::set<core::IdentHash>());
+  }
+
+  core::PrivateKeys keys;
+  core::RouterInfo router;
+  core::NetDb net_db;
+};
+
+BOOST_FIXTURE_TEST_SUITE(NetDbTests, NetDbFixture)
+
+BOOST_AUTO_TEST_CASE(FloodfillsFollowCapChanges)
+{
+  net_db.AddRouterInfo(
+      router.GetIdentHash(), router.GetBuffer(), router.GetBufferLen());
+  BOOST_REQUIRE(ClosestFloodfill());
+  BOOST_CHECK(ClosestFloodfill()->GetIdentHash() == router.GetIdentHash());
+
+  Publish(core::RouterInfo::Cap::Reachable);
+  BOOST_CHECK(!ClosestFloodfill());
+
+  Publish(core::RouterInfo::Cap::Reachable | core::RouterInfo::Cap::Floodfill);
+  BOOST_REQUIRE(ClosestFloodfill());
+  BOOST_CHECK(ClosestFloodfill()->GetIdentHash() == router.GetIdentHash());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
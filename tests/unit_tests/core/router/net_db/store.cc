@@ -0,0 +1,145 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "core/router/net_db/store.h"
+
+#include "tests/unit_tests/core/router/identity.h"
+
+struct NetDbStoreFixture : public IdentStoreFixture {
+  NetDbStoreFixture() : path(temp_path.string()) {}
+
+  static std::vector<std::uint8_t> Buffer(std::uint8_t id, std::size_t len) {
+    return std::vector<std::uint8_t>(len, id);
+  }
+
+  /// @brief Opens store and returns its live records
+  std::map<core::IdentHash, std::vector<std::uint8_t>> Open(
+      core::NetDbStore& store) {
+    std::map<core::IdentHash, std::vector<std::uint8_t>> records;
+    BOOST_REQUIRE(store.Open(
+        path,
+        [&records](const std::vector<core::NetDbStore::Record>& live) {
+          for (auto const& record : live)
+            records[record.ident].assign(record.buf, record.buf + record.len);
+        }));
+    return records;
+  }
+
+  std::string path;
+};
+
+BOOST_FIXTURE_TEST_SUITE(NetDbStoreTests, NetDbStoreFixture)
+
+BOOST_AUTO_TEST_CASE(ReplaysPutsAndErases)
+{
+  {
+    core::NetDbStore store;
+    BOOST_CHECK(Open(store).empty());
+    for (std::uint8_t id = 1; id <= 3; id++)
+      store.Put(Ident(id), Buffer(id, 100 * id).data(), 100 * id);
+    store.Put(Ident(2), Buffer(20, 50).data(), 50);
+    BOOST_CHECK(store.Erase(Ident(3)));
+    BOOST_CHECK(!store.Erase(Ident(4)));
+    BOOST_REQUIRE(store.Flush());
+    std::vector<std::uint8_t> buf;
+    BOOST_REQUIRE(store.Read(Ident(2), buf));
+    BOOST_CHECK(buf == Buffer(20, 50));
+    BOOST_CHECK(!store.Read(Ident(3), buf));
+  }
+  core::NetDbStore store;
+  auto records = Open(store);
+  BOOST_REQUIRE_EQUAL(records.size(), 2);
+  BOOST_CHECK(records[Ident(1)] == Buffer(1, 100));
+  BOOST_CHECK(records[Ident(2)] == Buffer(20, 50));
+}
+
+BOOST_AUTO_TEST_CASE(DropsTornAppend)
+{
+  {
+    core::NetDbStore store;
+    Open(store);
+    store.Put(Ident(1), Buffer(1, 100).data(), 100);
+    store.Put(Ident(2), Buffer(2, 100).data(), 100);
+    BOOST_REQUIRE(store.Flush());
+  }
+  // Cut the last record short, as a crash during append would
+  boost::filesystem::resize_file(path, boost::filesystem::file_size(path) - 10);
+  std::uint64_t size;
+  {
+    core::NetDbStore store;
+    auto records = Open(store);
+    BOOST_REQUIRE_EQUAL(records.size(), 1);
+    BOOST_CHECK(records[Ident(1)] == Buffer(1, 100));
+    size = store.GetFileSize();
+    // Appends after the cut are readable
+    store.Put(Ident(3), Buffer(3, 100).data(), 100);
+  }
+  BOOST_CHECK_GT(boost::filesystem::file_size(path), size);
+  core::NetDbStore store;
+  auto records = Open(store);
+  BOOST_CHECK_EQUAL(records.size(), 2);
+  BOOST_CHECK(records[Ident(3)] == Buffer(3, 100));
+}
+
+BOOST_AUTO_TEST_CASE(CompactsDeadRecords)
+{
+  core::NetDbStore store;
+  Open(store);
+  for (std::size_t round = 0; round < 20; round++)
+    {
+      for (std::uint8_t id = 0; id < 100; id++)
+        store.Put(Ident(id), Buffer(id + round, 1000).data(), 1000);
+      BOOST_REQUIRE(store.Flush());
+    }
+  // Only the last round is live, well under half of 2MB written
+  BOOST_CHECK_LT(store.GetFileSize(), 1024 * 1024);
+  BOOST_CHECK_EQUAL(store.GetNumRecords(), 100);
+  std::vector<std::uint8_t> buf;
+  BOOST_REQUIRE(store.Read(Ident(42), buf));
+  BOOST_CHECK(buf == Buffer(42 + 19, 1000));
+  store.Close();
+  core::NetDbStore reopened;
+  auto records = Open(reopened);
+  BOOST_CHECK_EQUAL(records.size(), 100);
+  BOOST_CHECK(records[Ident(7)] == Buffer(7 + 19, 1000));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,163 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "core/router/net_db/xor_trie.h"
+
+namespace core = xi2p::core;
+
+typedef core::XORTrie<int, 4> Trie;
+
+struct XORTrieFixture {
+  XORTrieFixture() : rng(1234) {
+    for (int i = 0; i < 500; i++)
+      keys.push_back(RandomKey());
+  }
+
+  Trie::Key RandomKey() {
+    Trie::Key key;
+    for (std::size_t i = 0; i < 32; i++)
+      key()[i] = static_cast<std::uint8_t>(rng());
+    return key;
+  }
+
+  /// @brief Indexes of k keys closest to target, by brute force
+  std::vector<int> Closest(
+      const Trie::Key& target,
+      std::size_t k,
+      const std::vector<bool>& present) {
+    std::vector<int> indexes;
+    for (std::size_t i = 0; i < keys.size(); i++)
+      if (present[i])
+        indexes.push_back(i);
+    std::sort(
+        indexes.begin(),
+        indexes.end(),
+        [&](int lhs, int rhs) {
+          for (std::size_t i = 0; i < 32; i++) {
+            std::uint8_t const l = keys[lhs]()[i] ^ target()[i];
+            std::uint8_t const r = keys[rhs]()[i] ^ target()[i];
+            if (l != r)
+              return l < r;
+          }
+          return false;
+        });
+    indexes.resize(std::min(k, indexes.size()));
+    return indexes;
+  }
+
+  std::vector<int> Visit(
+      const Trie& trie,
+      const Trie::Key& target,
+      std::size_t k) {
+    std::vector<int> indexes;
+    trie.VisitClosest(target, [&](const Trie::Key&, int value) {
+      indexes.push_back(value);
+      return indexes.size() < k;
+    });
+    return indexes;
+  }
+
+  std::mt19937 rng;
+  std::vector<Trie::Key> keys;
+};
+
+BOOST_FIXTURE_TEST_SUITE(XORTrieTests, XORTrieFixture)
+
+BOOST_AUTO_TEST_CASE(InsertRejectsDuplicates)
+{
+  Trie trie;
+  BOOST_CHECK(trie.Insert(keys[0], 0));
+  BOOST_CHECK(!trie.Insert(keys[0], 1));
+  BOOST_CHECK_EQUAL(trie.GetSize(), 1);
+  BOOST_CHECK(!trie.Remove(keys[1]));
+  BOOST_CHECK(trie.Remove(keys[0]));
+  BOOST_CHECK_EQUAL(trie.GetSize(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ClosestMatchesBruteForce)
+{
+  Trie trie;
+  std::vector<bool> present(keys.size(), true);
+  for (std::size_t i = 0; i < keys.size(); i++)
+    BOOST_REQUIRE(trie.Insert(keys[i], i));
+  for (int query = 0; query < 50; query++)
+    {
+      auto const target = RandomKey();
+      for (std::size_t k : {1, 3, 20})
+        {
+          auto const expected = Closest(target, k, present);
+          auto const visited = Visit(trie, target, k);
+          BOOST_CHECK_EQUAL_COLLECTIONS(
+              visited.begin(), visited.end(),
+              expected.begin(), expected.end());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ClosestAfterRemovals)
+{
+  Trie trie;
+  std::vector<bool> present(keys.size(), true);
+  for (std::size_t i = 0; i < keys.size(); i++)
+    trie.Insert(keys[i], i);
+  // Remove most keys so that leaves fold back together
+  for (std::size_t i = 0; i < keys.size(); i++)
+    if (i % 7)
+      {
+        BOOST_REQUIRE(trie.Remove(keys[i]));
+        present[i] = false;
+      }
+  BOOST_CHECK_EQUAL(trie.GetSize(), std::count(present.begin(), present.end(), true));
+  for (int query = 0; query < 50; query++)
+    {
+      auto const target = RandomKey();
+      auto const expected = Closest(target, keys.size(), present);
+      auto const visited = Visit(trie, target, keys.size());
+      BOOST_CHECK_EQUAL_COLLECTIONS(
+          visited.begin(), visited.end(),
+          expected.begin(), expected.end());
+    }
+  // Removed keys can be added back
+  for (std::size_t i = 0; i < keys.size(); i++)
+    if (!present[i])
+      BOOST_CHECK(trie.Insert(keys[i], i));
+  BOOST_CHECK_EQUAL(trie.GetSize(), keys.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,174 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "core/router/profiling.h"
+
+#include "core/util/timestamp.h"
+
+#include "tests/unit_tests/core/router/identity.h"
+
+struct ProfileStoreFixture : public IdentStoreFixture {
+  /// @brief Makes profile of id always declining, i.e. bad
+  static void Decline(core::ProfileStore& store, std::uint8_t id) {
+    for (int i = 0; i < 5; i++)
+      store.Get(Ident(id))->TunnelBuildResponse(1);
+  }
+
+  /// @return Directory of the profile files of older versions
+  boost::filesystem::path GetFilesPath() const {
+#if defined(_WIN32) || defined(__APPLE__)
+    return temp_path / "uppercase";
+#else
+    return temp_path;
+#endif
+  }
+
+  /// @brief Writes a profile file of older versions, always declining
+  void WriteProfileFile(
+      const std::string& directory,
+      std::uint8_t id,
+      const std::string& last_update_time) {
+    boost::filesystem::create_directories(GetFilesPath() / directory);
+    std::ofstream(
+        (GetFilesPath() / directory
+         / (core::PEER_PROFILE_PREFIX + Ident(id).ToBase64() + ".txt"))
+            .string())
+      << core::PEER_PROFILE_LAST_UPDATE_TIME << " = " << last_update_time
+      << "\n[" << core::PEER_PROFILE_SECTION_PARTICIPATION << "]\n"
+      << core::PEER_PROFILE_PARTICIPATION_DECLINED << " = 5\n";
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(ProfileStoreTests, ProfileStoreFixture)
+
+BOOST_AUTO_TEST_CASE(ReturnsSameProfile)
+{
+  core::ProfileStore store;
+  BOOST_REQUIRE(store.Open(temp_path));
+  auto profile = store.Get(Ident(1));
+  BOOST_CHECK_EQUAL(store.Get(Ident(1)), profile);
+  BOOST_CHECK_NE(store.Get(Ident(2)), profile);
+  BOOST_CHECK_EQUAL(store.GetNumProfiles(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(PersistsCounters)
+{
+  {
+    core::ProfileStore store;
+    BOOST_REQUIRE(store.Open(temp_path));
+    Decline(store, 1);
+    store.Get(Ident(2))->TunnelBuildResponse(0);
+    store.Close();
+  }
+  core::ProfileStore store;
+  BOOST_REQUIRE(store.Open(temp_path));
+  BOOST_CHECK_EQUAL(store.GetNumProfiles(), 2);
+  BOOST_CHECK(store.Get(Ident(1))->IsBad());
+  BOOST_CHECK(!store.Get(Ident(2))->IsBad());
+}
+
+BOOST_AUTO_TEST_CASE(KeepsProfilesWithoutFile)
+{
+  core::ProfileStore store;
+  Decline(store, 1);
+  BOOST_CHECK(store.Get(Ident(1))->IsBad());
+  BOOST_CHECK_EQUAL(store.GetNumProfiles(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ResetsInvalidFile)
+{
+  boost::filesystem::create_directories(temp_path);
+  std::ofstream((temp_path / "profiles.dat").string()) << "not a profile table";
+  core::ProfileStore store;
+  BOOST_REQUIRE(store.Open(temp_path));
+  BOOST_CHECK_EQUAL(store.GetNumProfiles(), 0);
+  Decline(store, 1);
+  BOOST_CHECK(store.Get(Ident(1))->IsBad());
+}
+
+BOOST_AUTO_TEST_CASE(KeepsFilesNotImported)
+{
+  auto const now = boost::posix_time::second_clock::local_time();
+  WriteProfileFile("pA", 1, boost::posix_time::to_simple_string(now));
+  WriteProfileFile("pA", 2, "not a time");
+  WriteProfileFile("pB", 3, boost::posix_time::to_simple_string(now));
+  core::ProfileStore store;
+  BOOST_REQUIRE(store.Open(temp_path));
+  BOOST_CHECK_EQUAL(store.GetNumProfiles(), 2);
+  BOOST_CHECK(store.Get(Ident(1))->IsBad());
+  BOOST_CHECK(store.Get(Ident(3))->IsBad());
+  // Only the directory of the file which failed is left, with that file
+  BOOST_CHECK_EQUAL(
+      std::distance(
+          boost::filesystem::directory_iterator(GetFilesPath() / "pA"),
+          boost::filesystem::directory_iterator()),
+      1);
+  BOOST_CHECK(!boost::filesystem::exists(GetFilesPath() / "pB"));
+}
+
+BOOST_AUTO_TEST_CASE(ReusesExpiredRecords)
+{
+  std::uint64_t const expiration = core::PEER_PROFILE_EXPIRATION_TIMEOUT * 3600;
+  core::ProfileStore store;
+  BOOST_REQUIRE(store.Open(temp_path));
+  auto profile = store.Get(Ident(1));
+  std::uint64_t const ts = core::GetSecondsSinceEpoch();
+  BOOST_CHECK_EQUAL(store.Expire(ts), 0);
+  BOOST_CHECK(profile->IsOf(Ident(1)));
+  BOOST_CHECK_EQUAL(store.Expire(ts + expiration), 1);
+  BOOST_CHECK(!profile->IsOf(Ident(1)));
+  BOOST_CHECK_EQUAL(store.GetNumProfiles(), 0);
+  BOOST_CHECK_EQUAL(store.Get(Ident(2)), profile);
+  BOOST_CHECK(profile->IsOf(Ident(2)));
+}
+
+BOOST_AUTO_TEST_CASE(ReusesExpiredProfilesWithoutFile)
+{
+  core::ProfileStore store;
+  auto profile = store.Get(Ident(1));
+  std::uint64_t const ts = core::GetSecondsSinceEpoch();
+  BOOST_CHECK_EQUAL(
+      store.Expire(ts + core::PEER_PROFILE_EXPIRATION_TIMEOUT * 3600), 1);
+  BOOST_CHECK_EQUAL(store.Get(Ident(2)), profile);
+  BOOST_CHECK_EQUAL(store.GetNumProfiles(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
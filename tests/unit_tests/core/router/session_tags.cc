@@ -0,0 +1,143 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "core/router/session_tags.h"
+
+namespace core = xi2p::core;
+
+struct SessionTagStoreFixture {
+  enum : std::uint32_t {
+    Lifetime = 960,
+    Start = 1500000000,
+  };
+
+  SessionTagStoreFixture() : store(Lifetime) {}
+
+  /// @brief num distinct tags, starting from id
+  static std::vector<std::uint8_t> Tags(std::uint32_t id, std::size_t num) {
+    std::vector<std::uint8_t> tags(num * 32);
+    for (std::size_t i = 0; i < num; i++, id++)
+      for (std::size_t j = 0; j < 32; j += 4)
+        std::memcpy(tags.data() + i * 32 + j, &id, 4);
+    return tags;
+  }
+
+  core::SessionTagStore store;
+};
+
+BOOST_FIXTURE_TEST_SUITE(SessionTagStoreTests, SessionTagStoreFixture)
+
+BOOST_AUTO_TEST_CASE(TakesTagOnce)
+{
+  auto decryption = std::make_shared<core::CBCDecryption>();
+  auto const tags = Tags(1, 3);
+  store.Add(decryption, tags.data(), 3, Start);
+  BOOST_CHECK_EQUAL(store.GetNumTags(), 3);
+  BOOST_CHECK_EQUAL(store.Take(tags.data() + 32), decryption);
+  BOOST_CHECK(!store.Take(tags.data() + 32));
+  BOOST_CHECK(!store.Take(Tags(4, 1).data()));
+  BOOST_CHECK_EQUAL(store.GetNumTags(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(SharesSessionBetweenTags)
+{
+  auto first = std::make_shared<core::CBCDecryption>();
+  auto second = std::make_shared<core::CBCDecryption>();
+  auto const tags = Tags(1, 4);
+  store.Add(first, tags.data(), 2, Start);
+  store.Add(second, tags.data() + 64, 1, Start);
+  store.Add(first, tags.data() + 96, 1, Start);
+  BOOST_CHECK_EQUAL(store.GetNumSessions(), 2);
+  BOOST_CHECK_EQUAL(first.use_count(), 2);
+  BOOST_CHECK_EQUAL(store.Take(tags.data()), first);
+  BOOST_CHECK_EQUAL(store.Take(tags.data() + 32), first);
+  BOOST_CHECK_EQUAL(store.Take(tags.data() + 96), first);
+  // Released with its last tag
+  BOOST_CHECK_EQUAL(store.GetNumSessions(), 1);
+  BOOST_CHECK_EQUAL(first.use_count(), 1);
+  BOOST_CHECK_EQUAL(store.Take(tags.data() + 64), second);
+  BOOST_CHECK_EQUAL(store.GetNumSessions(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(MovesRepeatedTagToNewSession)
+{
+  auto first = std::make_shared<core::CBCDecryption>();
+  auto second = std::make_shared<core::CBCDecryption>();
+  auto const tags = Tags(1, 1);
+  store.Add(first, tags.data(), 1, Start);
+  store.Add(second, tags.data(), 1, Start);
+  BOOST_CHECK_EQUAL(store.GetNumTags(), 1);
+  BOOST_CHECK_EQUAL(store.GetNumSessions(), 1);
+  BOOST_CHECK_EQUAL(store.Take(tags.data()), second);
+}
+
+BOOST_AUTO_TEST_CASE(ExpiresOldBuckets)
+{
+  auto decryption = std::make_shared<core::CBCDecryption>();
+  auto const old_tags = Tags(1, 10), new_tags = Tags(100, 10);
+  store.Add(decryption, old_tags.data(), 10, Start);
+  store.Add(decryption, new_tags.data(), 10, Start + Lifetime / 2);
+  BOOST_CHECK_EQUAL(store.Expire(Start + Lifetime), 0);
+  BOOST_CHECK_EQUAL(
+      store.Expire(Start + Lifetime + core::SessionTagStore::BucketInterval), 10);
+  BOOST_CHECK(!store.Take(old_tags.data()));
+  BOOST_CHECK_EQUAL(store.Take(new_tags.data()), decryption);
+  // Long idle period, everything left expires at once
+  BOOST_CHECK_EQUAL(store.Expire(Start + 100 * Lifetime), 9);
+  BOOST_CHECK_EQUAL(store.GetNumTags(), 0);
+  BOOST_CHECK_EQUAL(store.GetNumSessions(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(GrowsAndShrinks)
+{
+  auto decryption = std::make_shared<core::CBCDecryption>();
+  const std::size_t num = 20000;
+  auto const tags = Tags(1, num);
+  for (std::size_t i = 0; i < num; i += 100)
+    store.Add(decryption, tags.data() + i * 32, 100, Start);
+  BOOST_CHECK_EQUAL(store.GetNumTags(), num);
+  for (std::size_t i = 0; i < num; i += 2)
+    BOOST_CHECK_EQUAL(store.Take(tags.data() + i * 32), decryption);
+  BOOST_CHECK_EQUAL(store.GetNumTags(), num / 2);
+  for (std::size_t i = 1; i < num; i += 2)
+    BOOST_CHECK_EQUAL(store.Take(tags.data() + i * 32), decryption);
+  BOOST_CHECK_EQUAL(store.GetNumTags(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
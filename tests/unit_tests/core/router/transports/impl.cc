@@ -0,0 +1,91 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <thread>
+
+#include "core/router/transports/impl.h"
+
+namespace core = xi2p::core;
+
+struct DHKeysPairSupplierFixture {
+  DHKeysPairSupplierFixture()
+      : supplier(
+            core::DH_KEYS_PAIRS_MIN_SIZE,
+            core::DH_KEYS_PAIRS_MAX_SIZE,
+            std::chrono::milliseconds(10)) {}
+
+  void CheckBounds() const {
+    BOOST_CHECK_GE(supplier.GetTargetSize(), core::DH_KEYS_PAIRS_MIN_SIZE);
+    BOOST_CHECK_LE(supplier.GetTargetSize(), core::DH_KEYS_PAIRS_MAX_SIZE);
+  }
+
+  /// @brief Acquires from the empty pool until the target stops growing
+  void Storm() {
+    for (int i = 0; i < 8; i++) {
+      BOOST_REQUIRE(supplier.Acquire());
+      CheckBounds();
+    }
+  }
+
+  core::DHKeysPairSupplier supplier;
+};
+
+BOOST_FIXTURE_TEST_SUITE(DHKeysPairSupplierTests, DHKeysPairSupplierFixture)
+
+BOOST_AUTO_TEST_CASE(GrowsToMaxSizeWhenEmpty)
+{
+  BOOST_CHECK_EQUAL(supplier.GetTargetSize(), core::DH_KEYS_PAIRS_MIN_SIZE);
+  // Not started, every acquire finds the pool empty
+  Storm();
+  BOOST_CHECK_EQUAL(supplier.GetTargetSize(), core::DH_KEYS_PAIRS_MAX_SIZE);
+  BOOST_CHECK_EQUAL(supplier.GetNumEmpty(), 8);
+}
+
+BOOST_AUTO_TEST_CASE(ShrinksToMinSizeWhenIdle)
+{
+  Storm();
+  // Generating thread closes the windows while nothing is acquired
+  supplier.Start(1);
+  auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (supplier.GetTargetSize() > core::DH_KEYS_PAIRS_MIN_SIZE
+         && std::chrono::steady_clock::now() < deadline) {
+    CheckBounds();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  supplier.Stop();
+  BOOST_CHECK_EQUAL(supplier.GetTargetSize(), core::DH_KEYS_PAIRS_MIN_SIZE);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
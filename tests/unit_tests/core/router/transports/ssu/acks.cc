@@ -0,0 +1,150 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <array>
+#include <cstdint>
+
+#include "core/router/transports/ssu/acks.h"
+#include "core/router/transports/ssu/packet.h"
+#include "core/util/byte_stream.h"
+
+namespace core = xi2p::core;
+
+BOOST_AUTO_TEST_SUITE(SSUPendingACKsTests)
+
+BOOST_AUTO_TEST_CASE(ExplicitACKs)
+{
+  core::SSUPendingACKs acks;
+  BOOST_CHECK(acks.IsEmpty());
+  BOOST_CHECK_EQUAL(acks.GetSize(), 0);
+  acks.AddMessage(1);
+  acks.AddMessage(0x12345678);
+  acks.AddMessage(1);  // once only
+  BOOST_CHECK_EQUAL(acks.GetSize(), 1 + 2 * 4);
+  std::array<std::uint8_t, 32> buf {};
+  auto payload = buf.data();
+  std::uint8_t flag = 0;
+  acks.Write(payload, buf.size(), flag);
+  BOOST_CHECK_EQUAL(flag, core::SSUFlag::DataExplicitACKsIncluded);
+  BOOST_CHECK_EQUAL(payload - buf.data(), 9);
+  BOOST_CHECK_EQUAL(buf[0], 2);
+  BOOST_CHECK_EQUAL(core::InputByteStream::Read<std::uint32_t>(&buf[1]), 1);
+  BOOST_CHECK_EQUAL(
+      core::InputByteStream::Read<std::uint32_t>(&buf[5]), 0x12345678);
+  BOOST_CHECK(acks.IsEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(BitfieldACKs)
+{
+  core::SSUPendingACKs acks;
+  BOOST_CHECK(acks.AddFragment(7, 0));
+  BOOST_CHECK(acks.AddFragment(7, 8));
+  BOOST_CHECK(acks.AddFragment(9, 2));
+  BOOST_CHECK(!acks.AddFragment(9, core::SSUPendingACKs::MaxBitfieldFragments));
+  BOOST_CHECK_EQUAL(acks.GetSize(), 1 + (4 + 2) + (4 + 1));
+  std::array<std::uint8_t, 32> buf {};
+  auto payload = buf.data();
+  std::uint8_t flag = 0;
+  acks.Write(payload, buf.size(), flag);
+  BOOST_CHECK_EQUAL(flag, core::SSUFlag::DataACKBitfieldsIncluded);
+  BOOST_CHECK_EQUAL(payload - buf.data(), 12);
+  std::array<std::uint8_t, 12> const expected {{
+      2,
+      0, 0, 0, 7, 0x81, 0x02,  // fragments 0 and 8
+      0, 0, 0, 9, 0x04}};  // fragment 2
+  BOOST_CHECK_EQUAL_COLLECTIONS(
+      buf.begin(), buf.begin() + 12, expected.begin(), expected.end());
+  BOOST_CHECK(acks.IsEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(MessageACKSupersedesFragments)
+{
+  core::SSUPendingACKs acks;
+  acks.AddFragment(5, 1);
+  acks.AddFragment(6, 1);
+  acks.AddMessage(5);
+  BOOST_CHECK_EQUAL(acks.GetSize(), (1 + 4) + (1 + 4 + 1));
+  std::array<std::uint8_t, 32> buf {};
+  auto payload = buf.data();
+  std::uint8_t flag = 0;
+  acks.Write(payload, buf.size(), flag);
+  BOOST_CHECK_EQUAL(
+      flag,
+      core::SSUFlag::DataExplicitACKsIncluded
+      | core::SSUFlag::DataACKBitfieldsIncluded);
+  BOOST_CHECK_EQUAL(payload - buf.data(), 11);
+  BOOST_CHECK_EQUAL(core::InputByteStream::Read<std::uint32_t>(&buf[1]), 5);
+  BOOST_CHECK_EQUAL(core::InputByteStream::Read<std::uint32_t>(&buf[6]), 6);
+}
+
+BOOST_AUTO_TEST_CASE(WritesWhatFits)
+{
+  core::SSUPendingACKs acks;
+  for (std::uint32_t i = 0; i < 3; i++)
+    acks.AddMessage(i);
+  acks.AddFragment(10, 0);
+  std::array<std::uint8_t, 32> buf {};
+  auto payload = buf.data();
+  std::uint8_t flag = 0;
+  // Too small for any
+  acks.Write(payload, 4, flag);
+  BOOST_CHECK_EQUAL(flag, 0);
+  BOOST_CHECK(payload == buf.data());
+  // Two explicit ACKs, no room left for the bitfield
+  acks.Write(payload, 1 + 2 * 4 + 3, flag);
+  BOOST_CHECK_EQUAL(flag, core::SSUFlag::DataExplicitACKsIncluded);
+  BOOST_CHECK_EQUAL(payload - buf.data(), 9);
+  BOOST_CHECK_EQUAL(acks.GetSize(), (1 + 4) + (1 + 4 + 1));
+  // The rest
+  payload = buf.data();
+  flag = 0;
+  acks.Write(payload, buf.size(), flag);
+  BOOST_CHECK_EQUAL(payload - buf.data(), 11);
+  BOOST_CHECK(acks.IsEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(MaxACKsPerPacket)
+{
+  core::SSUPendingACKs acks;
+  for (std::uint32_t i = 0; i < 300; i++)
+    acks.AddMessage(i);
+  std::array<std::uint8_t, 2048> buf {};
+  auto payload = buf.data();
+  std::uint8_t flag = 0;
+  acks.Write(payload, buf.size(), flag);
+  BOOST_CHECK_EQUAL(buf[0], core::SSUPendingACKs::MaxACKs);
+  BOOST_CHECK_EQUAL(acks.GetSize(), 1 + 45 * 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,319 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "core/router/transports/ssu/congestion.h"
+
+namespace core = xi2p::core;
+
+namespace {
+
+std::uint64_t Now() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(SSUCongestionControlTests)
+
+BOOST_AUTO_TEST_CASE(SlowStart)
+{
+  core::SSUCongestionControl cc(1000);
+  BOOST_CHECK_EQUAL(cc.GetWindow(), 10000);
+  BOOST_CHECK_EQUAL(cc.GetRTO(), core::SSUCongestionControl::InitialRTO);
+  BOOST_CHECK_EQUAL(cc.GetPacingRate(), 0);
+  BOOST_CHECK(cc.IsSlowStart());
+  for (std::size_t i = 0; i < 10; i++) {
+    BOOST_CHECK(cc.CanSend(1000));
+    cc.OnSent(1000);
+  }
+  BOOST_CHECK(!cc.CanSend(1));
+  cc.OnACKed(1000, 1000, false, 1100);
+  BOOST_CHECK_EQUAL(cc.GetSRTT(), 100);
+  BOOST_CHECK_EQUAL(cc.GetRTO(), 300);  // 100 + 4 * 50
+  // The window doubles over a round trip
+  for (std::size_t i = 1; i < 10; i++)
+    cc.OnACKed(1000, 1000, false, 1100);
+  BOOST_CHECK_EQUAL(cc.GetBytesInFlight(), 0);
+  BOOST_CHECK_EQUAL(cc.GetWindow(), 20000);
+  // Twice the window per RTT
+  BOOST_CHECK_EQUAL(cc.GetPacingRate(), 400000);
+}
+
+BOOST_AUTO_TEST_CASE(LossReducesOncePerRoundTrip)
+{
+  core::SSUCongestionControl cc(1000);
+  for (std::size_t i = 0; i < 20; i++)
+    cc.OnSent(1000);
+  for (std::size_t i = 0; i < 10; i++)
+    cc.OnACKed(1000, 1000, false, 1100);
+  BOOST_CHECK_EQUAL(cc.GetWindow(), 20000);
+  // Losses of fragments sent before the first reduction do not reduce again
+  cc.OnLost(1000, 1050, 1200);
+  BOOST_CHECK_EQUAL(cc.GetWindow(), 10000);
+  BOOST_CHECK(!cc.IsSlowStart());
+  cc.OnLost(1000, 1060, 1210);
+  cc.OnLost(1000, 1200, 1220);
+  BOOST_CHECK_EQUAL(cc.GetWindow(), 10000);
+  BOOST_CHECK_EQUAL(cc.GetBytesInFlight(), 7000);
+  // Nor do ACKs of such fragments grow it
+  cc.OnACKed(1000, 1100, false, 1300);
+  BOOST_CHECK_EQUAL(cc.GetWindow(), 10000);
+  cc.OnLost(1000, 1300, 1400);
+  BOOST_CHECK_EQUAL(cc.GetWindow(), 5000);
+  // Never below the minimum
+  for (std::uint64_t ts = 1500; ts < 2000; ts += 100)
+    cc.OnLost(0, ts, ts + 50);
+  BOOST_CHECK_EQUAL(
+      cc.GetWindow(), core::SSUCongestionControl::MinWindow * 1000);
+}
+
+BOOST_AUTO_TEST_CASE(CongestionAvoidance)
+{
+  core::SSUCongestionControl cc(1000);
+  cc.OnSent(10000);
+  cc.OnLost(1000, 1000, 1100);  // window and threshold of 5000
+  BOOST_CHECK_EQUAL(cc.GetWindow(), 5000);
+  // One packet per window ACKed
+  for (std::size_t i = 0; i < 5; i++)
+    cc.OnACKed(1000, 1200, false, 1300);
+  BOOST_CHECK_EQUAL(cc.GetWindow(), 6000);
+  for (std::size_t i = 0; i < 5; i++)
+    cc.OnACKed(1000, 1300, false, 1400);
+  BOOST_CHECK_EQUAL(cc.GetWindow(), 6000);
+  cc.OnACKed(1000, 1300, false, 1400);
+  BOOST_CHECK_EQUAL(cc.GetWindow(), 7000);
+}
+
+BOOST_AUTO_TEST_CASE(Timeout)
+{
+  core::SSUCongestionControl cc(1000);
+  cc.OnSent(10000);
+  cc.OnTimeout(2000);
+  BOOST_CHECK_EQUAL(cc.GetWindow(), 1000);
+  BOOST_CHECK_EQUAL(cc.GetRTO(), 2000);
+  cc.OnTimeout(4000);
+  cc.OnTimeout(7000);
+  BOOST_CHECK_EQUAL(cc.GetRTO(), core::SSUCongestionControl::MaxRTO);
+  // Fragments declared lost after the timeout do not reduce further
+  cc.OnLost(1000, 1000, 7000);
+  BOOST_CHECK_EQUAL(cc.GetWindow(), 1000);
+  BOOST_CHECK_EQUAL(cc.GetBytesInFlight(), 9000);
+  cc.OnDropped(9000);
+  BOOST_CHECK_EQUAL(cc.GetBytesInFlight(), 0);
+  // Back to slow start
+  BOOST_CHECK(cc.IsSlowStart());
+  cc.OnACKed(1000, 7100, false, 7200);
+  BOOST_CHECK_EQUAL(cc.GetWindow(), 2000);
+}
+
+BOOST_AUTO_TEST_CASE(RTOEstimation)
+{
+  core::SSUCongestionControl cc(1000);
+  for (std::uint64_t ts = 1000; ts < 3000; ts += 100)
+    cc.OnACKed(0, ts, false, ts + 50);
+  BOOST_CHECK_EQUAL(cc.GetSRTT(), 50);
+  BOOST_CHECK_EQUAL(cc.GetRTO(), core::SSUCongestionControl::MinRTO);
+  // Resent fragments give no sample
+  cc.OnACKed(0, 3000, true, 5000);
+  BOOST_CHECK_EQUAL(cc.GetSRTT(), 50);
+  // A longer RTT raises the RTO beyond it
+  for (std::uint64_t ts = 5000; ts < 7000; ts += 100)
+    cc.OnACKed(0, ts, false, ts + 500);
+  BOOST_CHECK_GT(cc.GetSRTT(), 450);
+  BOOST_CHECK_GT(cc.GetRTO(), cc.GetSRTT());
+  BOOST_CHECK_LE(cc.GetRTO(), core::SSUCongestionControl::MaxRTO);
+}
+
+BOOST_AUTO_TEST_CASE(LossDetection)
+{
+  core::SSUCongestionControl cc(1000);
+  // Reordering window of at least MinReorderWindow
+  BOOST_CHECK(!cc.IsLost(1000, 1005));
+  BOOST_CHECK(cc.IsLost(1000, 1006));
+  cc.OnACKed(0, 1000, false, 1100);
+  // Of SRTT / 4 = 25 then
+  BOOST_CHECK(!cc.IsLost(1000, 1025));
+  BOOST_CHECK(cc.IsLost(1000, 1026));
+  BOOST_CHECK(!cc.IsTimedOut(1000, 1299));
+  BOOST_CHECK(cc.IsTimedOut(1000, 1300));
+}
+
+BOOST_AUTO_TEST_CASE(Pacer)
+{
+  core::SSUPacer pacer;
+  // Unpaced
+  for (std::size_t i = 0; i < 100; i++)
+    BOOST_CHECK_EQUAL(pacer.Consume(1000, 1000), 0);
+  // A burst of 4 packets, then 1 packet per millisecond
+  pacer.SetRate(1000000, 1000);
+  for (std::size_t i = 0; i < 4; i++)
+    BOOST_CHECK_EQUAL(pacer.Consume(1000, 1000), 0);
+  BOOST_CHECK_EQUAL(pacer.Consume(1000, 1000), 1);
+  BOOST_CHECK_EQUAL(pacer.Consume(1000, 1001), 0);
+  BOOST_CHECK_EQUAL(pacer.Consume(1000, 1001), 1);
+  // Slower
+  pacer.SetRate(100000, 1000);
+  BOOST_CHECK_EQUAL(pacer.Consume(1000, 1001), 10);
+  BOOST_CHECK_EQUAL(pacer.Consume(1000, 1011), 0);
+  // No more than a burst after idling
+  for (std::size_t i = 0; i < 4; i++)
+    BOOST_CHECK_EQUAL(pacer.Consume(1000, 5000), 0);
+  BOOST_CHECK_GT(pacer.Consume(1000, 5000), 0);
+}
+
+// Sends packets over lossy loopback UDP the way SSUData sends fragments:
+// within the window, paced, resent on RACK-style loss or timeout
+BOOST_AUTO_TEST_CASE(LossyLoopback)
+{
+  using boost::asio::ip::udp;
+  std::size_t const num_packets = 2000, packet_size = 1024;
+  double const loss = 0.05;
+  boost::asio::io_service service;
+  udp::socket sender(service, udp::endpoint(udp::v4(), 0)),
+              receiver(service, udp::endpoint(udp::v4(), 0));
+  udp::endpoint const
+    receiver_endpoint(
+        boost::asio::ip::address_v4::loopback(),
+        receiver.local_endpoint().port()),
+    sender_endpoint(
+        boost::asio::ip::address_v4::loopback(),
+        sender.local_endpoint().port());
+  sender.non_blocking(true);
+  receiver.non_blocking(true);
+  std::mt19937 rng(1);
+  std::bernoulli_distribution drop(loss);
+  core::SSUCongestionControl cc(packet_size);
+  core::SSUPacer pacer;
+  // Of each packet, 0 unless in flight
+  std::vector<std::uint64_t> send_times(num_packets);
+  std::vector<std::size_t> num_sends(num_packets);
+  std::vector<bool> is_acked(num_packets), is_received(num_packets);
+  std::size_t num_acked = 0, num_received = 0, num_lost = 0, next = 0;
+  std::size_t min_window = cc.GetWindow();
+  std::deque<std::uint32_t> lost;
+  std::array<std::uint8_t, packet_size> buf {};
+  boost::system::error_code ec;
+  auto const deadline = Now() + 60000;
+  while (num_acked < num_packets && Now() < deadline) {
+    // Receiver: ACKs what survives the loss
+    std::size_t len;
+    while ((len = receiver.receive(boost::asio::buffer(buf), 0, ec)) && !ec) {
+      std::uint32_t seq;
+      std::memcpy(&seq, buf.data(), sizeof(seq));
+      if (drop(rng))
+        continue;
+      if (!is_received[seq]) {
+        is_received[seq] = true;
+        num_received++;
+      }
+      receiver.send_to(boost::asio::buffer(&seq, sizeof(seq)), sender_endpoint);
+    }
+    // Sender: ACKs, then losses
+    auto ts = Now();
+    std::uint64_t acked_send_time = 0;
+    std::uint32_t seq;
+    while (sender.receive(boost::asio::buffer(&seq, sizeof(seq)), 0, ec) && !ec) {
+      if (is_acked[seq])
+        continue;
+      is_acked[seq] = true;
+      num_acked++;
+      if (send_times[seq]) {
+        bool const is_resent = num_sends[seq] > 1;
+        cc.OnACKed(packet_size, send_times[seq], is_resent, ts);
+        if (!is_resent)
+          acked_send_time = std::max(acked_send_time, send_times[seq]);
+      }
+    }
+    bool is_timed_out = false;
+    for (std::size_t i = 0; i < next; i++)
+      if (!is_acked[i] && send_times[i] && cc.IsTimedOut(send_times[i], ts))
+        is_timed_out = true;
+    if (is_timed_out)
+      cc.OnTimeout(ts);
+    for (std::size_t i = 0; i < next; i++)
+      if (!is_acked[i] && send_times[i]
+          && (is_timed_out || cc.IsLost(send_times[i], acked_send_time))) {
+        cc.OnLost(packet_size, send_times[i], ts);
+        send_times[i] = 0;
+        lost.push_back(i);
+        num_lost++;
+      }
+    min_window = std::min(min_window, cc.GetWindow());
+    // Lost packets first, within the window and paced
+    pacer.SetRate(cc.GetPacingRate(), packet_size);
+    while (!lost.empty() || next < num_packets) {
+      std::uint32_t const seq = lost.empty() ? next : lost.front();
+      if (is_acked[seq]) {
+        lost.pop_front();
+        continue;
+      }
+      if (cc.GetBytesInFlight() && !cc.CanSend(packet_size))
+        break;
+      if (pacer.Consume(packet_size, ts))
+        break;
+      if (lost.empty())
+        next++;
+      else
+        lost.pop_front();
+      std::memcpy(buf.data(), &seq, sizeof(seq));
+      sender.send_to(boost::asio::buffer(buf), receiver_endpoint);
+      send_times[seq] = ts;
+      num_sends[seq]++;
+      cc.OnSent(packet_size);
+      BOOST_REQUIRE_LE(
+          cc.GetBytesInFlight(), std::max(cc.GetWindow(), packet_size));
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  BOOST_CHECK_EQUAL(num_received, num_packets);
+  BOOST_CHECK_EQUAL(num_acked, num_packets);
+  BOOST_CHECK_EQUAL(cc.GetBytesInFlight(), 0);
+  // Losses were resent and reduced the window
+  BOOST_CHECK_GT(num_lost, 0);
+  BOOST_CHECK_LT(min_window, core::SSUCongestionControl::InitialWindow * packet_size);
+  BOOST_CHECK_GT(cc.GetSRTT(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
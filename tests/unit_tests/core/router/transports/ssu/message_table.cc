@@ -0,0 +1,140 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "core/router/transports/ssu/message_table.h"
+
+namespace core = xi2p::core;
+
+BOOST_AUTO_TEST_SUITE(SSUMessageTableTests)
+
+BOOST_AUTO_TEST_CASE(InsertFindErase)
+{
+  core::SSUMessageTable<std::uint32_t> table;
+  BOOST_CHECK(table.IsEmpty());
+  BOOST_CHECK(!table.Find(1));
+  table.Insert(1) = 10;
+  table.Insert(0xFFFFFFFF) = 20;
+  BOOST_CHECK_EQUAL(table.GetSize(), 2);
+  BOOST_REQUIRE(table.Find(1));
+  BOOST_CHECK_EQUAL(*table.Find(1), 10);
+  BOOST_CHECK_EQUAL(*table.Find(0xFFFFFFFF), 20);
+  table.Erase(1);
+  table.Erase(2);  // none
+  BOOST_CHECK(!table.Find(1));
+  BOOST_CHECK_EQUAL(*table.Find(0xFFFFFFFF), 20);
+  BOOST_CHECK_EQUAL(table.GetSize(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(MatchesMap)
+{
+  core::SSUMessageTable<std::uint32_t> table(4);
+  std::map<std::uint32_t, std::uint32_t> expected;
+  std::mt19937 rng(1);
+  // Few distinct IDs, so that probing chains collide and get shifted back
+  std::uniform_int_distribution<std::uint32_t> ids(0, 300);
+  for (std::uint32_t i = 0; i < 100000; i++) {
+    auto const id = ids(rng);
+    if (expected.count(id)) {
+      BOOST_REQUIRE(table.Find(id));
+      BOOST_REQUIRE_EQUAL(*table.Find(id), expected[id]);
+      if (rng() % 2) {
+        table.Erase(id);
+        expected.erase(id);
+      }
+    } else {
+      BOOST_REQUIRE(!table.Find(id));
+      table.Insert(id) = i;
+      expected[id] = i;
+    }
+    BOOST_REQUIRE_EQUAL(table.GetSize(), expected.size());
+  }
+  std::size_t num_messages = 0;
+  table.ForEach([&expected, &num_messages](std::uint32_t id, std::uint32_t& message) {
+    BOOST_CHECK_EQUAL(message, expected.at(id));
+    num_messages++;
+    return true;
+  });
+  BOOST_CHECK_EQUAL(num_messages, expected.size());
+}
+
+BOOST_AUTO_TEST_CASE(OldestFirst)
+{
+  core::SSUMessageTable<std::uint32_t> table(4);
+  for (std::uint32_t i = 0; i < 100; i++)
+    table.Insert(i * 7919) = i;
+  for (std::uint32_t i = 0; i < 100; i += 3)
+    table.Erase(i * 7919);
+  std::vector<std::uint32_t> order;
+  // Erases the odd ones on the way
+  table.ForEach([&order](std::uint32_t, std::uint32_t& message) {
+    order.push_back(message);
+    return message % 2 == 0;
+  });
+  BOOST_CHECK_EQUAL(order.size(), 66);
+  for (std::size_t i = 1; i < order.size(); i++)
+    BOOST_CHECK_LT(order[i - 1], order[i]);
+  BOOST_CHECK_EQUAL(table.GetSize(), 33);
+  BOOST_CHECK(table.Find(2 * 7919));
+  BOOST_CHECK(!table.Find(1 * 7919));
+}
+
+BOOST_AUTO_TEST_CASE(ReusesSlots)
+{
+  core::SSUMessageTable<std::vector<std::uint8_t>> table(4);
+  // A message which stays while many others come and go
+  table.Insert(0xDEADBEEF).assign(100, 1);
+  for (std::uint32_t i = 0; i < 10000; i++) {
+    auto& message = table.Insert(i);
+    if (i >= 4)  // all slots used once
+      BOOST_CHECK_GE(message.capacity(), 1000);
+    message.assign(1000, 2);
+    table.Erase(i);
+  }
+  // Compacted rather than grown
+  BOOST_CHECK_EQUAL(table.GetCapacity(), 4);
+  BOOST_REQUIRE(table.Find(0xDEADBEEF));
+  BOOST_CHECK_EQUAL(table.Find(0xDEADBEEF)->size(), 100);
+  // Grown once more than half full
+  for (std::uint32_t i = 0; i < 4; i++)
+    table.Insert(i);
+  BOOST_CHECK_EQUAL(table.GetCapacity(), 8);
+  BOOST_CHECK_EQUAL(table.GetSize(), 5);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,138 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "core/util/bloom_filter.h"
+
+namespace core = xi2p::core;
+
+namespace {
+
+std::vector<std::uint8_t> Entry(std::uint32_t n) {
+  return {
+      static_cast<std::uint8_t>(n), static_cast<std::uint8_t>(n >> 8),
+      static_cast<std::uint8_t>(n >> 16), static_cast<std::uint8_t>(n >> 24)};
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(RotatingBloomFilterTests)
+
+BOOST_AUTO_TEST_CASE(DetectsDuplicates)
+{
+  core::RotatingBloomFilter filter(1000, 1e-6, 600);
+  for (std::uint32_t i = 0; i < 1000; i++) {
+    auto const entry = Entry(i);
+    BOOST_CHECK(!filter.CheckAndAdd(entry.data(), entry.size(), 100));
+  }
+  BOOST_CHECK_EQUAL(filter.GetSize(), 1000);
+  for (std::uint32_t i = 0; i < 1000; i++) {
+    auto const entry = Entry(i);
+    BOOST_CHECK(filter.Contains(entry.data(), entry.size()));
+    BOOST_CHECK(filter.CheckAndAdd(entry.data(), entry.size(), 100));
+  }
+  BOOST_CHECK_EQUAL(filter.GetSize(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(BoundedFalsePositives)
+{
+  std::size_t const capacity = 100000;
+  core::RotatingBloomFilter filter(capacity, 1e-3, 600);
+  BOOST_CHECK_EQUAL(filter.GetNumHashes(), 11);
+  // Both generations full
+  for (std::uint32_t i = 0; i < 2 * capacity; i++) {
+    auto const entry = Entry(i);
+    filter.CheckAndAdd(entry.data(), entry.size(), 100);
+  }
+  std::size_t false_positives = 0;
+  for (std::uint32_t i = 2 * capacity; i < 3 * capacity; i++) {
+    auto const entry = Entry(i);
+    false_positives += filter.Contains(entry.data(), entry.size());
+  }
+  // 1e-3 expected, with some margin
+  BOOST_CHECK_LT(false_positives, capacity / 500);
+}
+
+BOOST_AUTO_TEST_CASE(ForgetsAfterTwoLifetimes)
+{
+  core::RotatingBloomFilter filter(1000, 1e-6, 60);
+  auto const old_entry = Entry(1), new_entry = Entry(2), other = Entry(3);
+  BOOST_CHECK(!filter.CheckAndAdd(old_entry.data(), old_entry.size(), 100));
+  // Rotated once: still remembered
+  BOOST_CHECK(!filter.CheckAndAdd(new_entry.data(), new_entry.size(), 160));
+  BOOST_CHECK(filter.CheckAndAdd(old_entry.data(), old_entry.size(), 170));
+  // Rotated twice: forgotten
+  BOOST_CHECK(!filter.CheckAndAdd(other.data(), other.size(), 220));
+  BOOST_CHECK(!filter.Contains(old_entry.data(), old_entry.size()));
+  BOOST_CHECK(filter.Contains(new_entry.data(), new_entry.size()));
+}
+
+BOOST_AUTO_TEST_CASE(RotatesAtCapacity)
+{
+  core::RotatingBloomFilter filter(10, 1e-6, 600);
+  for (std::uint32_t i = 0; i < 30; i++) {
+    auto const entry = Entry(i);
+    BOOST_CHECK(!filter.CheckAndAdd(entry.data(), entry.size(), 100));
+  }
+  BOOST_CHECK_EQUAL(filter.GetSize(), 10);
+  // Only the last two generations are remembered
+  auto const first = Entry(0), last = Entry(29);
+  BOOST_CHECK(!filter.Contains(first.data(), first.size()));
+  BOOST_CHECK(filter.Contains(last.data(), last.size()));
+  filter.Clear();
+  BOOST_CHECK(!filter.Contains(last.data(), last.size()));
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentCheckAndAdd)
+{
+  core::RotatingBloomFilter filter(100000, 1e-9, 600);
+  std::vector<std::thread> threads;
+  std::vector<std::size_t> added(4);
+  for (std::size_t t = 0; t < 4; t++)
+    threads.emplace_back([&filter, &added, t] {
+      // Every thread adds the same entries: each is new for exactly one
+      for (std::uint32_t i = 0; i < 10000; i++) {
+        auto const entry = Entry(i);
+        added[t] += !filter.CheckAndAdd(entry.data(), entry.size(), 100);
+      }
+    });
+  for (auto& thread : threads)
+    thread.join();
+  BOOST_CHECK_EQUAL(added[0] + added[1] + added[2] + added[3], 10000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
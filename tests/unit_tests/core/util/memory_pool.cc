@@ -0,0 +1,117 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "core/util/memory_pool.h"
+
+namespace core = xi2p::core;
+
+BOOST_AUTO_TEST_SUITE(MemoryPoolTests)
+
+struct ReuseTag {};
+struct ThreadsTag {};
+struct SharedTag {};
+struct ExitTag {};
+
+BOOST_AUTO_TEST_CASE(ReusesFreedBlocks)
+{
+  typedef core::BlockPool<1024, ReuseTag> Pool;
+  void* block = Pool::Allocate();
+  Pool::Deallocate(block);
+  BOOST_CHECK_EQUAL(Pool::Allocate(), block);
+  Pool::Deallocate(block);
+}
+
+BOOST_AUTO_TEST_CASE(RecyclesAcrossThreads)
+{
+  typedef core::BlockPool<1024, ThreadsTag> Pool;
+  const std::size_t count = 2000;  // fits in the depot
+  // Allocated here, freed by another thread, allocated here again
+  for (std::size_t round = 0; round < 4; round++)
+    {
+      std::vector<void*> blocks;
+      for (std::size_t i = 0; i < count; i++)
+        blocks.push_back(Pool::Allocate());
+      std::thread([&blocks] {
+        for (auto block : blocks)
+          Pool::Deallocate(block);
+      }).join();
+    }
+  // Publish the counters of this thread
+  for (std::size_t i = 0; i < 1024; i++)
+    Pool::Deallocate(Pool::Allocate());
+  auto const stats = core::GetPoolStats<ThreadsTag>();
+  BOOST_CHECK_GT(stats.hits, stats.misses);
+  BOOST_CHECK_GE(stats.misses, count);
+}
+
+BOOST_AUTO_TEST_CASE(AllocateShared)
+{
+  std::vector<std::shared_ptr<std::vector<int>>> objects;
+  for (int i = 0; i < 2048; i++)
+    objects.push_back(std::allocate_shared<std::vector<int>>(
+        core::PoolAllocator<std::vector<int>, SharedTag>(), 1, i));
+  for (int i = 0; i < 2048; i++)
+    BOOST_CHECK_EQUAL(objects[i]->front(), i);
+  objects.clear();
+  for (int i = 0; i < 2048; i++)
+    objects.push_back(std::allocate_shared<std::vector<int>>(
+        core::PoolAllocator<std::vector<int>, SharedTag>(), 1, i));
+  auto const stats = core::GetPoolStats<SharedTag>();
+  BOOST_CHECK_EQUAL(stats.hits + stats.misses, 4096);
+  BOOST_CHECK_GE(stats.hits, 2048);
+}
+
+BOOST_AUTO_TEST_CASE(FreesAfterThreadCacheDestroyed)
+{
+  typedef core::BlockPool<1024, ExitTag> Pool;
+  // Constructed before the cache of its thread, so destroyed after it
+  struct Holder {
+    void* block = nullptr;
+    ~Holder() {
+      Pool::Deallocate(block);
+      Pool::Deallocate(Pool::Allocate());
+    }
+  };
+  std::thread([] {
+    thread_local Holder holder;
+    holder.block = Pool::Allocate();
+  }).join();
+  BOOST_CHECK_EQUAL(core::GetPoolStats<ExitTag>().misses, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,142 @@
+/**                                                                                           //
+ * Copyright (c) 2017-2018, The Xi2p I2P Router Project                                      //
+ *                                                                                            //
+ * All rights reserved.                                                                       //
+ *                                                                                            //
+ * Redistribution and use in source and binary forms, with or without modification, are       //
+ * permitted provided that the following conditions are met:                                  //
+ *                                                                                            //
+ * 1. Redistributions of source code must retain the above copyright notice, this list of     //
+ *    conditions and the following disclaimer.                                                //
+ *                                                                                            //
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list     //
+ *    of conditions and the following disclaimer in the documentation and/or other            //
+ *    materials provided with the distribution.                                               //
+ *                                                                                            //
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be       //
+ *    used to endorse or promote products derived from this software without specific         //
+ *    prior written permission.                                                               //
+ *                                                                                            //
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY        //
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF    //
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL     //
+ * THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       //
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,               //
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS    //
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,          //
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF    //
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.               //
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "core/util/queue.h"
+
+namespace core = xi2p::core;
+
+BOOST_AUTO_TEST_SUITE(QueueTests)
+
+BOOST_AUTO_TEST_CASE(EmptyQueue)
+{
+  core::Queue<std::shared_ptr<int>> queue(4);
+  BOOST_CHECK(queue.IsEmpty());
+  BOOST_CHECK_EQUAL(queue.GetSize(), 0);
+  BOOST_CHECK(!queue.Get());
+  BOOST_CHECK(!queue.Peek());
+  BOOST_CHECK(!queue.GetNextWithTimeout(1));
+  BOOST_CHECK(!queue.Wait(0, 1));
+}
+
+BOOST_AUTO_TEST_CASE(FirstInFirstOut)
+{
+  core::Queue<std::shared_ptr<int>> queue(8);
+  for (int i = 0; i < 5; i++)
+    BOOST_CHECK(queue.Put(std::make_shared<int>(i)));
+  BOOST_CHECK_EQUAL(queue.GetSize(), 5);
+  BOOST_CHECK_EQUAL(*queue.Peek(), 0);
+  for (int i = 0; i < 5; i++)
+    BOOST_CHECK_EQUAL(*queue.Get(), i);
+  BOOST_CHECK(queue.IsEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(Bounded)
+{
+  core::Queue<std::shared_ptr<int>> queue(3);
+  BOOST_CHECK_EQUAL(queue.GetCapacity(), 4);
+  for (int i = 0; i < 4; i++)
+    BOOST_CHECK(queue.Put(std::make_shared<int>(i)));
+  BOOST_CHECK(!queue.Put(std::make_shared<int>(4)));
+  BOOST_CHECK_EQUAL(queue.GetNumDropped(), 1);
+  BOOST_CHECK_EQUAL(*queue.Get(), 0);
+  BOOST_CHECK(queue.Put(std::make_shared<int>(5)));
+  BOOST_CHECK_EQUAL(queue.GetSize(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(Batches)
+{
+  core::Queue<std::shared_ptr<int>> queue(4);
+  std::vector<std::shared_ptr<int>> in;
+  for (int i = 0; i < 6; i++)
+    in.push_back(std::make_shared<int>(i));
+  BOOST_CHECK_EQUAL(queue.PutAll(in), 4);
+  BOOST_CHECK_EQUAL(queue.GetNumDropped(), 2);
+  std::vector<std::shared_ptr<int>> out;
+  BOOST_CHECK_EQUAL(queue.GetAll(out, 3), 3);
+  BOOST_CHECK_EQUAL(queue.GetAll(out), 1);
+  BOOST_CHECK_EQUAL(queue.GetAll(out), 0);
+  BOOST_REQUIRE_EQUAL(out.size(), 4);
+  for (int i = 0; i < 4; i++)
+    BOOST_CHECK_EQUAL(*out[i], i);
+  // Slots release their element once consumed
+  BOOST_CHECK_EQUAL(in[0].use_count(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(WakeUp)
+{
+  core::Queue<std::shared_ptr<int>> queue;
+  std::thread waker([&queue] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue.WakeUp();
+  });
+  BOOST_CHECK(queue.Wait(10, 0));
+  waker.join();
+}
+
+BOOST_AUTO_TEST_CASE(MultipleProducers)
+{
+  const std::size_t producers = 4, count = 20000;
+  core::Queue<std::shared_ptr<std::size_t>> queue(1024);
+  std::vector<std::thread> threads;
+  for (std::size_t p = 0; p < producers; p++)
+    threads.emplace_back([&queue, p, count] {
+      for (std::size_t i = 0; i < count; i++) {
+        auto e = std::make_shared<std::size_t>(p * count + i);
+        while (!queue.Put(e))
+          std::this_thread::yield();
+      }
+    });
+  // Per producer order is preserved
+  std::vector<std::size_t> next(producers, 0);
+  std::vector<std::shared_ptr<std::size_t>> out;
+  std::size_t received = 0;
+  while (received < producers * count) {
+    out.clear();
+    received += queue.GetAllWithTimeout(out, 1000);
+    for (auto const& e : out) {
+      std::size_t const p = *e / count;
+      BOOST_REQUIRE_EQUAL(*e % count, next[p]++);
+    }
+  }
+  for (auto& t : threads)
+    t.join();
+  BOOST_CHECK(queue.IsEmpty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()